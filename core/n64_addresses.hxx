@@ -3,6 +3,9 @@
 #include <cstdint>
 #define addr constexpr uint32_t
 
+// RSP DMEM and IMEM
+addr RSP_MEM_START = 0x0400'0000;
+
 // RSP internal registers
 addr RSP_DMA_SPADDR = 0x0404'0000;
 addr RSP_DMA_RAMADDR = 0x0404'0004;
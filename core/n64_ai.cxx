@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <core/n64_addresses.hxx>
 #include <core/n64_ai.hxx>
+#include <core/n64_mmio.hxx>
 #include <fstream>
 
 namespace hydra::N64
@@ -101,41 +102,44 @@ namespace hydra::N64
         }
     }
 
+    void Ai::MapRegisters(MmioMap& mmio)
+    {
+        mmio.MapRead(AI_AREA_START, AI_AREA_END,
+                     [this](uint32_t addr) { return ReadWord(addr); });
+        mmio.MapWrite(AI_AREA_START, AI_AREA_END,
+                      [this](uint32_t addr, uint32_t data) { WriteWord(addr, data); });
+    }
+
     void Ai::Step()
     {
-        ai_cycles_++;
-        while (ai_cycles_ > ai_period_)
+        if (ai_dma_count_ == 0)
         {
-            ai_cycles_ -= ai_period_;
-            if (ai_dma_count_ == 0)
-            {
-                return;
-            }
-            uint32_t address = ai_dma_addresses_[0];
-            address &= 0x7ff'ffff;
-            uint32_t data = *reinterpret_cast<uint32_t*>(rdram_ptr_ + address);
-            int16_t left = (static_cast<int16_t>(data >> 16));
-            int16_t right = (static_cast<int16_t>(data & 0xffff));
-            ai_buffer_.push_back(left << 8 | left >> 8);
-            ai_buffer_.push_back(right << 8 | right >> 8);
-            if (ai_buffer_.size() > 200000)
-            {
-                Logger::Fatal("AI buffer overflow");
-            }
-            ai_dma_addresses_[0] += 4;
-            ai_dma_lengths_[0] -= 4;
-            if (ai_dma_lengths_[0] == 0)
+            return;
+        }
+        uint32_t address = ai_dma_addresses_[0];
+        address &= 0x7ff'ffff;
+        uint32_t data = *reinterpret_cast<uint32_t*>(rdram_ptr_ + address);
+        int16_t left = (static_cast<int16_t>(data >> 16));
+        int16_t right = (static_cast<int16_t>(data & 0xffff));
+        ai_buffer_.push_back(left << 8 | left >> 8);
+        ai_buffer_.push_back(right << 8 | right >> 8);
+        if (ai_buffer_.size() > 200000)
+        {
+            Logger::Fatal("AI buffer overflow");
+        }
+        ai_dma_addresses_[0] += 4;
+        ai_dma_lengths_[0] -= 4;
+        if (ai_dma_lengths_[0] == 0)
+        {
+            interrupt_callback_(true);
+            ai_dma_count_--;
+            if (ai_dma_count_ > 0)
             {
-                interrupt_callback_(true);
-                ai_dma_count_--;
-                if (ai_dma_count_ > 0)
-                {
-                    ai_dma_addresses_[0] = ai_dma_addresses_[1];
-                    ai_dma_lengths_[0] = ai_dma_lengths_[1];
-                }
-                audio_callback_(ai_buffer_.data(), ai_buffer_.size(), ai_frequency_);
-                ai_buffer_.clear();
+                ai_dma_addresses_[0] = ai_dma_addresses_[1];
+                ai_dma_lengths_[0] = ai_dma_lengths_[1];
             }
+            audio_callback_(ai_buffer_.data(), ai_buffer_.size(), ai_frequency_);
+            ai_buffer_.clear();
         }
     }
 
@@ -14,6 +14,7 @@ namespace hydra::N64
     class RCP;
     class CPU;
     class CPUBus;
+    class MmioMap;
 
     constexpr uint32_t HOST_SAMPLE_RATE = 48000;
 
@@ -24,16 +25,17 @@ namespace hydra::N64
         void InstallBuses(uint8_t* rdram_ptr);
         void SetInterruptCallback(std::function<void(bool)> callback);
         void SetAudioCallback(void(*callback)(const int16_t*, uint32_t, int));
+        // Plays one sample, called by the scheduler every ai_period_ cycles
         void Step();
         uint32_t ReadWord(uint32_t addr);
         void WriteWord(uint32_t addr, uint32_t data);
+        void MapRegisters(MmioMap& mmio);
 
     private:
         uint32_t ai_frequency_ = 0;
         uint32_t ai_period_ = 93750000 / 48000;
         bool ai_enabled_ = false;
         uint8_t ai_dma_count_ = 0;
-        uint32_t ai_cycles_ = 0;
         std::function<void(bool)> interrupt_callback_;
         void(*audio_callback_)(const int16_t*, uint32_t, int);
 
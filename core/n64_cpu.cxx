@@ -1,5 +1,6 @@
 #include <compatibility.hxx>
 #include <core/n64_addresses.hxx>
+#include <algorithm>
 #include <bitset>
 #include <cassert>
 #include <cmath>
@@ -21,8 +22,18 @@ namespace hydra::N64
 
     CPUBus::CPUBus(RCP& rcp) : rcp_(rcp)
     {
-        cart_rom_.resize(0xFC00000);
-        rdram_.resize(0x800000);
+        if (guest_memory_.IsAvailable())
+        {
+            cart_rom_ = {guest_memory_.CartRom(), CART_ROM_SIZE};
+            rdram_ = {guest_memory_.Rdram(), RDRAM_SIZE};
+        }
+        else
+        {
+            cart_rom_storage_.resize(CART_ROM_SIZE);
+            rdram_storage_.resize(RDRAM_SIZE);
+            cart_rom_ = cart_rom_storage_;
+            rdram_ = rdram_storage_;
+        }
         map_direct_addresses();
     }
 
@@ -73,6 +84,14 @@ namespace hydra::N64
     {
         pif_ram_.fill(0);
         time_ = 0;
+        if (rsp_thread_)
+        {
+            rsp_thread_->Finish();
+        }
+        scheduler_.Reset();
+        rsp_synced_time_ = 0;
+        rsp_cycles_ = 0;
+        block_cache_.Clear();
 
         if (cart_rom_.empty())
             return;
@@ -117,6 +136,10 @@ namespace hydra::N64
 
     uint8_t* CPUBus::redirect_paddress(uint32_t paddr)
     {
+        if ((paddr >> 16) == (RSP_MEM_START >> 16)) [[unlikely]]
+        {
+            sync_rsp();
+        }
         uint8_t* ptr = page_table_[paddr >> 16];
         if (ptr) [[likely]]
         {
@@ -140,7 +163,7 @@ namespace hydra::N64
         {
             page_table_[i] = &rdram_[N64_PAGE_SIZE * i];
         }
-        page_table_[ADDR_TO_PAGE(0x04000000)] = &rcp_.rsp_.mem_[0];
+        page_table_[ADDR_TO_PAGE(RSP_MEM_START)] = &rcp_.rsp_.mem_[0];
 
         for (int i = ADDR_TO_PAGE(0x08000000); i <= ADDR_TO_PAGE(0x0FFF'0000); i++)
         {
@@ -156,6 +179,91 @@ namespace hydra::N64
 #undef ADDR_TO_PAGE
     }
 
+    void CPUBus::run_rsp(uint64_t cycles)
+    {
+        // The RSP runs at two thirds of the CPU clock
+        rsp_cycles_ += cycles * 2;
+        rsp_cycles_ -= rcp_.rsp_.RunFor(rsp_cycles_ / 3) * 3;
+        if (rcp_.rsp_.IsIdle())
+        {
+            rsp_cycles_ = 0;
+        }
+    }
+
+    void CPUBus::sync_rsp()
+    {
+        sync_scheduler();
+        uint64_t elapsed = scheduler_.Now() - rsp_synced_time_;
+        rsp_synced_time_ = scheduler_.Now();
+        if (rsp_thread_)
+        {
+            // The rest is run on this thread, the worker is usually idle by now anyway
+            finish_rsp_run();
+        }
+        if (rsp_lags() && elapsed != 0 && !rcp_.rsp_.IsIdle())
+        {
+            run_rsp(elapsed);
+        }
+    }
+
+    void CPUBus::poll_rsp_thread()
+    {
+        sync_scheduler();
+        rsp_cycles_ += (scheduler_.Now() - rsp_synced_time_) * 2;
+        rsp_synced_time_ = scheduler_.Now();
+        if (rsp_thread_->IsBusy())
+        {
+            return;
+        }
+
+        finish_rsp_run();
+        if (!rcp_.rsp_.IsIdle())
+        {
+            rsp_thread_->Start(rsp_cycles_ / 3);
+        }
+    }
+
+    void CPUBus::finish_rsp_run()
+    {
+        rsp_cycles_ -= rsp_thread_->Finish() * 3;
+        rcp_.rsp_.ApplyDeferred();
+        if (rcp_.rsp_.IsIdle())
+        {
+            rsp_cycles_ = 0;
+        }
+    }
+
+    void CPUBus::schedule_rsp()
+    {
+        sync_scheduler();
+        if (!rcp_.rsp_.IsIdle() && !scheduler_.IsPending(TaskType::RspSlice))
+        {
+            scheduler_.Schedule(TaskType::RspSlice, 0);
+        }
+    }
+
+    void CPUBus::sync_scheduler()
+    {
+        if (!in_block_)
+        {
+            return;
+        }
+        // time_ already counts the instruction that is running, the scheduler doesn't until
+        // it's done, same as when instructions are stepped one by one
+        uint64_t time = (time_ - 1) & 0x1FFFFFFFF;
+        uint64_t elapsed = (time - block_synced_time_) & 0x1FFFFFFFF;
+        scheduler_.Advance(elapsed);
+        block_synced_time_ = time;
+        block_synced_cycles_ += elapsed;
+    }
+
+    bool CPUBus::rsp_running()
+    {
+        // The status belongs to the worker until its run is collected, which also applies the
+        // interrupt the run may have ended with
+        return (rsp_thread_ && rsp_thread_->IsPending()) || !rcp_.rsp_.IsIdle();
+    }
+
     template <>
     void CPU::log_cpu_state<false>(bool, uint64_t, uint64_t)
     {
@@ -243,394 +351,315 @@ namespace hydra::N64
         update_interrupt_check();
     }
 
+    uint32_t CPU::read_hwio(uint32_t addr)
+    {
+        return cpubus_.mmio_.Read(addr);
+    }
+
     void CPU::write_hwio(uint32_t addr, uint32_t data)
     {
-        // TODO: remove switch, turn into if chain
-        switch (addr)
-        {
-            case PI_STATUS:
-            {
-                if (data & 0b10)
-                {
-                    set_interrupt(InterruptType::PI, false);
-                }
-                return;
-            }
-            case PI_DRAM_ADDR:
-            {
-                cpubus_.pi_dram_addr_ = data;
-                return;
-            }
-            case PI_CART_ADDR:
-            {
-                cpubus_.pi_cart_addr_ = data;
-                return;
-            }
-            case PI_RD_LEN:
-            {
-                // std::memcpy(&cpubus_.rdram_[hydra::bswap32(cpubus_.pi_cart_addr_)],
-                // cpubus_.redirect_paddress(hydra::bswap32(cpubus_.pi_dram_addr_)), data + 1);
-                Logger::Warn("PI_RD_LEN write");
-                set_interrupt(InterruptType::PI, true);
-                return;
-            }
-            case PI_WR_LEN:
-            {
-                auto cart_addr = cpubus_.pi_cart_addr_ & 0xFFFFFFFE;
-                auto dram_addr = cpubus_.pi_dram_addr_ & 0x007FFFFE;
-                uint64_t length = data + 1;
-                if (cart_addr >= 0x8000000 && cart_addr < 0x10000000)
-                {
-                    Logger::Warn("DMA to SRAM is unimplemented!");
-                    cpubus_.dma_busy_ = false;
-                    set_interrupt(InterruptType::PI, true);
-                    return;
-                }
-                std::memcpy(&cpubus_.rdram_[dram_addr], cpubus_.redirect_paddress(cart_addr),
-                            length);
-                cpubus_.dma_busy_ = true;
-                // uint8_t domain = 0;
-                // if ((cart_addr >= 0x0800'0000 && cart_addr < 0x1000'0000) ||
-                //     (cart_addr >= 0x0500'0000 && cart_addr < 0x0600'0000))
-                // {
-                //     domain = 2;
-                // } else if ((cart_addr >= 0x0600'0000 && cart_addr < 0x0800'0000) ||
-                //            (cart_addr >= 0x1000'0000 && cart_addr < 0x1FC0'0000))
-                // {
-                //     domain = 1;
-                // }
-                // auto cycles = timing_pi_access(domain, length);
-                cpubus_.dma_busy_ = false;
-                set_interrupt(InterruptType::PI, true);
-                Logger::Debug("Raising PI interrupt");
-                return;
-            }
-            case PI_BSD_DOM1_PWD:
-            {
-                cpubus_.pi_bsd_dom1_pwd_ = data & 0xFF;
-                return;
-            }
-            case PI_BSD_DOM2_PWD:
-            {
-                cpubus_.pi_bsd_dom2_lat_ = data & 0xFF;
-                return;
-            }
-            case PI_BSD_DOM1_PGS:
-            {
-                cpubus_.pi_bsd_dom1_pgs_ = data & 0xFF;
-                return;
-            }
-            case PI_BSD_DOM2_PGS:
-            {
-                cpubus_.pi_bsd_dom2_pgs_ = data & 0xFF;
-                return;
-            }
-            case PI_BSD_DOM1_LAT:
-            {
-                cpubus_.pi_bsd_dom1_lat_ = data & 0xFF;
-                return;
-            }
-            case PI_BSD_DOM2_LAT:
-            {
-                cpubus_.pi_bsd_dom2_lat_ = data & 0xFF;
-                return;
-            }
-            case PI_BSD_DOM1_RLS:
-            {
-                cpubus_.pi_bsd_dom1_rls_ = data & 0xFF;
-                return;
-            }
-            case PI_BSD_DOM2_RLS:
+        cpubus_.mmio_.Write(addr, data);
+    }
+
+    void CPU::map_hwio()
+    {
+        MmioMap& mmio = cpubus_.mmio_;
+        mmio.SetUnmapped(
+            [this](uint32_t addr) {
+                Logger::Warn("Unhandled read_hwio from address {:08x} PC: {:08x}", addr, pc_);
+                return 0u;
+            },
+            [](uint32_t addr, uint32_t data) {
+                Logger::Warn("Unhandled write_hwio to address: {:08x} {:08x}", addr, data);
+            });
+
+        // Registers that read back a value as is
+        auto map_value = [&mmio](uint32_t addr, auto& value) {
+            mmio.MapRead(addr, addr + 3, [&value](uint32_t) {
+                return static_cast<uint32_t>(value);
+            });
+        };
+        auto map_read = [&mmio](uint32_t addr, MmioReadHandler handler) {
+            mmio.MapRead(addr, addr + 3, std::move(handler));
+        };
+        auto map_write = [&mmio](uint32_t addr, MmioWriteHandler handler) {
+            mmio.MapWrite(addr, addr + 3, std::move(handler));
+        };
+
+        rcp_.vi_.MapRegisters(mmio);
+        rcp_.ai_.MapRegisters(mmio);
+        // RDP registers, mapped here because the RSP writes them too and has to catch up first
+        // when it lags behind
+        mmio.MapRead(RDP_AREA_START, RDP_AREA_END, [this](uint32_t addr) {
+            cpubus_.sync_rsp();
+            rcp_.rdp_.Sync();
+            return rcp_.rdp_.ReadWord(addr);
+        });
+        mmio.MapWrite(RDP_AREA_START, RDP_AREA_END, [this](uint32_t addr, uint32_t data) {
+            cpubus_.sync_rsp();
+            rcp_.rdp_.WriteWord(addr, data);
+        });
+
+        // MIPS Interface
+        map_value(MI_MODE, cpubus_.mi_mode_);
+        map_read(MI_VERSION, [](uint32_t) { return 0x02020102u; });
+        map_value(MI_INTERRUPT, cpubus_.mi_interrupt_.full);
+        map_value(MI_MASK, cpubus_.mi_mask_);
+        map_write(MI_MODE, [this](uint32_t, uint32_t data) {
+            // TODO: properly implement
+            cpubus_.mi_mode_ = data;
+
+            if ((data >> 11) & 0b1)
             {
-                cpubus_.pi_bsd_dom2_rls_ = data & 0xFF;
-                return;
+                set_interrupt(InterruptType::DP, false);
             }
-            case MI_MODE:
+        });
+        map_write(MI_MASK, [this](uint32_t, uint32_t data) {
+            for (int j = 2, i = 0; i < 6; i++)
             {
-                // TODO: properly implement
-                cpubus_.mi_mode_ = data;
-
-                if ((data >> 11) & 0b1)
+                if (data & j)
                 {
-                    set_interrupt(InterruptType::DP, false);
+                    cpubus_.mi_mask_ |= 1 << i;
                 }
-                return;
+                j <<= 2;
             }
-            case MI_MASK:
+            for (int j = 1, i = 0; i < 6; i++)
             {
-                for (int j = 2, i = 0; i < 6; i++)
+                if (data & j)
                 {
-                    if (data & j)
-                    {
-                        cpubus_.mi_mask_ |= 1 << i;
-                    }
-                    j <<= 2;
+                    cpubus_.mi_mask_ &= ~(1 << i);
                 }
-                for (int j = 1, i = 0; i < 6; i++)
-                {
-                    if (data & j)
-                    {
-                        cpubus_.mi_mask_ &= ~(1 << i);
-                    }
-                    j <<= 2;
-                }
-                update_interrupt_check();
-                return;
-            }
-            case SI_DRAM_ADDR:
-            {
-                cpubus_.si_dram_addr_ = data;
-                return;
-            }
-            case SI_PIF_AD_WR64B:
-            {
-                std::memcpy(cpubus_.pif_ram_.data(),
-                            &cpubus_.rdram_[cpubus_.si_dram_addr_ & 0xff'ffff], 64);
-                pif_command();
-                set_interrupt(InterruptType::SI, true);
-                Logger::Debug("Raising SI interrupt");
-                return;
-            }
-            case SI_PIF_AD_RD64B:
-            {
-                pif_command();
-                std::memcpy(&cpubus_.rdram_[cpubus_.si_dram_addr_ & 0xff'ffff],
-                            cpubus_.pif_ram_.data(), 64);
-                set_interrupt(InterruptType::SI, true);
-                Logger::Debug("Raising SI interrupt");
-                return;
+                j <<= 2;
             }
-            case SI_STATUS:
-            {
-                set_interrupt(InterruptType::SI, false);
+            update_interrupt_check();
+        });
+
+        // Peripheral Interface
+        map_value(PI_DRAM_ADDR, cpubus_.pi_dram_addr_);
+        map_value(PI_CART_ADDR, cpubus_.pi_cart_addr_);
+        map_value(PI_RD_LEN, cpubus_.pi_rd_len_);
+        map_value(PI_WR_LEN, cpubus_.pi_wr_len_);
+        map_read(PI_STATUS, [this](uint32_t) {
+            return cpubus_.dma_busy_ | (cpubus_.io_busy_ << 1) | (cpubus_.dma_error_ << 2) |
+                   (cpubus_.mi_interrupt_.PI << 3);
+        });
+        map_value(PI_BSD_DOM1_LAT, cpubus_.pi_bsd_dom1_lat_);
+        map_value(PI_BSD_DOM1_PWD, cpubus_.pi_bsd_dom1_pwd_);
+        map_value(PI_BSD_DOM1_PGS, cpubus_.pi_bsd_dom1_pgs_);
+        map_value(PI_BSD_DOM1_RLS, cpubus_.pi_bsd_dom1_rls_);
+        map_value(PI_BSD_DOM2_LAT, cpubus_.pi_bsd_dom2_lat_);
+        map_value(PI_BSD_DOM2_PWD, cpubus_.pi_bsd_dom2_pwd_);
+        map_value(PI_BSD_DOM2_PGS, cpubus_.pi_bsd_dom2_pgs_);
+        map_value(PI_BSD_DOM2_RLS, cpubus_.pi_bsd_dom2_rls_);
+        map_write(PI_STATUS, [this](uint32_t, uint32_t data) {
+            if (data & 0b10)
+            {
+                set_interrupt(InterruptType::PI, false);
+            }
+        });
+        map_write(PI_DRAM_ADDR, [this](uint32_t, uint32_t data) { cpubus_.pi_dram_addr_ = data; });
+        map_write(PI_CART_ADDR, [this](uint32_t, uint32_t data) { cpubus_.pi_cart_addr_ = data; });
+        map_write(PI_RD_LEN, [this](uint32_t, uint32_t) {
+            // std::memcpy(&cpubus_.rdram_[hydra::bswap32(cpubus_.pi_cart_addr_)],
+            // cpubus_.redirect_paddress(hydra::bswap32(cpubus_.pi_dram_addr_)), data + 1);
+            Logger::Warn("PI_RD_LEN write");
+            set_interrupt(InterruptType::PI, true);
+        });
+        map_write(PI_WR_LEN, [this](uint32_t, uint32_t data) {
+            auto cart_addr = cpubus_.pi_cart_addr_ & 0xFFFFFFFE;
+            auto dram_addr = cpubus_.pi_dram_addr_ & 0x007FFFFE;
+            uint64_t length = data + 1;
+            if (cart_addr >= 0x8000000 && cart_addr < 0x10000000)
+            {
+                Logger::Warn("DMA to SRAM is unimplemented!");
+                cpubus_.dma_busy_ = false;
+                set_interrupt(InterruptType::PI, true);
                 return;
             }
-        }
-        // Video interface
-        if (addr >= VI_AREA_START && addr <= VI_AREA_END)
-        {
-            rcp_.vi_.WriteWord(addr, data);
-        }
-        // Audio interface
-        else if (addr >= AI_AREA_START && addr <= AI_AREA_END)
-        {
-            rcp_.ai_.WriteWord(addr, data);
-        }
-        else if (addr >= RSP_AREA_START && addr <= RSP_AREA_END)
-        {
-            switch (addr)
-            {
-                case RSP_DMA_SPADDR:
-                    rcp_.rsp_.write_hwio(RSPHWIO::Cache, data);
-                    break;
-                case RSP_DMA_RAMADDR:
-                    rcp_.rsp_.write_hwio(RSPHWIO::DramAddr, data);
-                    break;
-                case RSP_DMA_RDLEN:
-                    rcp_.rsp_.write_hwio(RSPHWIO::RdLen, data);
-                    break;
-                case RSP_DMA_WRLEN:
-                    rcp_.rsp_.write_hwio(RSPHWIO::WrLen, data);
-                    break;
-                case RSP_STATUS:
-                    rcp_.rsp_.write_hwio(RSPHWIO::Status, data);
-                    break;
-                case RSP_SEMAPHORE:
-                    rcp_.rsp_.write_hwio(RSPHWIO::Semaphore, data);
-                    break;
-                case RSP_PC:
-                {
-                    if (!rcp_.rsp_.status_.halt)
-                    {
-                        Logger::Warn("RSP PC write while not halted");
-                    }
-                    rcp_.rsp_.pc_ = data & 0xffc;
-                    rcp_.rsp_.next_pc_ = rcp_.rsp_.pc_ + 4;
-                    return;
-                }
-            }
-        }
-        else if (addr >= RDP_AREA_START && addr <= RDP_AREA_END)
-        {
-            rcp_.rdp_.WriteWord(addr, data);
-        }
-        else if (addr >= PIF_START && addr <= PIF_END)
-        {
+            std::memcpy(&cpubus_.rdram_[dram_addr], cpubus_.redirect_paddress(cart_addr), length);
+            cpubus_.block_cache_.InvalidateWrite(dram_addr, length);
+            cpubus_.dma_busy_ = true;
+            uint8_t domain = 0;
+            if ((cart_addr >= 0x0800'0000 && cart_addr < 0x1000'0000) ||
+                (cart_addr >= 0x0500'0000 && cart_addr < 0x0600'0000))
+            {
+                domain = 2;
+            }
+            else if ((cart_addr >= 0x0600'0000 && cart_addr < 0x0800'0000) ||
+                     (cart_addr >= 0x1000'0000 && cart_addr < 0x1FC0'0000))
+            {
+                domain = 1;
+            }
+            // The data is copied right away, PI_STATUS reports busy and the interrupt is
+            // raised once the transfer would have finished
+            uint32_t cycles = domain == 0 ? 0 : timing_pi_access(domain, length);
+            cpubus_.sync_scheduler();
+            cpubus_.scheduler_.Schedule(TaskType::PiDma, cycles);
+        });
+        map_write(PI_BSD_DOM1_PWD,
+                  [this](uint32_t, uint32_t data) { cpubus_.pi_bsd_dom1_pwd_ = data & 0xFF; });
+        map_write(PI_BSD_DOM2_PWD,
+                  [this](uint32_t, uint32_t data) { cpubus_.pi_bsd_dom2_lat_ = data & 0xFF; });
+        map_write(PI_BSD_DOM1_PGS,
+                  [this](uint32_t, uint32_t data) { cpubus_.pi_bsd_dom1_pgs_ = data & 0xFF; });
+        map_write(PI_BSD_DOM2_PGS,
+                  [this](uint32_t, uint32_t data) { cpubus_.pi_bsd_dom2_pgs_ = data & 0xFF; });
+        map_write(PI_BSD_DOM1_LAT,
+                  [this](uint32_t, uint32_t data) { cpubus_.pi_bsd_dom1_lat_ = data & 0xFF; });
+        map_write(PI_BSD_DOM2_LAT,
+                  [this](uint32_t, uint32_t data) { cpubus_.pi_bsd_dom2_lat_ = data & 0xFF; });
+        map_write(PI_BSD_DOM1_RLS,
+                  [this](uint32_t, uint32_t data) { cpubus_.pi_bsd_dom1_rls_ = data & 0xFF; });
+        map_write(PI_BSD_DOM2_RLS,
+                  [this](uint32_t, uint32_t data) { cpubus_.pi_bsd_dom2_rls_ = data & 0xFF; });
+
+        // RDRAM Interface
+        map_value(RI_MODE, cpubus_.ri_mode_);
+        map_value(RI_CONFIG, cpubus_.ri_config_);
+        map_value(RI_CURRENT_LOAD, cpubus_.ri_current_load_);
+        map_read(RI_SELECT, [](uint32_t) { return 0x14u; }); // TODO: implement
+        map_value(RI_REFRESH, cpubus_.ri_refresh_);
+        map_value(RI_LATENCY, cpubus_.ri_latency_);
+        mmio.MapWrite(RI_AREA_START, RI_AREA_END, [](uint32_t addr, uint32_t data) {
+            Logger::Warn("Write to RI register {:x} with data {:x}", addr, data);
+        });
+
+        // Serial Interface
+        map_value(SI_DRAM_ADDR, cpubus_.si_dram_addr_);
+        map_value(SI_PIF_AD_WR64B, cpubus_.si_pif_ad_wr64b_);
+        map_value(SI_PIF_AD_RD64B, cpubus_.si_pif_ad_rd64b_);
+        map_value(SI_STATUS, cpubus_.si_status_);
+        map_write(SI_DRAM_ADDR, [this](uint32_t, uint32_t data) { cpubus_.si_dram_addr_ = data; });
+        map_write(SI_PIF_AD_WR64B, [this](uint32_t, uint32_t) {
+            std::memcpy(cpubus_.pif_ram_.data(),
+                        &cpubus_.rdram_[cpubus_.si_dram_addr_ & 0xff'ffff], 64);
+            pif_command();
+            cpubus_.si_status_ |= SI_STATUS_DMA_BUSY;
+            cpubus_.sync_scheduler();
+            cpubus_.scheduler_.Schedule(TaskType::SiDma, SI_DMA_CYCLES);
+        });
+        map_write(SI_PIF_AD_RD64B, [this](uint32_t, uint32_t) {
+            pif_command();
+            std::memcpy(&cpubus_.rdram_[cpubus_.si_dram_addr_ & 0xff'ffff],
+                        cpubus_.pif_ram_.data(), 64);
+            cpubus_.block_cache_.InvalidateWrite(cpubus_.si_dram_addr_ & 0xff'ffff, 64);
+            cpubus_.si_status_ |= SI_STATUS_DMA_BUSY;
+            cpubus_.sync_scheduler();
+            cpubus_.scheduler_.Schedule(TaskType::SiDma, SI_DMA_CYCLES);
+        });
+        map_write(SI_STATUS,
+                  [this](uint32_t, uint32_t) { set_interrupt(InterruptType::SI, false); });
+
+        // RSP registers, mapped here because a status write that starts the RSP has to
+        // schedule it. The RSPHWIO values match the register offsets
+        for (uint32_t addr = RSP_DMA_SPADDR; addr <= RSP_SEMAPHORE; addr += 4)
+        {
+            RSPHWIO reg = static_cast<RSPHWIO>((addr - RSP_DMA_SPADDR) >> 2);
+            map_read(addr, [this, reg](uint32_t) {
+                cpubus_.sync_rsp();
+                return rcp_.rsp_.read_hwio(reg);
+            });
+        }
+        map_read(RSP_PC, [this](uint32_t) {
+            cpubus_.sync_rsp();
+            if (!rcp_.rsp_.status_.halt)
+            {
+                Logger::Warn("Reading from RSP_PC while not halted");
+            }
+            return rcp_.rsp_.pc_;
+        });
+        mmio.MapWrite(RSP_AREA_START, RSP_AREA_END, [](uint32_t, uint32_t) {});
+        for (RSPHWIO reg : {RSPHWIO::Cache, RSPHWIO::DramAddr, RSPHWIO::RdLen, RSPHWIO::WrLen,
+                            RSPHWIO::Semaphore})
+        {
+            map_write(RSP_DMA_SPADDR + static_cast<uint32_t>(reg) * 4,
+                      [this, reg](uint32_t, uint32_t data) {
+                          cpubus_.sync_rsp();
+                          rcp_.rsp_.write_hwio(reg, data);
+                          cpubus_.schedule_rsp();
+                      });
+        }
+        map_write(RSP_STATUS, [this](uint32_t, uint32_t data) {
+            cpubus_.sync_rsp();
+            rcp_.rsp_.write_hwio(RSPHWIO::Status, data);
+            cpubus_.schedule_rsp();
+        });
+        map_write(RSP_PC, [this](uint32_t, uint32_t data) {
+            cpubus_.sync_rsp();
+            if (!rcp_.rsp_.status_.halt)
+            {
+                Logger::Warn("RSP PC write while not halted");
+            }
+            rcp_.rsp_.pc_ = data & 0xffc;
+            rcp_.rsp_.next_pc_ = rcp_.rsp_.pc_ + 4;
+        });
+
+        // PIF RAM
+        mmio.MapRead(PIF_START, PIF_END, [this](uint32_t addr) {
+            uint8_t* pif_ram = &cpubus_.pif_ram_[addr - PIF_START];
+            uint32_t data = pif_ram[0] << 24 | pif_ram[1] << 16 | pif_ram[2] << 8 | pif_ram[3];
+            return data;
+        });
+        map_value(PIF_COMMAND, cpubus_.pif_ram_[63]);
+        mmio.MapWrite(PIF_START, PIF_END, [this](uint32_t addr, uint32_t data) {
             uint8_t* pif_ptr = reinterpret_cast<uint8_t*>(&cpubus_.pif_ram_[addr - PIF_START]);
             uint32_t swapped = hydra::bswap32(data);
             memcpy(pif_ptr, &swapped, 4);
             pif_command();
-        }
-        else if (addr == PIF_COMMAND)
-        {
+        });
+        map_write(PIF_COMMAND, [this](uint32_t, uint32_t data) {
             cpubus_.pif_ram_[63] = data;
             pif_command();
-        }
-        else if (addr == ISVIEWER_FLUSH)
-        {
-            std::stringstream ss;
-            for (uint32_t i = 0; i < data; i++)
-            {
-                ss << cpubus_.isviewer_buffer_[i];
-            }
-            std::cout << ss.str();
-        }
-        else if (addr >= ISVIEWER_AREA_START && addr <= ISVIEWER_AREA_END)
-        {
+        });
+
+        // ISViewer
+        mmio.MapRead(ISVIEWER_AREA_START, ISVIEWER_AREA_END, [this](uint32_t addr) {
+            uint8_t* isviewer_ptr =
+                reinterpret_cast<uint8_t*>(&cpubus_.isviewer_buffer_[addr - ISVIEWER_AREA_START]);
+            uint32_t data = isviewer_ptr[0] << 24 | isviewer_ptr[1] << 16 | isviewer_ptr[2] << 8 |
+                            isviewer_ptr[3];
+            return data;
+        });
+        map_read(ISVIEWER_FLUSH, [](uint32_t) {
+            Logger::Fatal("Reading from ISViewer");
+            return 0u;
+        });
+        mmio.MapWrite(ISVIEWER_AREA_START, ISVIEWER_AREA_END, [this](uint32_t addr, uint32_t data) {
             data = hydra::bswap32(data);
             for (int i = 0; i < 4; i++)
             {
                 cpubus_.isviewer_buffer_[addr - ISVIEWER_AREA_START + i] = data >> (i * 8);
             }
-        }
-        else if (addr >= RI_AREA_START && addr <= RI_AREA_END)
-        {
-            Logger::Warn("Write to RI register {:x} with data {:x}", addr, data);
-        }
-        else if (addr >= RDRAM_REGISTERS_START && addr <= RDRAM_REGISTERS_END)
-        {
-            Logger::Warn("Write to RDRAM register {:x} with data {:x}", addr, data);
-        }
-        else if (addr >= RDRAM_BROADCAST_START && addr <= RDRAM_BROADCAST_END)
-        {
-            Logger::Warn("Write to RDRAM broadcast register {:x} with data {:x}", addr, data);
-        }
-        else
-        {
-            Logger::Warn("Unhandled write_hwio to address: {:08x} {:08x}", addr, data);
-        }
-    }
-
-    uint32_t CPU::read_hwio(uint32_t addr)
-    {
-#define redir_case(addr, data) \
-    case addr:                 \
-        return data;
-        switch (addr)
-        {
-            // MIPS Interface
-            redir_case(MI_MODE, cpubus_.mi_mode_);
-            case MI_VERSION:
-            {
-                return 0x02020102;
-            }
-                redir_case(MI_INTERRUPT, cpubus_.mi_interrupt_.full);
-                redir_case(MI_MASK, cpubus_.mi_mask_);
-                // Peripheral Interface
-                redir_case(PI_DRAM_ADDR, cpubus_.pi_dram_addr_);
-                redir_case(PI_CART_ADDR, cpubus_.pi_cart_addr_);
-                redir_case(PI_RD_LEN, cpubus_.pi_rd_len_);
-                redir_case(PI_WR_LEN, cpubus_.pi_wr_len_);
-            case PI_STATUS:
-            {
-                return cpubus_.dma_busy_ | (cpubus_.io_busy_ << 1) | (cpubus_.dma_error_ << 2) |
-                       (cpubus_.mi_interrupt_.PI << 3);
-            }
-                redir_case(PI_BSD_DOM1_LAT, cpubus_.pi_bsd_dom1_lat_);
-                redir_case(PI_BSD_DOM1_PWD, cpubus_.pi_bsd_dom1_pwd_);
-                redir_case(PI_BSD_DOM1_PGS, cpubus_.pi_bsd_dom1_pgs_);
-                redir_case(PI_BSD_DOM1_RLS, cpubus_.pi_bsd_dom1_rls_);
-                redir_case(PI_BSD_DOM2_LAT, cpubus_.pi_bsd_dom2_lat_);
-                redir_case(PI_BSD_DOM2_PWD, cpubus_.pi_bsd_dom2_pwd_);
-                redir_case(PI_BSD_DOM2_PGS, cpubus_.pi_bsd_dom2_pgs_);
-                redir_case(PI_BSD_DOM2_RLS, cpubus_.pi_bsd_dom2_rls_);
-
-                // RDRAM Interface
-                redir_case(RI_MODE, cpubus_.ri_mode_);
-                redir_case(RI_CONFIG, cpubus_.ri_config_);
-                redir_case(RI_CURRENT_LOAD, cpubus_.ri_current_load_);
-                redir_case(RI_SELECT, 0x14); // TODO: implement
-                redir_case(RI_REFRESH, cpubus_.ri_refresh_);
-                redir_case(RI_LATENCY, cpubus_.ri_latency_);
-
-                // Serial Interface
-                redir_case(SI_DRAM_ADDR, cpubus_.si_dram_addr_);
-                redir_case(SI_PIF_AD_WR64B, cpubus_.si_pif_ad_wr64b_);
-                redir_case(SI_PIF_AD_RD64B, cpubus_.si_pif_ad_rd64b_);
-                redir_case(SI_STATUS, cpubus_.si_status_);
-
-            // RSP registers
-            case RSP_DMA_SPADDR:
-                return rcp_.rsp_.read_hwio(RSPHWIO::Cache);
-            case RSP_DMA_RAMADDR:
-                return rcp_.rsp_.read_hwio(RSPHWIO::DramAddr);
-            case RSP_DMA_RDLEN:
-                return rcp_.rsp_.read_hwio(RSPHWIO::RdLen);
-            case RSP_DMA_WRLEN:
-                return rcp_.rsp_.read_hwio(RSPHWIO::WrLen);
-            case RSP_STATUS:
-                return rcp_.rsp_.read_hwio(RSPHWIO::Status);
-            case RSP_DMA_FULL:
-                return rcp_.rsp_.read_hwio(RSPHWIO::Full);
-            case RSP_DMA_BUSY:
-                return rcp_.rsp_.read_hwio(RSPHWIO::Busy);
-            case RSP_SEMAPHORE:
-                return rcp_.rsp_.read_hwio(RSPHWIO::Semaphore);
-                redir_case(PIF_COMMAND, cpubus_.pif_ram_[63]);
-            case RSP_PC:
-            {
-                if (!rcp_.rsp_.status_.halt)
-                {
-                    Logger::Warn("Reading from RSP_PC while not halted");
-                }
-                return rcp_.rsp_.pc_;
-            }
-            case ISVIEWER_FLUSH:
-            {
-                Logger::Fatal("Reading from ISViewer");
-                return 0;
-            }
-            default:
+        });
+        map_write(ISVIEWER_FLUSH, [this](uint32_t, uint32_t data) {
+            std::stringstream ss;
+            for (uint32_t i = 0; i < data; i++)
             {
-                break;
+                ss << cpubus_.isviewer_buffer_[i];
             }
-        }
-#undef redir_case
-        // Video interface
-        if (addr >= VI_AREA_START && addr <= VI_AREA_END)
-        {
-            return rcp_.vi_.ReadWord(addr);
-        }
-        // Audio Interface
-        else if (addr >= AI_AREA_START && addr <= AI_AREA_END)
-        {
-            return rcp_.ai_.ReadWord(addr);
-        }
-        else if (addr >= PIF_START && addr <= PIF_END)
-        {
-            uint8_t* pif_ram = &cpubus_.pif_ram_[addr - PIF_START];
-            uint32_t data = pif_ram[0] << 24 | pif_ram[1] << 16 | pif_ram[2] << 8 | pif_ram[3];
-            return data;
-        }
-        else if (addr >= RDRAM_REGISTERS_START && addr <= RDRAM_REGISTERS_END)
-        {
+            std::cout << ss.str();
+        });
+
+        mmio.MapRead(RDRAM_REGISTERS_START, RDRAM_REGISTERS_END, [](uint32_t) {
             Logger::Warn("Reading from RDRAM registers");
-            return 0;
-        }
-        else if (addr >= ISVIEWER_AREA_START && addr <= ISVIEWER_AREA_END)
-        {
-            uint8_t* isviewer_ptr =
-                reinterpret_cast<uint8_t*>(&cpubus_.isviewer_buffer_[addr - ISVIEWER_AREA_START]);
-            uint32_t data = isviewer_ptr[0] << 24 | isviewer_ptr[1] << 16 | isviewer_ptr[2] << 8 |
-                            isviewer_ptr[3];
-            return data;
-        }
-        else if (addr >= RDP_AREA_START && addr <= RDP_AREA_END)
-        {
-            return rcp_.rdp_.ReadWord(addr);
-        }
-        else if (addr >= N64DD_AREA_START && addr <= N64DD_AREA_END)
-        {
+            return 0u;
+        });
+        mmio.MapWrite(RDRAM_REGISTERS_START, RDRAM_REGISTERS_END, [](uint32_t addr, uint32_t data) {
+            Logger::Warn("Write to RDRAM register {:x} with data {:x}", addr, data);
+        });
+        mmio.MapWrite(RDRAM_BROADCAST_START, RDRAM_BROADCAST_END,
+                      [](uint32_t addr, uint32_t data) {
+                          Logger::Warn("Write to RDRAM broadcast register {:x} with data {:x}",
+                                       addr, data);
+                      });
+        mmio.MapRead(N64DD_AREA_START, N64DD_AREA_END, [](uint32_t) {
             Logger::Warn("Accessing N64DD");
-            return 0;
-        }
-        else if (addr >= SRAM_AREA_START && addr <= SRAM_AREA_END)
-        {
+            return 0u;
+        });
+        mmio.MapRead(SRAM_AREA_START, SRAM_AREA_END, [](uint32_t) {
             Logger::Warn("Accessing SRAM");
-            return 0;
-        }
-        Logger::Warn("Unhandled read_hwio from address {:08x} PC: {:08x}", addr, pc_);
-        return 0;
+            return 0u;
+        });
     }
 
     enum class JoybusCommand : uint8_t
@@ -859,6 +888,19 @@ namespace hydra::N64
             std::bind(&CPU::set_interrupt, this, InterruptType::SP, std::placeholders::_1));
         rcp_.rdp_.SetInterruptCallback(
             std::bind(&CPU::set_interrupt, this, InterruptType::DP, std::placeholders::_1));
+        rcp_.rdp_.SetSyncCallback([this](uint64_t cycles) {
+            if (!cpubus_.scheduler_.IsPending(TaskType::RdpSync))
+            {
+                cpubus_.sync_scheduler();
+                cpubus_.scheduler_.Schedule(TaskType::RdpSync, cycles);
+            }
+        });
+        rcp_.rsp_.SetRdramWriteCallback(std::bind(&BlockCache::InvalidateWrite,
+                                                  &cpubus_.block_cache_, std::placeholders::_1,
+                                                  std::placeholders::_2));
+        fastmem_paddrs_.resize(FASTMEM_PAGE_COUNT, FASTMEM_UNMAPPED);
+        fastmem_pages_.resize(FASTMEM_PAGE_COUNT, nullptr);
+        map_hwio();
     }
 
     void CPU::Reset()
@@ -894,9 +936,67 @@ namespace hydra::N64
             newentry.initialized = false;
             std::swap(entry, newentry);
         }
+        map_fastmem();
         store_word(
             0x8000'0318,
             0x800000); // TODO: probably done by pif somewhere if RI_SELECT is emulated or something
+        schedule_compare();
+    }
+
+    void CPU::schedule_compare()
+    {
+        uint64_t compare = cp0_regs_[CP0_COMPARE].UD << 1;
+        if (compare > 0x1FFFFFFFF)
+        {
+            cpubus_.scheduler_.Cancel(TaskType::Compare);
+            return;
+        }
+        // IP7 is raised by the tick that brings time_ up to compare and that same tick already
+        // checks for interrupts, so the task runs right before it
+        cpubus_.sync_scheduler();
+        uint64_t delay = (compare - cpubus_.time_ - 1) & 0x1FFFFFFFF;
+        cpubus_.scheduler_.Schedule(TaskType::Compare, delay);
+    }
+
+    void CPU::handle_event(TaskType type)
+    {
+        switch (type)
+        {
+            case TaskType::Compare:
+            {
+                CP0Cause.IP7 = true;
+                update_interrupt_check();
+                // Next match is a full wrap of the 33 bit counter away
+                cpubus_.scheduler_.Schedule(TaskType::Compare, 0x2'0000'0000);
+                break;
+            }
+            case TaskType::PiDma:
+            {
+                cpubus_.dma_busy_ = false;
+                set_interrupt(InterruptType::PI, true);
+                Logger::Debug("Raising PI interrupt");
+                break;
+            }
+            case TaskType::SiDma:
+            {
+                cpubus_.si_status_ &= ~SI_STATUS_DMA_BUSY;
+                set_interrupt(InterruptType::SI, true);
+                Logger::Debug("Raising SI interrupt");
+                break;
+            }
+            case TaskType::RdpSync:
+            {
+                // The interrupt changes DPC_STATUS, which a lagging RSP may still be reading
+                cpubus_.sync_rsp();
+                rcp_.rdp_.Sync();
+                break;
+            }
+            default:
+            {
+                Logger::Warn("CPU: Unhandled scheduler task {}", static_cast<int>(type));
+                break;
+            }
+        }
     }
 
     // Shamelessly stolen from dillon
@@ -935,15 +1035,19 @@ namespace hydra::N64
 
     TranslatedAddress CPU::translate_vaddr(uint32_t addr)
     {
-        if (is_kernel_mode()) [[likely]]
+        // The fastmem table only holds the kernel mode mappings
+        if (!is_kernel_mode()) [[unlikely]]
         {
-            return translate_vaddr_kernel(addr);
+            Logger::Fatal("Non kernel mode :(");
+            return {};
         }
-        else
+
+        uint32_t page = fastmem_paddrs_[addr >> FASTMEM_PAGE_SHIFT];
+        if (page != FASTMEM_UNMAPPED) [[likely]]
         {
-            Logger::Fatal("Non kernel mode :(");
+            return {page | (addr & (FASTMEM_PAGE_SIZE - 1)), true, true};
         }
-        return {};
+        return translate_vaddr_kernel(addr);
     }
 
     TranslatedAddress CPU::translate_vaddr_kernel(uint32_t addr)
@@ -958,6 +1062,7 @@ namespace hydra::N64
             TranslatedAddress paddr = probe_tlb(addr);
             if (!paddr.success)
             {
+                Logger::Debug("TLB miss at {:08x}", addr);
                 throw_exception(prev_pc_, ExceptionType::TLBMissLoad);
                 set_cp0_regs_exception(addr);
             }
@@ -978,6 +1083,12 @@ namespace hydra::N64
 
     uint8_t CPU::load_byte(uint64_t vaddr)
     {
+        uint8_t* fast_ptr = fastmem_pointer(vaddr);
+        if (fast_ptr) [[likely]]
+        {
+            return *fast_ptr;
+        }
+
         TranslatedAddress paddr = translate_vaddr(vaddr);
         uint8_t* ptr = cpubus_.redirect_paddress(paddr.paddr);
 
@@ -991,6 +1102,14 @@ namespace hydra::N64
 
     uint16_t CPU::load_halfword(uint64_t vaddr)
     {
+        uint8_t* fast_ptr = fastmem_pointer(vaddr);
+        if (fast_ptr) [[likely]]
+        {
+            uint16_t data;
+            memcpy(&data, fast_ptr, sizeof(uint16_t));
+            return hydra::bswap16(data);
+        }
+
         TranslatedAddress paddr = translate_vaddr(vaddr);
         uint16_t* ptr = reinterpret_cast<uint16_t*>(cpubus_.redirect_paddress(paddr.paddr));
 
@@ -1006,6 +1125,14 @@ namespace hydra::N64
 
     uint32_t CPU::load_word(uint64_t vaddr)
     {
+        uint8_t* fast_ptr = fastmem_pointer(vaddr);
+        if (fast_ptr) [[likely]]
+        {
+            uint32_t data;
+            memcpy(&data, fast_ptr, sizeof(uint32_t));
+            return hydra::bswap32(data);
+        }
+
         TranslatedAddress paddr = translate_vaddr(vaddr);
         uint8_t* ptr = cpubus_.redirect_paddress(paddr.paddr);
         if (!ptr)
@@ -1022,6 +1149,14 @@ namespace hydra::N64
 
     uint64_t CPU::load_doubleword(uint64_t vaddr)
     {
+        uint8_t* fast_ptr = fastmem_pointer(vaddr);
+        if (fast_ptr) [[likely]]
+        {
+            uint64_t data;
+            memcpy(&data, fast_ptr, sizeof(uint64_t));
+            return hydra::bswap64(data);
+        }
+
         TranslatedAddress paddr = translate_vaddr(vaddr);
         uint64_t* ptr = reinterpret_cast<uint64_t*>(cpubus_.redirect_paddress(paddr.paddr));
 
@@ -1035,8 +1170,25 @@ namespace hydra::N64
         return hydra::bswap64(data);
     }
 
+    void CPU::invalidate_write(uint32_t paddr, uint32_t length)
+    {
+        cpubus_.block_cache_.InvalidateWrite(paddr, length);
+        if ((paddr & 0x1FFF'F000) == 0x0400'1000) [[unlikely]]
+        {
+            rcp_.rsp_.InvalidateImem();
+        }
+    }
+
     void CPU::store_byte(uint64_t vaddr, uint8_t data)
     {
+        uint8_t* fast_ptr = fastmem_pointer(vaddr);
+        if (fast_ptr) [[likely]]
+        {
+            *fast_ptr = data;
+            invalidate_write(fastmem_paddr(vaddr), sizeof(uint8_t));
+            return;
+        }
+
         TranslatedAddress paddr = translate_vaddr(vaddr);
         uint8_t* ptr = cpubus_.redirect_paddress(paddr.paddr);
         if (!ptr)
@@ -1045,10 +1197,20 @@ namespace hydra::N64
             return;
         }
         *ptr = data;
+        invalidate_write(paddr.paddr, sizeof(uint8_t));
     }
 
     void CPU::store_halfword(uint64_t vaddr, uint16_t data)
     {
+        uint8_t* fast_ptr = fastmem_pointer(vaddr);
+        if (fast_ptr) [[likely]]
+        {
+            uint16_t swapped = hydra::bswap16(data);
+            memcpy(fast_ptr, &swapped, sizeof(uint16_t));
+            invalidate_write(fastmem_paddr(vaddr), sizeof(uint16_t));
+            return;
+        }
+
         TranslatedAddress paddr = translate_vaddr(vaddr);
         uint16_t* ptr = reinterpret_cast<uint16_t*>(cpubus_.redirect_paddress(paddr.paddr));
         if (!ptr)
@@ -1057,10 +1219,20 @@ namespace hydra::N64
         }
         data = hydra::bswap16(data);
         memcpy(ptr, &data, sizeof(uint16_t));
+        invalidate_write(paddr.paddr, sizeof(uint16_t));
     }
 
     void CPU::store_word(uint64_t vaddr, uint32_t data)
     {
+        uint8_t* fast_ptr = fastmem_pointer(vaddr);
+        if (fast_ptr) [[likely]]
+        {
+            uint32_t swapped = hydra::bswap32(data);
+            memcpy(fast_ptr, &swapped, sizeof(uint32_t));
+            invalidate_write(fastmem_paddr(vaddr), sizeof(uint32_t));
+            return;
+        }
+
         TranslatedAddress paddr = translate_vaddr(vaddr);
         uint32_t* ptr = reinterpret_cast<uint32_t*>(cpubus_.redirect_paddress(paddr.paddr));
         bool isviewer = paddr.paddr <= ISVIEWER_AREA_END && paddr.paddr >= ISVIEWER_FLUSH;
@@ -1072,11 +1244,21 @@ namespace hydra::N64
         {
             data = hydra::bswap32(data);
             memcpy(ptr, &data, sizeof(uint32_t));
+            invalidate_write(paddr.paddr, sizeof(uint32_t));
         }
     }
 
     void CPU::store_doubleword(uint64_t vaddr, uint64_t data)
     {
+        uint8_t* fast_ptr = fastmem_pointer(vaddr);
+        if (fast_ptr) [[likely]]
+        {
+            uint64_t swapped = hydra::bswap64(data);
+            memcpy(fast_ptr, &swapped, sizeof(uint64_t));
+            invalidate_write(fastmem_paddr(vaddr), sizeof(uint64_t));
+            return;
+        }
+
         TranslatedAddress paddr = translate_vaddr(vaddr);
         uint64_t* ptr = reinterpret_cast<uint64_t*>(cpubus_.redirect_paddress(paddr.paddr));
         if (!ptr)
@@ -1085,22 +1267,22 @@ namespace hydra::N64
         }
         data = hydra::bswap64(data);
         memcpy(ptr, &data, sizeof(uint64_t));
+        invalidate_write(paddr.paddr, sizeof(uint64_t));
     }
 
     void CPU::Tick()
     {
         ++cpubus_.time_;
         cpubus_.time_ &= 0x1FFFFFFFF;
-        if (cpubus_.time_ == (cp0_regs_[CP0_COMPARE].UD << 1)) [[unlikely]]
-        {
-            CP0Cause.IP7 = true;
-            update_interrupt_check();
-        }
         gpr_regs_[0].UD = 0;
         prev_branch_ = was_branch_;
         was_branch_ = false;
-        TranslatedAddress paddr = translate_vaddr(pc_);
-        uint8_t* ptr = cpubus_.redirect_paddress(paddr.paddr);
+        uint8_t* ptr = fastmem_pointer(pc_);
+        if (!ptr) [[unlikely]]
+        {
+            TranslatedAddress paddr = translate_vaddr(pc_);
+            ptr = cpubus_.redirect_paddress(paddr.paddr);
+        }
         instruction_.full = hydra::bswap32(*reinterpret_cast<uint32_t*>(ptr));
         if (check_interrupts())
         {
@@ -1113,6 +1295,269 @@ namespace hydra::N64
         execute_instruction();
     }
 
+    uint32_t CPU::TickCached(uint32_t max_instructions)
+    {
+        TranslatedAddress paddr = translate_vaddr(pc_);
+        if (!paddr.success) [[unlikely]]
+        {
+            // A TLB miss exception was thrown, pc_ now points to the exception handler
+            return 0;
+        }
+
+        if (!BlockCache::IsCacheable(paddr.paddr)) [[unlikely]]
+        {
+            Tick();
+            return 1;
+        }
+
+        CachedBlock* block = cpubus_.block_cache_.Lookup(paddr.paddr);
+        if (!block)
+        {
+            block = compile_block(paddr.paddr);
+            if (block->instructions.empty()) [[unlikely]]
+            {
+                Tick();
+                return 1;
+            }
+        }
+
+        uint64_t entry_pc = pc_;
+        uint32_t executed = run_cached_block(block, max_instructions);
+        if (block->idle_loop) [[unlikely]]
+        {
+            executed = skip_idle_loop(*block, entry_pc, executed, max_instructions);
+        }
+        return executed;
+    }
+
+    uint32_t CPU::TickJit(uint32_t max_instructions)
+    {
+        if (!jit_buffer_.IsAvailable()) [[unlikely]]
+        {
+            return TickCached(max_instructions);
+        }
+
+        if (!jit_buffer_.HasSpace(JIT_MAX_BLOCK_SIZE) ||
+            !fault_table_.HasSpace(JIT_MAX_FAULT_SITES)) [[unlikely]]
+        {
+            // Blocks point into the buffer, so both are thrown away together
+            cpubus_.block_cache_.Clear();
+            fault_table_.Clear();
+            jit_buffer_.Reset();
+        }
+
+        TranslatedAddress paddr = translate_vaddr(pc_);
+        if (!paddr.success) [[unlikely]]
+        {
+            return 0;
+        }
+
+        if (!BlockCache::IsCacheable(paddr.paddr)) [[unlikely]]
+        {
+            Tick();
+            return 1;
+        }
+
+        CachedBlock* block = cpubus_.block_cache_.Lookup(paddr.paddr);
+        if (!block)
+        {
+            block = compile_block(paddr.paddr);
+            if (block->instructions.empty()) [[unlikely]]
+            {
+                Tick();
+                return 1;
+            }
+        }
+
+        if (block->jit_vaddr != pc_)
+        {
+            compile_jit_block(*block);
+        }
+
+        // Generated code doesn't check for interrupts after every instruction and doesn't wrap
+        // time_, so it's only entered when neither matters before the block ends. Compare is a
+        // scheduler task and max_instructions never reaches past it. It also can't start in a
+        // delay slot
+        uint64_t end_time = cpubus_.time_ + block->jit_length;
+        uint64_t entry_pc = pc_;
+        uint32_t executed;
+        if (!block->jit_code || block->jit_length > max_instructions ||
+            should_service_interrupt_ || next_pc_ != pc_ + 4 || end_time > 0x1FFFFFFFF) [[unlikely]]
+        {
+            executed = run_cached_block(block, max_instructions);
+        }
+        else
+        {
+            executed = block->jit_code(this);
+        }
+
+        if (block->idle_loop) [[unlikely]]
+        {
+            executed = skip_idle_loop(*block, entry_pc, executed, max_instructions);
+        }
+        return executed;
+    }
+
+    uint32_t CPU::skip_idle_loop(const CachedBlock& block, uint64_t entry_pc, uint32_t executed,
+                                 uint32_t max_instructions)
+    {
+        // Only once a full iteration ran and the loop is about to start over. Every following
+        // iteration would then run the exact same way until a scheduler task is due, so all of
+        // them that fit in the budget are skipped and only time moves forward
+        uint32_t length = block.instructions.size();
+        if (executed != length || pc_ != entry_pc || next_pc_ != pc_ + 4 || !block.valid ||
+            should_service_interrupt_)
+        {
+            return executed;
+        }
+
+        uint32_t skipped = (max_instructions - executed) / length * length;
+        cpubus_.time_ = (cpubus_.time_ + skipped) & 0x1FFFFFFFF;
+        idle_skipped_cycles_ += skipped;
+        return executed + skipped;
+    }
+
+    uint64_t CPU::RunFor(uint64_t cycles)
+    {
+        // Tasks scheduled while running (DMA completion, RSP start) can be due before the
+        // budget runs out, so the scheduler is checked between blocks
+        Scheduler& scheduler = cpubus_.scheduler_;
+        uint64_t consumed = 0;
+        if (!exact_fpu_ && fcr31_.rounding_mode != host_rounding_mode_)
+        {
+            set_host_rounding_mode(fcr31_.rounding_mode);
+        }
+        while (consumed < cycles)
+        {
+            uint64_t until_task = scheduler.CyclesUntilNextTask();
+            if (until_task == 0)
+            {
+                break;
+            }
+
+            uint64_t budget = std::min(cycles - consumed, until_task);
+            uint32_t max_instructions =
+                std::min<uint64_t>(budget, std::numeric_limits<uint32_t>::max());
+            uint32_t executed = 1;
+            cpubus_.in_block_ = true;
+            cpubus_.block_synced_time_ = cpubus_.time_;
+            cpubus_.block_synced_cycles_ = 0;
+            if (use_jit_)
+            {
+                executed = TickJit(max_instructions);
+            }
+            else if (use_block_cache_)
+            {
+                executed = TickCached(max_instructions);
+            }
+            else
+            {
+                Tick();
+            }
+            cpubus_.in_block_ = false;
+            scheduler.Advance(executed - cpubus_.block_synced_cycles_);
+            consumed += executed;
+        }
+        if (host_rounding_mode_ != 0)
+        {
+            set_host_rounding_mode(0);
+        }
+        return consumed;
+    }
+
+    uint32_t CPU::run_cached_block(CachedBlock* block, uint32_t max_instructions)
+    {
+        // Same per instruction steps as Tick, minus the address translation and decoding.
+        // The block is left as soon as control flow doesn't fall through to the next
+        // instruction (taken branch, skipped delay slot, exception) or the block is
+        // invalidated by a store to its own page
+        // Interrupts are only checked on block entry. An instruction that makes one pending
+        // (MTC0, MI mask writes, ...) ends the block, so it is still taken on the next instruction
+        if (should_service_interrupt_) [[unlikely]]
+        {
+            Tick();
+            return 1;
+        }
+
+        uint32_t executed = 0;
+        uint64_t expected_pc = pc_;
+        for (const DecodedInstruction& cached : block->instructions)
+        {
+            if (executed == max_instructions)
+            {
+                break;
+            }
+
+            ++cpubus_.time_;
+            cpubus_.time_ &= 0x1FFFFFFFF;
+            gpr_regs_[0].UD = 0;
+            prev_branch_ = was_branch_;
+            was_branch_ = false;
+            instruction_ = cached.instruction;
+            executed++;
+            log_cpu_state<CPU_LOGGING>(true, 30'000'000, 0);
+            prev_pc_ = pc_;
+            pc_ = next_pc_;
+            next_pc_ += 4;
+            cached.handler(this);
+
+            expected_pc += 4;
+            if (pc_ != expected_pc || !block->valid || should_service_interrupt_) [[unlikely]]
+            {
+                break;
+            }
+        }
+        return executed;
+    }
+
+    DecodedInstruction CPU::decode(Instruction instruction)
+    {
+        return {
+            .handler = handler_table_[static_cast<size_t>(decode_opcode(instruction.full))],
+            .instruction = instruction,
+        };
+    }
+
+    CachedBlock* CPU::compile_block(uint32_t paddr)
+    {
+        CachedBlock& block = cpubus_.block_cache_.Allocate(paddr);
+        uint32_t current = paddr;
+        bool delay_slot = false;
+        while (block.instructions.size() < BLOCK_MAX_INSTRUCTIONS)
+        {
+            uint8_t* ptr = cpubus_.redirect_paddress(current);
+            if (!ptr)
+            {
+                break;
+            }
+
+            uint32_t data;
+            memcpy(&data, ptr, sizeof(uint32_t));
+            Instruction instruction;
+            instruction.full = hydra::bswap32(data);
+            block.instructions.push_back(decode(instruction));
+            current += 4;
+
+            if (delay_slot || (current & (BLOCK_PAGE_SIZE - 1)) == 0 ||
+                !BlockCache::IsCacheable(current))
+            {
+                break;
+            }
+
+            if (is_branch(instruction))
+            {
+                delay_slot = true;
+            }
+            else if (ends_block(instruction))
+            {
+                break;
+            }
+        }
+        block.idle_loop = is_idle_loop(block.instructions);
+        block.valid = true;
+        return &block;
+    }
+
     void CPU::check_vi_interrupt()
     {
         if ((rcp_.vi_.vi_v_current_ & 0x3fe) == rcp_.vi_.vi_v_intr_)
@@ -1168,131 +1613,89 @@ namespace hydra::N64
 
     void CPU::execute_instruction()
     {
-        (instruction_table_[instruction_.IType.op])(this);
+        (handler_table_[static_cast<size_t>(decode_opcode(instruction_.full))])(this);
     }
 
-    void CPU::execute_cp0_instruction()
+    void CPU::c_ERET()
     {
-        uint32_t func = instruction_.RType.rs;
-        if (func & 0b10000)
+        if ((gpr_regs_[CP0_STATUS].UD & 0b10) == 1)
         {
-            // Coprocessor function
-            switch (static_cast<CP0Instruction>(instruction_.RType.func))
-            {
-                case CP0Instruction::ERET:
-                {
-                    if ((gpr_regs_[CP0_STATUS].UD & 0b10) == 1)
-                    {
-                        pc_ = cp0_regs_[CP0_ERROREPC].UD;
-                        CP0Status.ERL = false;
-                    }
-                    else
-                    {
-                        pc_ = cp0_regs_[CP0_EPC].UD;
-                        CP0Status.EXL = false;
-                    }
-                    if (!translate_vaddr(pc_).success)
-                    {
-                        Logger::Fatal("ERET jumped to invalid address {:016X}", pc_);
-                    }
-                    next_pc_ = pc_ + 4;
-                    llbit_ = 0;
-                    update_interrupt_check();
-                    break;
-                }
-                case CP0Instruction::TLBWI:
-                {
-                    uint8_t index = cp0_regs_[CP0_INDEX].UD & 0b11111;
-
-                    TLBEntry entry;
-                    EntryLo el0, el1;
-                    EntryHi eh;
-                    uint16_t mask = (cp0_regs_[CP0_PAGEMASK].UD >> 13) & 0b101010101010;
-                    mask |= mask >> 1;
-                    entry.mask = mask;
-                    el0.full = cp0_regs_[CP0_ENTRYLO0].UD;
-                    el1.full = cp0_regs_[CP0_ENTRYLO1].UD;
-                    eh.full = cp0_regs_[CP0_ENTRYHI].UD;
-                    entry.G = el0.G && el1.G;
-                    entry.entry_even.full = el0.full & 0x3FF'FFFE;
-                    entry.entry_odd.full = el1.full & 0x3FF'FFFE;
-                    eh.VPN2 &= ~entry.mask;
-                    entry.entry_hi.full = eh.full;
-                    entry.initialized = true;
-
-                    tlb_[index] = entry;
-                    break;
-                }
-                case CP0Instruction::TLBP:
-                {
-                    cp0_regs_[CP0_INDEX].UD = 1 << 31;
-                    for (int i = 0; i < 32; i++)
-                    {
-                        const TLBEntry& entry = tlb_[i];
-                        if (!entry.initialized)
-                        {
-                            continue;
-                        }
-                        EntryHi eh;
-                        eh.full = cp0_regs_[CP0_ENTRYHI].UD;
-
-                        if (entry.entry_hi.VPN2 == (eh.VPN2 & ~entry.mask) &&
-                            (entry.G || (eh.ASID == entry.entry_hi.ASID)) &&
-                            (entry.entry_hi.R == eh.R))
-                        {
-                            cp0_regs_[CP0_INDEX].UD = i;
-                            break;
-                        }
-                    }
-                    break;
-                }
-                case CP0Instruction::TLBR:
-                {
-                    uint8_t index = cp0_regs_[CP0_INDEX].UD & 0b11111;
-
-                    TLBEntry entry = tlb_[index];
-                    EntryLo el0, el1;
-                    el0.full = entry.entry_even.full;
-                    el1.full = entry.entry_odd.full;
-                    el0.G = entry.G;
-                    el1.G = entry.G;
-                    cp0_regs_[CP0_ENTRYLO0].UD = el0.full & 0x3FFF'FFFF;
-                    cp0_regs_[CP0_ENTRYLO1].UD = el1.full & 0x3FFF'FFFF;
-                    cp0_regs_[CP0_ENTRYHI].UD = entry.entry_hi.full;
-                    cp0_regs_[CP0_PAGEMASK].UD = entry.mask << 13;
-
-                    break;
-                }
-                case CP0Instruction::TLBWR:
-                {
-                    return Logger::Warn("TLBWR is not implemented");
-                }
-                case CP0Instruction::WAIT:
-                {
-                    return Logger::Warn("WAIT is not implemented");
-                }
-                default:
-                    Logger::Fatal("Invalid CP0 instruction at {:016X}", pc_);
-            }
+            pc_ = cp0_regs_[CP0_ERROREPC].UD;
+            CP0Status.ERL = false;
         }
         else
         {
-            switch (func & 0b1111)
+            pc_ = cp0_regs_[CP0_EPC].UD;
+            CP0Status.EXL = false;
+        }
+        if (!translate_vaddr(pc_).success)
+        {
+            Logger::Fatal("ERET jumped to invalid address {:016X}", pc_);
+        }
+        next_pc_ = pc_ + 4;
+        llbit_ = 0;
+        update_interrupt_check();
+    }
+
+    void CPU::c_TLBWI()
+    {
+        write_tlb_entry(cp0_regs_[CP0_INDEX].UD & 0b11111);
+    }
+
+    void CPU::c_TLBP()
+    {
+        cp0_regs_[CP0_INDEX].UD = 1 << 31;
+        for (int i = 0; i < 32; i++)
+        {
+            const TLBEntry& entry = tlb_[i];
+            if (!entry.initialized)
             {
-                case 0:
-                    return MFC0();
-                case 1:
-                    return DMFC0();
-                case 4:
-                    return MTC0();
-                case 5:
-                    return DMTC0();
-                default:
-                    Logger::Fatal("Invalid CP0 instruction at {:016X}", pc_);
+                continue;
             }
+            EntryHi eh;
+            eh.full = cp0_regs_[CP0_ENTRYHI].UD;
+
+            if (entry.entry_hi.VPN2 == (eh.VPN2 & ~entry.mask) &&
+                (entry.G || (eh.ASID == entry.entry_hi.ASID)) &&
+                (entry.entry_hi.R == eh.R))
+            {
+                cp0_regs_[CP0_INDEX].UD = i;
+                break;
+            }
+        }
+    }
+
+    void CPU::c_TLBR()
+    {
+        uint8_t index = cp0_regs_[CP0_INDEX].UD & 0b11111;
+
+        TLBEntry entry = tlb_[index];
+        EntryLo el0, el1;
+        el0.full = entry.entry_even.full;
+        el1.full = entry.entry_odd.full;
+        el0.G = entry.G;
+        el1.G = entry.G;
+        cp0_regs_[CP0_ENTRYLO0].UD = el0.full & 0x3FFF'FFFF;
+        cp0_regs_[CP0_ENTRYLO1].UD = el1.full & 0x3FFF'FFFF;
+        uint8_t asid = CP0EntryHi.ASID;
+        cp0_regs_[CP0_ENTRYHI].UD = entry.entry_hi.full;
+        cp0_regs_[CP0_PAGEMASK].UD = entry.mask << 13;
+        if (CP0EntryHi.ASID != asid)
+        {
+            map_fastmem_tlb();
         }
     }
 
+    void CPU::c_TLBWR()
+    {
+        write_tlb_entry(get_cp0_register_32(CP0_RANDOM) & 0b11111);
+    }
+
+    void CPU::c_WAIT()
+    {
+        Logger::Warn("WAIT is not implemented");
+    }
+
     void CPU::dump_pif_ram()
     {
         std::stringstream ss;
@@ -1314,9 +1717,31 @@ namespace hydra::N64
         CP0EntryHi.R = (vaddr >> 62) & 0b11;
     }
 
-    bool CPU::is_kernel_mode()
+    std::vector<DisassemblerInstruction> CPU::disassemble(uint64_t start_vaddr,
+                                                          uint64_t end_vaddr, bool register_names)
     {
-        return (CP0Status.KSU == 0b00) || CP0Status.EXL || CP0Status.ERL;
+        std::vector<DisassemblerInstruction> result;
+        for (uint64_t vaddr = start_vaddr & ~3ull; vaddr < end_vaddr; vaddr += 4)
+        {
+            // Goes through the TLB without raising exceptions, the CPU state is left untouched
+            uint32_t address = vaddr;
+            TranslatedAddress paddr = (address >= 0x8000'0000 && address <= 0xBFFF'FFFF)
+                                          ? TranslatedAddress{address & 0x1FFF'FFFF, true, true}
+                                          : probe_tlb(address);
+            uint8_t* ptr = paddr.success ? cpubus_.redirect_paddress(paddr.paddr) : nullptr;
+            if (!ptr)
+            {
+                result.push_back({address, "???"});
+                continue;
+            }
+            uint32_t data;
+            memcpy(&data, ptr, sizeof(uint32_t));
+            Instruction instruction;
+            instruction.full = hydra::bswap32(data);
+            result.push_back(
+                {address, disassemble_instruction(instruction, address, register_names)});
+        }
+        return result;
     }
 
     void CPU::dump_tlb()
@@ -1381,10 +1806,114 @@ namespace hydra::N64
                 };
             }
         }
-        Logger::Warn("TLB miss at {:08x}", vaddr);
         return {};
     }
 
+    void CPU::map_fastmem()
+    {
+        std::fill(fastmem_paddrs_.begin(), fastmem_paddrs_.end(), FASTMEM_UNMAPPED);
+        std::fill(fastmem_pages_.begin(), fastmem_pages_.end(), nullptr);
+
+        // KSEG0 and KSEG1 are both a window to the first 512 MiB of the physical address space
+        for (uint32_t vpage = 0x8000'0000 >> FASTMEM_PAGE_SHIFT;
+             vpage < 0xC000'0000 >> FASTMEM_PAGE_SHIFT; vpage++)
+        {
+            map_fastmem_page(vpage, (vpage << FASTMEM_PAGE_SHIFT) & 0x1FFF'FFFF);
+        }
+        map_fastmem_tlb();
+    }
+
+    void CPU::map_fastmem_page(uint32_t vpage, uint32_t paddr)
+    {
+        fastmem_paddrs_[vpage] = paddr;
+        uint8_t* ptr = paddr == FASTMEM_UNMAPPED ? nullptr : cpubus_.page_table_[paddr >> 16];
+        // A lagging RSP has to catch up before DMEM and IMEM are accessed, which happens on
+        // the slow path
+        if (cpubus_.rsp_lags() && (paddr >> 16) == (RSP_MEM_START >> 16))
+        {
+            ptr = nullptr;
+        }
+        fastmem_pages_[vpage] = ptr ? ptr + (paddr & 0xFFFF) : nullptr;
+    }
+
+    void CPU::SetRspBulk(bool enabled)
+    {
+        cpubus_.sync_rsp();
+        cpubus_.rsp_bulk_ = enabled;
+        map_fastmem();
+    }
+
+    void CPU::SetRspThread(bool enabled)
+    {
+        cpubus_.sync_rsp();
+        if (enabled && !cpubus_.rsp_thread_)
+        {
+            cpubus_.rsp_thread_ = std::make_unique<RspThread>(rcp_.rsp_);
+        }
+        else if (!enabled)
+        {
+            cpubus_.rsp_thread_.reset();
+        }
+        map_fastmem();
+    }
+
+    void CPU::map_fastmem_tlb_entry(const TLBEntry& entry)
+    {
+        // Every page the entry covers is looked up again, as it may be shadowed by another
+        // entry or have been mapped by the entry this one replaced
+        if (!entry.initialized)
+        {
+            return;
+        }
+        uint32_t offset_mask = (entry.mask << 13) | 0x1FFF;
+        uint32_t first = (static_cast<uint32_t>(entry.entry_hi.VPN2) << 13) & ~offset_mask;
+        if (first >= 0x8000'0000)
+        {
+            return;
+        }
+        uint32_t last = std::min(first + offset_mask, 0x7FFF'FFFFu);
+        for (uint32_t vpage = first >> FASTMEM_PAGE_SHIFT; vpage <= last >> FASTMEM_PAGE_SHIFT;
+             vpage++)
+        {
+            TranslatedAddress paddr = probe_tlb(vpage << FASTMEM_PAGE_SHIFT);
+            map_fastmem_page(vpage, paddr.success ? paddr.paddr : FASTMEM_UNMAPPED);
+        }
+    }
+
+    void CPU::map_fastmem_tlb()
+    {
+        // Only pages covered by a TLB entry can be mapped, so this is enough to follow an
+        // ASID change
+        for (const TLBEntry& entry : tlb_)
+        {
+            map_fastmem_tlb_entry(entry);
+        }
+    }
+
+    void CPU::write_tlb_entry(uint8_t index)
+    {
+        TLBEntry entry;
+        EntryLo el0, el1;
+        EntryHi eh;
+        uint16_t mask = (cp0_regs_[CP0_PAGEMASK].UD >> 13) & 0b101010101010;
+        mask |= mask >> 1;
+        entry.mask = mask;
+        el0.full = cp0_regs_[CP0_ENTRYLO0].UD;
+        el1.full = cp0_regs_[CP0_ENTRYLO1].UD;
+        eh.full = cp0_regs_[CP0_ENTRYHI].UD;
+        entry.G = el0.G && el1.G;
+        entry.entry_even.full = el0.full & 0x3FF'FFFE;
+        entry.entry_odd.full = el1.full & 0x3FF'FFFE;
+        eh.VPN2 &= ~entry.mask;
+        entry.entry_hi.full = eh.full;
+        entry.initialized = true;
+
+        TLBEntry old_entry = tlb_[index];
+        tlb_[index] = entry;
+        map_fastmem_tlb_entry(old_entry);
+        map_fastmem_tlb_entry(entry);
+    }
+
     void CPU::dump_rdram()
     {
         printf("rdram:\n");
@@ -2323,124 +2852,68 @@ namespace hydra::N64
         Logger::Fatal("Error instruction at PC: {:08X}, instruction: {}", pc_, instruction_.full);
     }
 
-    void CPU::SPECIAL()
+    void CPU::RDHWR()
+    {
+        throw_exception(prev_pc_, ExceptionType::ReservedInstruction);
+    }
+
+    bool CPU::check_cp1_usable()
+    {
+        // TODO: preserve cause
+        if (!CP0Status.CP1)
+        {
+            throw_exception(prev_pc_, ExceptionType::CoprocessorUnusable, 1);
+            return false;
+        }
+        return true;
+    }
+
+    void CPU::f_BC1F()
     {
-        (special_table_[instruction_.RType.func])(this);
+        int16_t offset = immval << 2;
+        int32_t seoffset = offset;
+        conditional_branch(!fcr31_.compare, pc_ + seoffset);
+        was_branch_ = false;
     }
 
-    void CPU::REGIMM()
+    void CPU::f_BC1T()
     {
-        (regimm_table_[instruction_.RType.rt])(this);
+        int16_t offset = immval << 2;
+        int32_t seoffset = offset;
+        conditional_branch(fcr31_.compare, pc_ + seoffset);
+        was_branch_ = false;
     }
 
-    void CPU::RDHWR()
+    void CPU::f_BC1FL()
     {
-        throw_exception(prev_pc_, ExceptionType::ReservedInstruction);
+        int16_t offset = immval << 2;
+        int32_t seoffset = offset;
+        conditional_branch_likely(!fcr31_.compare, pc_ + seoffset);
+        was_branch_ = false;
     }
 
-    void CPU::COP0()
+    void CPU::f_BC1TL()
     {
-        execute_cp0_instruction();
+        int16_t offset = immval << 2;
+        int32_t seoffset = offset;
+        conditional_branch_likely(fcr31_.compare, pc_ + seoffset);
+        was_branch_ = false;
     }
 
-    void CPU::COP1()
+    void CPU::f_UNIMPLEMENTED()
     {
-        // TODO: another LUT?
-        // TODO: preserve cause
-        if (!CP0Status.CP1)
-        {
-            return throw_exception(prev_pc_, ExceptionType::CoprocessorUnusable, 1);
-        }
-        switch (instruction_.RType.rs)
-        {
-            case 0b00010:
-                f_CFC1();
-                break;
-            case 0b00000:
-                f_MFC1();
-                break;
-            case 0b00001:
-                f_DMFC1();
-                break;
-            case 0b00100:
-                f_MTC1();
-                break;
-            case 0b00101:
-                f_DMTC1();
-                break;
-            case 0b00110:
-                f_CTC1();
-                break;
-            case 0b01000:
-                switch (instruction_.RType.rt)
-                {
-                    case 0:
-                    {
-                        int16_t offset = immval << 2;
-                        int32_t seoffset = offset;
-                        conditional_branch(!fcr31_.compare, pc_ + seoffset);
-                        was_branch_ = false;
-                        break;
-                    }
-                    case 1:
-                    {
-                        int16_t offset = immval << 2;
-                        int32_t seoffset = offset;
-                        conditional_branch(fcr31_.compare, pc_ + seoffset);
-                        was_branch_ = false;
-                        break;
-                    }
-                    case 2:
-                    {
-                        int16_t offset = immval << 2;
-                        int32_t seoffset = offset;
-                        conditional_branch_likely(!fcr31_.compare, pc_ + seoffset);
-                        was_branch_ = false;
-                        break;
-                    }
-                    case 3:
-                    {
-                        int16_t offset = immval << 2;
-                        int32_t seoffset = offset;
-                        conditional_branch_likely(fcr31_.compare, pc_ + seoffset);
-                        was_branch_ = false;
-                        break;
-                    }
-                    default:
-                    {
-                        Logger::Fatal("Unimplemented COP1 BC instruction");
-                    }
-                }
-                break;
-            case 0b00011:
-            case 0b00111:
-            {
-                if (!CP0Status.CP1)
-                {
-                    return throw_exception(prev_pc_, ExceptionType::CoprocessorUnusable, 1);
-                }
-                fcr31_.cause_divbyzero = 0;
-                fcr31_.cause_inexact = 0;
-                fcr31_.cause_invalidop = 0;
-                fcr31_.cause_overflow = 0;
-                fcr31_.cause_underflow = 0;
-                fcr31_.unimplemented = 1;
-                return throw_exception(prev_pc_, ExceptionType::FloatingPoint, 0);
-            }
-            case 0x9:
-            case 0xA:
-            case 0xB:
-            case 0xC:
-            case 0xD:
-            case 0xE:
-            case 0xF:
-                return throw_exception(prev_pc_, ExceptionType::ReservedInstruction);
-            default:
-            {
-                (float_table_[instruction_.RType.func])(this);
-                break;
-            }
-        }
+        fcr31_.cause_divbyzero = 0;
+        fcr31_.cause_inexact = 0;
+        fcr31_.cause_invalidop = 0;
+        fcr31_.cause_overflow = 0;
+        fcr31_.cause_underflow = 0;
+        fcr31_.unimplemented = 1;
+        throw_exception(prev_pc_, ExceptionType::FloatingPoint, 0);
+    }
+
+    void CPU::f_RESERVED()
+    {
+        throw_exception(prev_pc_, ExceptionType::ReservedInstruction);
     }
 
     void CPU::MFC2()
@@ -2495,33 +2968,15 @@ namespace hydra::N64
         }
     }
 
-    void CPU::COP2()
+    void CPU::COP2_RESERVED()
     {
-        switch (instruction_.RType.rs)
+        if (!CP0Status.CP2)
         {
-            case 0:
-                return MFC2();
-            case 1:
-                return DMFC2();
-            case 2:
-                return CFC2();
-            case 4:
-                return MTC2();
-            case 5:
-                return DMTC2();
-            case 6:
-                return CTC2();
-            default:
-            {
-                if (!CP0Status.CP2)
-                {
-                    throw_exception(prev_pc_, ExceptionType::CoprocessorUnusable, 2);
-                }
-                else
-                {
-                    throw_exception(prev_pc_, ExceptionType::ReservedInstruction, 2);
-                }
-            }
+            throw_exception(prev_pc_, ExceptionType::CoprocessorUnusable, 2);
+        }
+        else
+        {
+            throw_exception(prev_pc_, ExceptionType::ReservedInstruction, 2);
         }
     }
 
@@ -2746,11 +3201,16 @@ namespace hydra::N64
             {
                 CP0Cause.IP7 = false;
                 cp0_regs_[reg].UD = value;
+                schedule_compare();
                 break;
             }
             case CP0_COUNT:
             {
+                // The scheduler clock carries on from where the old count was
+                cpubus_.sync_scheduler();
                 cpubus_.time_ = value << 1;
+                cpubus_.block_synced_time_ = (cpubus_.time_ - 1) & 0x1FFFFFFFF;
+                schedule_compare();
                 break;
             }
             case CP0_CONFIG:
@@ -2772,7 +3232,12 @@ namespace hydra::N64
             }
             case CP0_ENTRYHI:
             {
+                uint8_t asid = CP0EntryHi.ASID;
                 CP0EntryHi.full = value & 0xC00000FFFFFFE0FF;
+                if (CP0EntryHi.ASID != asid)
+                {
+                    map_fastmem_tlb();
+                }
                 break;
             }
             case CP0_STATUS:
@@ -2824,7 +3289,12 @@ namespace hydra::N64
             }
             case CP0_ENTRYHI:
             {
+                uint8_t asid = CP0EntryHi.ASID;
                 cp0_regs_[reg].UD = value & 0xC00000FFFFFFE0FF;
+                if (CP0EntryHi.ASID != asid)
+                {
+                    map_fastmem_tlb();
+                }
                 break;
             }
             case CP0_XCONTEXT:
@@ -3206,6 +3676,10 @@ namespace hydra::N64
             case 31:
             {
                 fcr31_.full = rtreg.UW._0 & 0x183ffff;
+                if (!exact_fpu_ && fcr31_.rounding_mode != host_rounding_mode_)
+                {
+                    set_host_rounding_mode(fcr31_.rounding_mode);
+                }
                 check_fpu_exception();
                 break;
             }
@@ -3368,7 +3842,94 @@ namespace hydra::N64
         }
     }
 
-    template <class Type, class OperatorFunction, class CastFunction>
+    void CPU::set_host_rounding_mode(uint32_t mode)
+    {
+        switch (mode)
+        {
+            case 0:
+            {
+                std::fesetround(FE_TONEAREST);
+                break;
+            }
+            case 1:
+            {
+                std::fesetround(FE_TOWARDZERO);
+                break;
+            }
+            case 2:
+            {
+                std::fesetround(FE_UPWARD);
+                break;
+            }
+            case 3:
+            {
+                std::fesetround(FE_DOWNWARD);
+                break;
+            }
+        }
+        host_rounding_mode_ = mode;
+    }
+
+    // Works out the host exception flags an operation would have raised from its operands and
+    // result, except for inexact. The operands are never NaN or subnormal here, check_fpu_arg
+    // has already dealt with those
+    template <class Type, class OperatorFunction>
+    int CPU::fast_fpu_exceptions(Type fs, Type ft, Type result)
+    {
+        constexpr bool unary = std::is_invocable<OperatorFunction, Type>();
+        constexpr bool multiply = std::is_same_v<OperatorFunction, std::multiplies<>>;
+        constexpr bool divide = std::is_same_v<OperatorFunction, std::divides<>>;
+        switch (std::fpclassify(result))
+        {
+            case FP_NORMAL:
+            {
+                // Directed rounding turns an overflow into the largest finite value, redo the
+                // operation with more range to tell them apart
+                if constexpr (!unary)
+                {
+                    constexpr Type max = std::numeric_limits<Type>::max();
+                    if (std::abs(result) == max)
+                    {
+                        long double wide = std::invoke(OperatorFunction(),
+                                                       static_cast<long double>(fs),
+                                                       static_cast<long double>(ft));
+                        return std::abs(wide) > max ? FE_OVERFLOW | FE_INEXACT : 0;
+                    }
+                }
+                return 0;
+            }
+            case FP_NAN:
+            {
+                return FE_INVALID;
+            }
+            case FP_INFINITE:
+            {
+                if (std::isinf(fs) || (!unary && std::isinf(ft)))
+                {
+                    return 0;
+                }
+                if (divide && ft == 0)
+                {
+                    return FE_DIVBYZERO;
+                }
+                return FE_OVERFLOW | FE_INEXACT;
+            }
+            case FP_SUBNORMAL:
+            {
+                return FE_UNDERFLOW | FE_INEXACT;
+            }
+            case FP_ZERO:
+            {
+                // Only a product or quotient of non zero values can round down to zero
+                bool underflow = (multiply && fs != 0 && ft != 0) ||
+                                 (divide && fs != 0 && !std::isinf(ft));
+                return underflow ? FE_UNDERFLOW | FE_INEXACT : 0;
+            }
+        }
+        return 0;
+    }
+
+    template <class Type, bool Fast, class OperatorFunction, class CastFunction>
     void CPU::fpu_operate_impl(OperatorFunction op, CastFunction cast)
     {
         bool _64bit = CP0Status.FR;
@@ -3395,42 +3956,60 @@ namespace hydra::N64
                 return;
             }
         }
-        int round_mode = std::fegetround();
-        switch (fcr31_.rounding_mode)
+        Type result{};
+        int exception;
+        if constexpr (Fast)
         {
-            case 0:
+            // The host rounding mode already matches fcr31_
+            if constexpr (std::is_invocable<decltype(op), Type>())
             {
-                std::fesetround(FE_TONEAREST);
-                break;
+                result = std::invoke(op, fs);
             }
-            case 1:
+            else
             {
-                std::fesetround(FE_TOWARDZERO);
-                break;
+                result = std::invoke(op, fs, ft);
             }
-            case 2:
+            exception = fast_fpu_exceptions<Type, OperatorFunction>(fs, ft, result);
+        }
+        else
+        {
+            int round_mode = std::fegetround();
+            switch (fcr31_.rounding_mode)
             {
-                std::fesetround(FE_UPWARD);
-                break;
+                case 0:
+                {
+                    std::fesetround(FE_TONEAREST);
+                    break;
+                }
+                case 1:
+                {
+                    std::fesetround(FE_TOWARDZERO);
+                    break;
+                }
+                case 2:
+                {
+                    std::fesetround(FE_UPWARD);
+                    break;
+                }
+                case 3:
+                {
+                    std::fesetround(FE_DOWNWARD);
+                    break;
+                }
             }
-            case 3:
+            std::feclearexcept(FE_ALL_EXCEPT);
+            // if takes 1 parameter
+            if constexpr (std::is_invocable<decltype(op), Type>())
             {
-                std::fesetround(FE_DOWNWARD);
-                break;
+                result = std::invoke(op, fs);
             }
+            else
+            {
+                result = std::invoke(op, fs, ft);
+            }
+            exception = fetestexcept(FE_ALL_EXCEPT);
+            std::fesetround(round_mode);
         }
-        std::feclearexcept(FE_ALL_EXCEPT);
-        Type result{};
-        // if takes 1 parameter
-        if constexpr (std::is_invocable<decltype(op), Type>())
-        {
-            result = std::invoke(op, fs);
-        }
-        else
-        {
-            result = std::invoke(op, fs, ft);
-        }
-        int exception = fetestexcept(FE_ALL_EXCEPT);
         if (exception & FE_UNDERFLOW)
         {
             if (!fcr31_.flush_subnormals || fcr31_.enable_underflow || fcr31_.enable_inexact)
@@ -3476,7 +4055,6 @@ namespace hydra::N64
                 fcr31_.flag_invalidop = 1;
             }
         }
-        std::fesetround(round_mode);
         check_fpu_result(result);
         if (check_fpu_exception())
         {
@@ -3493,16 +4071,34 @@ namespace hydra::N64
         fcr31_.cause_overflow = false;
         fcr31_.cause_divbyzero = false;
         fcr31_.cause_invalidop = false;
+        // The fast path doesn't report inexact results, so it's only taken while no FPU
+        // exceptions are enabled
+        constexpr uint32_t FCR31_ENABLE_MASK = 0b11111 << 7;
+        bool fast = !exact_fpu_ && (fcr31_.full & FCR31_ENABLE_MASK) == 0;
         switch (fmtval)
         {
             case FMT_S:
             {
-                fpu_operate_impl<float>(op, cast);
+                if (fast)
+                {
+                    fpu_operate_impl<float, true>(op, cast);
+                }
+                else
+                {
+                    fpu_operate_impl<float, false>(op, cast);
+                }
                 break;
             }
             case FMT_D:
             {
-                fpu_operate_impl<double>(op, cast);
+                if (fast)
+                {
+                    fpu_operate_impl<double, true>(op, cast);
+                }
+                else
+                {
+                    fpu_operate_impl<double, false>(op, cast);
+                }
                 break;
             }
         }
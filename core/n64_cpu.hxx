@@ -10,18 +10,36 @@
 #include <core/n64_log.hxx>
 #include <concepts>
 #include <core/n64_addresses.hxx>
+#include <core/n64_cpu_cache.hxx>
+#include <core/n64_cpu_decode.hxx>
+#include <core/n64_cpu_jit.hxx>
+#include <core/n64_fastmem.hxx>
+#include <core/n64_mmio.hxx>
 #include <core/n64_rcp.hxx>
+#include <core/n64_rsp_thread.hxx>
+#include <core/n64_scheduler.hxx>
 #include <core/n64_types.hxx>
 #include <cstdint>
 #include <limits>
 #include <memory>
 #include <queue>
+#include <span>
 #include <vector>
 
 #define KB(x) (static_cast<size_t>(x << 10))
 #define check_bit(x, y) ((x) & (1u << y))
 
 constexpr auto INSTRS_PER_SECOND = 93'750'000;
+// Same as mupen64plus, the PIF doesn't have a meaningful transfer rate
+constexpr uint32_t SI_DMA_CYCLES = 0x900;
+constexpr uint32_t SI_STATUS_DMA_BUSY = 1 << 0;
+constexpr size_t RDRAM_SIZE = 0x80'0000;
+constexpr size_t CART_ROM_SIZE = 0xFC0'0000;
+constexpr uint32_t FASTMEM_PAGE_SHIFT = 12;
+constexpr uint32_t FASTMEM_PAGE_SIZE = 1 << FASTMEM_PAGE_SHIFT;
+constexpr uint32_t FASTMEM_PAGE_COUNT = 1 << (32 - FASTMEM_PAGE_SHIFT);
+// Physical address of a virtual page that has to go through translate_vaddr
+constexpr uint32_t FASTMEM_UNMAPPED = ~0u;
 constexpr uint32_t KSEG0_START = 0x8000'0000;
 constexpr uint32_t KSEG0_END = 0x9FFF'FFFF;
 constexpr uint32_t KSEG1_START = 0xA000'0000;
@@ -166,6 +184,7 @@ namespace hydra
     {
         class N64;
         class QA;
+        class CPURecompiler;
     } // namespace N64
 } // namespace hydra
 
@@ -177,16 +196,6 @@ namespace hydra::N64
         Mouse = 0x0200,
     };
 
-    enum class CP0Instruction
-    {
-        TLBWI = 2,
-        TLBP = 8,
-        TLBR = 1,
-        ERET = 24,
-        WAIT = 17,
-        TLBWR = 6,
-    };
-
     // Bit hack to get signum of number (-1, 0 or 1)
     template <typename T>
     int sgn(T val)
@@ -233,16 +242,41 @@ namespace hydra::N64
     private:
         inline uint8_t* redirect_paddress(uint32_t paddr);
         void map_direct_addresses();
+        // Runs the RSP for the given number of CPU cycles
+        void run_rsp(uint64_t cycles);
+        // In bulk mode, runs the RSP up to the current time before the CPU observes it. With
+        // the worker thread, waits for it first
+        void sync_rsp();
+        // Hands the worker what the RSP owes if it's idle, called on the RSP's slices
+        void poll_rsp_thread();
+        // Collects the worker's run and applies what it left for the CPU thread
+        void finish_rsp_run();
+        // Called after the CPU started the RSP or one of its DMAs
+        void schedule_rsp();
+        void sync_scheduler();
+        bool rsp_running();
+
+        // The RSP may be behind the CPU
+        bool rsp_lags() const
+        {
+            return rsp_bulk_ || rsp_thread_;
+        }
 
         static std::vector<uint8_t> ipl_;
-        std::vector<uint8_t> cart_rom_;
+        // RDRAM and ROM live in guest_memory_ when it's available, and in the storage
+        // vectors otherwise
+        GuestAddressSpace guest_memory_{RDRAM_SIZE, CART_ROM_SIZE};
+        std::vector<uint8_t> cart_rom_storage_;
+        std::vector<uint8_t> rdram_storage_;
+        std::span<uint8_t> cart_rom_;
         bool rom_loaded_ = false;
         bool ipl_loaded_ = false;
-        std::vector<uint8_t> rdram_{};
+        std::span<uint8_t> rdram_;
         std::vector<uint8_t> sram_{};
         std::array<char, ISVIEWER_AREA_END - ISVIEWER_AREA_START> isviewer_buffer_{};
         std::array<uint8_t, 64> pif_ram_{};
         std::array<uint8_t*, 0x10000> page_table_{};
+        MmioMap mmio_;
 
         // MIPS Interface
         uint32_t mi_mode_ = 0;
@@ -284,9 +318,29 @@ namespace hydra::N64
 
         uint64_t time_ = 0;
 
+        Scheduler scheduler_;
+        // RunFor only advances the scheduler once a block ends, so anything that schedules or
+        // reads its clock from inside one brings it up to time_ first with sync_scheduler
+        bool in_block_ = false;
+        // time_ the scheduler clock was last brought up to, and by how much in this block
+        uint64_t block_synced_time_ = 0;
+        uint64_t block_synced_cycles_ = 0;
+        BlockCache block_cache_;
+
+        // In bulk mode the RSP lags behind the CPU and runs the cycles it owes in one go, either
+        // on its (long) scheduler slice or when the CPU accesses its registers or memory
+        bool rsp_bulk_ = false;
+        // Scheduler time the RSP has been run up to
+        uint64_t rsp_synced_time_ = 0;
+        // RSP cycles owed, times three
+        uint64_t rsp_cycles_ = 0;
+        // Set while the RSP runs on a worker thread, which also implies bulk execution
+        std::unique_ptr<RspThread> rsp_thread_;
+
         RCP& rcp_;
         friend class CPU;
         friend class hydra::N64::N64;
+        friend class hydra::N64::CPURecompiler;
     };
 
     template <auto MemberFunc>
@@ -298,6 +352,15 @@ namespace hydra::N64
         (cpu->*MemberFunc)();
     }
 
+    template <auto CheckFunc, auto MemberFunc>
+    static void checked_lut_wrapper(CPU* cpu)
+    {
+        if ((cpu->*CheckFunc)())
+        {
+            (cpu->*MemberFunc)();
+        }
+    }
+
     enum class InterruptType
     {
         VI,
@@ -313,7 +376,12 @@ namespace hydra::N64
     public:
         CPU(CPUBus& cpubus, RCP& rcp);
         void Tick();
+        // Runs until the cycle budget is spent or a scheduler task is due, returns the cycles
+        // consumed. The scheduler clock is advanced by the same amount
+        uint64_t RunFor(uint64_t cycles);
         void Reset();
+        void SetRspBulk(bool enabled);
+        void SetRspThread(bool enabled);
 
     private:
         using PipelineStageRet = void;
@@ -352,18 +420,63 @@ namespace hydra::N64
         int32_t mouse_delta_x_, mouse_delta_y_;
         std::chrono::time_point<std::chrono::high_resolution_clock> last_second_time_;
         bool should_service_interrupt_ = false;
+        bool use_block_cache_ = false;
+        bool use_jit_ = false;
+        bool exact_fpu_ = false;
+        // fcr31_ rounding mode the host is set to. The fast FPU path needs the two to match,
+        // so the host follows fcr31_ while RunFor is executing and is round to nearest
+        // everywhere else
+        uint32_t host_rounding_mode_ = 0;
+        // Cycles fast forwarded through idle loops instead of being executed
+        uint64_t idle_skipped_cycles_ = 0;
+        X64CodeBuffer jit_buffer_{32 * 1024 * 1024};
+        FaultTable fault_table_{jit_buffer_.Begin(), jit_buffer_.End()};
+        // Physical address and host pointer of every 4 KiB page of the 32-bit virtual address
+        // space, kept in sync with the TLB. Pages that miss the TLB or lie in the unsupported
+        // segments are FASTMEM_UNMAPPED, pages that aren't backed by memory (hardware
+        // registers, the IPL) have no host pointer. Only kernel mode is supported, so the
+        // table is built for it
+        std::vector<uint32_t> fastmem_paddrs_;
+        std::vector<uint8_t*> fastmem_pages_;
 
         inline TranslatedAddress translate_vaddr(uint32_t vaddr);
         inline TranslatedAddress translate_vaddr_kernel(uint32_t vaddr);
         inline TranslatedAddress probe_tlb(uint32_t vaddr);
 
+        uint8_t* fastmem_pointer(uint32_t vaddr)
+        {
+            // Other modes take the slow path, which doesn't support them
+            if (!is_kernel_mode()) [[unlikely]]
+            {
+                return nullptr;
+            }
+            uint8_t* page = fastmem_pages_[vaddr >> FASTMEM_PAGE_SHIFT];
+            return page ? page + (vaddr & (FASTMEM_PAGE_SIZE - 1)) : nullptr;
+        }
+
+        // Only valid for addresses fastmem_pointer returned a pointer for
+        uint32_t fastmem_paddr(uint32_t vaddr)
+        {
+            return fastmem_paddrs_[vaddr >> FASTMEM_PAGE_SHIFT] | (vaddr & (FASTMEM_PAGE_SIZE - 1));
+        }
+
+        // Every CPU store ends up here, for code cached by the CPU or the RSP
+        void invalidate_write(uint32_t paddr, uint32_t length);
+
+        void map_fastmem();
+        void map_fastmem_page(uint32_t vpage, uint32_t paddr);
+        void map_fastmem_tlb_entry(const TLBEntry& entry);
+        void map_fastmem_tlb();
+        void write_tlb_entry(uint8_t index);
+
         uint32_t read_hwio(uint32_t addr);
         void write_hwio(uint32_t addr, uint32_t data);
+        void map_hwio();
 
         // clang-format off
-        void SPECIAL(), REGIMM(), J(), JAL(), BEQ(), BNE(), BLEZ(), BGTZ(),
+        void J(), JAL(), BEQ(), BNE(), BLEZ(), BGTZ(),
             ADDI(), ADDIU(), SLTI(), SLTIU(), ANDI(), ORI(), XORI(), LUI(),
-            COP0(), COP1(), COP2(), COP3(), BEQL(), BNEL(), BLEZL(), BGTZL(),
+            COP3(), BEQL(), BNEL(), BLEZL(), BGTZL(),
             DADDI(), DADDIU(), LDL(), LDR(), ERROR(),
             LB(), LH(), LWL(), LW(), LBU(), LHU(), LWR(), LWU(),
             SB(), SH(), SWL(), SW(), SDL(), SDR(), SWR(), CACHE(),
@@ -371,6 +484,8 @@ namespace hydra::N64
             SC(), SWC1(), SWC2(), SCD(), SDC1(), SDC2(), SD(),
             MTC0(), DMTC0(), MFC0(), DMFC0();
 
+        void c_TLBR(), c_TLBWI(), c_TLBWR(), c_TLBP(), c_WAIT(), c_ERET();
+
         void s_SLL(), s_SRL(), s_SRA(), s_SLLV(), s_SRLV(), s_SRAV(),
             s_JR(), s_JALR(), s_SYSCALL(), s_BREAK(), s_SYNC(),
             s_MFHI(), s_MTHI(), s_MFLO(), s_MTLO(), s_DSLLV(), s_DSRLV(), s_DSRAV(),
@@ -389,58 +504,37 @@ namespace hydra::N64
             f_CVTS(), f_CVTD(), f_CVTW(), f_CVTL(), f_CF(), f_CUN(),
             f_CEQ(), f_CUEQ(), f_COLT(), f_CULT(), f_COLE(), f_CULE(),
             f_CSF(), f_CNGLE(), f_CSEQ(), f_CNGL(), f_CLT(), f_CNGE(), f_CLE(), f_CNGT(),
-            f_CFC1(), f_MFC1(), f_DMFC1(), f_MTC1(), f_DMTC1(), f_CTC1();
-
-        void MFC2(), DMFC2(), MTC2(), DMTC2(), CFC2(), CTC2(), RDHWR();
+            f_CFC1(), f_MFC1(), f_DMFC1(), f_MTC1(), f_DMTC1(), f_CTC1(),
+            f_BC1F(), f_BC1T(), f_BC1FL(), f_BC1TL(), f_UNIMPLEMENTED(), f_RESERVED();
 
-        using func_ptr = void (*)(CPU*);
-        constexpr static std::array<func_ptr, 64> instruction_table_ =
-        {
-            &lut_wrapper<&CPU::SPECIAL>, &lut_wrapper<&CPU::REGIMM>, &lut_wrapper<&CPU::J>, &lut_wrapper<&CPU::JAL>, &lut_wrapper<&CPU::BEQ>, &lut_wrapper<&CPU::BNE>, &lut_wrapper<&CPU::BLEZ>, &lut_wrapper<&CPU::BGTZ>,
-            &lut_wrapper<&CPU::ADDI>, &lut_wrapper<&CPU::ADDIU>, &lut_wrapper<&CPU::SLTI>, &lut_wrapper<&CPU::SLTIU>, &lut_wrapper<&CPU::ANDI>, &lut_wrapper<&CPU::ORI>, &lut_wrapper<&CPU::XORI>, &lut_wrapper<&CPU::LUI>,
-            &lut_wrapper<&CPU::COP0>, &lut_wrapper<&CPU::COP1>, &lut_wrapper<&CPU::COP2>, &lut_wrapper<&CPU::COP3>, &lut_wrapper<&CPU::BEQL>, &lut_wrapper<&CPU::BNEL>, &lut_wrapper<&CPU::BLEZL>, &lut_wrapper<&CPU::BGTZL>,
-            &lut_wrapper<&CPU::DADDI>, &lut_wrapper<&CPU::DADDIU>, &lut_wrapper<&CPU::LDL>, &lut_wrapper<&CPU::LDR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::RDHWR>,
-            &lut_wrapper<&CPU::LB>, &lut_wrapper<&CPU::LH>, &lut_wrapper<&CPU::LWL>, &lut_wrapper<&CPU::LW>, &lut_wrapper<&CPU::LBU>, &lut_wrapper<&CPU::LHU>, &lut_wrapper<&CPU::LWR>, &lut_wrapper<&CPU::LWU>,
-            &lut_wrapper<&CPU::SB>, &lut_wrapper<&CPU::SH>, &lut_wrapper<&CPU::SWL>, &lut_wrapper<&CPU::SW>, &lut_wrapper<&CPU::SDL>, &lut_wrapper<&CPU::SDR>, &lut_wrapper<&CPU::SWR>, &lut_wrapper<&CPU::CACHE>,
-            &lut_wrapper<&CPU::LL>, &lut_wrapper<&CPU::LWC1>, &lut_wrapper<&CPU::LWC2>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::LLD>, &lut_wrapper<&CPU::LDC1>, &lut_wrapper<&CPU::LDC2>, &lut_wrapper<&CPU::LD>,
-            &lut_wrapper<&CPU::SC>, &lut_wrapper<&CPU::SWC1>, &lut_wrapper<&CPU::SWC2>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::SCD>, &lut_wrapper<&CPU::SDC1>, &lut_wrapper<&CPU::SDC2>, &lut_wrapper<&CPU::SD>,
-        };
+        void MFC2(), DMFC2(), MTC2(), DMTC2(), CFC2(), CTC2(), COP2_RESERVED(), RDHWR();
 
-        constexpr static std::array<func_ptr, 64> special_table_ =
-        {
-            &lut_wrapper<&CPU::s_SLL>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::s_SRL>, &lut_wrapper<&CPU::s_SRA>, &lut_wrapper<&CPU::s_SLLV>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::s_SRLV>, &lut_wrapper<&CPU::s_SRAV>,
-            &lut_wrapper<&CPU::s_JR>, &lut_wrapper<&CPU::s_JALR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::s_SYSCALL>, &lut_wrapper<&CPU::s_BREAK>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::s_SYNC>,
-            &lut_wrapper<&CPU::s_MFHI>, &lut_wrapper<&CPU::s_MTHI>, &lut_wrapper<&CPU::s_MFLO>, &lut_wrapper<&CPU::s_MTLO>, &lut_wrapper<&CPU::s_DSLLV>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::s_DSRLV>, &lut_wrapper<&CPU::s_DSRAV>,
-            &lut_wrapper<&CPU::s_MULT>, &lut_wrapper<&CPU::s_MULTU>, &lut_wrapper<&CPU::s_DIV>, &lut_wrapper<&CPU::s_DIVU>, &lut_wrapper<&CPU::s_DMULT>, &lut_wrapper<&CPU::s_DMULTU>, &lut_wrapper<&CPU::s_DDIV>, &lut_wrapper<&CPU::s_DDIVU>,
-            &lut_wrapper<&CPU::s_ADD>, &lut_wrapper<&CPU::s_ADDU>, &lut_wrapper<&CPU::s_SUB>, &lut_wrapper<&CPU::s_SUBU>, &lut_wrapper<&CPU::s_AND>, &lut_wrapper<&CPU::s_OR>, &lut_wrapper<&CPU::s_XOR>, &lut_wrapper<&CPU::s_NOR>,
-            &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::s_SLT>, &lut_wrapper<&CPU::s_SLTU>, &lut_wrapper<&CPU::s_DADD>, &lut_wrapper<&CPU::s_DADDU>, &lut_wrapper<&CPU::s_DSUB>, &lut_wrapper<&CPU::s_DSUBU>,
-            &lut_wrapper<&CPU::s_TGE>, &lut_wrapper<&CPU::s_TGEU>, &lut_wrapper<&CPU::s_TLT>, &lut_wrapper<&CPU::s_TLTU>, &lut_wrapper<&CPU::s_TEQ>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::s_TNE>, &lut_wrapper<&CPU::ERROR>,
-            &lut_wrapper<&CPU::s_DSLL>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::s_DSRL>, &lut_wrapper<&CPU::s_DSRA>, &lut_wrapper<&CPU::s_DSLL32>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::s_DSRL32>, &lut_wrapper<&CPU::s_DSRA32>,
-        };
+        bool check_cp1_usable();
 
-        constexpr static std::array<func_ptr, 64> float_table_ =
-        {
-            &lut_wrapper<&CPU::f_ADD>, &lut_wrapper<&CPU::f_SUB>, &lut_wrapper<&CPU::f_MUL>, &lut_wrapper<&CPU::f_DIV>, &lut_wrapper<&CPU::f_SQRT>, &lut_wrapper<&CPU::f_ABS>, &lut_wrapper<&CPU::f_MOV>, &lut_wrapper<&CPU::f_NEG>,
-            &lut_wrapper<&CPU::f_ROUNDL>, &lut_wrapper<&CPU::f_TRUNCL>, &lut_wrapper<&CPU::f_CEILL>, &lut_wrapper<&CPU::f_FLOORL>, &lut_wrapper<&CPU::f_ROUNDW>, &lut_wrapper<&CPU::f_TRUNCW>, &lut_wrapper<&CPU::f_CEILW>, &lut_wrapper<&CPU::f_FLOORW>,
-            &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>,
-            &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>,
-            &lut_wrapper<&CPU::f_CVTS>, &lut_wrapper<&CPU::f_CVTD>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::f_CVTW>, &lut_wrapper<&CPU::f_CVTL>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>,
-            &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>,
-            &lut_wrapper<&CPU::f_CF>, &lut_wrapper<&CPU::f_CUN>, &lut_wrapper<&CPU::f_CEQ>, &lut_wrapper<&CPU::f_CUEQ>, &lut_wrapper<&CPU::f_COLT>, &lut_wrapper<&CPU::f_CULT>, &lut_wrapper<&CPU::f_COLE>, &lut_wrapper<&CPU::f_CULE>,
-            &lut_wrapper<&CPU::f_CSF>, &lut_wrapper<&CPU::f_CNGLE>, &lut_wrapper<&CPU::f_CSEQ>, &lut_wrapper<&CPU::f_CNGL>, &lut_wrapper<&CPU::f_CLT>, &lut_wrapper<&CPU::f_CNGE>, &lut_wrapper<&CPU::f_CLE>, &lut_wrapper<&CPU::f_CNGT>,
+        using func_ptr = void (*)(CPU*);
+        // clang-format on
+        // Indexed by Opcode, see n64_cpu_decode.hxx
+        constexpr static std::array<func_ptr, OPCODE_COUNT> handler_table_ = {
+#define X(name, mnemonic, group, index, format, handler)                                           \
+    is_cop1_group(DecodeGroup::group)                                                              \
+        ? static_cast<func_ptr>(&checked_lut_wrapper<&CPU::check_cp1_usable, &CPU::handler>)       \
+        : static_cast<func_ptr>(&lut_wrapper<&CPU::handler>),
+            CPU_OPCODES
+#undef X
         };
 
-        constexpr static std::array<func_ptr, 32> regimm_table_ =
-        {
-            &lut_wrapper<&CPU::r_BLTZ>, &lut_wrapper<&CPU::r_BGEZ>, &lut_wrapper<&CPU::r_BLTZL>, &lut_wrapper<&CPU::r_BGEZL>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>,
-            &lut_wrapper<&CPU::r_TGEI>, &lut_wrapper<&CPU::r_TGEIU>, &lut_wrapper<&CPU::r_TLTI>, &lut_wrapper<&CPU::r_TLTIU>, &lut_wrapper<&CPU::r_TEQI>,  &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::r_TNEI>,  &lut_wrapper<&CPU::ERROR>,
-            &lut_wrapper<&CPU::r_BLTZAL>, &lut_wrapper<&CPU::r_BGEZAL>, &lut_wrapper<&CPU::r_BLTZALL>, &lut_wrapper<&CPU::r_BGEZALL>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>,
-            &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>, &lut_wrapper<&CPU::ERROR>,
-        };
-        // clang-format on
+        static DecodedInstruction decode(Instruction instruction);
+        CachedBlock* compile_block(uint32_t paddr);
+        // Runs at most max_instructions from the block cache, returns how many were executed
+        uint32_t TickCached(uint32_t max_instructions);
+        // Same as TickCached but runs recompiled host code where possible
+        uint32_t TickJit(uint32_t max_instructions);
+        uint32_t run_cached_block(CachedBlock* block, uint32_t max_instructions);
+        uint32_t skip_idle_loop(const CachedBlock& block, uint64_t entry_pc, uint32_t executed,
+                                uint32_t max_instructions);
+        void compile_jit_block(CachedBlock& block);
 
         void execute_instruction();
-        void execute_cp0_instruction();
 
         void conditional_branch(bool condition, uint64_t address);
         void conditional_branch_likely(bool condition, uint64_t address);
@@ -459,7 +553,8 @@ namespace hydra::N64
         bool check_interrupts();
         void update_interrupt_check();
         inline void set_interrupt(InterruptType type, bool value);
-        void handle_event();
+        void handle_event(TaskType type);
+        void schedule_compare();
         uint32_t timing_pi_access(uint8_t domain, uint32_t length);
         void check_vi_interrupt();
         void throw_exception(uint32_t, ExceptionType, uint8_t = 0);
@@ -490,9 +585,14 @@ namespace hydra::N64
         template <class OperatorFunction, class CastFunction>
         void fpu_operate(OperatorFunction op, CastFunction cast);
 
-        template <class Type, class OperatorFunction, class CastFunction>
+        template <class Type, bool Fast, class OperatorFunction, class CastFunction>
         void fpu_operate_impl(OperatorFunction op, CastFunction cast);
 
+        template <class Type, class OperatorFunction>
+        int fast_fpu_exceptions(Type fs, Type ft, Type result);
+
+        void set_host_rounding_mode(uint32_t mode);
+
         template <class Type>
         Type get_fpu_reg(int regnum);
 
@@ -511,7 +611,11 @@ namespace hydra::N64
         template <bool DoLog>
         void log_cpu_state(bool use_crc, uint64_t instructions, uint64_t start = 0);
 
-        bool is_kernel_mode();
+        bool is_kernel_mode()
+        {
+            return (CP0Status.KSU == 0b00) || CP0Status.EXL || CP0Status.ERL;
+        }
+
         void dump_tlb();
         void dump_pif_ram();
         void dump_rdram();
@@ -521,5 +625,6 @@ namespace hydra::N64
         std::function<int32_t(uint32_t, hydra::ButtonType)> read_input_callback_;
 
         friend class hydra::N64::N64;
+        friend class hydra::N64::CPURecompiler;
     };
 } // namespace hydra::N64
@@ -0,0 +1,232 @@
+#include <core/n64_cpu_cache.hxx>
+
+namespace hydra::N64
+{
+    namespace
+    {
+        struct RegisterUsage
+        {
+            uint32_t reads = 0;
+            uint32_t writes = 0;
+        };
+
+        constexpr uint32_t reg_bit(uint32_t reg)
+        {
+            // r0 is always zero, so it never carries state between iterations
+            return (1u << reg) & ~1u;
+        }
+
+        // Returns false for instructions that are not allowed in an idle loop
+        bool get_register_usage(Instruction instruction, RegisterUsage& usage)
+        {
+            uint32_t rs = reg_bit(instruction.RType.rs);
+            uint32_t rt = reg_bit(instruction.RType.rt);
+            uint32_t rd = reg_bit(instruction.RType.rd);
+            switch (instruction.IType.op)
+            {
+                case 0:
+                {
+                    switch (instruction.RType.func)
+                    {
+                        // SLL, SRL, SRA, DSLL, DSRL, DSRA, DSLL32, DSRL32, DSRA32
+                        case 0:
+                        case 2:
+                        case 3:
+                        case 56:
+                        case 58:
+                        case 59:
+                        case 60:
+                        case 62:
+                        case 63:
+                            usage = {rt, rd};
+                            return true;
+                        // SLLV, SRLV, SRAV, DSLLV, DSRLV, DSRAV, ADDU, SUBU, AND, OR, XOR,
+                        // NOR, SLT, SLTU, DADDU, DSUBU
+                        case 4:
+                        case 6:
+                        case 7:
+                        case 20:
+                        case 22:
+                        case 23:
+                        case 33:
+                        case 35:
+                        case 36:
+                        case 37:
+                        case 38:
+                        case 39:
+                        case 42:
+                        case 43:
+                        case 45:
+                        case 47:
+                            usage = {rs | rt, rd};
+                            return true;
+                        // SYNC
+                        case 15:
+                            usage = {0, 0};
+                            return true;
+                        default:
+                            return false;
+                    }
+                }
+                case 1:
+                {
+                    // BLTZ, BGEZ, BLTZL, BGEZL
+                    if (instruction.RType.rt > 3)
+                    {
+                        return false;
+                    }
+                    usage = {rs, 0};
+                    return true;
+                }
+                // BEQ, BNE, BEQL, BNEL
+                case 4:
+                case 5:
+                case 20:
+                case 21:
+                    usage = {rs | rt, 0};
+                    return true;
+                // BLEZ, BGTZ, BLEZL, BGTZL
+                case 6:
+                case 7:
+                case 22:
+                case 23:
+                    usage = {rs, 0};
+                    return true;
+                // ADDIU, SLTI, SLTIU, ANDI, ORI, XORI, DADDIU, LB, LH, LW, LBU, LHU, LWU, LD.
+                // Hardware register reads have no side effects other than the semaphore,
+                // which reads the same every time once set
+                case 9:
+                case 10:
+                case 11:
+                case 12:
+                case 13:
+                case 14:
+                case 25:
+                case 32:
+                case 33:
+                case 35:
+                case 36:
+                case 37:
+                case 39:
+                case 55:
+                    usage = {rs, rt};
+                    return true;
+                // LUI
+                case 15:
+                    usage = {0, rt};
+                    return true;
+                default:
+                    return false;
+            }
+        }
+    } // namespace
+
+    bool is_idle_loop(const std::vector<DecodedInstruction>& instructions)
+    {
+        size_t size = instructions.size();
+        if (size < 2)
+        {
+            return false;
+        }
+
+        // Must end in a relative branch to the first instruction, computed like the branch
+        // handlers do
+        Instruction branch = instructions[size - 2].instruction;
+        if (!is_branch(branch) || branch.IType.op == 2 || branch.IType.op == 3 ||
+            branch.IType.op == 0 || branch.IType.op == 17)
+        {
+            return false;
+        }
+        int32_t offset = static_cast<int16_t>(branch.IType.immediate << 2);
+        if (offset != -static_cast<int32_t>((size - 1) * 4))
+        {
+            return false;
+        }
+
+        std::vector<RegisterUsage> usages(size);
+        uint32_t written = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            if (!get_register_usage(instructions[i].instruction, usages[i]))
+            {
+                return false;
+            }
+            written |= usages[i].writes;
+        }
+
+        // A register that is read before it is written in the same iteration carries a value
+        // over from the previous one, like a counter
+        uint32_t written_so_far = 0;
+        for (const RegisterUsage& usage : usages)
+        {
+            if (usage.reads & written & ~written_so_far)
+            {
+                return false;
+            }
+            written_so_far |= usage.writes;
+        }
+        return true;
+    }
+
+    BlockCache::BlockCache()
+    {
+        // 512 MiB of physical address space in 4 KiB pages
+        pages_.resize(0x2000'0000 >> BLOCK_PAGE_SHIFT);
+    }
+
+    CachedBlock& BlockCache::Allocate(uint32_t paddr)
+    {
+        uint32_t page_index = paddr >> BLOCK_PAGE_SHIFT;
+        std::unique_ptr<BlockPage>& page = pages_[page_index];
+        if (!page)
+        {
+            page = std::make_unique<BlockPage>();
+        }
+
+        std::unique_ptr<CachedBlock>& block = page->blocks[(paddr & (BLOCK_PAGE_SIZE - 1)) >> 2];
+        if (!block)
+        {
+            block = std::make_unique<CachedBlock>();
+        }
+
+        if (page_index < BLOCK_RDRAM_PAGES)
+        {
+            code_pages_[page_index] = true;
+        }
+
+        block->valid = false;
+        block->idle_loop = false;
+        block->instructions.clear();
+        block->jit_code = nullptr;
+        block->jit_vaddr = JIT_NOT_COMPILED;
+        block->jit_length = 0;
+        return *block;
+    }
+
+    void BlockCache::Clear()
+    {
+        for (auto& page : pages_)
+        {
+            page.reset();
+        }
+        code_pages_.fill(false);
+    }
+
+    void BlockCache::invalidate_page(uint32_t page_index)
+    {
+        // Blocks are only marked invalid and not freed, as the block currently being
+        // executed may be the one that got overwritten
+        BlockPage* page = pages_[page_index].get();
+        if (page)
+        {
+            for (auto& block : page->blocks)
+            {
+                if (block)
+                {
+                    block->valid = false;
+                }
+            }
+        }
+        code_pages_[page_index] = false;
+    }
+} // namespace hydra::N64
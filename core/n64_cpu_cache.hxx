@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <core/n64_cpu_decode.hxx>
+#include <core/n64_types.hxx>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace hydra::N64
+{
+    constexpr uint32_t BLOCK_PAGE_SHIFT = 12;
+    constexpr uint32_t BLOCK_PAGE_SIZE = 1 << BLOCK_PAGE_SHIFT;
+    constexpr uint32_t BLOCK_RDRAM_PAGES = 0x80'0000 >> BLOCK_PAGE_SHIFT;
+    constexpr size_t BLOCK_MAX_INSTRUCTIONS = 64;
+    // Never a valid PC as it's not word aligned
+    constexpr uint64_t JIT_NOT_COMPILED = ~0ull;
+
+    // Control flow instructions, the block ends after their delay slot
+    inline bool is_branch(Instruction instruction)
+    {
+        switch (instruction.IType.op)
+        {
+            case 0:
+                // JR, JALR
+                return instruction.RType.func == 8 || instruction.RType.func == 9;
+            case 1:
+                // BLTZ, BGEZ, BLTZL, BGEZL and their linking versions
+                return (instruction.RType.rt & 0b01100) == 0;
+            case 2:
+            case 3:
+            case 4:
+            case 5:
+            case 6:
+            case 7:
+            case 20:
+            case 21:
+            case 22:
+            case 23:
+                return true;
+            case 17:
+                // BC1F, BC1T, BC1FL, BC1TL
+                return instruction.RType.rs == 0b01000;
+            default:
+                return false;
+        }
+    }
+
+    // Instructions that may change the address translation or always raise an exception
+    inline bool ends_block(Instruction instruction)
+    {
+        switch (instruction.IType.op)
+        {
+            case 0:
+                // SYSCALL, BREAK
+                return instruction.RType.func == 12 || instruction.RType.func == 13;
+            case 16:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // A block that branches back to its own start, and where every register it reads is either
+    // left untouched or written earlier in the same iteration. No stores or other side effects.
+    // Each iteration starts in the same state, so the loop can only exit once an interrupt or
+    // scheduler task changes memory or a hardware register
+    bool is_idle_loop(const std::vector<DecodedInstruction>& instructions);
+
+    // A straight-line run of instructions starting at a physical address. Blocks never
+    // cross a 4 KiB page, end after the delay slot of a branch, and are marked invalid
+    // (but kept allocated) when the RDRAM page they live in is written to
+    struct CachedBlock
+    {
+        bool valid = false;
+        bool idle_loop = false;
+        std::vector<DecodedInstruction> instructions;
+
+        // Host code for the first jit_length instructions, only valid when entered from
+        // jit_vaddr since branch targets and exception PCs are baked into the code
+        uint32_t (*jit_code)(CPU*) = nullptr;
+        uint64_t jit_vaddr = JIT_NOT_COMPILED;
+        uint32_t jit_length = 0;
+    };
+
+    class BlockCache final
+    {
+    public:
+        BlockCache();
+
+        CachedBlock* Lookup(uint32_t paddr)
+        {
+            BlockPage* page = pages_[paddr >> BLOCK_PAGE_SHIFT].get();
+            if (!page) [[unlikely]]
+            {
+                return nullptr;
+            }
+            CachedBlock* block = page->blocks[(paddr & (BLOCK_PAGE_SIZE - 1)) >> 2].get();
+            if (!block || !block->valid) [[unlikely]]
+            {
+                return nullptr;
+            }
+            return block;
+        }
+
+        CachedBlock& Allocate(uint32_t paddr);
+
+        // Called for every write that can land in RDRAM, cheap when the page holds no code
+        void InvalidateWrite(uint32_t paddr, uint32_t length)
+        {
+            uint32_t first = paddr >> BLOCK_PAGE_SHIFT;
+            uint32_t last = (paddr + length - 1) >> BLOCK_PAGE_SHIFT;
+            for (uint32_t page = first; page <= last && page < BLOCK_RDRAM_PAGES; page++)
+            {
+                if (code_pages_[page]) [[unlikely]]
+                {
+                    invalidate_page(page);
+                }
+            }
+        }
+
+        void Clear();
+
+        // For generated code that checks stores against pages with code inline
+        const bool* CodePages() const
+        {
+            return code_pages_.data();
+        }
+
+        // Only RDRAM, cartridge ROM and the IPL are cached, everything else (for example
+        // code running from SP DMEM during boot) goes through the regular interpreter
+        static bool IsCacheable(uint32_t paddr)
+        {
+            return paddr < 0x80'0000 || (paddr >= 0x1000'0000 && paddr < 0x1FC0'0000) ||
+                   (paddr - 0x1FC0'0000u < 1984u);
+        }
+
+    private:
+        struct BlockPage
+        {
+            std::array<std::unique_ptr<CachedBlock>, BLOCK_PAGE_SIZE / 4> blocks;
+        };
+
+        void invalidate_page(uint32_t page);
+
+        std::vector<std::unique_ptr<BlockPage>> pages_;
+        std::array<bool, BLOCK_RDRAM_PAGES> code_pages_{};
+    };
+} // namespace hydra::N64
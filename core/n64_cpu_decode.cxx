@@ -0,0 +1,123 @@
+#include <core/n64_cpu_decode.hxx>
+#include <fmt/format.h>
+
+namespace hydra::N64
+{
+    namespace
+    {
+        const char* fmt_suffix(uint32_t fmt)
+        {
+            switch (fmt)
+            {
+                case 16:
+                    return ".s";
+                case 17:
+                    return ".d";
+                case 20:
+                    return ".w";
+                case 21:
+                    return ".l";
+                default:
+                    return ".?";
+            }
+        }
+
+        std::string signed_hex(int32_t value)
+        {
+            return value < 0 ? fmt::format("-0x{:x}", -static_cast<int64_t>(value))
+                             : fmt::format("0x{:x}", value);
+        }
+    } // namespace
+
+    std::string disassemble_instruction(Instruction instruction, uint32_t vaddr,
+                                        bool register_names)
+    {
+        if (instruction.full == 0)
+        {
+            return "nop";
+        }
+
+        Opcode opcode = decode_opcode(instruction.full);
+        const OpcodeInfo& info = OPCODE_INFO[static_cast<size_t>(opcode)];
+        auto gpr = [register_names](uint32_t reg) { return gpr_get_name(reg, register_names); };
+        std::string rs = gpr(instruction.RType.rs);
+        std::string rt = gpr(instruction.RType.rt);
+        std::string rd = gpr(instruction.RType.rd);
+        uint32_t rt_index = instruction.RType.rt;
+        uint32_t rd_index = instruction.RType.rd;
+        uint32_t sa = instruction.RType.sa;
+        uint32_t fs = instruction.FType.fs;
+        uint32_t ft = instruction.FType.ft;
+        uint32_t fd = instruction.FType.fd;
+        uint32_t jump_target = instruction.JType.target;
+        int32_t seimm = static_cast<int16_t>(instruction.IType.immediate);
+        uint32_t immediate = instruction.IType.immediate;
+        uint32_t target = vaddr + 4 + (seimm << 2);
+        std::string mnemonic = info.mnemonic;
+        if (info.group == DecodeGroup::Cop1Function)
+        {
+            mnemonic += fmt_suffix(instruction.FType.fmt);
+        }
+
+        switch (info.format)
+        {
+            case OperandFormat::None:
+                if (opcode == Opcode::INVALID)
+                {
+                    return fmt::format("invalid {:08x}", instruction.full);
+                }
+                return mnemonic;
+            case OperandFormat::Shift:
+                return fmt::format("{} {}, {}, {}", mnemonic, rd, rt, sa);
+            case OperandFormat::ShiftVariable:
+                return fmt::format("{} {}, {}, {}", mnemonic, rd, rt, rs);
+            case OperandFormat::Arithmetic:
+                return fmt::format("{} {}, {}, {}", mnemonic, rd, rs, rt);
+            case OperandFormat::Rs:
+                return fmt::format("{} {}", mnemonic, rs);
+            case OperandFormat::Rd:
+                return fmt::format("{} {}", mnemonic, rd);
+            case OperandFormat::JumpLink:
+                return fmt::format("{} {}, {}", mnemonic, rd, rs);
+            case OperandFormat::RsRt:
+                return fmt::format("{} {}, {}", mnemonic, rs, rt);
+            case OperandFormat::Immediate:
+                return fmt::format("{} {}, {}, {}", mnemonic, rt, rs, signed_hex(seimm));
+            case OperandFormat::Logical:
+                return fmt::format("{} {}, {}, 0x{:x}", mnemonic, rt, rs, immediate);
+            case OperandFormat::Upper:
+                return fmt::format("{} {}, 0x{:x}", mnemonic, rt, immediate);
+            case OperandFormat::Trap:
+                return fmt::format("{} {}, {}", mnemonic, rs, signed_hex(seimm));
+            case OperandFormat::Branch:
+                return fmt::format("{} {}, {}, 0x{:08x}", mnemonic, rs, rt, target);
+            case OperandFormat::BranchZero:
+                return fmt::format("{} {}, 0x{:08x}", mnemonic, rs, target);
+            case OperandFormat::Jump:
+                return fmt::format("{} 0x{:08x}", mnemonic,
+                                   ((vaddr + 4) & 0xF000'0000) | (jump_target << 2));
+            case OperandFormat::Memory:
+                return fmt::format("{} {}, {}({})", mnemonic, rt, signed_hex(seimm), rs);
+            case OperandFormat::FloatMemory:
+                return fmt::format("{} f{}, {}({})", mnemonic, ft, signed_hex(seimm), rs);
+            case OperandFormat::CopMemory:
+                return fmt::format("{} ${}, {}({})", mnemonic, rt_index, signed_hex(seimm), rs);
+            case OperandFormat::Cache:
+                return fmt::format("{} 0x{:x}, {}({})", mnemonic, rt_index, signed_hex(seimm),
+                                   rs);
+            case OperandFormat::CopMove:
+                return fmt::format("{} {}, ${}", mnemonic, rt, rd_index);
+            case OperandFormat::FloatMove:
+                return fmt::format("{} {}, f{}", mnemonic, rt, fs);
+            case OperandFormat::FloatBranch:
+                return fmt::format("{} 0x{:08x}", mnemonic, target);
+            case OperandFormat::FloatThree:
+                return fmt::format("{} f{}, f{}, f{}", mnemonic, fd, fs, ft);
+            case OperandFormat::FloatTwo:
+                return fmt::format("{} f{}, f{}", mnemonic, fd, fs);
+            case OperandFormat::FloatCompare:
+                return fmt::format("{} f{}, f{}", mnemonic, fs, ft);
+        }
+        return mnemonic;
+    }
+} // namespace hydra::N64
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <array>
+#include <core/n64_types.hxx>
+#include <cstdint>
+#include <string>
+
+namespace hydra::N64
+{
+    class CPU;
+
+    // Which field of the instruction word selects the opcode
+    enum class DecodeGroup : uint8_t
+    {
+        None,
+        Primary,      // op
+        Special,      // func, op == 0
+        Regimm,       // rt, op == 1
+        Cop0,         // rs, op == 16
+        Cop0Function, // func, op == 16 and rs & 0x10
+        Cop1,         // rs, op == 17
+        Cop1Branch,   // rt, op == 17 and rs == 8
+        Cop1Function, // func, op == 17 and rs & 0x10
+        Cop2,         // rs, op == 18
+    };
+
+    // Operand layout, only used for disassembly
+    enum class OperandFormat : uint8_t
+    {
+        None,           //
+        Shift,          // rd, rt, sa
+        ShiftVariable,  // rd, rt, rs
+        Arithmetic,     // rd, rs, rt
+        Rs,             // rs
+        Rd,             // rd
+        JumpLink,       // rd, rs
+        RsRt,           // rs, rt
+        Immediate,      // rt, rs, signed immediate
+        Logical,        // rt, rs, unsigned immediate
+        Upper,          // rt, unsigned immediate
+        Trap,           // rs, signed immediate
+        Branch,         // rs, rt, target
+        BranchZero,     // rs, target
+        Jump,           // target
+        Memory,         // rt, offset(rs)
+        FloatMemory,    // ft, offset(rs)
+        CopMemory,      // $rt, offset(rs)
+        Cache,          // rt, offset(rs) with rt being the cache operation
+        CopMove,        // rt, $rd
+        FloatMove,      // rt, fs
+        FloatBranch,    // target
+        FloatThree,     // fd, fs, ft
+        FloatTwo,       // fd, fs
+        FloatCompare,   // fs, ft
+    };
+
+    // X(name, mnemonic, group, index, format, handler)
+    // Every instruction the CPU decodes to, the handler is a member function of CPU.
+    // COP1 handlers are wrapped with the coprocessor usable check
+    // clang-format off
+#define CPU_OPCODES \
+    X(INVALID,       "invalid",   None,         0,  None,          ERROR)            \
+    X(J,             "j",         Primary,      2,  Jump,          J)                \
+    X(JAL,           "jal",       Primary,      3,  Jump,          JAL)              \
+    X(BEQ,           "beq",       Primary,      4,  Branch,        BEQ)              \
+    X(BNE,           "bne",       Primary,      5,  Branch,        BNE)              \
+    X(BLEZ,          "blez",      Primary,      6,  BranchZero,    BLEZ)             \
+    X(BGTZ,          "bgtz",      Primary,      7,  BranchZero,    BGTZ)             \
+    X(ADDI,          "addi",      Primary,      8,  Immediate,     ADDI)             \
+    X(ADDIU,         "addiu",     Primary,      9,  Immediate,     ADDIU)            \
+    X(SLTI,          "slti",      Primary,      10, Immediate,     SLTI)             \
+    X(SLTIU,         "sltiu",     Primary,      11, Immediate,     SLTIU)            \
+    X(ANDI,          "andi",      Primary,      12, Logical,       ANDI)             \
+    X(ORI,           "ori",       Primary,      13, Logical,       ORI)              \
+    X(XORI,          "xori",      Primary,      14, Logical,       XORI)             \
+    X(LUI,           "lui",       Primary,      15, Upper,         LUI)              \
+    X(COP3,          "cop3",      Primary,      19, None,          COP3)             \
+    X(BEQL,          "beql",      Primary,      20, Branch,        BEQL)             \
+    X(BNEL,          "bnel",      Primary,      21, Branch,        BNEL)             \
+    X(BLEZL,         "blezl",     Primary,      22, BranchZero,    BLEZL)            \
+    X(BGTZL,         "bgtzl",     Primary,      23, BranchZero,    BGTZL)            \
+    X(DADDI,         "daddi",     Primary,      24, Immediate,     DADDI)            \
+    X(DADDIU,        "daddiu",    Primary,      25, Immediate,     DADDIU)           \
+    X(LDL,           "ldl",       Primary,      26, Memory,        LDL)              \
+    X(LDR,           "ldr",       Primary,      27, Memory,        LDR)              \
+    X(RDHWR,         "rdhwr",     Primary,      31, None,          RDHWR)            \
+    X(LB,            "lb",        Primary,      32, Memory,        LB)               \
+    X(LH,            "lh",        Primary,      33, Memory,        LH)               \
+    X(LWL,           "lwl",       Primary,      34, Memory,        LWL)              \
+    X(LW,            "lw",        Primary,      35, Memory,        LW)               \
+    X(LBU,           "lbu",       Primary,      36, Memory,        LBU)              \
+    X(LHU,           "lhu",       Primary,      37, Memory,        LHU)              \
+    X(LWR,           "lwr",       Primary,      38, Memory,        LWR)              \
+    X(LWU,           "lwu",       Primary,      39, Memory,        LWU)              \
+    X(SB,            "sb",        Primary,      40, Memory,        SB)               \
+    X(SH,            "sh",        Primary,      41, Memory,        SH)               \
+    X(SWL,           "swl",       Primary,      42, Memory,        SWL)              \
+    X(SW,            "sw",        Primary,      43, Memory,        SW)               \
+    X(SDL,           "sdl",       Primary,      44, Memory,        SDL)              \
+    X(SDR,           "sdr",       Primary,      45, Memory,        SDR)              \
+    X(SWR,           "swr",       Primary,      46, Memory,        SWR)              \
+    X(CACHE,         "cache",     Primary,      47, Cache,         CACHE)            \
+    X(LL,            "ll",        Primary,      48, Memory,        LL)               \
+    X(LWC1,          "lwc1",      Primary,      49, FloatMemory,   LWC1)             \
+    X(LWC2,          "lwc2",      Primary,      50, CopMemory,     LWC2)             \
+    X(LLD,           "lld",       Primary,      52, Memory,        LLD)              \
+    X(LDC1,          "ldc1",      Primary,      53, FloatMemory,   LDC1)             \
+    X(LDC2,          "ldc2",      Primary,      54, CopMemory,     LDC2)             \
+    X(LD,            "ld",        Primary,      55, Memory,        LD)               \
+    X(SC,            "sc",        Primary,      56, Memory,        SC)               \
+    X(SWC1,          "swc1",      Primary,      57, FloatMemory,   SWC1)             \
+    X(SWC2,          "swc2",      Primary,      58, CopMemory,     SWC2)             \
+    X(SCD,           "scd",       Primary,      60, Memory,        SCD)              \
+    X(SDC1,          "sdc1",      Primary,      61, FloatMemory,   SDC1)             \
+    X(SDC2,          "sdc2",      Primary,      62, CopMemory,     SDC2)             \
+    X(SD,            "sd",        Primary,      63, Memory,        SD)               \
+    X(s_SLL,         "sll",       Special,      0,  Shift,         s_SLL)            \
+    X(s_SRL,         "srl",       Special,      2,  Shift,         s_SRL)            \
+    X(s_SRA,         "sra",       Special,      3,  Shift,         s_SRA)            \
+    X(s_SLLV,        "sllv",      Special,      4,  ShiftVariable, s_SLLV)           \
+    X(s_SRLV,        "srlv",      Special,      6,  ShiftVariable, s_SRLV)           \
+    X(s_SRAV,        "srav",      Special,      7,  ShiftVariable, s_SRAV)           \
+    X(s_JR,          "jr",        Special,      8,  Rs,            s_JR)             \
+    X(s_JALR,        "jalr",      Special,      9,  JumpLink,      s_JALR)           \
+    X(s_SYSCALL,     "syscall",   Special,      12, None,          s_SYSCALL)        \
+    X(s_BREAK,       "break",     Special,      13, None,          s_BREAK)          \
+    X(s_SYNC,        "sync",      Special,      15, None,          s_SYNC)           \
+    X(s_MFHI,        "mfhi",      Special,      16, Rd,            s_MFHI)           \
+    X(s_MTHI,        "mthi",      Special,      17, Rs,            s_MTHI)           \
+    X(s_MFLO,        "mflo",      Special,      18, Rd,            s_MFLO)           \
+    X(s_MTLO,        "mtlo",      Special,      19, Rs,            s_MTLO)           \
+    X(s_DSLLV,       "dsllv",     Special,      20, ShiftVariable, s_DSLLV)          \
+    X(s_DSRLV,       "dsrlv",     Special,      22, ShiftVariable, s_DSRLV)          \
+    X(s_DSRAV,       "dsrav",     Special,      23, ShiftVariable, s_DSRAV)          \
+    X(s_MULT,        "mult",      Special,      24, RsRt,          s_MULT)           \
+    X(s_MULTU,       "multu",     Special,      25, RsRt,          s_MULTU)          \
+    X(s_DIV,         "div",       Special,      26, RsRt,          s_DIV)            \
+    X(s_DIVU,        "divu",      Special,      27, RsRt,          s_DIVU)           \
+    X(s_DMULT,       "dmult",     Special,      28, RsRt,          s_DMULT)          \
+    X(s_DMULTU,      "dmultu",    Special,      29, RsRt,          s_DMULTU)         \
+    X(s_DDIV,        "ddiv",      Special,      30, RsRt,          s_DDIV)           \
+    X(s_DDIVU,       "ddivu",     Special,      31, RsRt,          s_DDIVU)          \
+    X(s_ADD,         "add",       Special,      32, Arithmetic,    s_ADD)            \
+    X(s_ADDU,        "addu",      Special,      33, Arithmetic,    s_ADDU)           \
+    X(s_SUB,         "sub",       Special,      34, Arithmetic,    s_SUB)            \
+    X(s_SUBU,        "subu",      Special,      35, Arithmetic,    s_SUBU)           \
+    X(s_AND,         "and",       Special,      36, Arithmetic,    s_AND)            \
+    X(s_OR,          "or",        Special,      37, Arithmetic,    s_OR)             \
+    X(s_XOR,         "xor",       Special,      38, Arithmetic,    s_XOR)            \
+    X(s_NOR,         "nor",       Special,      39, Arithmetic,    s_NOR)            \
+    X(s_SLT,         "slt",       Special,      42, Arithmetic,    s_SLT)            \
+    X(s_SLTU,        "sltu",      Special,      43, Arithmetic,    s_SLTU)           \
+    X(s_DADD,        "dadd",      Special,      44, Arithmetic,    s_DADD)           \
+    X(s_DADDU,       "daddu",     Special,      45, Arithmetic,    s_DADDU)          \
+    X(s_DSUB,        "dsub",      Special,      46, Arithmetic,    s_DSUB)           \
+    X(s_DSUBU,       "dsubu",     Special,      47, Arithmetic,    s_DSUBU)          \
+    X(s_TGE,         "tge",       Special,      48, RsRt,          s_TGE)            \
+    X(s_TGEU,        "tgeu",      Special,      49, RsRt,          s_TGEU)           \
+    X(s_TLT,         "tlt",       Special,      50, RsRt,          s_TLT)            \
+    X(s_TLTU,        "tltu",      Special,      51, RsRt,          s_TLTU)           \
+    X(s_TEQ,         "teq",       Special,      52, RsRt,          s_TEQ)            \
+    X(s_TNE,         "tne",       Special,      54, RsRt,          s_TNE)            \
+    X(s_DSLL,        "dsll",      Special,      56, Shift,         s_DSLL)           \
+    X(s_DSRL,        "dsrl",      Special,      58, Shift,         s_DSRL)           \
+    X(s_DSRA,        "dsra",      Special,      59, Shift,         s_DSRA)           \
+    X(s_DSLL32,      "dsll32",    Special,      60, Shift,         s_DSLL32)         \
+    X(s_DSRL32,      "dsrl32",    Special,      62, Shift,         s_DSRL32)         \
+    X(s_DSRA32,      "dsra32",    Special,      63, Shift,         s_DSRA32)         \
+    X(r_BLTZ,        "bltz",      Regimm,       0,  BranchZero,    r_BLTZ)           \
+    X(r_BGEZ,        "bgez",      Regimm,       1,  BranchZero,    r_BGEZ)           \
+    X(r_BLTZL,       "bltzl",     Regimm,       2,  BranchZero,    r_BLTZL)          \
+    X(r_BGEZL,       "bgezl",     Regimm,       3,  BranchZero,    r_BGEZL)          \
+    X(r_TGEI,        "tgei",      Regimm,       8,  Trap,          r_TGEI)           \
+    X(r_TGEIU,       "tgeiu",     Regimm,       9,  Trap,          r_TGEIU)          \
+    X(r_TLTI,        "tlti",      Regimm,       10, Trap,          r_TLTI)           \
+    X(r_TLTIU,       "tltiu",     Regimm,       11, Trap,          r_TLTIU)          \
+    X(r_TEQI,        "teqi",      Regimm,       12, Trap,          r_TEQI)           \
+    X(r_TNEI,        "tnei",      Regimm,       14, Trap,          r_TNEI)           \
+    X(r_BLTZAL,      "bltzal",    Regimm,       16, BranchZero,    r_BLTZAL)         \
+    X(r_BGEZAL,      "bgezal",    Regimm,       17, BranchZero,    r_BGEZAL)         \
+    X(r_BLTZALL,     "bltzall",   Regimm,       18, BranchZero,    r_BLTZALL)        \
+    X(r_BGEZALL,     "bgezall",   Regimm,       19, BranchZero,    r_BGEZALL)        \
+    X(MFC0,          "mfc0",      Cop0,         0,  CopMove,       MFC0)             \
+    X(DMFC0,         "dmfc0",     Cop0,         1,  CopMove,       DMFC0)            \
+    X(MTC0,          "mtc0",      Cop0,         4,  CopMove,       MTC0)             \
+    X(DMTC0,         "dmtc0",     Cop0,         5,  CopMove,       DMTC0)            \
+    X(c_TLBR,        "tlbr",      Cop0Function, 1,  None,          c_TLBR)           \
+    X(c_TLBWI,       "tlbwi",     Cop0Function, 2,  None,          c_TLBWI)          \
+    X(c_TLBWR,       "tlbwr",     Cop0Function, 6,  None,          c_TLBWR)          \
+    X(c_TLBP,        "tlbp",      Cop0Function, 8,  None,          c_TLBP)           \
+    X(c_WAIT,        "wait",      Cop0Function, 17, None,          c_WAIT)           \
+    X(c_ERET,        "eret",      Cop0Function, 24, None,          c_ERET)           \
+    X(f_MFC1,        "mfc1",      Cop1,         0,  FloatMove,     f_MFC1)           \
+    X(f_DMFC1,       "dmfc1",     Cop1,         1,  FloatMove,     f_DMFC1)          \
+    X(f_CFC1,        "cfc1",      Cop1,         2,  CopMove,       f_CFC1)           \
+    X(f_DCFC1,       "dcfc1",     Cop1,         3,  CopMove,       f_UNIMPLEMENTED)  \
+    X(f_MTC1,        "mtc1",      Cop1,         4,  FloatMove,     f_MTC1)           \
+    X(f_DMTC1,       "dmtc1",     Cop1,         5,  FloatMove,     f_DMTC1)          \
+    X(f_CTC1,        "ctc1",      Cop1,         6,  CopMove,       f_CTC1)           \
+    X(f_DCTC1,       "dctc1",     Cop1,         7,  CopMove,       f_UNIMPLEMENTED)  \
+    X(f_RESERVED,    "cop1",      None,         0,  None,          f_RESERVED)       \
+    X(f_BC1F,        "bc1f",      Cop1Branch,   0,  FloatBranch,   f_BC1F)           \
+    X(f_BC1T,        "bc1t",      Cop1Branch,   1,  FloatBranch,   f_BC1T)           \
+    X(f_BC1FL,       "bc1fl",     Cop1Branch,   2,  FloatBranch,   f_BC1FL)          \
+    X(f_BC1TL,       "bc1tl",     Cop1Branch,   3,  FloatBranch,   f_BC1TL)          \
+    X(f_ADD,         "add",       Cop1Function, 0,  FloatThree,    f_ADD)            \
+    X(f_SUB,         "sub",       Cop1Function, 1,  FloatThree,    f_SUB)            \
+    X(f_MUL,         "mul",       Cop1Function, 2,  FloatThree,    f_MUL)            \
+    X(f_DIV,         "div",       Cop1Function, 3,  FloatThree,    f_DIV)            \
+    X(f_SQRT,        "sqrt",      Cop1Function, 4,  FloatTwo,      f_SQRT)           \
+    X(f_ABS,         "abs",       Cop1Function, 5,  FloatTwo,      f_ABS)            \
+    X(f_MOV,         "mov",       Cop1Function, 6,  FloatTwo,      f_MOV)            \
+    X(f_NEG,         "neg",       Cop1Function, 7,  FloatTwo,      f_NEG)            \
+    X(f_ROUNDL,      "round.l",   Cop1Function, 8,  FloatTwo,      f_ROUNDL)         \
+    X(f_TRUNCL,      "trunc.l",   Cop1Function, 9,  FloatTwo,      f_TRUNCL)         \
+    X(f_CEILL,       "ceil.l",    Cop1Function, 10, FloatTwo,      f_CEILL)          \
+    X(f_FLOORL,      "floor.l",   Cop1Function, 11, FloatTwo,      f_FLOORL)         \
+    X(f_ROUNDW,      "round.w",   Cop1Function, 12, FloatTwo,      f_ROUNDW)         \
+    X(f_TRUNCW,      "trunc.w",   Cop1Function, 13, FloatTwo,      f_TRUNCW)         \
+    X(f_CEILW,       "ceil.w",    Cop1Function, 14, FloatTwo,      f_CEILW)          \
+    X(f_FLOORW,      "floor.w",   Cop1Function, 15, FloatTwo,      f_FLOORW)         \
+    X(f_CVTS,        "cvt.s",     Cop1Function, 32, FloatTwo,      f_CVTS)           \
+    X(f_CVTD,        "cvt.d",     Cop1Function, 33, FloatTwo,      f_CVTD)           \
+    X(f_CVTW,        "cvt.w",     Cop1Function, 36, FloatTwo,      f_CVTW)           \
+    X(f_CVTL,        "cvt.l",     Cop1Function, 37, FloatTwo,      f_CVTL)           \
+    X(f_CF,          "c.f",       Cop1Function, 48, FloatCompare,  f_CF)             \
+    X(f_CUN,         "c.un",      Cop1Function, 49, FloatCompare,  f_CUN)            \
+    X(f_CEQ,         "c.eq",      Cop1Function, 50, FloatCompare,  f_CEQ)            \
+    X(f_CUEQ,        "c.ueq",     Cop1Function, 51, FloatCompare,  f_CUEQ)           \
+    X(f_COLT,        "c.olt",     Cop1Function, 52, FloatCompare,  f_COLT)           \
+    X(f_CULT,        "c.ult",     Cop1Function, 53, FloatCompare,  f_CULT)           \
+    X(f_COLE,        "c.ole",     Cop1Function, 54, FloatCompare,  f_COLE)           \
+    X(f_CULE,        "c.ule",     Cop1Function, 55, FloatCompare,  f_CULE)           \
+    X(f_CSF,         "c.sf",      Cop1Function, 56, FloatCompare,  f_CSF)            \
+    X(f_CNGLE,       "c.ngle",    Cop1Function, 57, FloatCompare,  f_CNGLE)          \
+    X(f_CSEQ,        "c.seq",     Cop1Function, 58, FloatCompare,  f_CSEQ)           \
+    X(f_CNGL,        "c.ngl",     Cop1Function, 59, FloatCompare,  f_CNGL)           \
+    X(f_CLT,         "c.lt",      Cop1Function, 60, FloatCompare,  f_CLT)            \
+    X(f_CNGE,        "c.nge",     Cop1Function, 61, FloatCompare,  f_CNGE)           \
+    X(f_CLE,         "c.le",      Cop1Function, 62, FloatCompare,  f_CLE)            \
+    X(f_CNGT,        "c.ngt",     Cop1Function, 63, FloatCompare,  f_CNGT)           \
+    X(MFC2,          "mfc2",      Cop2,         0,  CopMove,       MFC2)             \
+    X(DMFC2,         "dmfc2",     Cop2,         1,  CopMove,       DMFC2)            \
+    X(CFC2,          "cfc2",      Cop2,         2,  CopMove,       CFC2)             \
+    X(MTC2,          "mtc2",      Cop2,         4,  CopMove,       MTC2)             \
+    X(DMTC2,         "dmtc2",     Cop2,         5,  CopMove,       DMTC2)            \
+    X(CTC2,          "ctc2",      Cop2,         6,  CopMove,       CTC2)             \
+    X(COP2_RESERVED, "cop2",      None,         0,  None,          COP2_RESERVED)
+    // clang-format on
+
+    enum class Opcode : uint16_t
+    {
+#define X(name, mnemonic, group, index, format, handler) name,
+        CPU_OPCODES
+#undef X
+            Count
+    };
+
+    constexpr size_t OPCODE_COUNT = static_cast<size_t>(Opcode::Count);
+
+    struct OpcodeInfo
+    {
+        const char* mnemonic;
+        DecodeGroup group;
+        uint8_t index;
+        OperandFormat format;
+    };
+
+    constexpr std::array<OpcodeInfo, OPCODE_COUNT> OPCODE_INFO = {{
+#define X(name, mnemonic, group, index, format, handler) \
+    {mnemonic, DecodeGroup::group, index, OperandFormat::format},
+        CPU_OPCODES
+#undef X
+    }};
+
+    constexpr bool is_cop1_group(DecodeGroup group)
+    {
+        return group == DecodeGroup::Cop1 || group == DecodeGroup::Cop1Branch ||
+               group == DecodeGroup::Cop1Function;
+    }
+
+    template <DecodeGroup Group, size_t Size>
+    constexpr std::array<Opcode, Size> make_decode_table(Opcode fallback)
+    {
+        std::array<Opcode, Size> table{};
+        table.fill(fallback);
+        for (size_t i = 0; i < OPCODE_COUNT; i++)
+        {
+            if (OPCODE_INFO[i].group == Group)
+            {
+                table[OPCODE_INFO[i].index] = static_cast<Opcode>(i);
+            }
+        }
+        return table;
+    }
+
+    // The rs values of COP1 and COP2 that aren't moves or branches raise an exception instead
+    // of being invalid
+    constexpr auto PRIMARY_DECODE = make_decode_table<DecodeGroup::Primary, 64>(Opcode::INVALID);
+    constexpr auto SPECIAL_DECODE = make_decode_table<DecodeGroup::Special, 64>(Opcode::INVALID);
+    constexpr auto REGIMM_DECODE = make_decode_table<DecodeGroup::Regimm, 32>(Opcode::INVALID);
+    constexpr auto COP0_DECODE = make_decode_table<DecodeGroup::Cop0, 16>(Opcode::INVALID);
+    constexpr auto COP0_FUNCTION_DECODE =
+        make_decode_table<DecodeGroup::Cop0Function, 64>(Opcode::INVALID);
+    constexpr auto COP1_DECODE = make_decode_table<DecodeGroup::Cop1, 16>(Opcode::f_RESERVED);
+    constexpr auto COP1_BRANCH_DECODE =
+        make_decode_table<DecodeGroup::Cop1Branch, 32>(Opcode::INVALID);
+    constexpr auto COP1_FUNCTION_DECODE =
+        make_decode_table<DecodeGroup::Cop1Function, 64>(Opcode::INVALID);
+    constexpr auto COP2_DECODE = make_decode_table<DecodeGroup::Cop2, 32>(Opcode::COP2_RESERVED);
+
+    constexpr Opcode decode_opcode(uint32_t word)
+    {
+        uint32_t op = word >> 26;
+        uint32_t rs = (word >> 21) & 0b11111;
+        uint32_t rt = (word >> 16) & 0b11111;
+        uint32_t func = word & 0b111111;
+        switch (op)
+        {
+            case 0:
+                return SPECIAL_DECODE[func];
+            case 1:
+                return REGIMM_DECODE[rt];
+            case 16:
+                return (rs & 0b10000) ? COP0_FUNCTION_DECODE[func] : COP0_DECODE[rs];
+            case 17:
+                if (rs == 0b01000)
+                {
+                    return COP1_BRANCH_DECODE[rt];
+                }
+                // Every format goes through the same handler, which picks the type from fmt
+                return (rs & 0b10000) ? COP1_FUNCTION_DECODE[func] : COP1_DECODE[rs];
+            case 18:
+                return COP2_DECODE[rs];
+            default:
+                return PRIMARY_DECODE[op];
+        }
+    }
+
+    static_assert(decode_opcode(0x27BD'FFE0) == Opcode::ADDIU);
+    static_assert(decode_opcode(0x0000'0000) == Opcode::s_SLL);
+    static_assert(decode_opcode(0x4200'0018) == Opcode::c_ERET);
+    static_assert(decode_opcode(0x4501'0004) == Opcode::f_BC1T);
+    static_assert(decode_opcode(0x4602'0800) == Opcode::f_ADD);
+    static_assert(decode_opcode(0x4680'0020) == Opcode::f_CVTS);
+    static_assert(decode_opcode(0x4520'0000) == Opcode::f_RESERVED);
+
+    // An instruction word with its handler looked up when the block holding it is compiled,
+    // used by the block cache and the recompiler. The interpreter and the disassembler call
+    // decode_opcode themselves
+    struct DecodedInstruction
+    {
+        void (*handler)(CPU*);
+        Instruction instruction;
+    };
+
+    std::string disassemble_instruction(Instruction instruction, uint32_t vaddr,
+                                        bool register_names);
+} // namespace hydra::N64
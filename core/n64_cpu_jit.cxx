@@ -0,0 +1,999 @@
+#include <core/n64_cpu.hxx>
+#include <core/n64_cpu_jit.hxx>
+#include <cstring>
+
+#if CPU_JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+namespace hydra::N64
+{
+    X64CodeBuffer::X64CodeBuffer(size_t size)
+    {
+#if CPU_JIT_SUPPORTED
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+        {
+            Logger::Warn("Failed to allocate executable memory, the JIT is disabled");
+            return;
+        }
+        memory_ = static_cast<uint8_t*>(memory);
+        size_ = size;
+#else
+        (void)size;
+#endif
+    }
+
+    X64CodeBuffer::~X64CodeBuffer()
+    {
+#if CPU_JIT_SUPPORTED
+        if (memory_)
+        {
+            munmap(memory_, size_);
+        }
+#endif
+    }
+
+    /**
+        Translates a CachedBlock to host code
+
+        Guest registers stay in gpr_regs_/hi_/lo_, host registers only hold temporaries.
+        Simple integer instructions and branches are emitted inline, everything else calls the
+        same handler the interpreter would after setting up pc_, next_pc_ and friends like Tick
+        does. The generated function returns the number of instructions it executed.
+
+        rbx: CPU*
+        r12: &CPUBus::time_
+        r13: address after the delay slot of the current branch
+        r14: was_branch_ of the current branch
+        r15: base of the guest address space, when fastmem is available
+    */
+    class CPURecompiler final
+    {
+    public:
+        CPURecompiler(CPU& cpu, CachedBlock& block, uint64_t vaddr)
+            : cpu_(cpu), block_(block), vaddr_(vaddr),
+              guest_base_(cpu.cpubus_.guest_memory_.Base())
+        {
+        }
+
+        // Returns the number of instructions compiled, zero if the block can't be compiled
+        uint32_t Compile()
+        {
+            const std::vector<DecodedInstruction>& instructions = block_.instructions;
+            uint32_t length = instructions.size();
+            for (uint32_t i = 0; i < instructions.size(); i++)
+            {
+                // A branch needs its delay slot in the same block, and branches in delay
+                // slots are left to the interpreter
+                if (is_branch(instructions[i].instruction) &&
+                    (i + 1 == instructions.size() || is_branch(instructions[i + 1].instruction)))
+                {
+                    length = i;
+                    break;
+                }
+            }
+
+            if (length == 0)
+            {
+                return 0;
+            }
+
+            emit_prologue();
+            for (uint32_t i = 0; i < length; i++)
+            {
+                const DecodedInstruction& cached = instructions[i];
+                bool delay_slot = i != 0 && is_branch(instructions[i - 1].instruction);
+                if (is_branch(cached.instruction))
+                {
+                    if (!emit_branch(cached.instruction, i))
+                    {
+                        emit_fallback(cached, i, false);
+                        e_.mov64(X64Reg::R13, X64Reg::RBX, offset(&cpu_.next_pc_));
+                        e_.movzx8(X64Reg::R14, X64Reg::RBX, offset(&cpu_.was_branch_));
+                    }
+                }
+                else if (guest_base_ && is_fastmem_access(cached.instruction))
+                {
+                    emit_fastmem_access(cached, i, delay_slot);
+                }
+                else if (!emit_native(cached.instruction))
+                {
+                    emit_fallback(cached, i, delay_slot);
+                }
+                else
+                {
+                    pending_time_++;
+                }
+            }
+
+            sync_time();
+            uint32_t last = length - 1;
+            e_.store32_imm(X64Reg::RBX, offset(&cpu_.instruction_),
+                           instructions[last].instruction.full);
+            if (last != 0 && is_branch(instructions[last - 1].instruction))
+            {
+                store_pc(offset(&cpu_.prev_pc_), address(last));
+                e_.store64(X64Reg::RBX, offset(&cpu_.pc_), X64Reg::R13);
+                e_.lea64(X64Reg::RAX, X64Reg::R13, 4);
+                e_.store64(X64Reg::RBX, offset(&cpu_.next_pc_), X64Reg::RAX);
+                e_.store8(X64Reg::RBX, offset(&cpu_.prev_branch_), X64Reg::R14);
+                e_.store8_imm(X64Reg::RBX, offset(&cpu_.was_branch_), 0);
+            }
+            else
+            {
+                write_pc_state(address(last), address(last) + 4);
+            }
+            exit(length);
+            emit_epilogue();
+            return length;
+        }
+
+        const std::vector<uint8_t>& Code()
+        {
+            return e_.Code();
+        }
+
+        // Offsets of the guest memory accesses in the code and of the handler call to
+        // continue at when they fault
+        const std::vector<std::pair<size_t, size_t>>& FaultSites()
+        {
+            return fault_sites_;
+        }
+
+    private:
+        int32_t offset(const void* member)
+        {
+            return static_cast<int32_t>(reinterpret_cast<const uint8_t*>(member) -
+                                        reinterpret_cast<const uint8_t*>(&cpu_));
+        }
+
+        int32_t gpr(uint32_t reg)
+        {
+            return offset(&cpu_.gpr_regs_[reg]);
+        }
+
+        uint64_t address(uint32_t index)
+        {
+            return vaddr_ + index * 4;
+        }
+
+        void load(X64Reg dst, uint32_t reg)
+        {
+            if (reg == 0)
+                e_.xor32(dst, dst);
+            else
+                e_.mov64(dst, X64Reg::RBX, gpr(reg));
+        }
+
+        void load32(X64Reg dst, uint32_t reg)
+        {
+            if (reg == 0)
+                e_.xor32(dst, dst);
+            else
+                e_.mov32(dst, X64Reg::RBX, gpr(reg));
+        }
+
+        void load32_signed(X64Reg dst, uint32_t reg)
+        {
+            if (reg == 0)
+                e_.xor32(dst, dst);
+            else
+                e_.movsxd(dst, X64Reg::RBX, gpr(reg));
+        }
+
+        void store(uint32_t reg, X64Reg src)
+        {
+            e_.store64(X64Reg::RBX, gpr(reg), src);
+        }
+
+        void store_pc(int32_t disp, uint64_t value)
+        {
+            if (static_cast<int64_t>(value) == static_cast<int32_t>(value))
+            {
+                e_.store64_imm(X64Reg::RBX, disp, static_cast<int32_t>(value));
+            }
+            else
+            {
+                e_.mov64_imm(X64Reg::RAX, value);
+                e_.store64(X64Reg::RBX, disp, X64Reg::RAX);
+            }
+        }
+
+        // State as Tick leaves it after a non branch instruction at prev_pc
+        void write_pc_state(uint64_t prev_pc, uint64_t pc)
+        {
+            store_pc(offset(&cpu_.prev_pc_), prev_pc);
+            store_pc(offset(&cpu_.pc_), pc);
+            store_pc(offset(&cpu_.next_pc_), pc + 4);
+            e_.store8_imm(X64Reg::RBX, offset(&cpu_.prev_branch_), 0);
+            e_.store8_imm(X64Reg::RBX, offset(&cpu_.was_branch_), 0);
+        }
+
+        void add_time(uint32_t instructions)
+        {
+            if (instructions != 0)
+            {
+                e_.add64_mem_imm(X64Reg::R12, 0, instructions);
+            }
+        }
+
+        void sync_time()
+        {
+            add_time(pending_time_);
+            pending_time_ = 0;
+        }
+
+        void exit(uint32_t executed)
+        {
+            e_.mov64_imm(X64Reg::RAX, executed);
+            exits_.push_back(e_.jmp());
+        }
+
+        void exit_if(X64Cond cond, uint32_t executed)
+        {
+            X64Emitter::Label skip = e_.jcc(invert_condition(cond));
+            exit(executed);
+            e_.Bind(skip);
+        }
+
+        void emit_prologue()
+        {
+            // Five pushes keep the stack 16 byte aligned for the handler calls
+            e_.push(X64Reg::RBX);
+            e_.push(X64Reg::R12);
+            e_.push(X64Reg::R13);
+            e_.push(X64Reg::R14);
+            e_.push(X64Reg::R15);
+            e_.mov64(X64Reg::RBX, X64Reg::RDI);
+            e_.mov64_imm(X64Reg::R12, reinterpret_cast<uint64_t>(&cpu_.cpubus_.time_));
+            if (guest_base_)
+            {
+                e_.mov64_imm(X64Reg::R15, reinterpret_cast<uint64_t>(guest_base_));
+            }
+            e_.store64_imm(X64Reg::RBX, gpr(0), 0);
+        }
+
+        void emit_epilogue()
+        {
+            for (X64Emitter::Label label : exits_)
+            {
+                e_.Bind(label);
+            }
+            e_.pop(X64Reg::R15);
+            e_.pop(X64Reg::R14);
+            e_.pop(X64Reg::R13);
+            e_.pop(X64Reg::R12);
+            e_.pop(X64Reg::RBX);
+            e_.ret();
+        }
+
+        // Sets up the state the handler expects and calls it, time is the caller's business
+        void emit_call(const DecodedInstruction& cached, uint32_t index, bool delay_slot)
+        {
+            uint64_t pc = address(index);
+            e_.store32_imm(X64Reg::RBX, offset(&cpu_.instruction_), cached.instruction.full);
+            store_pc(offset(&cpu_.prev_pc_), pc);
+            if (delay_slot)
+            {
+                e_.store64(X64Reg::RBX, offset(&cpu_.pc_), X64Reg::R13);
+                e_.lea64(X64Reg::RAX, X64Reg::R13, 4);
+                e_.store64(X64Reg::RBX, offset(&cpu_.next_pc_), X64Reg::RAX);
+                e_.store8(X64Reg::RBX, offset(&cpu_.prev_branch_), X64Reg::R14);
+            }
+            else
+            {
+                store_pc(offset(&cpu_.pc_), pc + 4);
+                store_pc(offset(&cpu_.next_pc_), pc + 8);
+                e_.store8_imm(X64Reg::RBX, offset(&cpu_.prev_branch_), 0);
+            }
+            e_.store8_imm(X64Reg::RBX, offset(&cpu_.was_branch_), 0);
+            e_.mov64(X64Reg::RDI, X64Reg::RBX);
+            e_.mov64_imm(X64Reg::RAX, reinterpret_cast<uint64_t>(cached.handler));
+            e_.call(X64Reg::RAX);
+            e_.store64_imm(X64Reg::RBX, gpr(0), 0);
+        }
+
+        void emit_fallback(const DecodedInstruction& cached, uint32_t index, bool delay_slot)
+        {
+            pending_time_++;
+            sync_time();
+            emit_checked_call(cached, index, delay_slot);
+        }
+
+        void emit_checked_call(const DecodedInstruction& cached, uint32_t index, bool delay_slot)
+        {
+            emit_call(cached, index, delay_slot);
+
+            // Leave when the handler redirected control flow (exception, skipped delay slot),
+            // made an interrupt pending or overwrote the block
+            if (delay_slot)
+            {
+                e_.cmp64_mem_reg(X64Reg::RBX, offset(&cpu_.pc_), X64Reg::R13);
+            }
+            else
+            {
+                e_.mov64_imm(X64Reg::RAX, address(index) + 4);
+                e_.cmp64_mem_reg(X64Reg::RBX, offset(&cpu_.pc_), X64Reg::RAX);
+            }
+            exit_if(X64Cond::NE, index + 1);
+            e_.cmp8_mem_imm(X64Reg::RBX, offset(&cpu_.should_service_interrupt_), 0);
+            exit_if(X64Cond::NE, index + 1);
+
+            // SB through SD, including the coprocessor stores
+            if ((cached.instruction.IType.op & 0b101000) == 0b101000)
+            {
+                e_.mov64_imm(X64Reg::RAX, reinterpret_cast<uint64_t>(&block_.valid));
+                e_.cmp8_mem_imm(X64Reg::RAX, 0, 0);
+                exit_if(X64Cond::E, index + 1);
+            }
+        }
+
+        bool emit_branch(Instruction instruction, uint32_t index)
+        {
+            uint64_t pc = address(index);
+            uint32_t rs = instruction.RType.rs;
+            uint32_t rt = instruction.RType.rt;
+            // Same arithmetic as the interpreter, pc_ already points to the delay slot
+            int16_t offset16 = instruction.IType.immediate << 2;
+            int32_t seoffset = offset16;
+            uint64_t target = pc + 4 + seoffset;
+            uint64_t link = static_cast<int64_t>(static_cast<int32_t>(pc + 4)) + 4;
+            X64Cond cond = X64Cond::E;
+            bool likely = false;
+            switch (instruction.IType.op)
+            {
+                case 0:
+                {
+                    uint32_t rd = instruction.RType.rd;
+                    if (instruction.RType.func == 9)
+                    {
+                        // JALR with rd == r0 is left to the interpreter
+                        if (rd == 0)
+                        {
+                            return false;
+                        }
+                        e_.mov64_imm(X64Reg::RAX, link);
+                        store(rd, X64Reg::RAX);
+                    }
+                    load(X64Reg::R13, rs);
+                    e_.test32_imm(X64Reg::R13, 0b11);
+                    X64Emitter::Label aligned = e_.jcc(X64Cond::E);
+                    // Misaligned target, let the handler raise the address error
+                    add_time(pending_time_ + 1);
+                    emit_call(block_.instructions[index], index, false);
+                    exit(index + 1);
+                    e_.Bind(aligned);
+                    pending_time_++;
+                    e_.mov64_imm(X64Reg::R14, 1);
+                    return true;
+                }
+                case 2:
+                case 3:
+                {
+                    if (instruction.IType.op == 3)
+                    {
+                        e_.mov64_imm(X64Reg::RAX, link);
+                        store(31, X64Reg::RAX);
+                    }
+                    pending_time_++;
+                    e_.mov64_imm(X64Reg::R13,
+                                 (pc & 0xF000'0000) | (instruction.JType.target << 2));
+                    e_.mov64_imm(X64Reg::R14, 1);
+                    return true;
+                }
+                case 20:
+                    likely = true;
+                    [[fallthrough]];
+                case 4:
+                    load(X64Reg::RAX, rs);
+                    load(X64Reg::RCX, rt);
+                    e_.cmp(X64Reg::RAX, X64Reg::RCX);
+                    cond = X64Cond::E;
+                    break;
+                case 21:
+                    likely = true;
+                    [[fallthrough]];
+                case 5:
+                    load(X64Reg::RAX, rs);
+                    load(X64Reg::RCX, rt);
+                    e_.cmp(X64Reg::RAX, X64Reg::RCX);
+                    cond = X64Cond::NE;
+                    break;
+                case 22:
+                    likely = true;
+                    [[fallthrough]];
+                case 6:
+                    load(X64Reg::RAX, rs);
+                    e_.test(X64Reg::RAX, X64Reg::RAX);
+                    cond = X64Cond::LE;
+                    break;
+                case 23:
+                    likely = true;
+                    [[fallthrough]];
+                case 7:
+                    load(X64Reg::RAX, rs);
+                    e_.test(X64Reg::RAX, X64Reg::RAX);
+                    cond = X64Cond::G;
+                    break;
+                default:
+                    return false;
+            }
+
+            pending_time_++;
+            if (likely)
+            {
+                X64Emitter::Label taken = e_.jcc(cond);
+                // Not taken, the delay slot is skipped
+                add_time(pending_time_);
+                e_.store32_imm(X64Reg::RBX, offset(&cpu_.instruction_), instruction.full);
+                write_pc_state(pc, pc + 8);
+                exit(index + 1);
+                e_.Bind(taken);
+                e_.mov64_imm(X64Reg::R13, target);
+            }
+            else
+            {
+                e_.mov64_imm(X64Reg::R13, pc + 8);
+                e_.mov64_imm(X64Reg::RDX, target);
+                e_.cmovcc(cond, X64Reg::R13, X64Reg::RDX);
+            }
+            e_.mov64_imm(X64Reg::R14, 1);
+            return true;
+        }
+
+        // LB, LH, LW, LBU, LHU, LWU, LD, SB, SH, SW, SD
+        static bool is_fastmem_access(Instruction instruction)
+        {
+            switch (instruction.IType.op)
+            {
+                case 32:
+                case 33:
+                case 35:
+                case 36:
+                case 37:
+                case 39:
+                case 55:
+                case 40:
+                case 41:
+                case 43:
+                case 63:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // Aligned KSEG0/KSEG1 accesses go straight to the guest address space, everything
+        // else (TLB mapped, misaligned or not sign extended addresses) calls the handler.
+        // Accesses that fault because nothing is mapped there (hardware registers, the IPL)
+        // or because it's read only (cartridge ROM) are sent to the same handler call by the
+        // SIGSEGV handler
+        void emit_fastmem_access(const DecodedInstruction& cached, uint32_t index,
+                                 bool delay_slot)
+        {
+            uint32_t op = cached.instruction.IType.op;
+            uint32_t rs = cached.instruction.IType.rs;
+            uint32_t rt = cached.instruction.IType.rt;
+            int32_t seimm = static_cast<int16_t>(cached.instruction.IType.immediate);
+            uint32_t size;
+            switch (op)
+            {
+                case 32:
+                case 36:
+                case 40:
+                    size = 1;
+                    break;
+                case 33:
+                case 37:
+                case 41:
+                    size = 2;
+                    break;
+                case 55:
+                case 63:
+                    size = 8;
+                    break;
+                default:
+                    size = 4;
+                    break;
+            }
+
+            // Same as a fallback, time is updated before the access
+            pending_time_++;
+            sync_time();
+
+            std::vector<X64Emitter::Label> slow_path;
+            if (size == 8)
+            {
+                // LD and SD are reserved instructions in 32-bit User and Supervisor mode
+                e_.mov32(X64Reg::RCX, X64Reg::RBX, offset(&cpu_.opmode_));
+                e_.cmp_imm(X64Reg::RCX, static_cast<int32_t>(OperatingMode::Kernel));
+                X64Emitter::Label allowed = e_.jcc(X64Cond::E);
+                e_.cmp8_mem_imm(X64Reg::RBX, offset(&cpu_.mode64_), 0);
+                slow_path.push_back(e_.jcc(X64Cond::E));
+                e_.Bind(allowed);
+            }
+            load(X64Reg::RAX, rs);
+            e_.add_imm(true, X64Reg::RAX, seimm);
+            e_.movsxd(X64Reg::RCX, X64Reg::RAX);
+            e_.cmp(X64Reg::RCX, X64Reg::RAX);
+            slow_path.push_back(e_.jcc(X64Cond::NE));
+            e_.mov64(X64Reg::RCX, X64Reg::RAX);
+            e_.shr_imm(false, X64Reg::RCX, 30);
+            e_.cmp_imm(X64Reg::RCX, 0b10);
+            slow_path.push_back(e_.jcc(X64Cond::NE));
+            if (size > 1)
+            {
+                e_.test32_imm(X64Reg::RAX, size - 1);
+                slow_path.push_back(e_.jcc(X64Cond::NE));
+            }
+            e_.and_imm(false, X64Reg::RAX, 0x1FFF'FFFF);
+
+            size_t access;
+            if ((op & 0b101000) == 0b101000)
+            {
+                // Stores to RDRAM pages with code need the handler to invalidate blocks
+                e_.cmp_imm(X64Reg::RAX, BLOCK_RDRAM_PAGES << BLOCK_PAGE_SHIFT);
+                X64Emitter::Label outside_rdram = e_.jcc(X64Cond::AE);
+                e_.mov64(X64Reg::RDX, X64Reg::RAX);
+                e_.shr_imm(false, X64Reg::RDX, BLOCK_PAGE_SHIFT);
+                e_.mov64_imm(X64Reg::RCX, reinterpret_cast<uint64_t>(
+                                              cpu_.cpubus_.block_cache_.CodePages()));
+                e_.add(true, X64Reg::RDX, X64Reg::RCX);
+                e_.cmp8_mem_imm(X64Reg::RDX, 0, 0);
+                slow_path.push_back(e_.jcc(X64Cond::NE));
+                e_.Bind(outside_rdram);
+
+                load(X64Reg::RCX, rt);
+                switch (size)
+                {
+                    case 1:
+                        access = e_.Size();
+                        e_.store8(X64Reg::R15, X64Reg::RAX, X64Reg::RCX);
+                        break;
+                    case 2:
+                        e_.rol16_imm(X64Reg::RCX, 8);
+                        access = e_.Size();
+                        e_.store16(X64Reg::R15, X64Reg::RAX, X64Reg::RCX);
+                        break;
+                    case 4:
+                        e_.bswap(false, X64Reg::RCX);
+                        access = e_.Size();
+                        e_.store32(X64Reg::R15, X64Reg::RAX, X64Reg::RCX);
+                        break;
+                    default:
+                        e_.bswap(true, X64Reg::RCX);
+                        access = e_.Size();
+                        e_.store64(X64Reg::R15, X64Reg::RAX, X64Reg::RCX);
+                        break;
+                }
+            }
+            else
+            {
+                access = e_.Size();
+                switch (op)
+                {
+                    case 32:
+                        // LB
+                        e_.movsx8(X64Reg::RCX, X64Reg::R15, X64Reg::RAX);
+                        break;
+                    case 36:
+                        // LBU
+                        e_.movzx8(X64Reg::RCX, X64Reg::R15, X64Reg::RAX);
+                        break;
+                    case 33:
+                        // LH
+                        e_.movzx16(X64Reg::RCX, X64Reg::R15, X64Reg::RAX);
+                        e_.rol16_imm(X64Reg::RCX, 8);
+                        e_.movsx16(X64Reg::RCX, X64Reg::RCX);
+                        break;
+                    case 37:
+                        // LHU
+                        e_.movzx16(X64Reg::RCX, X64Reg::R15, X64Reg::RAX);
+                        e_.rol16_imm(X64Reg::RCX, 8);
+                        break;
+                    case 35:
+                        // LW
+                        e_.mov32(X64Reg::RCX, X64Reg::R15, X64Reg::RAX);
+                        e_.bswap(false, X64Reg::RCX);
+                        e_.movsxd(X64Reg::RCX, X64Reg::RCX);
+                        break;
+                    case 39:
+                        // LWU
+                        e_.mov32(X64Reg::RCX, X64Reg::R15, X64Reg::RAX);
+                        e_.bswap(false, X64Reg::RCX);
+                        break;
+                    default:
+                        // LD
+                        e_.mov64(X64Reg::RCX, X64Reg::R15, X64Reg::RAX);
+                        e_.bswap(true, X64Reg::RCX);
+                        break;
+                }
+                if (rt != 0)
+                {
+                    store(rt, X64Reg::RCX);
+                }
+            }
+            X64Emitter::Label done = e_.jmp();
+
+            fault_sites_.push_back({access, e_.Size()});
+            for (X64Emitter::Label label : slow_path)
+            {
+                e_.Bind(label);
+            }
+            emit_checked_call(cached, index, delay_slot);
+            e_.Bind(done);
+        }
+
+        bool emit_native(Instruction instruction)
+        {
+            uint32_t rs = instruction.IType.rs;
+            uint32_t rt = instruction.IType.rt;
+            uint32_t immediate = instruction.IType.immediate;
+            int32_t seimm = static_cast<int16_t>(immediate);
+            switch (instruction.IType.op)
+            {
+                case 0:
+                    return emit_special(instruction);
+                case 9:
+                case 10:
+                case 11:
+                case 12:
+                case 13:
+                case 14:
+                case 15:
+                case 25:
+                    break;
+                case 47:
+                    // CACHE does nothing in the interpreter either
+                    return true;
+                default:
+                    return false;
+            }
+
+            // Writes to r0 are never visible, r0 is cleared before every instruction
+            if (rt == 0)
+            {
+                return true;
+            }
+
+            switch (instruction.IType.op)
+            {
+                case 9:
+                    // ADDIU
+                    load32(X64Reg::RAX, rs);
+                    e_.add_imm(false, X64Reg::RAX, seimm);
+                    e_.movsxd(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 10:
+                    // SLTI
+                    load(X64Reg::RAX, rs);
+                    e_.cmp_imm(X64Reg::RAX, seimm);
+                    e_.setcc(X64Cond::L, X64Reg::RAX);
+                    e_.movzx8(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 11:
+                    // SLTIU
+                    load(X64Reg::RAX, rs);
+                    e_.cmp_imm(X64Reg::RAX, seimm);
+                    e_.setcc(X64Cond::B, X64Reg::RAX);
+                    e_.movzx8(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 12:
+                    // ANDI
+                    load(X64Reg::RAX, rs);
+                    e_.and_imm(true, X64Reg::RAX, immediate);
+                    break;
+                case 13:
+                    // ORI
+                    load(X64Reg::RAX, rs);
+                    e_.or_imm(X64Reg::RAX, immediate);
+                    break;
+                case 14:
+                    // XORI
+                    load(X64Reg::RAX, rs);
+                    e_.xor_imm(X64Reg::RAX, immediate);
+                    break;
+                case 15:
+                    // LUI
+                    e_.store64_imm(X64Reg::RBX, gpr(rt), static_cast<int32_t>(immediate << 16));
+                    return true;
+                case 25:
+                    // DADDIU
+                    load(X64Reg::RAX, rs);
+                    e_.add_imm(true, X64Reg::RAX, seimm);
+                    break;
+            }
+            store(rt, X64Reg::RAX);
+            return true;
+        }
+
+        bool emit_special(Instruction instruction)
+        {
+            uint32_t rs = instruction.RType.rs;
+            uint32_t rt = instruction.RType.rt;
+            uint32_t rd = instruction.RType.rd;
+            uint8_t sa = instruction.RType.sa;
+            int32_t hi = offset(&cpu_.hi_);
+            int32_t lo = offset(&cpu_.lo_);
+            switch (instruction.RType.func)
+            {
+                case 15:
+                    // SYNC
+                    return true;
+                case 17:
+                    // MTHI
+                    load(X64Reg::RAX, rs);
+                    e_.store64(X64Reg::RBX, hi, X64Reg::RAX);
+                    return true;
+                case 19:
+                    // MTLO
+                    load(X64Reg::RAX, rs);
+                    e_.store64(X64Reg::RBX, lo, X64Reg::RAX);
+                    return true;
+                case 24:
+                    // MULT
+                    load32_signed(X64Reg::RAX, rs);
+                    load32_signed(X64Reg::RCX, rt);
+                    e_.imul(X64Reg::RAX, X64Reg::RCX);
+                    e_.movsxd(X64Reg::RDX, X64Reg::RAX);
+                    e_.store64(X64Reg::RBX, lo, X64Reg::RDX);
+                    e_.sar_imm(true, X64Reg::RAX, 32);
+                    e_.store64(X64Reg::RBX, hi, X64Reg::RAX);
+                    return true;
+                case 25:
+                    // MULTU
+                    load32(X64Reg::RAX, rs);
+                    load32(X64Reg::RCX, rt);
+                    e_.imul(X64Reg::RAX, X64Reg::RCX);
+                    e_.movsxd(X64Reg::RDX, X64Reg::RAX);
+                    e_.store64(X64Reg::RBX, lo, X64Reg::RDX);
+                    e_.shr_imm(true, X64Reg::RAX, 32);
+                    e_.movsxd(X64Reg::RAX, X64Reg::RAX);
+                    e_.store64(X64Reg::RBX, hi, X64Reg::RAX);
+                    return true;
+                case 0:
+                case 2:
+                case 3:
+                case 4:
+                case 6:
+                case 7:
+                case 16:
+                case 18:
+                case 20:
+                case 22:
+                case 23:
+                case 33:
+                case 35:
+                case 36:
+                case 37:
+                case 38:
+                case 39:
+                case 42:
+                case 43:
+                case 45:
+                case 47:
+                case 56:
+                case 58:
+                case 59:
+                case 60:
+                case 62:
+                case 63:
+                    break;
+                default:
+                    return false;
+            }
+
+            if (rd == 0)
+            {
+                return true;
+            }
+
+            switch (instruction.RType.func)
+            {
+                case 0:
+                    // SLL
+                    load32(X64Reg::RAX, rt);
+                    e_.shl_imm(false, X64Reg::RAX, sa);
+                    e_.movsxd(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 2:
+                    // SRL
+                    load32(X64Reg::RAX, rt);
+                    e_.shr_imm(false, X64Reg::RAX, sa);
+                    e_.movsxd(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 3:
+                    // SRA, shifts all 64 bits and keeps the low word
+                    load(X64Reg::RAX, rt);
+                    e_.sar_imm(true, X64Reg::RAX, sa);
+                    e_.movsxd(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 4:
+                    // SLLV
+                    load32(X64Reg::RAX, rt);
+                    load32(X64Reg::RCX, rs);
+                    e_.shl_cl(false, X64Reg::RAX);
+                    e_.movsxd(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 6:
+                    // SRLV
+                    load32(X64Reg::RAX, rt);
+                    load32(X64Reg::RCX, rs);
+                    e_.shr_cl(false, X64Reg::RAX);
+                    e_.movsxd(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 7:
+                    // SRAV
+                    load(X64Reg::RAX, rt);
+                    load32(X64Reg::RCX, rs);
+                    e_.and_imm(false, X64Reg::RCX, 0b11111);
+                    e_.sar_cl(true, X64Reg::RAX);
+                    e_.movsxd(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 16:
+                    // MFHI
+                    e_.mov64(X64Reg::RAX, X64Reg::RBX, hi);
+                    break;
+                case 18:
+                    // MFLO
+                    e_.mov64(X64Reg::RAX, X64Reg::RBX, lo);
+                    break;
+                case 20:
+                    // DSLLV
+                    load(X64Reg::RAX, rt);
+                    load32(X64Reg::RCX, rs);
+                    e_.shl_cl(true, X64Reg::RAX);
+                    break;
+                case 22:
+                    // DSRLV
+                    load(X64Reg::RAX, rt);
+                    load32(X64Reg::RCX, rs);
+                    e_.shr_cl(true, X64Reg::RAX);
+                    break;
+                case 23:
+                    // DSRAV
+                    load(X64Reg::RAX, rt);
+                    load32(X64Reg::RCX, rs);
+                    e_.sar_cl(true, X64Reg::RAX);
+                    break;
+                case 33:
+                    // ADDU
+                    load32(X64Reg::RAX, rs);
+                    load32(X64Reg::RCX, rt);
+                    e_.add(false, X64Reg::RAX, X64Reg::RCX);
+                    e_.movsxd(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 35:
+                    // SUBU
+                    load32(X64Reg::RAX, rs);
+                    load32(X64Reg::RCX, rt);
+                    e_.sub(false, X64Reg::RAX, X64Reg::RCX);
+                    e_.movsxd(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 36:
+                    // AND
+                    load(X64Reg::RAX, rs);
+                    load(X64Reg::RCX, rt);
+                    e_.and_(X64Reg::RAX, X64Reg::RCX);
+                    break;
+                case 37:
+                    // OR
+                    load(X64Reg::RAX, rs);
+                    load(X64Reg::RCX, rt);
+                    e_.or_(X64Reg::RAX, X64Reg::RCX);
+                    break;
+                case 38:
+                    // XOR
+                    load(X64Reg::RAX, rs);
+                    load(X64Reg::RCX, rt);
+                    e_.xor_(X64Reg::RAX, X64Reg::RCX);
+                    break;
+                case 39:
+                    // NOR
+                    load(X64Reg::RAX, rs);
+                    load(X64Reg::RCX, rt);
+                    e_.or_(X64Reg::RAX, X64Reg::RCX);
+                    e_.not_(X64Reg::RAX);
+                    break;
+                case 42:
+                    // SLT
+                    load(X64Reg::RAX, rs);
+                    load(X64Reg::RCX, rt);
+                    e_.cmp(X64Reg::RAX, X64Reg::RCX);
+                    e_.setcc(X64Cond::L, X64Reg::RAX);
+                    e_.movzx8(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 43:
+                    // SLTU
+                    load(X64Reg::RAX, rs);
+                    load(X64Reg::RCX, rt);
+                    e_.cmp(X64Reg::RAX, X64Reg::RCX);
+                    e_.setcc(X64Cond::B, X64Reg::RAX);
+                    e_.movzx8(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 45:
+                    // DADDU
+                    load(X64Reg::RAX, rs);
+                    load(X64Reg::RCX, rt);
+                    e_.add(true, X64Reg::RAX, X64Reg::RCX);
+                    break;
+                case 47:
+                    // DSUBU
+                    load(X64Reg::RAX, rs);
+                    load(X64Reg::RCX, rt);
+                    e_.sub(true, X64Reg::RAX, X64Reg::RCX);
+                    break;
+                case 56:
+                    // DSLL
+                    load(X64Reg::RAX, rt);
+                    e_.shl_imm(true, X64Reg::RAX, sa);
+                    break;
+                case 58:
+                    // DSRL
+                    load(X64Reg::RAX, rt);
+                    e_.shr_imm(true, X64Reg::RAX, sa);
+                    break;
+                case 59:
+                    // DSRA
+                    load(X64Reg::RAX, rt);
+                    e_.sar_imm(true, X64Reg::RAX, sa);
+                    break;
+                case 60:
+                    // DSLL32
+                    load(X64Reg::RAX, rt);
+                    e_.shl_imm(true, X64Reg::RAX, sa + 32);
+                    break;
+                case 62:
+                    // DSRL32
+                    load(X64Reg::RAX, rt);
+                    e_.shr_imm(true, X64Reg::RAX, sa + 32);
+                    break;
+                case 63:
+                    // DSRA32
+                    load(X64Reg::RAX, rt);
+                    e_.sar_imm(true, X64Reg::RAX, sa + 32);
+                    break;
+            }
+            store(rd, X64Reg::RAX);
+            return true;
+        }
+
+        CPU& cpu_;
+        CachedBlock& block_;
+        uint64_t vaddr_;
+        uint8_t* guest_base_;
+        X64Emitter e_;
+        std::vector<X64Emitter::Label> exits_;
+        std::vector<std::pair<size_t, size_t>> fault_sites_;
+        // Instructions executed since time_ was last updated by the generated code
+        uint32_t pending_time_ = 0;
+    };
+
+    void CPU::compile_jit_block(CachedBlock& block)
+    {
+        block.jit_code = nullptr;
+        block.jit_vaddr = pc_;
+        block.jit_length = 0;
+#if CPU_JIT_SUPPORTED
+        CPURecompiler recompiler(*this, block, pc_);
+        uint32_t length = recompiler.Compile();
+        if (length == 0)
+        {
+            return;
+        }
+
+        const std::vector<uint8_t>& code = recompiler.Code();
+        uint8_t* memory = jit_buffer_.Current();
+        memcpy(memory, code.data(), code.size());
+        jit_buffer_.Commit(code.size());
+        for (const auto& [access, handler] : recompiler.FaultSites())
+        {
+            fault_table_.Add(memory + access, memory + handler);
+        }
+        block.jit_code = reinterpret_cast<uint32_t (*)(CPU*)>(memory);
+        block.jit_length = length;
+#endif
+    }
+} // namespace hydra::N64
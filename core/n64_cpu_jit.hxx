@@ -0,0 +1,764 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define CPU_JIT_SUPPORTED 1
+#else
+#define CPU_JIT_SUPPORTED 0
+#endif
+
+namespace hydra::N64
+{
+    // Upper bound for the code of one block, the buffer is flushed when less than this is left
+    constexpr size_t JIT_MAX_BLOCK_SIZE = 64 * 1024;
+    // Every fault site is a memory access of at least 4 bytes
+    constexpr size_t JIT_MAX_FAULT_SITES = JIT_MAX_BLOCK_SIZE / 4;
+
+    enum class X64Reg : uint8_t
+    {
+        RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+        R8, R9, R10, R11, R12, R13, R14, R15,
+    };
+
+    enum class X64Cond : uint8_t
+    {
+        O, NO, B, AE, E, NE, BE, A, S, NS, P, NP, L, GE, LE, G,
+    };
+
+    enum class X64Xmm : uint8_t
+    {
+        XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7,
+        XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15,
+    };
+
+    constexpr X64Cond invert_condition(X64Cond cond)
+    {
+        return static_cast<X64Cond>(static_cast<uint8_t>(cond) ^ 1);
+    }
+
+    // Executable memory for generated code. Everything is thrown away at once when it
+    // runs out of space, which keeps the bookkeeping down to a single bump pointer
+    class X64CodeBuffer final
+    {
+    public:
+        X64CodeBuffer(size_t size);
+        ~X64CodeBuffer();
+        X64CodeBuffer(const X64CodeBuffer&) = delete;
+        X64CodeBuffer& operator=(const X64CodeBuffer&) = delete;
+
+        bool IsAvailable()
+        {
+            return memory_ != nullptr;
+        }
+
+        // Whether there's room left for at least one more block of the largest size
+        bool HasSpace(size_t needed)
+        {
+            return size_ - used_ >= needed;
+        }
+
+        uint8_t* Current()
+        {
+            return memory_ + used_;
+        }
+
+        uint8_t* Begin()
+        {
+            return memory_;
+        }
+
+        uint8_t* End()
+        {
+            return memory_ + size_;
+        }
+
+        void Commit(size_t size)
+        {
+            used_ += size;
+        }
+
+        void Reset()
+        {
+            used_ = 0;
+        }
+
+    private:
+        uint8_t* memory_ = nullptr;
+        size_t size_ = 0;
+        size_t used_ = 0;
+    };
+
+    // Minimal x86-64 encoder, only the instructions the recompilers need. Code is built in
+    // a vector and copied to executable memory once the block is complete, so jumps are
+    // encoded with rel32 displacements that stay valid after the copy
+    class X64Emitter final
+    {
+    public:
+        using Label = size_t;
+
+        const std::vector<uint8_t>& Code()
+        {
+            return code_;
+        }
+
+        size_t Size()
+        {
+            return code_.size();
+        }
+
+        void Clear()
+        {
+            code_.clear();
+        }
+
+        void push(X64Reg reg)
+        {
+            rex(false, 0, 0, id(reg), false);
+            emit8(0x50 | (id(reg) & 7));
+        }
+
+        void pop(X64Reg reg)
+        {
+            rex(false, 0, 0, id(reg), false);
+            emit8(0x58 | (id(reg) & 7));
+        }
+
+        void ret()
+        {
+            emit8(0xC3);
+        }
+
+        void call(X64Reg reg)
+        {
+            rex(false, 0, 0, id(reg), false);
+            emit8(0xFF);
+            modrm_reg(2, id(reg));
+        }
+
+        // Loads and stores, always [base + disp]
+        void mov64(X64Reg dst, X64Reg base, int32_t disp)
+        {
+            op_mem(true, {0x8B}, id(dst), base, disp);
+        }
+
+        void mov32(X64Reg dst, X64Reg base, int32_t disp)
+        {
+            op_mem(false, {0x8B}, id(dst), base, disp);
+        }
+
+        void movsxd(X64Reg dst, X64Reg base, int32_t disp)
+        {
+            op_mem(true, {0x63}, id(dst), base, disp);
+        }
+
+        void movzx8(X64Reg dst, X64Reg base, int32_t disp)
+        {
+            op_mem(false, {0x0F, 0xB6}, id(dst), base, disp);
+        }
+
+        void store64(X64Reg base, int32_t disp, X64Reg src)
+        {
+            op_mem(true, {0x89}, id(src), base, disp);
+        }
+
+        void store8(X64Reg base, int32_t disp, X64Reg src)
+        {
+            op_mem(false, {0x88}, id(src), base, disp, true);
+        }
+
+        void store64_imm(X64Reg base, int32_t disp, int32_t imm)
+        {
+            op_mem(true, {0xC7}, 0, base, disp);
+            emit32(imm);
+        }
+
+        void store32_imm(X64Reg base, int32_t disp, uint32_t imm)
+        {
+            op_mem(false, {0xC7}, 0, base, disp);
+            emit32(imm);
+        }
+
+        void store8_imm(X64Reg base, int32_t disp, uint8_t imm)
+        {
+            op_mem(false, {0xC6}, 0, base, disp);
+            emit8(imm);
+        }
+
+        void movzx16(X64Reg dst, X64Reg base, int32_t disp)
+        {
+            op_mem(false, {0x0F, 0xB7}, id(dst), base, disp);
+        }
+
+        void store32(X64Reg base, int32_t disp, X64Reg src)
+        {
+            op_mem(false, {0x89}, id(src), base, disp);
+        }
+
+        void store16(X64Reg base, int32_t disp, X64Reg src)
+        {
+            emit8(0x66);
+            op_mem(false, {0x89}, id(src), base, disp);
+        }
+
+        // Loads and stores with [base + index], used for guest memory accesses
+        void movzx8(X64Reg dst, X64Reg base, X64Reg index)
+        {
+            op_mem_index(false, {0x0F, 0xB6}, id(dst), base, index);
+        }
+
+        void movsx8(X64Reg dst, X64Reg base, X64Reg index)
+        {
+            op_mem_index(true, {0x0F, 0xBE}, id(dst), base, index);
+        }
+
+        void movzx16(X64Reg dst, X64Reg base, X64Reg index)
+        {
+            op_mem_index(false, {0x0F, 0xB7}, id(dst), base, index);
+        }
+
+        void mov32(X64Reg dst, X64Reg base, X64Reg index)
+        {
+            op_mem_index(false, {0x8B}, id(dst), base, index);
+        }
+
+        void mov64(X64Reg dst, X64Reg base, X64Reg index)
+        {
+            op_mem_index(true, {0x8B}, id(dst), base, index);
+        }
+
+        void store8(X64Reg base, X64Reg index, X64Reg src)
+        {
+            op_mem_index(false, {0x88}, id(src), base, index, true);
+        }
+
+        void store16(X64Reg base, X64Reg index, X64Reg src)
+        {
+            emit8(0x66);
+            op_mem_index(false, {0x89}, id(src), base, index);
+        }
+
+        void store32(X64Reg base, X64Reg index, X64Reg src)
+        {
+            op_mem_index(false, {0x89}, id(src), base, index);
+        }
+
+        void store64(X64Reg base, X64Reg index, X64Reg src)
+        {
+            op_mem_index(true, {0x89}, id(src), base, index);
+        }
+
+        void add64_mem_imm(X64Reg base, int32_t disp, int32_t imm)
+        {
+            op_mem(true, {0x81}, 0, base, disp);
+            emit32(imm);
+        }
+
+        void cmp8_mem_imm(X64Reg base, int32_t disp, uint8_t imm)
+        {
+            op_mem(false, {0x80}, 7, base, disp);
+            emit8(imm);
+        }
+
+        void cmp64_mem_reg(X64Reg base, int32_t disp, X64Reg reg)
+        {
+            op_mem(true, {0x39}, id(reg), base, disp);
+        }
+
+        void lea64(X64Reg dst, X64Reg base, int32_t disp)
+        {
+            op_mem(true, {0x8D}, id(dst), base, disp);
+        }
+
+        // Register to register
+        void mov64(X64Reg dst, X64Reg src)
+        {
+            op_reg(true, {0x89}, id(src), id(dst));
+        }
+
+        void mov64_imm(X64Reg dst, uint64_t imm)
+        {
+            if (imm <= 0xFFFF'FFFF)
+            {
+                rex(false, 0, 0, id(dst), false);
+                emit8(0xB8 | (id(dst) & 7));
+                emit32(static_cast<uint32_t>(imm));
+            }
+            else if (static_cast<int64_t>(imm) == static_cast<int32_t>(imm))
+            {
+                op_reg(true, {0xC7}, 0, id(dst));
+                emit32(static_cast<uint32_t>(imm));
+            }
+            else
+            {
+                rex(true, 0, 0, id(dst), false);
+                emit8(0xB8 | (id(dst) & 7));
+                emit64(imm);
+            }
+        }
+
+        void movsxd(X64Reg dst, X64Reg src)
+        {
+            op_reg(true, {0x63}, id(dst), id(src));
+        }
+
+        void movzx8(X64Reg dst, X64Reg src)
+        {
+            op_reg(false, {0x0F, 0xB6}, id(dst), id(src), true);
+        }
+
+        void movsx16(X64Reg dst, X64Reg src)
+        {
+            op_reg(true, {0x0F, 0xBF}, id(dst), id(src));
+        }
+
+        void bswap(bool wide, X64Reg reg)
+        {
+            rex(wide, 0, 0, id(reg), false);
+            emit8(0x0F);
+            emit8(0xC8 | (id(reg) & 7));
+        }
+
+        // Swaps the bytes of the low halfword with an amount of 8
+        void rol16_imm(X64Reg reg, uint8_t amount)
+        {
+            emit8(0x66);
+            op_reg(false, {0xC1}, 0, id(reg));
+            emit8(amount);
+        }
+
+        void add(bool wide, X64Reg dst, X64Reg src)
+        {
+            op_reg(wide, {0x01}, id(src), id(dst));
+        }
+
+        void sub(bool wide, X64Reg dst, X64Reg src)
+        {
+            op_reg(wide, {0x29}, id(src), id(dst));
+        }
+
+        void and_(X64Reg dst, X64Reg src)
+        {
+            op_reg(true, {0x21}, id(src), id(dst));
+        }
+
+        void or_(X64Reg dst, X64Reg src)
+        {
+            op_reg(true, {0x09}, id(src), id(dst));
+        }
+
+        void xor_(X64Reg dst, X64Reg src)
+        {
+            op_reg(true, {0x31}, id(src), id(dst));
+        }
+
+        void xor32(X64Reg dst, X64Reg src)
+        {
+            op_reg(false, {0x31}, id(src), id(dst));
+        }
+
+        void cmp(X64Reg lhs, X64Reg rhs)
+        {
+            op_reg(true, {0x39}, id(rhs), id(lhs));
+        }
+
+        void not_(X64Reg reg)
+        {
+            op_reg(true, {0xF7}, 2, id(reg));
+        }
+
+        void test(X64Reg lhs, X64Reg rhs)
+        {
+            op_reg(true, {0x85}, id(rhs), id(lhs));
+        }
+
+        void test32_imm(X64Reg reg, uint32_t imm)
+        {
+            op_reg(false, {0xF7}, 0, id(reg));
+            emit32(imm);
+        }
+
+        void imul(X64Reg dst, X64Reg src)
+        {
+            op_reg(true, {0x0F, 0xAF}, id(dst), id(src));
+        }
+
+        void add_imm(bool wide, X64Reg dst, int32_t imm)
+        {
+            alu_imm(wide, 0, dst, imm);
+        }
+
+        void or_imm(X64Reg dst, int32_t imm)
+        {
+            alu_imm(true, 1, dst, imm);
+        }
+
+        void and_imm(bool wide, X64Reg dst, int32_t imm)
+        {
+            alu_imm(wide, 4, dst, imm);
+        }
+
+        void xor_imm(X64Reg dst, int32_t imm)
+        {
+            alu_imm(true, 6, dst, imm);
+        }
+
+        void cmp_imm(X64Reg dst, int32_t imm)
+        {
+            alu_imm(true, 7, dst, imm);
+        }
+
+        void shl_imm(bool wide, X64Reg reg, uint8_t amount)
+        {
+            shift_imm(wide, 4, reg, amount);
+        }
+
+        void shr_imm(bool wide, X64Reg reg, uint8_t amount)
+        {
+            shift_imm(wide, 5, reg, amount);
+        }
+
+        void sar_imm(bool wide, X64Reg reg, uint8_t amount)
+        {
+            shift_imm(wide, 7, reg, amount);
+        }
+
+        // Shifts by cl
+        void shl_cl(bool wide, X64Reg reg)
+        {
+            op_reg(wide, {0xD3}, 4, id(reg));
+        }
+
+        void shr_cl(bool wide, X64Reg reg)
+        {
+            op_reg(wide, {0xD3}, 5, id(reg));
+        }
+
+        void sar_cl(bool wide, X64Reg reg)
+        {
+            op_reg(wide, {0xD3}, 7, id(reg));
+        }
+
+        void setcc(X64Cond cond, X64Reg reg)
+        {
+            op_reg(false, {0x0F, static_cast<uint8_t>(0x90 | static_cast<uint8_t>(cond))}, 0,
+                   id(reg), true);
+        }
+
+        void cmovcc(X64Cond cond, X64Reg dst, X64Reg src)
+        {
+            op_reg(true, {0x0F, static_cast<uint8_t>(0x40 | static_cast<uint8_t>(cond))},
+                   id(dst), id(src));
+        }
+
+        // SSE2 on 16-bit lanes, enough for the RSP vector unit
+        void movdqu(X64Xmm dst, X64Reg base, int32_t disp)
+        {
+            emit8(0xF3);
+            op_mem(false, {0x0F, 0x6F}, id(dst), base, disp);
+        }
+
+        void movdqu(X64Reg base, int32_t disp, X64Xmm src)
+        {
+            emit8(0xF3);
+            op_mem(false, {0x0F, 0x7F}, id(src), base, disp);
+        }
+
+        void movdqa(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0x6F, dst, src);
+        }
+
+        void paddw(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0xFD, dst, src);
+        }
+
+        void psubw(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0xF9, dst, src);
+        }
+
+        void psubusw(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0xD9, dst, src);
+        }
+
+        void pmullw(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0xD5, dst, src);
+        }
+
+        void pmulhw(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0xE5, dst, src);
+        }
+
+        void pmulhuw(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0xE4, dst, src);
+        }
+
+        void pand(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0xDB, dst, src);
+        }
+
+        // dst = ~dst & src
+        void pandn(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0xDF, dst, src);
+        }
+
+        void por(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0xEB, dst, src);
+        }
+
+        void pxor(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0xEF, dst, src);
+        }
+
+        void pcmpeqw(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0x75, dst, src);
+        }
+
+        void pcmpgtw(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0x65, dst, src);
+        }
+
+        void punpcklwd(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0x61, dst, src);
+        }
+
+        void punpckhwd(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0x69, dst, src);
+        }
+
+        void packssdw(X64Xmm dst, X64Xmm src)
+        {
+            sse_op(0x6B, dst, src);
+        }
+
+        void psllw_imm(X64Xmm reg, uint8_t amount)
+        {
+            sse_shift_imm(0x71, 6, reg, amount);
+        }
+
+        void psrlw_imm(X64Xmm reg, uint8_t amount)
+        {
+            sse_shift_imm(0x71, 2, reg, amount);
+        }
+
+        void psraw_imm(X64Xmm reg, uint8_t amount)
+        {
+            sse_shift_imm(0x71, 4, reg, amount);
+        }
+
+        void psrad_imm(X64Xmm reg, uint8_t amount)
+        {
+            sse_shift_imm(0x72, 4, reg, amount);
+        }
+
+        void pshuflw(X64Xmm dst, X64Xmm src, uint8_t order)
+        {
+            emit8(0xF2);
+            op_reg(false, {0x0F, 0x70}, id(dst), id(src));
+            emit8(order);
+        }
+
+        void pshufhw(X64Xmm dst, X64Xmm src, uint8_t order)
+        {
+            emit8(0xF3);
+            op_reg(false, {0x0F, 0x70}, id(dst), id(src));
+            emit8(order);
+        }
+
+        void pshufd(X64Xmm dst, X64Xmm src, uint8_t order)
+        {
+            emit8(0x66);
+            op_reg(false, {0x0F, 0x70}, id(dst), id(src));
+            emit8(order);
+        }
+
+        // Zero extends the lane into dst
+        void pextrw(X64Reg dst, X64Xmm src, uint8_t lane)
+        {
+            emit8(0x66);
+            op_reg(false, {0x0F, 0xC5}, id(dst), id(src));
+            emit8(lane);
+        }
+
+        void pinsrw(X64Xmm dst, X64Reg src, uint8_t lane)
+        {
+            emit8(0x66);
+            op_reg(false, {0x0F, 0xC4}, id(dst), id(src));
+            emit8(lane);
+        }
+
+        // Forward jumps, the returned label is bound to the target with Bind
+        Label jcc(X64Cond cond)
+        {
+            emit8(0x0F);
+            emit8(0x80 | static_cast<uint8_t>(cond));
+            emit32(0);
+            return code_.size();
+        }
+
+        Label jmp()
+        {
+            emit8(0xE9);
+            emit32(0);
+            return code_.size();
+        }
+
+        void Bind(Label label)
+        {
+            int32_t rel = static_cast<int32_t>(code_.size() - label);
+            memcpy(&code_[label - 4], &rel, sizeof(int32_t));
+        }
+
+    private:
+        static uint8_t id(X64Reg reg)
+        {
+            return static_cast<uint8_t>(reg);
+        }
+
+        static uint8_t id(X64Xmm reg)
+        {
+            return static_cast<uint8_t>(reg);
+        }
+
+        void emit8(uint8_t value)
+        {
+            code_.push_back(value);
+        }
+
+        void emit32(uint32_t value)
+        {
+            uint8_t bytes[4];
+            memcpy(bytes, &value, sizeof(value));
+            code_.insert(code_.end(), bytes, bytes + 4);
+        }
+
+        void emit64(uint64_t value)
+        {
+            uint8_t bytes[8];
+            memcpy(bytes, &value, sizeof(value));
+            code_.insert(code_.end(), bytes, bytes + 8);
+        }
+
+        // byte_regs forces a REX prefix so that registers 4-7 mean spl-dil and not ah-bh
+        void rex(bool wide, uint8_t reg, uint8_t index, uint8_t base, bool byte_regs)
+        {
+            uint8_t prefix = 0x40 | (wide << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) |
+                             (base >> 3);
+            if (prefix != 0x40 || (byte_regs && (reg >= 4 || base >= 4)))
+            {
+                emit8(prefix);
+            }
+        }
+
+        void modrm_reg(uint8_t reg, uint8_t rm)
+        {
+            emit8(0xC0 | ((reg & 7) << 3) | (rm & 7));
+        }
+
+        void op_reg(bool wide, std::initializer_list<uint8_t> opcode, uint8_t reg, uint8_t rm,
+                    bool byte_regs = false)
+        {
+            rex(wide, reg, 0, rm, byte_regs);
+            code_.insert(code_.end(), opcode);
+            modrm_reg(reg, rm);
+        }
+
+        void op_mem(bool wide, std::initializer_list<uint8_t> opcode, uint8_t reg, X64Reg base,
+                    int32_t disp, bool byte_regs = false)
+        {
+            uint8_t b = id(base);
+            rex(wide, reg, 0, b, byte_regs && reg >= 4);
+            code_.insert(code_.end(), opcode);
+            uint8_t mod;
+            if (disp == 0 && (b & 7) != 5)
+            {
+                mod = 0b00;
+            }
+            else if (disp >= -128 && disp <= 127)
+            {
+                mod = 0b01;
+            }
+            else
+            {
+                mod = 0b10;
+            }
+            emit8((mod << 6) | ((reg & 7) << 3) | (b & 7));
+            if ((b & 7) == 4)
+            {
+                // rsp and r12 need a SIB byte
+                emit8(0x24);
+            }
+            if (mod == 0b01)
+            {
+                emit8(static_cast<uint8_t>(disp));
+            }
+            else if (mod == 0b10)
+            {
+                emit32(static_cast<uint32_t>(disp));
+            }
+        }
+
+        void op_mem_index(bool wide, std::initializer_list<uint8_t> opcode, uint8_t reg,
+                          X64Reg base, X64Reg index, bool byte_regs = false)
+        {
+            uint8_t b = id(base);
+            uint8_t i = id(index);
+            rex(wide, reg, i, b, byte_regs && reg >= 4);
+            code_.insert(code_.end(), opcode);
+            // rbp and r13 can only be a base with a displacement
+            uint8_t mod = (b & 7) == 5 ? 0b01 : 0b00;
+            emit8((mod << 6) | ((reg & 7) << 3) | 0b100);
+            emit8(((i & 7) << 3) | (b & 7));
+            if (mod == 0b01)
+            {
+                emit8(0);
+            }
+        }
+
+        void alu_imm(bool wide, uint8_t ext, X64Reg reg, int32_t imm)
+        {
+            op_reg(wide, {0x81}, ext, id(reg));
+            emit32(static_cast<uint32_t>(imm));
+        }
+
+        void shift_imm(bool wide, uint8_t ext, X64Reg reg, uint8_t amount)
+        {
+            op_reg(wide, {0xC1}, ext, id(reg));
+            emit8(amount);
+        }
+
+        // The mandatory prefix goes before REX
+        void sse_op(uint8_t opcode, X64Xmm dst, X64Xmm src)
+        {
+            emit8(0x66);
+            op_reg(false, {0x0F, opcode}, id(dst), id(src));
+        }
+
+        void sse_shift_imm(uint8_t opcode, uint8_t ext, X64Xmm reg, uint8_t amount)
+        {
+            emit8(0x66);
+            op_reg(false, {0x0F, opcode}, ext, id(reg));
+            emit8(amount);
+        }
+
+        std::vector<uint8_t> code_;
+    };
+} // namespace hydra::N64
@@ -0,0 +1,288 @@
+#include <core/n64_addresses.hxx>
+#include <core/n64_fastmem.hxx>
+#include <core/n64_log.hxx>
+
+#include <algorithm>
+
+#if FASTMEM_SUPPORTED
+#include <atomic>
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+namespace hydra::N64
+{
+#if FASTMEM_SUPPORTED
+    namespace
+    {
+        constexpr uint32_t CART_ROM_PADDR = 0x1000'0000;
+        // The ISViewer registers sit in the middle of the cartridge address range
+        constexpr uint32_t ISVIEWER_PAGE = ISVIEWER_AREA_START & ~0xFFFFu;
+        constexpr uint32_t ISVIEWER_PAGE_SIZE = 0x1'0000;
+
+        // The published fault tables. Only atomics the handler can read while a table on
+        // another thread changes, it never follows a pointer of a buffer it isn't running
+        struct FaultSlot
+        {
+            std::atomic<bool> used;
+            std::atomic<uintptr_t> begin;
+            std::atomic<uintptr_t> end;
+            std::atomic<const FaultSite*> sites;
+            std::atomic<size_t> count;
+        };
+
+        constexpr int FAULT_SLOT_COUNT = 64;
+        FaultSlot fault_slots[FAULT_SLOT_COUNT];
+
+        struct sigaction previous_action;
+
+        bool find_fault_handler(uintptr_t pc, uintptr_t& handler)
+        {
+            for (FaultSlot& slot : fault_slots)
+            {
+                uintptr_t begin = slot.begin.load(std::memory_order_acquire);
+                uintptr_t end = slot.end.load(std::memory_order_acquire);
+                if (pc < begin || pc >= end)
+                {
+                    continue;
+                }
+
+                const FaultSite* sites = slot.sites.load(std::memory_order_acquire);
+                size_t count = slot.count.load(std::memory_order_acquire);
+                uint32_t access = static_cast<uint32_t>(pc - begin);
+                const FaultSite* site =
+                    std::lower_bound(sites, sites + count, access,
+                                     [](const FaultSite& site, uint32_t access) {
+                                         return site.access < access;
+                                     });
+                if (site != sites + count && site->access == access)
+                {
+                    handler = begin + site->handler;
+                    return true;
+                }
+                return false;
+            }
+            return false;
+        }
+
+        void segv_handler(int signal, siginfo_t* info, void* context)
+        {
+            ucontext_t* ucontext = static_cast<ucontext_t*>(context);
+            uintptr_t pc = ucontext->uc_mcontext.gregs[REG_RIP];
+            uintptr_t handler;
+            if (find_fault_handler(pc, handler))
+            {
+                ucontext->uc_mcontext.gregs[REG_RIP] = handler;
+                return;
+            }
+
+            // Not one of ours, pass it on to whatever was installed before
+            if (previous_action.sa_flags & SA_SIGINFO)
+            {
+                previous_action.sa_sigaction(signal, info, context);
+            }
+            else if (previous_action.sa_handler != SIG_DFL && previous_action.sa_handler != SIG_IGN)
+            {
+                previous_action.sa_handler(signal);
+            }
+            else
+            {
+                // Returning retries the access, which now crashes as usual
+                sigaction(SIGSEGV, &previous_action, nullptr);
+            }
+        }
+
+        void install_segv_handler()
+        {
+            // Emulator instances can be created on several threads
+            static bool installed = [] {
+                struct sigaction action = {};
+                action.sa_sigaction = segv_handler;
+                action.sa_flags = SA_SIGINFO | SA_NODEFER;
+                sigemptyset(&action.sa_mask);
+                sigaction(SIGSEGV, &action, &previous_action);
+                return true;
+            }();
+            (void)installed;
+        }
+
+        bool map_fixed(uint8_t* address, size_t size, int protection, int fd, size_t offset)
+        {
+            void* result = mmap(address, size, protection, MAP_SHARED | MAP_FIXED, fd,
+                                static_cast<off_t>(offset));
+            return result == address;
+        }
+    } // namespace
+#endif
+
+    GuestAddressSpace::GuestAddressSpace(size_t rdram_size, size_t cart_rom_size)
+    {
+#if FASTMEM_SUPPORTED
+        fd_ = memfd_create("n64-memory", MFD_CLOEXEC);
+        if (fd_ < 0 || ftruncate(fd_, static_cast<off_t>(rdram_size + cart_rom_size)) != 0)
+        {
+            Logger::Warn("Failed to create guest memory, fastmem is disabled");
+            release();
+            return;
+        }
+
+        void* base = mmap(nullptr, GUEST_ADDRESS_SPACE_SIZE, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        void* cart_rom =
+            mmap(nullptr, cart_rom_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, rdram_size);
+        if (base == MAP_FAILED || cart_rom == MAP_FAILED)
+        {
+            Logger::Warn("Failed to reserve the guest address space, fastmem is disabled");
+            if (base != MAP_FAILED)
+            {
+                munmap(base, GUEST_ADDRESS_SPACE_SIZE);
+            }
+            if (cart_rom != MAP_FAILED)
+            {
+                munmap(cart_rom, cart_rom_size);
+            }
+            release();
+            return;
+        }
+        base_ = static_cast<uint8_t*>(base);
+        cart_rom_ = static_cast<uint8_t*>(cart_rom);
+        cart_rom_size_ = cart_rom_size;
+
+        // ROM is read only in the guest view, so stores to it fault and take the slow path
+        size_t before_isviewer = ISVIEWER_PAGE - CART_ROM_PADDR;
+        size_t after_isviewer = before_isviewer + ISVIEWER_PAGE_SIZE;
+        bool mapped = map_fixed(base_, rdram_size, PROT_READ | PROT_WRITE, fd_, 0) &&
+                      map_fixed(base_ + CART_ROM_PADDR, before_isviewer, PROT_READ, fd_,
+                                rdram_size) &&
+                      map_fixed(base_ + CART_ROM_PADDR + after_isviewer,
+                                cart_rom_size - after_isviewer, PROT_READ, fd_,
+                                rdram_size + after_isviewer);
+        if (!mapped)
+        {
+            Logger::Warn("Failed to map guest memory, fastmem is disabled");
+            release();
+            return;
+        }
+
+        // Only a hint, shared memory uses huge pages depending on the system configuration
+        madvise(base_, rdram_size, MADV_HUGEPAGE);
+        install_segv_handler();
+#else
+        (void)rdram_size;
+        (void)cart_rom_size;
+#endif
+    }
+
+    GuestAddressSpace::~GuestAddressSpace()
+    {
+        release();
+    }
+
+    void GuestAddressSpace::release()
+    {
+#if FASTMEM_SUPPORTED
+        if (base_)
+        {
+            munmap(base_, GUEST_ADDRESS_SPACE_SIZE);
+            base_ = nullptr;
+        }
+        if (cart_rom_)
+        {
+            munmap(cart_rom_, cart_rom_size_);
+            cart_rom_ = nullptr;
+        }
+        if (fd_ >= 0)
+        {
+            close(fd_);
+            fd_ = -1;
+        }
+#endif
+    }
+
+    FaultTable::FaultTable(const uint8_t* begin, const uint8_t* end) : begin_(begin)
+    {
+#if FASTMEM_SUPPORTED
+        if (!begin)
+        {
+            return;
+        }
+
+        // Every site is an access of a few bytes followed by its slow path, so a sixteenth of
+        // the buffer is plenty. Left uninitialised so only the pages that get used are touched
+        capacity_ = (end - begin) / 16;
+        sites_.reset(new FaultSite[capacity_]);
+        for (int i = 0; i < FAULT_SLOT_COUNT; i++)
+        {
+            bool used = false;
+            if (fault_slots[i].used.compare_exchange_strong(used, true))
+            {
+                slot_ = i;
+                break;
+            }
+        }
+        if (slot_ == -1)
+        {
+            Logger::Warn("Too many code buffers for fastmem, faults won't be handled");
+            capacity_ = 0;
+            return;
+        }
+
+        FaultSlot& slot = fault_slots[slot_];
+        slot.sites.store(sites_.get(), std::memory_order_relaxed);
+        slot.count.store(0, std::memory_order_relaxed);
+        slot.begin.store(reinterpret_cast<uintptr_t>(begin), std::memory_order_release);
+        slot.end.store(reinterpret_cast<uintptr_t>(end), std::memory_order_release);
+#else
+        (void)end;
+#endif
+    }
+
+    FaultTable::~FaultTable()
+    {
+#if FASTMEM_SUPPORTED
+        if (slot_ == -1)
+        {
+            return;
+        }
+
+        FaultSlot& slot = fault_slots[slot_];
+        slot.end.store(0, std::memory_order_release);
+        slot.begin.store(0, std::memory_order_release);
+        slot.count.store(0, std::memory_order_release);
+        slot.sites.store(nullptr, std::memory_order_release);
+        slot.used.store(false, std::memory_order_release);
+#endif
+    }
+
+    void FaultTable::Add(const uint8_t* access, const uint8_t* handler)
+    {
+#if FASTMEM_SUPPORTED
+        if (count_ == capacity_)
+        {
+            return;
+        }
+
+        sites_[count_].access = static_cast<uint32_t>(access - begin_);
+        sites_[count_].handler = static_cast<uint32_t>(handler - begin_);
+        count_++;
+        // The site is written before the count that makes it visible
+        fault_slots[slot_].count.store(count_, std::memory_order_release);
+#else
+        (void)access;
+        (void)handler;
+#endif
+    }
+
+    void FaultTable::Clear()
+    {
+#if FASTMEM_SUPPORTED
+        count_ = 0;
+        if (slot_ != -1)
+        {
+            fault_slots[slot_].count.store(0, std::memory_order_release);
+        }
+#endif
+    }
+} // namespace hydra::N64
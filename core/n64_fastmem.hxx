@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define FASTMEM_SUPPORTED 1
+#else
+#define FASTMEM_SUPPORTED 0
+#endif
+
+namespace hydra::N64
+{
+    // The whole 32-bit physical address space
+    constexpr size_t GUEST_ADDRESS_SPACE_SIZE = 0x1'0000'0000;
+
+    /**
+        The physical address space of one console reserved in host memory, so that generated
+        code can access guest memory at Base() + paddr
+
+        RDRAM and cartridge ROM are backed by a memfd. RDRAM is only mapped in the reserved
+        region and used from there by everything else too, ROM is mapped read only in the
+        region and writable at a separate address for loading it. Everything else, hardware
+        registers included, is left unmapped, and accesses to it fault. Code that accesses the
+        region says where to continue when that happens in a FaultTable
+    */
+    class GuestAddressSpace final
+    {
+    public:
+        GuestAddressSpace(size_t rdram_size, size_t cart_rom_size);
+        ~GuestAddressSpace();
+        GuestAddressSpace(const GuestAddressSpace&) = delete;
+        GuestAddressSpace& operator=(const GuestAddressSpace&) = delete;
+
+        bool IsAvailable()
+        {
+            return base_ != nullptr;
+        }
+
+        uint8_t* Base()
+        {
+            return base_;
+        }
+
+        uint8_t* Rdram()
+        {
+            return base_;
+        }
+
+        uint8_t* CartRom()
+        {
+            return cart_rom_;
+        }
+
+    private:
+        void release();
+
+        uint8_t* base_ = nullptr;
+        uint8_t* cart_rom_ = nullptr;
+        size_t cart_rom_size_ = 0;
+        int fd_ = -1;
+    };
+
+    struct FaultSite
+    {
+        // Offsets from the start of the code buffer
+        uint32_t access;
+        uint32_t handler;
+    };
+
+    /**
+        Where faulting guest memory accesses in one code buffer continue
+
+        Code is emitted into the buffer in order, so the sites come in sorted and the ones
+        already published never change. The SIGSEGV handler only reads the published ones, and
+        only for faults inside the buffer, which can only come from the thread running its code,
+        the same one that adds and clears the sites
+    */
+    class FaultTable final
+    {
+    public:
+        FaultTable(const uint8_t* begin, const uint8_t* end);
+        ~FaultTable();
+        FaultTable(const FaultTable&) = delete;
+        FaultTable& operator=(const FaultTable&) = delete;
+
+        // Whether count more sites fit, the buffer is flushed along with the table otherwise
+        bool HasSpace(size_t count)
+        {
+            return slot_ == -1 || capacity_ - count_ >= count;
+        }
+
+        // Faults with the host pc at access continue at handler instead
+        void Add(const uint8_t* access, const uint8_t* handler);
+        void Clear();
+
+    private:
+        const uint8_t* begin_;
+        std::unique_ptr<FaultSite[]> sites_;
+        size_t capacity_ = 0;
+        size_t count_ = 0;
+        // Where the table is published for the SIGSEGV handler, -1 if it isn't
+        int slot_ = -1;
+    };
+} // namespace hydra::N64
@@ -35,40 +35,17 @@ namespace hydra::N64
     void N64::RunFrame()
     {
         CALLGRIND_START_INSTRUMENTATION;
-        static int cycles = 0;
-        for (int f = 0; f < 1; f++)
-        { // fields
-            for (int hl = 0; hl < cpu_.rcp_.vi_.num_halflines_; hl++)
-            { // halflines
-                cpu_.rcp_.vi_.vi_v_current_ = (hl << 1) + f;
-                cpu_.check_vi_interrupt();
-                while (cycles <= cpu_.rcp_.vi_.cycles_per_halfline_)
-                {
-                    static int cpu_cycles = 0;
-                    cpu_cycles++;
-                    cpu_.Tick();
-                    rcp_.ai_.Step();
-                    if (!cpu_.rcp_.rsp_.IsHalted())
-                    {
-                        while (cpu_cycles > 2)
-                        {
-                            cpu_.rcp_.rsp_.Tick();
-                            if (!cpu_.rcp_.rsp_.IsHalted())
-                            {
-                                cpu_.rcp_.rsp_.Tick();
-                            }
-                            cpu_cycles -= 3;
-                        }
-                    }
-                    else
-                    {
-                        cpu_cycles = 0;
-                    }
-                    cycles++;
-                }
-                cycles -= cpu_.rcp_.vi_.cycles_per_halfline_;
+        Scheduler& scheduler = cpu_.cpubus_.scheduler_;
+        frame_done_ = false;
+        start_halfline();
+        while (!frame_done_)
+        {
+            cpu_.RunFor(scheduler.CyclesUntilNextTask());
+            TaskType type;
+            while (scheduler.PopDue(type))
+            {
+                handle_event(type);
             }
-            cpu_.check_vi_interrupt();
         }
         CALLGRIND_STOP_INSTRUMENTATION;
     }
@@ -77,6 +54,80 @@ namespace hydra::N64
     {
         cpu_.Reset();
         rcp_.Reset();
+        halfline_ = 0;
+        Scheduler& scheduler = cpu_.cpubus_.scheduler_;
+        scheduler.Schedule(TaskType::Halfline, rcp_.vi_.cycles_per_halfline_);
+        scheduler.Schedule(TaskType::AiSample, rcp_.ai_.ai_period_);
+        if (!rcp_.rsp_.IsIdle())
+        {
+            scheduler.Schedule(TaskType::RspSlice, 0);
+        }
+    }
+
+    void N64::start_halfline()
+    {
+        rcp_.vi_.vi_v_current_ = halfline_ << 1;
+        cpu_.check_vi_interrupt();
+    }
+
+    void N64::handle_event(TaskType type)
+    {
+        Scheduler& scheduler = cpu_.cpubus_.scheduler_;
+        switch (type)
+        {
+            case TaskType::Halfline:
+            {
+                scheduler.Schedule(TaskType::Halfline, rcp_.vi_.cycles_per_halfline_);
+                halfline_++;
+                if (halfline_ >= rcp_.vi_.num_halflines_)
+                {
+                    halfline_ = 0;
+                    cpu_.check_vi_interrupt();
+                    frame_done_ = true;
+                }
+                else
+                {
+                    start_halfline();
+                }
+                break;
+            }
+            case TaskType::AiSample:
+            {
+                rcp_.ai_.Step();
+                scheduler.Schedule(TaskType::AiSample, rcp_.ai_.ai_period_);
+                break;
+            }
+            case TaskType::RspSlice:
+            {
+                CPUBus& cpubus = cpu_.cpubus_;
+                uint64_t slice = RSP_SLICE_CYCLES;
+                if (cpubus.rsp_thread_)
+                {
+                    cpubus.poll_rsp_thread();
+                    slice = RSP_THREAD_CYCLES;
+                }
+                else if (cpubus.rsp_bulk_)
+                {
+                    cpubus.sync_rsp();
+                    slice = RSP_BULK_CYCLES;
+                }
+                else
+                {
+                    cpubus.run_rsp(RSP_SLICE_CYCLES);
+                }
+
+                if (cpubus.rsp_running())
+                {
+                    scheduler.Schedule(TaskType::RspSlice, slice);
+                }
+                break;
+            }
+            default:
+            {
+                cpu_.handle_event(type);
+                break;
+            }
+        }
     }
 
     void N64::SetMousePos(int32_t x, int32_t y)
@@ -8,6 +8,14 @@
 
 namespace hydra::N64
 {
+    // CPU cycles the RSP runs ahead in one go
+    constexpr uint64_t RSP_SLICE_CYCLES = 48;
+    // CPU cycles between catch ups of the RSP in bulk mode while the CPU doesn't access it
+    constexpr uint64_t RSP_BULK_CYCLES = 4096;
+    // CPU cycles between checks on the RSP worker thread, which waits for the CPU thread
+    // whenever it raises an interrupt or writes an RDP register
+    constexpr uint64_t RSP_THREAD_CYCLES = 1024;
+
     class N64
     {
     public:
@@ -29,6 +37,124 @@ namespace hydra::N64
             cpu_.read_input_callback_ = callback;
         }
 
+        // Switches between the regular interpreter and the block cache
+        void SetCachedInterpreter(bool enabled)
+        {
+            cpu_.use_block_cache_ = enabled;
+        }
+
+        // Switches between the x86-64 recompiler and the interpreter, on other hosts this
+        // falls back to the block cache
+        void SetJit(bool enabled)
+        {
+            cpu_.use_jit_ = enabled;
+        }
+
+        // The exact FPU mode reads the host exception flags after every FPU instruction. The
+        // default fast mode infers them from the operands and the result instead, which
+        // misses inexact results and is only used while no FPU exceptions are enabled
+        void SetExactFpu(bool enabled)
+        {
+            cpu_.exact_fpu_ = enabled;
+        }
+
+        // Same for the RSP, its blocks are kept per IMEM image so switching between
+        // microcodes doesn't throw them away
+        void SetRspCachedInterpreter(bool enabled)
+        {
+            rcp_.rsp_.SetCachedInterpreter(enabled);
+        }
+
+        // Compiles the RSP's blocks to x86-64, the interpreter still runs what the recompiler
+        // doesn't handle
+        void SetRspJit(bool enabled)
+        {
+            rcp_.rsp_.SetJit(enabled);
+        }
+
+        // Lets the RSP lag behind the CPU and run what it owes in large slices. It catches up
+        // early whenever the CPU accesses its registers, DMEM or IMEM
+        void SetRspBulk(bool enabled)
+        {
+            cpu_.SetRspBulk(enabled);
+        }
+
+        // Runs the RSP on a worker thread, behind the CPU like in bulk mode. The CPU only
+        // waits for it when it accesses RSP or RDP registers, DMEM or IMEM
+        void SetRspThread(bool enabled)
+        {
+            cpu_.SetRspThread(enabled);
+        }
+
+        // Switches the RSP vector unit between SSE4.1 and the scalar reference implementation
+        void SetSimdVectorUnit(bool enabled)
+        {
+            rcp_.rsp_.SetSimdVectorUnit(enabled);
+        }
+
+        // Runs audio tasks of known microcodes natively instead of on the RSP, on by default
+        void SetAudioHle(bool enabled)
+        {
+            rcp_.rsp_.SetAudioHle(enabled);
+        }
+
+        // Runs graphics tasks of Fast3D, F3DEX and F3DEX2 natively and sends the triangles
+        // straight to the RDP. Off by default, other microcodes always run on the RSP
+        void SetGraphicsHle(bool enabled)
+        {
+            rcp_.rsp_.SetGraphicsHle(enabled);
+        }
+
+        // Threads the RDP rasterizes on besides the one running it, 0 draws everything there.
+        // The output is the same for any count
+        void SetRdpThreads(unsigned threads)
+        {
+            rcp_.rdp_.SetThreads(threads);
+        }
+
+        // Switches the RDP combiner and blender between SSE4.1 and the scalar reference
+        // implementation
+        void SetRdpSimd(bool enabled)
+        {
+            rcp_.rdp_.SetSimd(enabled);
+        }
+
+        // Draws the RDP's command lists on a thread of its own, off by default. The CPU waits
+        // for it at the interrupt of a SyncFull, on reads of the RDP's registers and when the
+        // VI shows an image it's still drawing to
+        void SetRdpAsync(bool enabled)
+        {
+            rcp_.rdp_.SetAsync(enabled);
+        }
+
+        // Groups the RSP's tasks by microcode and collects statistics on them, off by default
+        void SetRspProfiling(bool enabled)
+        {
+            cpu_.cpubus_.sync_rsp();
+            rcp_.rsp_.SetProfiling(enabled);
+        }
+
+        // Per microcode totals and last task since profiling was enabled or cleared, tasks
+        // still running aren't included
+        std::vector<RspUcodeProfile> GetRspProfile()
+        {
+            cpu_.cpubus_.sync_rsp();
+            return rcp_.rsp_.GetProfiles();
+        }
+
+        void ClearRspProfile()
+        {
+            cpu_.cpubus_.sync_rsp();
+            rcp_.rsp_.ClearProfiles();
+        }
+
+        // Cycles skipped by fast forwarding through idle loops since startup, only the block
+        // cache and the recompiler detect them
+        uint64_t GetIdleSkippedCycles()
+        {
+            return cpu_.idle_skipped_cycles_;
+        }
+
         int GetWidth()
         {
             return rcp_.vi_.width_;
@@ -41,12 +167,18 @@ namespace hydra::N64
 
         void RenderVideo(std::vector<uint8_t>& data)
         {
+            rcp_.rdp_.WaitForRange(rcp_.vi_.vi_origin_, rcp_.vi_.GetFramebufferSize());
             rcp_.vi_.Redraw(data);
         }
 
     private:
+        void start_halfline();
+        void handle_event(TaskType type);
+
         RCP rcp_;
         CPUBus cpubus_;
         CPU cpu_;
+        int halfline_ = 0;
+        bool frame_done_ = false;
     };
 } // namespace hydra::N64
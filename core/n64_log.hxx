@@ -4,6 +4,7 @@
 #include <fmt/core.h>
 #include <fmt/format.h>
 #include <functional>
+#include <mutex>
 #include <str_hash.hxx>
 #include <unordered_map>
 #include <vector>
@@ -35,6 +36,8 @@ struct Logger
 
         std::string msg = fmt::format(fmt, std::forward<T>(args)...);
         uint32_t hash = str_hash(msg);
+        // The RDP's rasterizer threads warn too
+        std::lock_guard<std::mutex> lock(get_warnings_mutex());
         if (warnings[hash])
             return;
 
@@ -59,6 +62,7 @@ struct Logger
 
     static void ClearWarnings()
     {
+        std::lock_guard<std::mutex> lock(get_warnings_mutex());
         get_warnings().clear();
     }
 
@@ -90,4 +94,10 @@ private:
         static std::unordered_map<uint32_t, bool> warnings;
         return warnings;
     }
+
+    static std::mutex& get_warnings_mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
 };
\ No newline at end of file
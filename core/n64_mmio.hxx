@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <core/n64_log.hxx>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace hydra::N64
+{
+    using MmioReadHandler = std::function<uint32_t(uint32_t addr)>;
+    using MmioWriteHandler = std::function<void(uint32_t addr, uint32_t data)>;
+
+    /**
+        Maps physical addresses to handlers with a two level table
+
+        The first level is indexed by the 64 KiB page of the address and points to a table with
+        a handler index for every word in that page. Pages that are entirely covered by one
+        handler share a table, so large windows like SRAM or the N64DD only cost the first
+        level entries. Index 0 is the handler for everything that isn't mapped
+    */
+    template <typename Handler>
+    class MmioTable
+    {
+        static constexpr uint32_t PAGE_SHIFT = 16;
+        static constexpr uint32_t PAGE_COUNT = 0x2000;
+        static constexpr uint32_t WORDS_PER_PAGE = (1 << PAGE_SHIFT) / 4;
+        using Page = std::array<uint8_t, WORDS_PER_PAGE>;
+
+    public:
+        MmioTable()
+        {
+            handlers_.resize(1);
+            pages_.fill(uniform_page(0));
+        }
+
+        const Handler& Lookup(uint32_t addr) const
+        {
+            uint32_t page = addr >> PAGE_SHIFT;
+            if (page >= PAGE_COUNT) [[unlikely]]
+            {
+                return handlers_[0];
+            }
+            return handlers_[(*pages_[page])[(addr >> 2) & (WORDS_PER_PAGE - 1)]];
+        }
+
+        void SetUnmapped(Handler handler)
+        {
+            handlers_[0] = std::move(handler);
+        }
+
+        // Later mappings take priority over earlier ones where they overlap, so a window can
+        // be mapped first and the registers inside it after
+        void Map(uint32_t start, uint32_t end, Handler handler)
+        {
+            if (handlers_.size() > UINT8_MAX)
+            {
+                Logger::Fatal("Too many MMIO handlers");
+            }
+            uint8_t index = handlers_.size();
+            handlers_.push_back(std::move(handler));
+            for (uint32_t page = start >> PAGE_SHIFT; page <= end >> PAGE_SHIFT; page++)
+            {
+                uint32_t page_start = page << PAGE_SHIFT;
+                uint32_t page_end = page_start + (1 << PAGE_SHIFT) - 1;
+                if (start <= page_start && end >= page_end)
+                {
+                    pages_[page] = uniform_page(index);
+                    continue;
+                }
+
+                Page* table = private_page(page);
+                uint32_t first = (std::max(start, page_start) - page_start) >> 2;
+                uint32_t last = (std::min(end, page_end) - page_start) >> 2;
+                for (uint32_t word = first; word <= last; word++)
+                {
+                    (*table)[word] = index;
+                }
+            }
+        }
+
+    private:
+        Page* uniform_page(uint8_t index)
+        {
+            if (uniform_pages_.size() <= index)
+            {
+                uniform_pages_.resize(index + 1);
+            }
+            if (!uniform_pages_[index])
+            {
+                uniform_pages_[index] = std::make_unique<Page>();
+                uniform_pages_[index]->fill(index);
+            }
+            return uniform_pages_[index].get();
+        }
+
+        // Copies a shared page before it gets modified
+        Page* private_page(uint32_t page)
+        {
+            for (const std::unique_ptr<Page>& uniform : uniform_pages_)
+            {
+                if (uniform.get() == pages_[page])
+                {
+                    private_pages_.push_back(std::make_unique<Page>(*pages_[page]));
+                    pages_[page] = private_pages_.back().get();
+                    break;
+                }
+            }
+            return pages_[page];
+        }
+
+        std::vector<Handler> handlers_;
+        std::array<Page*, PAGE_COUNT> pages_;
+        std::vector<std::unique_ptr<Page>> uniform_pages_;
+        std::vector<std::unique_ptr<Page>> private_pages_;
+    };
+
+    // Hardware registers, each device maps the handlers for its own register window
+    class MmioMap
+    {
+    public:
+        uint32_t Read(uint32_t addr) const
+        {
+            return reads_.Lookup(addr)(addr);
+        }
+
+        void Write(uint32_t addr, uint32_t data) const
+        {
+            writes_.Lookup(addr)(addr, data);
+        }
+
+        void MapRead(uint32_t start, uint32_t end, MmioReadHandler handler)
+        {
+            reads_.Map(start, end, std::move(handler));
+        }
+
+        void MapWrite(uint32_t start, uint32_t end, MmioWriteHandler handler)
+        {
+            writes_.Map(start, end, std::move(handler));
+        }
+
+        void SetUnmapped(MmioReadHandler read, MmioWriteHandler write)
+        {
+            reads_.SetUnmapped(std::move(read));
+            writes_.SetUnmapped(std::move(write));
+        }
+
+    private:
+        MmioTable<MmioReadHandler> reads_;
+        MmioTable<MmioWriteHandler> writes_;
+    };
+} // namespace hydra::N64
@@ -7,12 +7,15 @@
 #include <core/n64_addresses.hxx>
 #include <core/n64_rdp.hxx>
 #include <core/n64_rdp_commands.hxx>
+#include <core/n64_rdp_pool.hxx>
+#include <core/n64_rdp_thread.hxx>
 #include <cstdlib>
-#include <execution>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <sstream>
+#include <thread>
+#include <tuple>
 
 inline static uint32_t irand(uint32_t* state)
 {
@@ -41,11 +44,16 @@ inline static uint16_t rgba32_to_rgba16(uint32_t color)
     return (r << 11) | (g << 6) | (b << 1) | a;
 }
 
-static std::pair<int32_t, int32_t> perspective_correction(int32_t s, int32_t t, int32_t w)
+static std::pair<int32_t, int32_t> perspective_correction(int32_t s, int32_t t, int32_t w,
+                                                          bool& warned)
 {
     if ((w >> 15) == 0)
     {
-        Logger::WarnOnce("Division by zero in perspective correction");
+        if (!warned)
+        {
+            Logger::WarnOnce("Division by zero in perspective correction");
+            warned = true;
+        }
         return {0, 0};
     }
     return {(s / (w >> 15)) >> 5, (t / (w >> 15)) >> 5};
@@ -92,6 +100,86 @@ namespace hydra::N64
     {
         rdram_9th_bit_.resize(0x800000);
         init_depth_luts();
+        unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+        SetThreads(std::min(cores, RDP_DEFAULT_MAX_THREADS + 1) - 1);
+#if RDP_SIMD_SUPPORTED
+        simd_ = __builtin_cpu_supports("sse4.1");
+#endif
+    }
+
+    RDP::~RDP() = default;
+
+    void RDP::SetThreads(unsigned threads)
+    {
+        wait();
+        flush();
+        pool_ = std::make_unique<RdpWorkerPool>(threads);
+        contexts_.resize(pool_->GetWorkerCount());
+    }
+
+    void RDP::SetSimd(bool enabled)
+    {
+        wait();
+        simd_ = false;
+        pipelines_dirty_ = true;
+        if (!enabled)
+        {
+            return;
+        }
+#if RDP_SIMD_SUPPORTED
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            simd_ = true;
+            return;
+        }
+#endif
+        Logger::Warn("The SIMD combiner needs SSE4.1, using the scalar one");
+    }
+
+    void RDP::SetAsync(bool enabled)
+    {
+        Sync();
+        if (!enabled)
+        {
+            thread_.reset();
+        }
+        else if (!thread_)
+        {
+            thread_ = std::make_unique<RdpThread>(*this);
+        }
+    }
+
+    void RDP::Sync()
+    {
+        wait();
+        if (interrupt_pending_)
+        {
+            interrupt_pending_ = false;
+            raise_interrupt();
+        }
+        unsynced_words_ = 0;
+    }
+
+    void RDP::WaitForRange(uint32_t address, uint32_t length)
+    {
+        for (const auto& [start, end] : busy_ranges_)
+        {
+            if (address < end && start < address + length)
+            {
+                wait();
+                return;
+            }
+        }
+    }
+
+    void RDP::wait()
+    {
+        if (thread_)
+        {
+            thread_->Wait();
+        }
+        busy_ranges_.clear();
+        queued_images_dirty_ = true;
     }
 
     void RDP::InstallBuses(uint8_t* rdram_ptr, uint8_t* spmem_ptr)
@@ -180,29 +268,38 @@ namespace hydra::N64
 
     void RDP::Reset()
     {
-        seed_ = 3;
+        wait();
+        flush();
+        pending_commands_.clear();
+        pending_sync_full_ = false;
+        interrupt_pending_ = false;
+        unsynced_words_ = 0;
+        queued_images_dirty_ = true;
+        tile_seeds_.fill(3);
         status_.ready = 1;
-        color_sub_a_[0] = color_sub_a_[1] = &color_one_;
-        color_sub_b_[0] = color_sub_b_[1] = &color_zero_;
-        color_multiplier_[0] = color_multiplier_[1] = &color_one_;
-        color_adder_[0] = color_adder_[1] = &color_zero_;
-        alpha_sub_a_[0] = alpha_sub_a_[1] = &color_zero_;
-        alpha_sub_b_[0] = alpha_sub_b_[1] = &color_zero_;
-        alpha_multiplier_[0] = alpha_multiplier_[1] = &color_one_;
-        alpha_adder_[0] = alpha_adder_[1] = &color_zero_;
-        blender_1a_[0] = blender_1a_[1] = 0;
-        blender_1b_[0] = blender_1b_[1] = 0;
-        blender_2a_[0] = blender_2a_[1] = 0;
-        blender_2b_[0] = blender_2b_[1] = 0;
-        texel_color_[0] = texel_color_[1] = 0xFFFFFFFF;
-        texel_alpha_[0] = texel_alpha_[1] = 0xFFFFFFFF;
-        cycle_type_ = CycleType::Cycle1;
-        perspective_correction_func_ = &no_perspective_correction;
+        state_.color_sub_a[0] = state_.color_sub_a[1] = CombinerInput::One;
+        state_.color_sub_b[0] = state_.color_sub_b[1] = CombinerInput::Zero;
+        state_.color_multiplier[0] = state_.color_multiplier[1] = CombinerInput::One;
+        state_.color_adder[0] = state_.color_adder[1] = CombinerInput::Zero;
+        state_.alpha_sub_a[0] = state_.alpha_sub_a[1] = CombinerInput::Zero;
+        state_.alpha_sub_b[0] = state_.alpha_sub_b[1] = CombinerInput::Zero;
+        state_.alpha_multiplier[0] = state_.alpha_multiplier[1] = CombinerInput::One;
+        state_.alpha_adder[0] = state_.alpha_adder[1] = CombinerInput::Zero;
+        state_.blender_1a[0] = state_.blender_1a[1] = 0;
+        state_.blender_1b[0] = state_.blender_1b[1] = 0;
+        state_.blender_2a[0] = state_.blender_2a[1] = 0;
+        state_.blender_2b[0] = state_.blender_2b[1] = 0;
+        state_.cycle_type = CycleType::Cycle1;
+        state_.persp_tex_en = false;
+        state_dirty_ = true;
+        pipelines_dirty_ = true;
     }
 
     void RDP::SendCommand(const std::vector<uint64_t>& data)
     {
+        Sync();
         execute_command(data);
+        flush();
     }
 
     void RDP::process_commands()
@@ -232,7 +329,7 @@ namespace hydra::N64
                 {
                     printf("Address: %08x\n", current);
                 }
-                execute_command(command);
+                queue_command(command);
                 // Logger::Info("RDP: Command {} ({:02x})",
                 // get_rdp_command_name(static_cast<RDPCommandType>(command_type)),
                 // static_cast<int>(command_type));
@@ -244,10 +341,139 @@ namespace hydra::N64
             }
         }
 
+        submit();
         current_address_ = end_address_;
         status_.freeze = 0;
     }
 
+    void RDP::queue_command(const std::vector<uint64_t>& data)
+    {
+        if (!thread_)
+        {
+            execute_command(data);
+            return;
+        }
+
+        RDPCommandType id = static_cast<RDPCommandType>((data[0] >> 56) & 0b111111);
+        if (id == RDPCommandType::SyncFull)
+        {
+            pending_sync_full_ = true;
+        }
+        track_images(data);
+        pending_commands_.insert(pending_commands_.end(), data.begin(), data.end());
+    }
+
+    void RDP::submit()
+    {
+        if (!thread_)
+        {
+            flush();
+            return;
+        }
+
+        if (pending_commands_.empty())
+        {
+            return;
+        }
+
+        unsynced_words_ += pending_commands_.size();
+        thread_->Submit(std::move(pending_commands_));
+        pending_commands_.clear();
+        if (pending_sync_full_)
+        {
+            pending_sync_full_ = false;
+            interrupt_pending_ = true;
+            if (sync_callback_)
+            {
+                sync_callback_(unsynced_words_ * RDP_SYNC_CYCLES_PER_WORD);
+            }
+            else
+            {
+                Sync();
+            }
+        }
+    }
+
+    void RDP::run_commands(const std::vector<uint64_t>& commands)
+    {
+        std::vector<uint64_t> command;
+        size_t i = 0;
+        while (i < commands.size())
+        {
+            RDPCommandType id = static_cast<RDPCommandType>((commands[i] >> 56) & 0b111111);
+            size_t length = get_rdp_command_length(id);
+            command.assign(commands.begin() + i, commands.begin() + i + length);
+            execute_command(command);
+            i += length;
+        }
+        flush();
+    }
+
+    void RDP::track_images(const std::vector<uint64_t>& data)
+    {
+        RDPCommandType id = static_cast<RDPCommandType>((data[0] >> 56) & 0b111111);
+        switch (id)
+        {
+            case RDPCommandType::SetColorImage:
+            {
+                SetColorImageCommand command;
+                command.full = data[0];
+                queued_color_image_ = command.dram_address;
+                queued_color_row_ = ((command.width + 1) * (4 << command.size) + 7) / 8;
+                queued_z_row_ = (command.width + 1) * 2;
+                queued_images_dirty_ = true;
+                return;
+            }
+            case RDPCommandType::SetZImage:
+            {
+                queued_z_image_ = data[0] & 0x1FFFFFF;
+                queued_images_dirty_ = true;
+                return;
+            }
+            case RDPCommandType::SetScissor:
+            {
+                SetScissorCommand command;
+                command.full = data[0];
+                queued_rows_ = (command.YL >> 2) + 1;
+                queued_images_dirty_ = true;
+                return;
+            }
+            case RDPCommandType::Rectangle:
+            case RDPCommandType::TextureRectangle:
+            case RDPCommandType::TextureRectangleFlip:
+            {
+                break;
+            }
+            default:
+            {
+                if (id < RDPCommandType::Triangle || id > RDPCommandType::TriangleShadeTextureDepth)
+                {
+                    return;
+                }
+                break;
+            }
+        }
+
+        if (queued_images_dirty_)
+        {
+            // Without knowing the modes both images are assumed to be written
+            queued_images_dirty_ = false;
+            busy_ranges_.emplace_back(queued_color_image_,
+                                      queued_color_image_ + queued_color_row_ * queued_rows_);
+            busy_ranges_.emplace_back(queued_z_image_,
+                                      queued_z_image_ + queued_z_row_ * queued_rows_);
+        }
+    }
+
+    void RDP::raise_interrupt()
+    {
+        Logger::Debug("Raising DP interrupt");
+        interrupt_callback_(true);
+        status_.dma_busy = false;
+        status_.pipe_busy = false;
+        status_.start_gclk = false;
+    }
+
     void RDP::execute_command(const std::vector<uint64_t>& data)
     {
         RDPCommandType id = static_cast<RDPCommandType>((data[0] >> 56) & 0b111111);
@@ -262,22 +488,27 @@ namespace hydra::N64
             }
             case RDPCommandType::SyncFull:
             {
-                Logger::Debug("Raising DP interrupt");
-                interrupt_callback_(true);
-                status_.dma_busy = false;
-                status_.pipe_busy = false;
-                status_.start_gclk = false;
+                flush();
+                // The CPU thread raises it in Sync
+                if (!on_worker_)
+                {
+                    raise_interrupt();
+                }
                 break;
             }
             case RDPCommandType::SetColorImage:
             {
+                // Rows of another image can overlap rows of other tiles in this one
+                flush();
                 SetColorImageCommand color_format;
                 color_format.full = data[0];
-                framebuffer_dram_address_ = color_format.dram_address;
-                framebuffer_width_ = color_format.width + 1;
-                framebuffer_format_ = color_format.format;
+                state_.framebuffer_dram_address = color_format.dram_address;
+                state_.framebuffer_width = color_format.width + 1;
+                state_.framebuffer_format = color_format.format;
                 // 0 = 4bpp, 1 = 8bpp, 2 = 16bpp, 3 = 32bpp
-                framebuffer_pixel_size_ = 4 * (1 << color_format.size);
+                state_.framebuffer_pixel_size = 4 * (1 << color_format.size);
+                state_dirty_ = true;
+                pipelines_dirty_ = true;
                 break;
             }
             case RDPCommandType::Triangle:
@@ -295,52 +526,56 @@ namespace hydra::N64
                 bool shade = id8 & 0b100;
                 EdgewalkerInput input = triangle_get_edgewalker_input(data, shade, texture, depth);
                 Primitive primitive = edgewalker(input);
-                render_primitive(primitive);
+                queue_primitive(primitive);
                 break;
             }
             case RDPCommandType::Rectangle:
             {
                 EdgewalkerInput input = rectangle_get_edgewalker_input<false, false>(data);
                 Primitive primitive = edgewalker(input);
-                render_primitive(primitive);
+                queue_primitive(primitive);
                 break;
             }
             case RDPCommandType::TextureRectangle:
             {
                 EdgewalkerInput input = rectangle_get_edgewalker_input<true, false>(data);
                 Primitive primitive = edgewalker(input);
-                render_primitive(primitive);
+                queue_primitive(primitive);
                 break;
             }
             case RDPCommandType::TextureRectangleFlip:
             {
                 EdgewalkerInput input = rectangle_get_edgewalker_input<true, true>(data);
                 Primitive primitive = edgewalker(input);
-                render_primitive(primitive);
+                queue_primitive(primitive);
                 break;
             }
             case RDPCommandType::SetFillColor:
             {
-                fill_color_32_ = data[0] & 0xFFFFFFFF;
-                fill_color_16_0_ = data[0] & 0xFFFF;
-                fill_color_16_1_ = (data[0] >> 16);
-                fill_color_32_ = hydra::bswap32(fill_color_32_);
+                state_.fill_color_32 = data[0] & 0xFFFFFFFF;
+                state_.fill_color_16_0 = data[0] & 0xFFFF;
+                state_.fill_color_16_1 = (data[0] >> 16);
+                state_.fill_color_32 = hydra::bswap32(state_.fill_color_32);
+                state_dirty_ = true;
                 break;
             }
             case RDPCommandType::LoadTile:
             {
                 // Loads a tile (part of the bigger texture set by SetTextureImage) into TMEM
+                flush();
                 LoadTileCommand command;
                 command.full = data[0];
 
                 load_tile(command);
+                state_dirty_ = true;
                 break;
             }
             case RDPCommandType::LoadBlock:
             {
+                flush();
                 LoadBlockCommand command;
                 command.full = data[0];
-                TileDescriptor& tile = tiles_[command.tile];
+                TileDescriptor& tile = state_.tiles[command.tile];
 
                 int sl = command.SL;
                 int sh = command.SH;
@@ -414,7 +649,7 @@ namespace hydra::N64
                 // how wide each line is, and the format and size of the texture.
                 SetTileCommand command;
                 command.full = data[0];
-                TileDescriptor& tile = tiles_[command.Tile];
+                TileDescriptor& tile = state_.tiles[command.Tile];
                 tile.tmem_address = command.TMemAddress;
                 tile.format = static_cast<Format>(command.format);
                 tile.size = 4 * (1 << command.size);
@@ -433,17 +668,20 @@ namespace hydra::N64
                     tile.mask_t = -1;
                 else
                     tile.mask_t = (1 << command.MaskT) - 1;
+                state_dirty_ = true;
+                pipelines_dirty_ = true;
                 break;
             }
             case RDPCommandType::SetTileSize:
             {
                 SetTileSizeCommand command;
                 command.full = data[0];
-                TileDescriptor& tile = tiles_[command.Tile];
+                TileDescriptor& tile = state_.tiles[command.Tile];
                 tile.sl = command.SL;
                 tile.tl = command.TL;
                 tile.sh = command.SH;
                 tile.th = command.TH;
+                state_dirty_ = true;
                 break;
             }
             case RDPCommandType::SetTextureImage:
@@ -460,70 +698,71 @@ namespace hydra::N64
             {
                 SetOtherModesCommand command;
                 command.full = data[0];
-                cycle_type_ = static_cast<CycleType>(command.cycle_type);
-                z_compare_en_ = command.z_compare_en;
-                z_update_en_ = command.z_update_en;
-                z_source_sel_ = command.z_source_sel;
-                z_mode_ = command.z_mode;
-
-                blender_1a_[0] = command.b_m1a_0;
-                blender_1b_[0] = command.b_m1b_0;
-                blender_2a_[0] = command.b_m2a_0;
-                blender_2b_[0] = command.b_m2b_0;
-
-                blender_1a_[1] = command.b_m1a_1;
-                blender_1b_[1] = command.b_m1b_1;
-                blender_2a_[1] = command.b_m2a_1;
-                blender_2b_[1] = command.b_m2b_1;
-
-                image_read_en_ = command.image_read_en;
-                alpha_compare_en_ = command.alpha_compare_en;
-                antialias_en_ = command.antialias_en;
-                cvg_dest_ = static_cast<CoverageMode>(command.cvg_dest);
-                color_on_cvg_ = command.color_on_cvg;
-                if (command.persp_tex_en)
-                {
-                    perspective_correction_func_ = &perspective_correction;
-                }
-                else
-                {
-                    perspective_correction_func_ = &no_perspective_correction;
-                }
+                state_.cycle_type = static_cast<CycleType>(command.cycle_type);
+                state_.z_compare_en = command.z_compare_en;
+                state_.z_update_en = command.z_update_en;
+                state_.z_source_sel = command.z_source_sel;
+                state_.z_mode = command.z_mode;
+
+                state_.blender_1a[0] = command.b_m1a_0;
+                state_.blender_1b[0] = command.b_m1b_0;
+                state_.blender_2a[0] = command.b_m2a_0;
+                state_.blender_2b[0] = command.b_m2b_0;
+
+                state_.blender_1a[1] = command.b_m1a_1;
+                state_.blender_1b[1] = command.b_m1b_1;
+                state_.blender_2a[1] = command.b_m2a_1;
+                state_.blender_2b[1] = command.b_m2b_1;
+
+                state_.image_read_en = command.image_read_en;
+                state_.alpha_compare_en = command.alpha_compare_en;
+                state_.antialias_en = command.antialias_en;
+                state_.cvg_dest = static_cast<CoverageMode>(command.cvg_dest);
+                state_.color_on_cvg = command.color_on_cvg;
+                state_.persp_tex_en = command.persp_tex_en;
+                state_dirty_ = true;
+                pipelines_dirty_ = true;
                 break;
             }
             case RDPCommandType::SetPrimDepth:
             {
-                primitive_depth_ = data[0] & (0x7FFF << 16);
-                primitive_depth_delta_ = data[0] & 0xFFFF;
+                state_.primitive_depth = data[0] & (0x7FFF << 16);
+                state_.primitive_depth_delta = data[0] & 0xFFFF;
+                state_dirty_ = true;
                 break;
             }
             case RDPCommandType::SetZImage:
             {
-                zbuffer_dram_address_ = data[0] & 0x1FFFFFF;
+                flush();
+                state_.zbuffer_dram_address = data[0] & 0x1FFFFFF;
+                state_dirty_ = true;
                 break;
             }
             case RDPCommandType::SetEnvironmentColor:
             {
-                environment_color_ = data[0] & 0xFFFFFFFF;
-                environment_color_ = hydra::bswap32(environment_color_);
+                state_.environment_color = data[0] & 0xFFFFFFFF;
+                state_.environment_color = hydra::bswap32(state_.environment_color);
 
-                uint8_t alpha = environment_color_ >> 24;
-                environment_alpha_ = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+                uint8_t alpha = state_.environment_color >> 24;
+                state_.environment_alpha = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+                state_dirty_ = true;
                 break;
             }
             case RDPCommandType::SetBlendColor:
             {
-                blend_color_ = data[0] & 0xFFFFFFFF;
-                blend_color_ = hydra::bswap32(blend_color_);
+                state_.blend_color = data[0] & 0xFFFFFFFF;
+                state_.blend_color = hydra::bswap32(state_.blend_color);
+                state_dirty_ = true;
                 break;
             }
             case RDPCommandType::SetPrimitiveColor:
             {
-                primitive_color_ = data[0] & 0xFFFFFFFF;
-                primitive_color_ = hydra::bswap32(primitive_color_);
+                state_.primitive_color = data[0] & 0xFFFFFFFF;
+                state_.primitive_color = hydra::bswap32(state_.primitive_color);
 
-                uint8_t alpha = primitive_color_ >> 24;
-                primitive_alpha_ = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+                uint8_t alpha = state_.primitive_color >> 24;
+                state_.primitive_alpha = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+                state_dirty_ = true;
                 break;
             }
             case RDPCommandType::SetScissor:
@@ -538,11 +777,12 @@ namespace hydra::N64
             }
             case RDPCommandType::SetFogColor:
             {
-                fog_color_ = data[0] & 0xFFFFFFFF;
-                fog_color_ = hydra::bswap32(fog_color_);
+                state_.fog_color = data[0] & 0xFFFFFFFF;
+                state_.fog_color = hydra::bswap32(state_.fog_color);
 
-                uint8_t alpha = fog_color_ >> 24;
-                fog_alpha_ = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+                uint8_t alpha = state_.fog_color >> 24;
+                state_.fog_alpha = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+                state_dirty_ = true;
                 break;
             }
             case RDPCommandType::SetCombineMode:
@@ -550,25 +790,27 @@ namespace hydra::N64
                 SetCombineModeCommand command;
                 command.full = data[0];
 
-                color_sub_a_[0] = color_get_sub_a(command.sub_A_RGB_0);
-                color_sub_b_[0] = color_get_sub_b(command.sub_B_RGB_0);
-                color_multiplier_[0] = color_get_mul(command.mul_RGB_0);
-                color_adder_[0] = color_get_add(command.add_RGB_0);
-
-                color_sub_a_[1] = color_get_sub_a(command.sub_A_RGB_1);
-                color_sub_b_[1] = color_get_sub_b(command.sub_B_RGB_1);
-                color_multiplier_[1] = color_get_mul(command.mul_RGB_1);
-                color_adder_[1] = color_get_add(command.add_RGB_1);
-
-                alpha_sub_a_[0] = alpha_get_sub_add(command.sub_A_Alpha_0);
-                alpha_sub_b_[0] = alpha_get_sub_add(command.sub_B_Alpha_0);
-                alpha_multiplier_[0] = alpha_get_mul(command.mul_Alpha_0);
-                alpha_adder_[0] = alpha_get_sub_add(command.add_Alpha_0);
-
-                alpha_sub_a_[1] = alpha_get_sub_add(command.sub_A_Alpha_1);
-                alpha_sub_b_[1] = alpha_get_sub_add(command.sub_B_Alpha_1);
-                alpha_multiplier_[1] = alpha_get_mul(command.mul_Alpha_1);
-                alpha_adder_[1] = alpha_get_sub_add(command.add_Alpha_1);
+                state_.color_sub_a[0] = color_get_sub_a(command.sub_A_RGB_0);
+                state_.color_sub_b[0] = color_get_sub_b(command.sub_B_RGB_0);
+                state_.color_multiplier[0] = color_get_mul(command.mul_RGB_0);
+                state_.color_adder[0] = color_get_add(command.add_RGB_0);
+
+                state_.color_sub_a[1] = color_get_sub_a(command.sub_A_RGB_1);
+                state_.color_sub_b[1] = color_get_sub_b(command.sub_B_RGB_1);
+                state_.color_multiplier[1] = color_get_mul(command.mul_RGB_1);
+                state_.color_adder[1] = color_get_add(command.add_RGB_1);
+
+                state_.alpha_sub_a[0] = alpha_get_sub_add(command.sub_A_Alpha_0);
+                state_.alpha_sub_b[0] = alpha_get_sub_add(command.sub_B_Alpha_0);
+                state_.alpha_multiplier[0] = alpha_get_mul(command.mul_Alpha_0);
+                state_.alpha_adder[0] = alpha_get_sub_add(command.add_Alpha_0);
+
+                state_.alpha_sub_a[1] = alpha_get_sub_add(command.sub_A_Alpha_1);
+                state_.alpha_sub_b[1] = alpha_get_sub_add(command.sub_B_Alpha_1);
+                state_.alpha_multiplier[1] = alpha_get_mul(command.mul_Alpha_1);
+                state_.alpha_adder[1] = alpha_get_sub_add(command.add_Alpha_1);
+                state_dirty_ = true;
+                pipelines_dirty_ = true;
                 break;
             }
             case RDPCommandType::SetKeyR:
@@ -586,86 +828,86 @@ namespace hydra::N64
         }
     }
 
-    uint32_t* RDP::color_get_sub_a(uint8_t sub_a)
+    CombinerInput RDP::color_get_sub_a(uint8_t sub_a)
     {
         switch (sub_a & 0b1111)
         {
             case 0:
-                return &combined_color_;
+                return CombinerInput::Combined;
             case 1:
-                return &texel_color_[0];
+                return CombinerInput::Texel0;
             case 2:
-                return &texel_color_[1];
+                return CombinerInput::Texel1;
             case 3:
-                return &primitive_color_;
+                return CombinerInput::Primitive;
             case 4:
-                return &shade_color_;
+                return CombinerInput::Shade;
             case 5:
-                return &environment_color_;
+                return CombinerInput::Environment;
             case 6:
-                return &color_one_;
+                return CombinerInput::One;
             case 7:
-                return &noise_color_;
+                return CombinerInput::Noise;
             default:
-                return &color_zero_;
+                return CombinerInput::Zero;
         }
     }
 
-    uint32_t* RDP::color_get_sub_b(uint8_t sub_b)
+    CombinerInput RDP::color_get_sub_b(uint8_t sub_b)
     {
         switch (sub_b & 0b1111)
         {
             case 0:
-                return &combined_color_;
+                return CombinerInput::Combined;
             case 1:
-                return &texel_color_[0];
+                return CombinerInput::Texel0;
             case 2:
-                return &texel_color_[1];
+                return CombinerInput::Texel1;
             case 3:
-                return &primitive_color_;
+                return CombinerInput::Primitive;
             case 4:
-                return &shade_color_;
+                return CombinerInput::Shade;
             case 5:
-                return &environment_color_;
+                return CombinerInput::Environment;
             // TODO: Key center??
             case 6:
-                return &color_zero_;
+                return CombinerInput::Zero;
             // TODO: Convert K4??
             case 7:
-                return &color_zero_;
+                return CombinerInput::Zero;
             default:
-                return &color_zero_;
+                return CombinerInput::Zero;
         }
     }
 
-    uint32_t* RDP::color_get_mul(uint8_t mul)
+    CombinerInput RDP::color_get_mul(uint8_t mul)
     {
         switch (mul & 0b11111)
         {
             case 0:
-                return &combined_color_;
+                return CombinerInput::Combined;
             case 1:
-                return &texel_color_[0];
+                return CombinerInput::Texel0;
             case 2:
-                return &texel_color_[1];
+                return CombinerInput::Texel1;
             case 3:
-                return &primitive_color_;
+                return CombinerInput::Primitive;
             case 4:
-                return &shade_color_;
+                return CombinerInput::Shade;
             case 5:
-                return &environment_color_;
+                return CombinerInput::Environment;
             case 7:
-                return &combined_alpha_;
+                return CombinerInput::CombinedAlpha;
             case 8:
-                return &texel_alpha_[0];
+                return CombinerInput::Texel0Alpha;
             case 9:
-                return &texel_alpha_[1];
+                return CombinerInput::Texel1Alpha;
             case 10:
-                return &primitive_alpha_;
+                return CombinerInput::PrimitiveAlpha;
             case 11:
-                return &shade_alpha_;
+                return CombinerInput::ShadeAlpha;
             case 12:
-                return &environment_alpha_;
+                return CombinerInput::EnvironmentAlpha;
             // TODO: rest of the colors
             case 16:
             case 17:
@@ -683,166 +925,151 @@ namespace hydra::N64
             case 29:
             case 30:
             case 31:
-                return &color_zero_;
+                return CombinerInput::Zero;
             default:
                 Logger::WarnOnce("Unhandled mul: {}", mul);
-                return &color_zero_;
+                return CombinerInput::Zero;
         }
     }
 
-    uint32_t* RDP::color_get_add(uint8_t add)
+    CombinerInput RDP::color_get_add(uint8_t add)
     {
         switch (add & 0b111)
         {
             case 0:
-                return &combined_color_;
+                return CombinerInput::Combined;
             case 1:
-                return &texel_color_[0];
+                return CombinerInput::Texel0;
             case 2:
-                return &texel_color_[1];
+                return CombinerInput::Texel1;
             case 3:
-                return &primitive_color_;
+                return CombinerInput::Primitive;
             case 4:
-                return &shade_color_;
+                return CombinerInput::Shade;
             case 5:
-                return &environment_color_;
+                return CombinerInput::Environment;
             case 6:
-                return &color_one_;
+                return CombinerInput::One;
             case 7:
-                return &color_zero_;
+                return CombinerInput::Zero;
         }
         Logger::Fatal("Unreachable!");
-        return nullptr;
+        return CombinerInput::Zero;
     }
 
-    uint32_t* RDP::alpha_get_sub_add(uint8_t sub_a)
+    CombinerInput RDP::alpha_get_sub_add(uint8_t sub_a)
     {
         switch (sub_a & 0b111)
         {
             case 0:
-                return &combined_alpha_;
+                return CombinerInput::CombinedAlpha;
             case 1:
-                return &texel_alpha_[0];
+                return CombinerInput::Texel0Alpha;
             case 2:
-                return &texel_alpha_[1];
+                return CombinerInput::Texel1Alpha;
             case 3:
-                return &primitive_alpha_;
+                return CombinerInput::PrimitiveAlpha;
             case 4:
-                return &shade_alpha_;
+                return CombinerInput::ShadeAlpha;
             case 5:
-                return &environment_alpha_;
+                return CombinerInput::EnvironmentAlpha;
             case 6:
-                return &color_one_;
+                return CombinerInput::One;
             default:
-                return &color_zero_;
+                return CombinerInput::Zero;
         }
     }
 
-    uint32_t* RDP::alpha_get_mul(uint8_t mul)
+    CombinerInput RDP::alpha_get_mul(uint8_t mul)
     {
         switch (mul & 0b111)
         {
             case 0:
             {
                 Logger::WarnOnce("Unhandled alpha mul: LOD fraction", mul);
-                return &color_one_;
+                return CombinerInput::One;
             }
             case 1:
-                return &texel_alpha_[0];
+                return CombinerInput::Texel0Alpha;
             case 2:
-                return &texel_alpha_[1];
+                return CombinerInput::Texel1Alpha;
             case 3:
-                return &primitive_alpha_;
+                return CombinerInput::PrimitiveAlpha;
             case 4:
-                return &shade_alpha_;
+                return CombinerInput::ShadeAlpha;
             case 5:
-                return &environment_alpha_;
+                return CombinerInput::EnvironmentAlpha;
             case 6:
             {
                 Logger::WarnOnce("Unhandled alpha mul: Primitive LOD fraction", mul);
-                return &color_zero_;
+                return CombinerInput::Zero;
             }
             default:
-                return &color_zero_;
+                return CombinerInput::Zero;
         }
     }
 
-    void RDP::draw_pixel(int x, int y)
+    template <CycleType Cycle, bool Framebuffer16>
+    void RDP::draw_pixel(RdpPixelContext& ctx, int x, int y)
     {
-        uintptr_t address = reinterpret_cast<uintptr_t>(rdram_ptr_) + framebuffer_dram_address_ +
-                            (y * framebuffer_width_ + x) * (framebuffer_pixel_size_ >> 3);
-        switch (cycle_type_)
+        const RdpState& state = *ctx.state;
+        uintptr_t address = reinterpret_cast<uintptr_t>(rdram_ptr_) + state.framebuffer_dram_address +
+                            (y * state.framebuffer_width + x) * (state.framebuffer_pixel_size >> 3);
+        if constexpr (Cycle == CycleType::Cycle1 || Cycle == CycleType::Cycle2)
         {
-            case CycleType::Cycle2:
+            // TODO: there's may be a way to check which cycle we should get the data from
+            if constexpr (Cycle == CycleType::Cycle2)
             {
-                color_combiner(0);
-                color_combiner(1);
-                blender(0);
-                // TODO: remove code duplication
-                if (framebuffer_pixel_size_ == 16)
-                {
-                    uint16_t* ptr = reinterpret_cast<uint16_t*>(address);
-                    framebuffer_color_ = rgba16_to_rgba32(hydra::bswap16(*ptr));
-                    *ptr = hydra::bswap16(rgba32_to_rgba16(blender(1)));
-                }
-                else
-                {
-                    uint32_t* ptr = reinterpret_cast<uint32_t*>(address);
-                    framebuffer_color_ = hydra::bswap32(*ptr);
-                    *ptr = hydra::bswap32(blender(1));
-                }
-                break;
+                color_combiner(ctx, 0);
             }
-            case CycleType::Cycle1:
+            color_combiner(ctx, 1);
+            if constexpr (Cycle == CycleType::Cycle2)
             {
-                // TODO: there's may be a way to check which cycle we should get the data from
-                color_combiner(1);
-                if (framebuffer_pixel_size_ == 16)
-                {
-                    uint16_t* ptr = reinterpret_cast<uint16_t*>(address);
-                    framebuffer_color_ = rgba16_to_rgba32(hydra::bswap16(*ptr));
-                    *ptr = hydra::bswap16(rgba32_to_rgba16(blender(0)));
-                }
-                else
-                {
-                    uint32_t* ptr = reinterpret_cast<uint32_t*>(address);
-                    framebuffer_color_ = hydra::bswap32(*ptr);
-                    *ptr = hydra::bswap32(blender(0));
-                }
-                break;
+                blender(ctx, 0);
             }
-            case CycleType::Copy:
+            constexpr int cycle = Cycle == CycleType::Cycle2 ? 1 : 0;
+            if constexpr (Framebuffer16)
             {
-                if (alpha_compare_en_ && texel_alpha_[0] == 0)
-                {
-                    break;
-                }
+                uint16_t* ptr = reinterpret_cast<uint16_t*>(address);
+                ctx.framebuffer_color = rgba16_to_rgba32(hydra::bswap16(*ptr));
+                *ptr = hydra::bswap16(rgba32_to_rgba16(blender(ctx, cycle)));
+            }
+            else
+            {
+                uint32_t* ptr = reinterpret_cast<uint32_t*>(address);
+                ctx.framebuffer_color = hydra::bswap32(*ptr);
+                *ptr = hydra::bswap32(blender(ctx, cycle));
+            }
+        }
+        else if constexpr (Cycle == CycleType::Copy)
+        {
+            if (state.alpha_compare_en && ctx[CombinerInput::Texel0Alpha] == 0)
+            {
+                return;
+            }
 
-                if (framebuffer_pixel_size_ == 16)
-                {
-                    uint16_t* ptr = reinterpret_cast<uint16_t*>(address);
-                    *ptr = hydra::bswap16(rgba32_to_rgba16(texel_color_[0]));
-                }
-                else
-                {
-                    uint32_t* ptr = reinterpret_cast<uint32_t*>(address);
-                    *ptr = hydra::bswap32(texel_color_[0]);
-                }
-                break;
+            if constexpr (Framebuffer16)
+            {
+                uint16_t* ptr = reinterpret_cast<uint16_t*>(address);
+                *ptr = hydra::bswap16(rgba32_to_rgba16(ctx[CombinerInput::Texel0]));
             }
-            case CycleType::Fill:
+            else
             {
-                if (framebuffer_pixel_size_ == 16)
-                {
-                    uint16_t* ptr = reinterpret_cast<uint16_t*>(address);
-                    *ptr = hydra::bswap16((x & 1) ? fill_color_16_0_ : fill_color_16_1_);
-                }
-                else
-                {
-                    uint32_t* ptr = reinterpret_cast<uint32_t*>(address);
-                    *ptr = hydra::bswap32(fill_color_32_);
-                }
-                break;
+                uint32_t* ptr = reinterpret_cast<uint32_t*>(address);
+                *ptr = hydra::bswap32(ctx[CombinerInput::Texel0]);
+            }
+        }
+        else
+        {
+            if constexpr (Framebuffer16)
+            {
+                uint16_t* ptr = reinterpret_cast<uint16_t*>(address);
+                *ptr = hydra::bswap16((x & 1) ? state.fill_color_16_0 : state.fill_color_16_1);
+            }
+            else
+            {
+                uint32_t* ptr = reinterpret_cast<uint32_t*>(address);
+                *ptr = hydra::bswap32(state.fill_color_32);
             }
         }
     }
@@ -853,80 +1080,83 @@ namespace hydra::N64
         return (a - b) * c / 0xFF + d;
     }
 
-    void RDP::color_combiner(int cycle)
+    void RDP::color_combiner(RdpPixelContext& ctx, int cycle)
     {
-        uint8_t r = combine(*color_sub_a_[cycle], *color_sub_b_[cycle], *color_multiplier_[cycle],
-                            *color_adder_[cycle]);
-        uint8_t g = combine(*color_sub_a_[cycle] >> 8, *color_sub_b_[cycle] >> 8,
-                            *color_multiplier_[cycle] >> 8, *color_adder_[cycle] >> 8);
-        uint8_t b = combine(*color_sub_a_[cycle] >> 16, *color_sub_b_[cycle] >> 16,
-                            *color_multiplier_[cycle] >> 16, *color_adder_[cycle] >> 16);
-        uint8_t a = combine(*alpha_sub_a_[cycle], *alpha_sub_b_[cycle], *alpha_multiplier_[cycle],
-                            *alpha_adder_[cycle]);
-        combined_color_ = (a << 24) | (b << 16) | (g << 8) | r;
-        combined_alpha_ = a << 24 | a << 16 | a << 8 | a;
+        const RdpState& state = *ctx.state;
+        uint32_t sub_a = ctx[state.color_sub_a[cycle]];
+        uint32_t sub_b = ctx[state.color_sub_b[cycle]];
+        uint32_t multiplier = ctx[state.color_multiplier[cycle]];
+        uint32_t adder = ctx[state.color_adder[cycle]];
+        uint8_t r = combine(sub_a, sub_b, multiplier, adder);
+        uint8_t g = combine(sub_a >> 8, sub_b >> 8, multiplier >> 8, adder >> 8);
+        uint8_t b = combine(sub_a >> 16, sub_b >> 16, multiplier >> 16, adder >> 16);
+        uint8_t a = combine(ctx[state.alpha_sub_a[cycle]], ctx[state.alpha_sub_b[cycle]],
+                            ctx[state.alpha_multiplier[cycle]], ctx[state.alpha_adder[cycle]]);
+        ctx[CombinerInput::Combined] = (a << 24) | (b << 16) | (g << 8) | r;
+        ctx[CombinerInput::CombinedAlpha] = a << 24 | a << 16 | a << 8 | a;
     }
 
-    uint32_t RDP::blender(int cycle)
+    uint32_t RDP::blender(RdpPixelContext& ctx, int cycle)
     {
+        const RdpState& state = *ctx.state;
         uint32_t color1, color2;
         uint8_t multiplier1, multiplier2;
 
-        switch (blender_1a_[cycle] & 0b11)
+        switch (state.blender_1a[cycle] & 0b11)
         {
             case 0:
-                color1 = combined_color_;
+                color1 = ctx[CombinerInput::Combined];
                 break;
             case 1:
-                color1 = framebuffer_color_;
+                color1 = ctx.framebuffer_color;
                 break;
             case 2:
-                color1 = blend_color_;
+                color1 = state.blend_color;
                 break;
             case 3:
-                color1 = fog_color_;
+                color1 = state.fog_color;
                 break;
         }
 
-        switch (blender_2a_[cycle] & 0b11)
+        switch (state.blender_2a[cycle] & 0b11)
         {
             case 0:
-                color2 = combined_color_;
+                color2 = ctx[CombinerInput::Combined];
                 break;
             case 1:
-                color2 = framebuffer_color_;
+                color2 = ctx.framebuffer_color;
                 break;
             case 2:
-                color2 = blend_color_;
+                color2 = state.blend_color;
                 break;
             case 3:
-                color2 = fog_color_;
+                color2 = state.fog_color;
                 break;
         }
 
-        switch (blender_1b_[cycle] & 0b11)
+        switch (state.blender_1b[cycle] & 0b11)
         {
             case 0:
-                multiplier1 = combined_alpha_ >> 24;
+                multiplier1 = ctx[CombinerInput::CombinedAlpha] >> 24;
                 break;
             case 1:
-                multiplier1 = fog_alpha_ >> 24;
+                multiplier1 = state.fog_alpha >> 24;
                 break;
             case 2:
-                multiplier1 = shade_alpha_ >> 24;
+                multiplier1 = ctx[CombinerInput::ShadeAlpha] >> 24;
                 break;
             case 3:
                 multiplier1 = 0x00;
                 break;
         }
 
-        switch (blender_2b_[cycle] & 0b11)
+        switch (state.blender_2b[cycle] & 0b11)
         {
             case 0:
                 multiplier2 = ~multiplier1;
                 break;
             case 1:
-                multiplier2 = 0x00; //(uint8_t)(((float)old_coverage_ / 8.0f) * 0xFF);
+                multiplier2 = 0x00; //(uint8_t)(((float)ctx.old_coverage / 8.0f) * 0xFF);
                 break;
             case 2:
                 multiplier2 = 0xFF;
@@ -937,16 +1167,17 @@ namespace hydra::N64
         }
 
         bool zero_multipliers = multiplier1 + multiplier2 == 0;
-        if (zero_multipliers)
+        if (zero_multipliers && ctx.warned.blender[cycle] != &state)
         {
+            ctx.warned.blender[cycle] = &state;
             Logger::WarnOnce("Blender division by zero - blender settings: {} {} {} {}",
-                             blender_1a_[cycle], blender_2a_[cycle], blender_1b_[cycle],
-                             blender_2b_[cycle]);
+                             state.blender_1a[cycle], state.blender_2a[cycle], state.blender_1b[cycle],
+                             state.blender_2b[cycle]);
         }
 
         uint8_t r, g, b;
 
-        if ((!color_on_cvg_ || coverage_overflow_) && !zero_multipliers)
+        if ((!state.color_on_cvg || ctx.coverage_overflow) && !zero_multipliers)
         {
             r = (((color1 >> 0) & 0xFF) * multiplier1 + ((color2 >> 0) & 0xFF) * multiplier2) /
                 (multiplier1 + multiplier2);
@@ -962,13 +1193,13 @@ namespace hydra::N64
             b = (color2 >> 16) & 0xFF;
         }
 
-        // uint8_t r_f = framebuffer_color_ & 0xFF;
-        // uint8_t g_f = (framebuffer_color_ >> 8) & 0xFF;
-        // uint8_t b_f = (framebuffer_color_ >> 16) & 0xFF;
+        // uint8_t r_f = ctx.framebuffer_color & 0xFF;
+        // uint8_t g_f = (ctx.framebuffer_color >> 8) & 0xFF;
+        // uint8_t b_f = (ctx.framebuffer_color >> 16) & 0xFF;
 
-        if (current_coverage_ != 8)
+        if (ctx.current_coverage != 8)
         {
-            // float cvg = (float)current_coverage_ / 8.0f;
+            // float cvg = (float)ctx.current_coverage / 8.0f;
             // r = (r * cvg) + (r_f * (1 - cvg));
             // g = (g * cvg) + (g_f * (1 - cvg));
             // b = (b * cvg) + (b_f * (1 - cvg));
@@ -977,8 +1208,10 @@ namespace hydra::N64
         return (0 << 24) | (b << 16) | (g << 8) | r;
     }
 
-    bool RDP::depth_test(int x, int y, int32_t z, int16_t dz)
+    template <bool ZCompare, bool Framebuffer16>
+    bool RDP::depth_test(RdpPixelContext& ctx, int x, int y, int32_t z, int16_t dz)
     {
+        const RdpState& state = *ctx.state;
         enum DepthMode
         {
             Opaque,
@@ -987,13 +1220,13 @@ namespace hydra::N64
             Decal
         };
 
-        old_coverage_ = coverage_get(x, y);
-        coverage_overflow_ = ((old_coverage_ - 1) + current_coverage_) & 0b1000;
+        ctx.old_coverage = coverage_get<Framebuffer16>(state, x, y);
+        ctx.coverage_overflow = ((ctx.old_coverage - 1) + ctx.current_coverage) & 0b1000;
 
-        if (z_compare_en_)
+        if constexpr (ZCompare)
         {
-            int32_t old_z = z_get(x, y);
-            int16_t old_dz = dz_get(x, y);
+            int32_t old_z = z_get(state, x, y);
+            int16_t old_dz = dz_get(state, x, y);
             int16_t dz_max = std::max(old_dz, dz);
             bool was_max = old_z == 0x3FFFF;
             bool pass = false;
@@ -1003,16 +1236,20 @@ namespace hydra::N64
             bool infront = z < old_z;
 
             // See Color Blend Hardware in the programmers manual
-            switch (z_mode_ & 0b11)
+            switch (state.z_mode & 0b11)
             {
                 case Opaque:
                 {
-                    pass = was_max || (coverage_overflow_ ? infront : nearer);
+                    pass = was_max || (ctx.coverage_overflow ? infront : nearer);
                     break;
                 }
                 case Interpenetrating:
                 {
-                    Logger::WarnOnce("Interpenetrating depth mode not implemented");
+                    if (!ctx.warned.interpenetrating)
+                    {
+                        Logger::WarnOnce("Interpenetrating depth mode not implemented");
+                        ctx.warned.interpenetrating = true;
+                    }
                     pass = was_max || z < old_z;
                     break;
                 }
@@ -1035,19 +1272,19 @@ namespace hydra::N64
         }
     }
 
-    uint32_t RDP::z_get(int x, int y)
+    uint32_t RDP::z_get(const RdpState& state, int x, int y)
     {
-        uintptr_t address = reinterpret_cast<uintptr_t>(rdram_ptr_) + zbuffer_dram_address_ +
-                            (y * framebuffer_width_ + x) * 2;
+        uintptr_t address = reinterpret_cast<uintptr_t>(rdram_ptr_) + state.zbuffer_dram_address +
+                            (y * state.framebuffer_width + x) * 2;
         uint16_t* ptr = reinterpret_cast<uint16_t*>(address);
         uint16_t z_compressed = (hydra::bswap16(*ptr) >> 2) & 0x3FFF;
         uint32_t decompressed = z_decompress_lut_[z_compressed];
         return decompressed;
     }
 
-    uint16_t RDP::dz_get(int x, int y)
+    uint16_t RDP::dz_get(const RdpState& state, int x, int y)
     {
-        uintptr_t address = zbuffer_dram_address_ + (y * framebuffer_width_ + x) * 2;
+        uintptr_t address = state.zbuffer_dram_address + (y * state.framebuffer_width + x) * 2;
         uint16_t* ptr = reinterpret_cast<uint16_t*>(rdram_ptr_ + address);
         bool hidden1 = rdram_9th_bit_[address];
         bool hidden2 = rdram_9th_bit_[address + 1];
@@ -1055,10 +1292,10 @@ namespace hydra::N64
         return dz_decompress(dz_c);
     }
 
-    void RDP::dz_set(int x, int y, uint16_t dz)
+    void RDP::dz_set(const RdpState& state, int x, int y, uint16_t dz)
     {
         uint8_t dz_c = dz_compress(dz);
-        uintptr_t address = zbuffer_dram_address_ + (y * framebuffer_width_ + x) * 2;
+        uintptr_t address = state.zbuffer_dram_address + (y * state.framebuffer_width + x) * 2;
         uint16_t* ptr = reinterpret_cast<uint16_t*>(rdram_ptr_ + address);
         uint16_t old = hydra::bswap16(*ptr);
         old &= 0xFFFC;
@@ -1068,13 +1305,14 @@ namespace hydra::N64
         rdram_9th_bit_[address + 1] = (dz_c >> 3) & 0b1;
     }
 
-    uint8_t RDP::coverage_get(int x, int y)
+    template <bool Framebuffer16>
+    uint8_t RDP::coverage_get(const RdpState& state, int x, int y)
     {
         uint8_t coverage = 0;
-        if (framebuffer_pixel_size_ == 16)
+        if constexpr (Framebuffer16)
         {
             // Get coverage from hidden bits
-            uintptr_t address = framebuffer_dram_address_ + (y * framebuffer_width_ + x) * 2;
+            uintptr_t address = state.framebuffer_dram_address + (y * state.framebuffer_width + x) * 2;
             bool bit0 = rdram_9th_bit_[address];
             bool bit1 = rdram_9th_bit_[address + 1];
             bool bit2 = hydra::bswap16(*reinterpret_cast<uint16_t*>(&rdram_ptr_[address])) & 0b1;
@@ -1084,7 +1322,7 @@ namespace hydra::N64
         {
             // Coverage is top 3 bits of alpha
             uintptr_t address = reinterpret_cast<uintptr_t>(rdram_ptr_) +
-                                framebuffer_dram_address_ + (y * framebuffer_width_ + x) * 4;
+                                state.framebuffer_dram_address + (y * state.framebuffer_width + x) * 4;
             uint32_t* ptr = reinterpret_cast<uint32_t*>(address);
             coverage = (hydra::bswap32(*ptr) >> 29) & 0b111;
         }
@@ -1093,10 +1331,11 @@ namespace hydra::N64
         return coverage;
     }
 
-    void RDP::coverage_set(int x, int y, uint8_t coverage)
+    template <bool Framebuffer16>
+    void RDP::coverage_set(const RdpState& state, int x, int y, uint8_t coverage)
     {
-        auto old_coverage = coverage_get(x, y);
-        switch (cvg_dest_)
+        auto old_coverage = coverage_get<Framebuffer16>(state, x, y);
+        switch (state.cvg_dest)
         {
             case CoverageMode::Clamp:
             {
@@ -1125,12 +1364,12 @@ namespace hydra::N64
             }
         }
 
-        if (framebuffer_pixel_size_ == 16)
+        if constexpr (Framebuffer16)
         {
             bool bit0 = coverage & 0b1;
             bool bit1 = coverage & 0b10;
             bool bit2 = coverage & 0b100;
-            uintptr_t address = framebuffer_dram_address_ + (y * framebuffer_width_ + x) * 2;
+            uintptr_t address = state.framebuffer_dram_address + (y * state.framebuffer_width + x) * 2;
             rdram_9th_bit_[address] = bit0;
             rdram_9th_bit_[address + 1] = bit1;
             uint16_t* ptr = reinterpret_cast<uint16_t*>(&rdram_ptr_[address]);
@@ -1142,7 +1381,7 @@ namespace hydra::N64
         else
         {
             uintptr_t address = reinterpret_cast<uintptr_t>(rdram_ptr_) +
-                                framebuffer_dram_address_ + (y * framebuffer_width_ + x) * 4;
+                                state.framebuffer_dram_address + (y * state.framebuffer_width + x) * 4;
             uint32_t* ptr = reinterpret_cast<uint32_t*>(address);
             uint32_t old = hydra::bswap32(*ptr);
             old &= 0x1FFFFFFF;
@@ -1151,11 +1390,11 @@ namespace hydra::N64
         }
     }
 
-    void RDP::z_set(int x, int y, uint32_t z)
+    void RDP::z_set(const RdpState& state, int x, int y, uint32_t z)
     {
         z &= 0x3FFFF;
-        uintptr_t address = reinterpret_cast<uintptr_t>(rdram_ptr_) + zbuffer_dram_address_ +
-                            (y * framebuffer_width_ + x) * 2;
+        uintptr_t address = reinterpret_cast<uintptr_t>(rdram_ptr_) + state.zbuffer_dram_address +
+                            (y * state.framebuffer_width + x) * 2;
         uint16_t* ptr = reinterpret_cast<uint16_t*>(address);
         uint16_t compressed = z_compress_lut_[z & 0x3FFFF];
         *ptr = hydra::bswap16(compressed);
@@ -1207,9 +1446,9 @@ namespace hydra::N64
         return 1 << dz_c;
     }
 
-    void RDP::fetch_texels(int texel, int tile, int32_t s, int32_t t)
+    template <Format TexelFormat, int TexelSize>
+    void RDP::fetch_texels(RdpPixelContext& ctx, const TileDescriptor& td, int32_t s, int32_t t)
     {
-        TileDescriptor& td = tiles_[tile];
         if (td.clamp_s)
         {
             auto max_s = ((td.sh >> 2) - (td.sl >> 2)) & 0x3ff;
@@ -1232,125 +1471,110 @@ namespace hydra::N64
         }
         else
             t &= td.mask_t;
+
+        uint32_t texel_color, texel_alpha;
+        if constexpr (TexelFormat == Format::RGBA && TexelSize == 16)
+        {
+            uint16_t address = (td.tmem_address + (t * td.line_width) + s * 2) & 0xFFF;
+            uint8_t byte1 = tmem_[address & 0xFFF];
+            uint8_t byte2 = tmem_[(address + 1) & 0xFFF];
+            texel_color = rgba16_to_rgba32((byte1 << 8) | byte2);
+            uint8_t alpha = texel_color >> 24;
+            texel_alpha = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+        }
+        else if constexpr (TexelFormat == Format::RGBA && TexelSize == 32)
+        {
+            uint16_t address = (td.tmem_address + (t * td.line_width) + s * 2) & 0xFFF;
+            uint8_t byte1 = tmem_[address & 0xFFF];
+            uint8_t byte2 = tmem_[(address + 1) & 0xFFF];
+            uint8_t byte3 = tmem_[(address + 2) & 0xFFF];
+            uint8_t byte4 = tmem_[(address + 3) & 0xFFF];
+            texel_color = (byte1 << 24) | (byte2 << 16) | (byte3 << 8) | byte4;
+            texel_alpha = (byte1 << 24) | (byte1 << 16) | (byte1 << 8) | byte1;
+        }
+        else if constexpr (TexelFormat == Format::IA && TexelSize == 4)
+        {
+            uint16_t address = (td.tmem_address + (t * td.line_width) + s / 2) & 0xFFF;
+            uint8_t ia = tmem_[address & 0xFFF];
+            ia = (s & 1) ? (ia & 0xF) : (ia >> 4);
+            uint8_t i = ia & 0xE;
+            i = (i << 4) | (i << 1) | (i >> 2);
+            uint8_t a = (ia & 0x1) ? 0xFF : 0;
+            texel_color = (a << 24) | (i << 16) | (i << 8) | i;
+            texel_alpha = (a << 24) | (a << 16) | (a << 8) | a;
+        }
+        else if constexpr (TexelFormat == Format::IA && TexelSize == 8)
+        {
+            uint16_t address = (td.tmem_address + (t * td.line_width) + s) & 0xFFF;
+            uint8_t ia = tmem_[address & 0xFFF];
+            uint8_t i = (ia >> 4) | (ia & 0xF0);
+            uint8_t a = (ia & 0xF) | (ia << 4);
+            texel_color = (a << 24) | (i << 16) | (i << 8) | i;
+            texel_alpha = (a << 24) | (a << 16) | (a << 8) | a;
+        }
+        else if constexpr (TexelFormat == Format::IA && TexelSize == 16)
+        {
+            uint16_t address = (td.tmem_address + (t * td.line_width) + s * 2) & 0xFFF;
+            if (t & 1)
+            {
+                address ^= 0b10;
+            }
+            uint8_t i = tmem_[address & 0xFFF];
+            uint8_t a = tmem_[(address + 1) & 0xFFF];
+            texel_color = (a << 24) | (i << 16) | (i << 8) | i;
+            texel_alpha = (a << 24) | (a << 16) | (a << 8) | a;
+        }
+        else if constexpr (TexelFormat == Format::I && TexelSize == 4)
+        {
+            uint16_t address = (td.tmem_address + (t * td.line_width) + s / 2) & 0xFFF;
+            uint8_t i = tmem_[address & 0xFFF];
+            if (s & 1)
+            {
+                i &= 0xF;
+            }
+            else
+            {
+                i >>= 4;
+            }
+            texel_color = (i << 24) | (i << 16) | (i << 8) | i;
+            texel_alpha = texel_color;
+        }
+        else
+        {
+            static_assert(TexelFormat == Format::I && TexelSize == 8);
+            uint16_t address = (td.tmem_address + (t * td.line_width) + s) & 0xFFF;
+            uint8_t i = tmem_[address & 0xFFF];
+            texel_color = (i << 24) | (i << 16) | (i << 8) | i;
+            texel_alpha = texel_color;
+        }
+
+        ctx[CombinerInput::Texel0] = ctx[CombinerInput::Texel1] = texel_color;
+        ctx[CombinerInput::Texel0Alpha] = ctx[CombinerInput::Texel1Alpha] = texel_alpha;
+    }
+
+    // The texels are left as they were, make_pipeline already warned about the format
+    void RDP::fetch_unsupported_texels(RdpPixelContext&, const TileDescriptor&, int32_t, int32_t)
+    {
+    }
+
+    void RDP::warn_unsupported_texels(const TileDescriptor& td)
+    {
         switch (td.format)
         {
             case Format::RGBA:
             {
-                switch (td.size)
-                {
-                    case 16:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s * 2) & 0xFFF;
-                        uint8_t byte1 = tmem_[address & 0xFFF];
-                        uint8_t byte2 = tmem_[(address + 1) & 0xFFF];
-                        texel_color_[texel] = rgba16_to_rgba32((byte1 << 8) | byte2);
-                        uint8_t alpha = texel_color_[texel] >> 24;
-                        texel_alpha_[texel] = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
-                        break;
-                    }
-                    case 32:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s * 2) & 0xFFF;
-                        uint8_t byte1 = tmem_[address & 0xFFF];
-                        uint8_t byte2 = tmem_[(address + 1) & 0xFFF];
-                        uint8_t byte3 = tmem_[(address + 2) & 0xFFF];
-                        uint8_t byte4 = tmem_[(address + 3) & 0xFFF];
-                        texel_color_[texel] = (byte1 << 24) | (byte2 << 16) | (byte3 << 8) | byte4;
-                        texel_alpha_[texel] = (byte1 << 24) | (byte1 << 16) | (byte1 << 8) | byte1;
-                        break;
-                    }
-                    default:
-                    {
-                        Logger::WarnOnce("Unimplemented texture size for RGBA: {}",
-                                         static_cast<int>(td.size));
-                        break;
-                    }
-                }
+                Logger::WarnOnce("Unimplemented texture size for RGBA: {}",
+                                 static_cast<int>(td.size));
                 break;
             }
             case Format::IA:
             {
-                switch (td.size)
-                {
-                    case 4:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s / 2) & 0xFFF;
-                        uint8_t ia = tmem_[address & 0xFFF];
-                        ia = (s & 1) ? (ia & 0xF) : (ia >> 4);
-                        uint8_t i = ia & 0xE;
-                        i = (i << 4) | (i << 1) | (i >> 2);
-                        uint8_t a = (ia & 0x1) ? 0xFF : 0;
-                        texel_color_[texel] = (a << 24) | (i << 16) | (i << 8) | i;
-                        texel_alpha_[texel] = (a << 24) | (a << 16) | (a << 8) | a;
-                        break;
-                    }
-                    case 8:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s) & 0xFFF;
-                        uint8_t ia = tmem_[address & 0xFFF];
-                        uint8_t i = (ia >> 4) | (ia & 0xF0);
-                        uint8_t a = (ia & 0xF) | (ia << 4);
-                        texel_color_[texel] = (a << 24) | (i << 16) | (i << 8) | i;
-                        texel_alpha_[texel] = (a << 24) | (a << 16) | (a << 8) | a;
-                        break;
-                    }
-                    case 16:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s * 2) & 0xFFF;
-                        if (t & 1)
-                        {
-                            address ^= 0b10;
-                        }
-                        uint8_t i = tmem_[address & 0xFFF];
-                        uint8_t a = tmem_[(address + 1) & 0xFFF];
-                        texel_color_[texel] = (a << 24) | (i << 16) | (i << 8) | i;
-                        texel_alpha_[texel] = (a << 24) | (a << 16) | (a << 8) | a;
-                        break;
-                    }
-                    default:
-                    {
-                        Logger::WarnOnce("Unimplemented texture size for IA: {}",
-                                         static_cast<int>(td.size));
-                        break;
-                    }
-                }
+                Logger::WarnOnce("Unimplemented texture size for IA: {}", static_cast<int>(td.size));
                 break;
             }
             case Format::I:
             {
-                switch (td.size)
-                {
-                    case 4:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s / 2) & 0xFFF;
-                        uint8_t i = tmem_[address & 0xFFF];
-                        if (s & 1)
-                        {
-                            i &= 0xF;
-                        }
-                        else
-                        {
-                            i >>= 4;
-                        }
-                        texel_color_[texel] = (i << 24) | (i << 16) | (i << 8) | i;
-                        texel_alpha_[texel] = texel_color_[texel];
-                        break;
-                    }
-                    case 8:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s) & 0xFFF;
-                        uint8_t i = tmem_[address & 0xFFF];
-                        texel_color_[texel] = (i << 24) | (i << 16) | (i << 8) | i;
-                        texel_alpha_[texel] = texel_color_[texel];
-                        break;
-                    }
-                    default:
-                    {
-                        Logger::WarnOnce("Unimplemented texture size for I: {}",
-                                         static_cast<int>(td.size));
-                        break;
-                    }
-                }
+                Logger::WarnOnce("Unimplemented texture size for I: {}", static_cast<int>(td.size));
                 break;
             }
             default:
@@ -1360,15 +1584,15 @@ namespace hydra::N64
         }
     }
 
-    void RDP::get_noise()
+    void RDP::get_noise(RdpPixelContext& ctx)
     {
-        auto r = irand(&seed_);
-        noise_color_ = (r << 24) | (r << 16) | (r << 8) | r;
+        auto r = irand(ctx.seed);
+        ctx[CombinerInput::Noise] = (r << 24) | (r << 16) | (r << 8) | r;
     }
 
     void RDP::load_tile(const LoadTileCommand& command)
     {
-        TileDescriptor& td = tiles_[command.tile];
+        TileDescriptor& td = state_.tiles[command.tile];
         uint32_t x_start = command.SL >> 2;
         uint32_t x_end = command.SH >> 2;
         uint32_t y_start = command.TL >> 2;
@@ -1589,7 +1813,7 @@ namespace hydra::N64
         RectangleCommand command;
         command.full = data[0];
 
-        if (cycle_type_ == CycleType::Copy || cycle_type_ == CycleType::Fill)
+        if (state_.cycle_type == CycleType::Copy || state_.cycle_type == CycleType::Fill)
         {
             command.yl |= 3;
         }
@@ -1619,7 +1843,7 @@ namespace hydra::N64
             DsDx <<= 6;
             DtDy <<= 6;
 
-            if (cycle_type_ == CycleType::Copy)
+            if (state_.cycle_type == CycleType::Copy)
             {
                 // Copy mode copies 4 pixels at a time, so we need to divide this by 4
                 DsDx >>= 2;
@@ -1696,7 +1920,7 @@ namespace hydra::N64
         primitive.right_major = input.right_major;
 
         bool sign_slopeh = input.slopeh & 0x80000000;
-        if (cycle_type_ != CycleType::Copy)
+        if (state_.cycle_type != CycleType::Copy)
         {
             DrDx = (input.DrDx >> 8) & ~1;
             DgDx = (input.DgDx >> 8) & ~1;
@@ -2001,9 +2225,10 @@ namespace hydra::N64
         }
     }
 
-    void RDP::compute_coverage(const Span& span)
+    void RDP::compute_coverage(RdpPixelContext& ctx, const Span& span)
     {
-        std::memset(&coverage_mask_buffer_, 0xFFFF, sizeof(coverage_mask_buffer_));
+        auto& coverage_mask_buffer = ctx.coverage_mask_buffer;
+        std::memset(&coverage_mask_buffer, 0xFFFF, sizeof(coverage_mask_buffer));
 
         for (int subpixel = 0; subpixel < 4; subpixel++)
         {
@@ -2018,12 +2243,12 @@ namespace hydra::N64
 
             for (int i = span.min_x; i <= current_left_int; i++)
             {
-                coverage_mask_buffer_[i] &= ~(mask << shift);
+                coverage_mask_buffer[i] &= ~(mask << shift);
             }
 
             for (int i = span.max_x; i >= current_right_int; i--)
             {
-                coverage_mask_buffer_[i] &= ~(mask << shift);
+                coverage_mask_buffer[i] &= ~(mask << shift);
             }
 
             auto current_right_frac = current_right & 0b111;
@@ -2046,111 +2271,431 @@ namespace hydra::N64
 
             if (current_right_int == current_left_int)
             {
-                coverage_mask_buffer_[current_right_int] |= (coverage_left & coverage_right)
-                                                            << shift;
+                coverage_mask_buffer[current_right_int] |= (coverage_left & coverage_right)
+                                                           << shift;
                 continue;
             }
 
-            coverage_mask_buffer_[current_right_int] |= coverage_right << shift;
-            coverage_mask_buffer_[current_left_int] |= coverage_left << shift;
+            coverage_mask_buffer[current_right_int] |= coverage_right << shift;
+            coverage_mask_buffer[current_left_int] |= coverage_left << shift;
         }
     }
 
-    void RDP::render_primitive(const Primitive& primitive)
+    RdpPipeline RDP::make_pipeline(const TileDescriptor& tile)
     {
-        // clang-format off
-        hydra::parallel_for(primitive.spans.begin(), primitive.spans.end(), [this, &primitive](auto&& span) {
-                if (!span.valid)
-                    return;
-                int32_t y = span.y;
-                int32_t x_start = 0, x_inc = 0;
-                int32_t DzDx = primitive.DzDx;
-                int32_t DrDx = primitive.DrDx;
-                int32_t DgDx = primitive.DgDx;
-                int32_t DbDx = primitive.DbDx;
-                int32_t DaDx = primitive.DaDx;
+        // Indexed by cycle type, 16bpp, z compare, z update, antialias and perspective
+        static constexpr auto span_functions = []<size_t... Keys>(std::index_sequence<Keys...>) {
+            return std::array<SpanFunction, sizeof...(Keys)>{
+                &RDP::render_span<static_cast<CycleType>(Keys & 0b11), (Keys & 0b100) != 0,
+                                  (Keys & 0b1000) != 0, (Keys & 0b10000) != 0,
+                                  (Keys & 0b100000) != 0, (Keys & 0b1000000) != 0>...};
+        }(std::make_index_sequence<128>());
+
+        uint32_t key = static_cast<uint32_t>(state_.cycle_type) |
+                       (state_.framebuffer_pixel_size == 16) << 2 | state_.z_compare_en << 3 |
+                       state_.z_update_en << 4 | state_.antialias_en << 5 |
+                       state_.persp_tex_en << 6;
+
+        RdpPipeline pipeline;
+        pipeline.render_span = span_functions[key];
+        pipeline.batch = false;
+        // Smaller pixels share words with their neighbours, so they have to be drawn in turn
+        if (simd_ && state_.framebuffer_pixel_size >= 16 &&
+            (state_.cycle_type == CycleType::Cycle1 || state_.cycle_type == CycleType::Cycle2))
+        {
+            // Same if the first cycle reads the combined color, which is still the one of the
+            // pixel drawn before it
+            int cycle = state_.cycle_type == CycleType::Cycle2 ? 0 : 1;
+            auto combined = [](CombinerInput input) {
+                return input == CombinerInput::Combined || input == CombinerInput::CombinedAlpha;
+            };
+            pipeline.batch =
+                !combined(state_.color_sub_a[cycle]) && !combined(state_.color_sub_b[cycle]) &&
+                !combined(state_.color_multiplier[cycle]) && !combined(state_.color_adder[cycle]) &&
+                !combined(state_.alpha_sub_a[cycle]) && !combined(state_.alpha_sub_b[cycle]) &&
+                !combined(state_.alpha_multiplier[cycle]) && !combined(state_.alpha_adder[cycle]);
+        }
+        switch (tile.format)
+        {
+            case Format::RGBA:
+                pipeline.fetch_texels = tile.size == 16   ? &RDP::fetch_texels<Format::RGBA, 16>
+                                        : tile.size == 32 ? &RDP::fetch_texels<Format::RGBA, 32>
+                                                          : &RDP::fetch_unsupported_texels;
+                break;
+            case Format::IA:
+                pipeline.fetch_texels = tile.size == 4    ? &RDP::fetch_texels<Format::IA, 4>
+                                        : tile.size == 8  ? &RDP::fetch_texels<Format::IA, 8>
+                                        : tile.size == 16 ? &RDP::fetch_texels<Format::IA, 16>
+                                                          : &RDP::fetch_unsupported_texels;
+                break;
+            case Format::I:
+                pipeline.fetch_texels = tile.size == 4   ? &RDP::fetch_texels<Format::I, 4>
+                                        : tile.size == 8 ? &RDP::fetch_texels<Format::I, 8>
+                                                         : &RDP::fetch_unsupported_texels;
+                break;
+            default:
+                pipeline.fetch_texels = &RDP::fetch_unsupported_texels;
+                break;
+        }
+        // Once per pipeline instead of for every pixel on every rasterizer worker
+        if (pipeline.fetch_texels == &RDP::fetch_unsupported_texels)
+        {
+            warn_unsupported_texels(tile);
+        }
+        return pipeline;
+    }
+
+    void RDP::queue_primitive(const Primitive& primitive)
+    {
+        if (state_dirty_)
+        {
+            states_.push_back(state_);
+            state_dirty_ = false;
+        }
 
-                int32_t DzPix = primitive.DzPix;
+        if (pipelines_dirty_)
+        {
+            for (size_t i = 0; i < pipelines_.size(); i++)
+            {
+                pipelines_[i] = make_pipeline(state_.tiles[i]);
+            }
+            pipelines_dirty_ = false;
+        }
 
-                if (z_source_sel_)
-                {
-                    DzDx = 0;
-                    DzPix = primitive_depth_delta_;
-                }
+        QueuedPrimitive queued;
+        queued.pipeline = pipelines_[primitive.tile_index];
+        queued.state = states_.size() - 1;
+        queued.DrDx = primitive.DrDx;
+        queued.DgDx = primitive.DgDx;
+        queued.DbDx = primitive.DbDx;
+        queued.DaDx = primitive.DaDx;
+        queued.DsDx = primitive.DsDx;
+        queued.DtDx = primitive.DtDx;
+        queued.DwDx = primitive.DwDx;
+        queued.DzDx = primitive.DzDx;
+        queued.DzPix = primitive.DzPix;
+        queued.tile_index = primitive.tile_index;
+        queued.right_major = primitive.right_major;
+
+        uint32_t index = primitives_.size();
+        bool used = false;
+        int32_t y_start = std::max(primitive.y_start, 0);
+        int32_t y_end = std::min<int32_t>(primitive.y_end, primitive.spans.size() - 1);
+        for (int32_t y = y_start; y <= y_end; y++)
+        {
+            const Span& span = primitive.spans[y];
+            if (!span.valid)
+            {
+                continue;
+            }
+
+            auto& bin = bins_[span.y / RDP_TILE_ROWS];
+            if (bin.empty())
+            {
+                used_tiles_.push_back(span.y / RDP_TILE_ROWS);
+            }
+            bin.push_back({index, span});
+            queued_spans_++;
+            used = true;
+        }
+
+        if (used)
+        {
+            primitives_.push_back(queued);
+        }
+
+        if (queued_spans_ >= RDP_MAX_QUEUED_SPANS)
+        {
+            flush();
+        }
+    }
+
+    void RDP::flush()
+    {
+        if (queued_spans_ == 0)
+        {
+            return;
+        }
+
+        pool_->Run(used_tiles_.size(), [this](unsigned worker, size_t job) {
+            draw_tile(contexts_[worker], used_tiles_[job]);
+        });
+
+        for (uint16_t tile : used_tiles_)
+        {
+            bins_[tile].clear();
+        }
+        used_tiles_.clear();
+        primitives_.clear();
+        states_.clear();
+        queued_spans_ = 0;
+        state_dirty_ = true;
+    }
+
+    void RDP::draw_tile(RdpPixelContext& ctx, int tile)
+    {
+        ctx.Reset();
+        ctx.seed = &tile_seeds_[tile];
+        for (const BinnedSpan& binned : bins_[tile])
+        {
+            const QueuedPrimitive& primitive = primitives_[binned.primitive];
+            const RdpState& state = states_[primitive.state];
+            if (ctx.state != &state)
+            {
+                ctx.SetState(state);
+            }
+            (this->*primitive.pipeline.render_span)(ctx, primitive, binned.span);
+        }
+        ctx.state = nullptr;
+    }
+
+    template <CycleType Cycle, bool Framebuffer16, bool ZCompare, bool ZUpdate, bool Antialias,
+              bool Perspective>
+    void RDP::render_span(RdpPixelContext& ctx, const QueuedPrimitive& primitive,
+                          const Span& span)
+    {
+        const RdpState& state = *ctx.state;
+        const TileDescriptor& td = state.tiles[primitive.tile_index];
+        int32_t y = span.y;
+        int32_t x_start = 0, x_inc = 0;
+        int32_t DzDx = primitive.DzDx;
+        int32_t DrDx = primitive.DrDx;
+        int32_t DgDx = primitive.DgDx;
+        int32_t DbDx = primitive.DbDx;
+        int32_t DaDx = primitive.DaDx;
+
+        int32_t DzPix = primitive.DzPix;
+
+        if (state.z_source_sel)
+        {
+            DzDx = 0;
+            DzPix = state.primitive_depth_delta;
+        }
+
+        int32_t r = span.r;
+        int32_t g = span.g;
+        int32_t b = span.b;
+        int32_t a = span.a;
+        int32_t s = span.s;
+        int32_t t = span.t;
+        int32_t w = span.w;
+        int32_t z = state.z_source_sel ? state.primitive_depth : span.z;
+
+        if (primitive.right_major)
+        {
+            x_start = span.min_x;
+            x_inc = 1;
+        }
+        else
+        {
+            x_start = span.max_x;
+            x_inc = -1;
+        }
+
+        int32_t x = x_start;
+        int length = span.max_x - span.min_x;
 
-                int32_t r = span.r;
-                int32_t g = span.g;
-                int32_t b = span.b;
-                int32_t a = span.a;
-                int32_t s = span.s;
-                int32_t t = span.t;
-                int32_t w = span.w;
-                int32_t z = z_source_sel_ ? primitive_depth_ : span.z;
+        compute_coverage(ctx, span);
+
+        bool batch = false;
+        if constexpr (Cycle == CycleType::Cycle1 || Cycle == CycleType::Cycle2)
+        {
+            batch = primitive.pipeline.batch && ((!ZCompare && !ZUpdate) || can_batch(state, span));
+            ctx.batch.count = 0;
+        }
+
+        // The SIMD path works out the attributes of the whole span up front, the scalar one
+        // steps them pixel by pixel below
+        bool interpolated = false;
+#if RDP_SIMD_SUPPORTED
+        if (simd_)
+        {
+            interpolate_span(ctx, primitive, span, z, DzDx, x_inc, length, Perspective);
+            interpolated = true;
+        }
+#endif
+        const RdpSpanAttributes& attributes = ctx.attributes;
 
-                if (primitive.right_major)
+        for (int i = 0; i <= length; i++)
+        {
+            int32_t z_cur;
+            if (interpolated)
+            {
+                ctx[CombinerInput::Shade] = attributes.shade[i];
+                ctx[CombinerInput::ShadeAlpha] = attributes.shade_alpha[i];
+                z_cur = attributes.z[i];
+            }
+            else
+            {
+                uint8_t r8 = color_clamp(r >> 16);
+                uint8_t g8 = color_clamp(g >> 16);
+                uint8_t b8 = color_clamp(b >> 16);
+                uint8_t a8 = color_clamp(a >> 16);
+
+                ctx[CombinerInput::Shade] = (a8 << 24) | (b8 << 16) | (g8 << 8) | r8;
+                ctx[CombinerInput::ShadeAlpha] = (a8 << 24) | (a8 << 16) | (a8 << 8) | a8;
+                z_cur = z_correct((z >> 10) & 0x3f'ffff);
+            }
+
+            get_noise(ctx);
+
+            ctx.current_coverage = std::popcount(ctx.coverage_mask_buffer[x & 0x3ff] & 0xa5a5u);
+            if (depth_test<ZCompare, Framebuffer16>(ctx, x, y, z_cur, DzPix))
+            {
+                int32_t s_cur, t_cur;
+                if (interpolated)
                 {
-                    x_start = span.min_x;
-                    x_inc = 1;
+                    s_cur = attributes.s[i];
+                    t_cur = attributes.t[i];
                 }
                 else
                 {
-                    x_start = span.max_x;
-                    x_inc = -1;
+                    std::tie(s_cur, t_cur) =
+                        Perspective ? perspective_correction(s, t, w, ctx.warned.perspective)
+                                    : no_perspective_correction(s, t, w);
                 }
+                (this->*primitive.pipeline.fetch_texels)(ctx, td, s_cur, t_cur);
 
-                int32_t x = x_start;
-                int length = span.max_x - span.min_x;
+                // 0xA5A5 is the checkerboard pattern the N64 uses as it has only
+                // 3 bits to store coverage
+                bool cvbit = ctx.coverage_mask_buffer[x & 0x3ff] & 0x8000u;
+                if ((Antialias ? ctx.current_coverage : cvbit) && batch)
+                {
+                    RdpPixelBatch& pixels = ctx.batch;
+                    size_t index = pixels.count++;
+                    pixels.x[index] = x;
+                    pixels.z[index] = z_cur;
+                    pixels.coverage[index] = ctx.current_coverage;
+                    pixels.coverage_overflow[index] = ctx.coverage_overflow ? 0xFFFFFFFF : 0;
+                    pixels.shade[index] = ctx[CombinerInput::Shade];
+                    pixels.noise[index] = ctx[CombinerInput::Noise];
+                    pixels.texel[index] = ctx[CombinerInput::Texel0];
+                    pixels.texel_alpha[index] = ctx[CombinerInput::Texel0Alpha];
+                }
+                else if (Antialias ? ctx.current_coverage : cvbit)
+                {
+                    draw_pixel<Cycle, Framebuffer16>(ctx, x, y);
+                    if constexpr (ZUpdate)
+                    {
+                        z_set(state, x, y, z_cur);
+                        dz_set(state, x, y, DzPix);
+                    }
+                    coverage_set<Framebuffer16>(state, x, y, ctx.current_coverage);
+                }
+            }
 
-                compute_coverage(span);
+            if (!interpolated)
+            {
+                z += DzDx * x_inc;
+                r += DrDx * x_inc;
+                g += DgDx * x_inc;
+                b += DbDx * x_inc;
+                a += DaDx * x_inc;
+                s += primitive.DsDx * x_inc;
+                t += primitive.DtDx * x_inc;
+                w += primitive.DwDx * x_inc;
+            }
+            x += x_inc;
+        }
 
-                for (int i = 0; i <= length; i++)
-                {
-                    uint8_t r8 = color_clamp(r >> 16);
-                    uint8_t g8 = color_clamp(g >> 16);
-                    uint8_t b8 = color_clamp(b >> 16);
-                    uint8_t a8 = color_clamp(a >> 16);
+        if constexpr (Cycle == CycleType::Cycle1 || Cycle == CycleType::Cycle2)
+        {
+            if (ctx.batch.count != 0)
+            {
+                draw_batch<Framebuffer16, ZUpdate>(ctx, y, DzPix);
+            }
+        }
+    }
 
-                    shade_color_ = (a8 << 24) | (b8 << 16) | (g8 << 8) | r8;
-                    shade_alpha_ = (a8 << 24) | (a8 << 16) | (a8 << 8) | a8;
+    bool RDP::can_batch(const RdpState& state, const Span& span)
+    {
+        // The pixels of a batch are drawn after all of them were tested, which is only the
+        // same as drawing them in turn when the depth row doesn't overlap the color row
+        uint32_t pixel_bytes = state.framebuffer_pixel_size >> 3;
+        uint32_t first = span.y * state.framebuffer_width + span.min_x;
+        uint32_t last = span.y * state.framebuffer_width + span.max_x + 1;
+        uint32_t color_start = state.framebuffer_dram_address + first * pixel_bytes;
+        uint32_t color_end = state.framebuffer_dram_address + last * pixel_bytes;
+        uint32_t z_start = state.zbuffer_dram_address + first * 2;
+        uint32_t z_end = state.zbuffer_dram_address + last * 2;
+        return color_end <= z_start || z_end <= color_start;
+    }
 
-                    get_noise();
+    template <bool Framebuffer16, bool ZUpdate>
+    void RDP::draw_batch(RdpPixelContext& ctx, int y, int16_t dz)
+    {
+        const RdpState& state = *ctx.state;
+        RdpPixelBatch& pixels = ctx.batch;
+        uintptr_t row = reinterpret_cast<uintptr_t>(rdram_ptr_) + state.framebuffer_dram_address +
+                        y * state.framebuffer_width * (state.framebuffer_pixel_size >> 3);
+        for (size_t i = 0; i < pixels.count; i++)
+        {
+            uintptr_t address = row + pixels.x[i] * (state.framebuffer_pixel_size >> 3);
+            if constexpr (Framebuffer16)
+            {
+                pixels.framebuffer[i] =
+                    rgba16_to_rgba32(hydra::bswap16(*reinterpret_cast<uint16_t*>(address)));
+            }
+            else
+            {
+                pixels.framebuffer[i] = hydra::bswap32(*reinterpret_cast<uint32_t*>(address));
+            }
+        }
 
-                    int32_t z_cur = z_correct((z >> 10) & 0x3f'ffff);
-                    current_coverage_ =
-                        std::popcount(coverage_mask_buffer_[x & 0x3ff] & 0xa5a5u);
-                    if (depth_test(x, y, z_cur, DzPix))
-                    {
-                        auto [s_cur, t_cur] = perspective_correction_func_(s, t, w);
-                        fetch_texels(0, primitive.tile_index, s_cur, t_cur);
-                        fetch_texels(1, primitive.tile_index, s_cur, t_cur);
-
-                        // 0xA5A5 is the checkerboard pattern the N64 uses as it has only
-                        // 3 bits to store coverage
-                        bool cvbit = coverage_mask_buffer_[x & 0x3ff] & 0x8000u;
-                        if (antialias_en_ ? current_coverage_ : cvbit)
-                        {
-                            draw_pixel(x, y);
-                            if (z_update_en_)
-                            {
-                                z_set(x, y, z_cur);
-                                dz_set(x, y, DzPix);
-                            }
-                            coverage_set(x, y, current_coverage_);
-                        }
-                    }
+#if RDP_SIMD_SUPPORTED
+        combine_batch(ctx);
+#endif
 
-                    z += DzDx * x_inc;
-                    r += DrDx * x_inc;
-                    g += DgDx * x_inc;
-                    b += DbDx * x_inc;
-                    a += DaDx * x_inc;
-                    s += primitive.DsDx * x_inc;
-                    t += primitive.DtDx * x_inc;
-                    w += primitive.DwDx * x_inc;
-                    x += x_inc;
-                }
+        for (size_t i = 0; i < pixels.count; i++)
+        {
+            int x = pixels.x[i];
+            uintptr_t address = row + x * (state.framebuffer_pixel_size >> 3);
+            if constexpr (Framebuffer16)
+            {
+                *reinterpret_cast<uint16_t*>(address) =
+                    hydra::bswap16(rgba32_to_rgba16(pixels.color[i]));
             }
-        );
-        // clang-format on
+            else
+            {
+                *reinterpret_cast<uint32_t*>(address) = hydra::bswap32(pixels.color[i]);
+            }
+            if constexpr (ZUpdate)
+            {
+                z_set(state, x, y, pixels.z[i]);
+                dz_set(state, x, y, dz);
+            }
+            coverage_set<Framebuffer16>(state, x, y, pixels.coverage[i]);
+        }
+
+        // Left like drawing the pixels one by one leaves them, the next span can read them
+        size_t last = pixels.count - 1;
+        uint8_t alpha = pixels.combined[last] >> 24;
+        ctx[CombinerInput::Combined] = pixels.combined[last];
+        ctx[CombinerInput::CombinedAlpha] = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+        ctx.framebuffer_color = pixels.framebuffer[last];
+        pixels.count = 0;
+    }
+
+    void RdpPixelContext::Reset()
+    {
+        inputs.fill(0);
+        (*this)[CombinerInput::Texel0] = (*this)[CombinerInput::Texel1] = 0xFFFFFFFF;
+        (*this)[CombinerInput::Texel0Alpha] = (*this)[CombinerInput::Texel1Alpha] = 0xFFFFFFFF;
+        (*this)[CombinerInput::One] = 0xFFFFFFFF;
+        framebuffer_color = 0;
+        current_coverage = 0;
+        old_coverage = 0;
+        coverage_overflow = false;
+        state = nullptr;
+        warned = {};
+    }
+
+    void RdpPixelContext::SetState(const RdpState& state)
+    {
+        this->state = &state;
+        (*this)[CombinerInput::Primitive] = state.primitive_color;
+        (*this)[CombinerInput::PrimitiveAlpha] = state.primitive_alpha;
+        (*this)[CombinerInput::Environment] = state.environment_color;
+        (*this)[CombinerInput::EnvironmentAlpha] = state.environment_alpha;
     }
 } // namespace hydra::N64
\ No newline at end of file
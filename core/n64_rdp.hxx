@@ -3,9 +3,16 @@
 #include <core/n64_types.hxx>
 #include <cstring>
 #include <functional>
+#include <memory>
 #include <utility>
 #include <vector>
 
+#if defined(__x86_64__)
+#define RDP_SIMD_SUPPORTED 1
+#else
+#define RDP_SIMD_SUPPORTED 0
+#endif
+
 #define RDP_COMMANDS                      \
     X(Triangle, 0x8, 4)                   \
     X(TriangleDepth, 0x9, 6)              \
@@ -43,11 +50,10 @@
     X(SetEnvironmentColor, 0x3B, 1)       \
     X(SetFogColor, 0x38, 1)
 
-using persp_func_ptr = std::pair<int32_t, int32_t> (*)(int32_t, int32_t, int32_t);
-
 namespace hydra::N64
 {
     class RSP;
+    class GraphicsHle;
     union LoadTileCommand;
 
     enum class RDPCommandType
@@ -180,10 +186,218 @@ namespace hydra::N64
         Save = 3
     };
 
+    enum class CycleType
+    {
+        Cycle1,
+        Cycle2,
+        Copy,
+        Fill
+    };
+
+    // The values the color combiner picks its inputs from
+    enum class CombinerInput : uint8_t
+    {
+        Combined,
+        Texel0,
+        Texel1,
+        Primitive,
+        Shade,
+        Environment,
+        One,
+        Noise,
+        Zero,
+        CombinedAlpha,
+        Texel0Alpha,
+        Texel1Alpha,
+        PrimitiveAlpha,
+        ShadeAlpha,
+        EnvironmentAlpha,
+        Count
+    };
+
+    // Everything the commands set up for the primitives that follow them. Queued primitives
+    // keep a copy of the state they were sent with
+    struct RdpState
+    {
+        CycleType cycle_type = CycleType::Cycle1;
+
+        uint32_t zbuffer_dram_address = 0;
+        uint32_t framebuffer_dram_address = 0;
+        uint16_t framebuffer_width = 0;
+        uint8_t framebuffer_format = 0;
+        uint8_t framebuffer_pixel_size = 0;
+
+        uint32_t fill_color_32 = 0;
+        uint16_t fill_color_16_0 = 0, fill_color_16_1 = 0;
+        uint32_t blend_color = 0;
+        uint32_t fog_color = 0;
+        uint32_t fog_alpha = 0;
+        uint32_t primitive_color = 0;
+        uint32_t primitive_alpha = 0;
+        uint32_t environment_color = 0;
+        uint32_t environment_alpha = 0;
+
+        CombinerInput color_sub_a[2];
+        CombinerInput color_sub_b[2];
+        CombinerInput color_multiplier[2];
+        CombinerInput color_adder[2];
+
+        CombinerInput alpha_sub_a[2];
+        CombinerInput alpha_sub_b[2];
+        CombinerInput alpha_multiplier[2];
+        CombinerInput alpha_adder[2];
+
+        uint8_t blender_1a[2];
+        uint8_t blender_1b[2];
+        uint8_t blender_2a[2];
+        uint8_t blender_2b[2];
+
+        bool z_update_en = false;
+        bool z_compare_en = false;
+        bool z_source_sel = false;
+        bool image_read_en = false;
+        bool alpha_compare_en = false;
+        bool antialias_en = false;
+        bool color_on_cvg = false;
+        CoverageMode cvg_dest = CoverageMode::Clamp;
+        uint8_t z_mode = 0;
+        uint32_t primitive_depth = 0;
+        uint16_t primitive_depth_delta = 0;
+        bool persp_tex_en = false;
+
+        std::array<TileDescriptor, 8> tiles{};
+    };
+
+    class RDP;
+    struct QueuedPrimitive;
+    struct RdpPixelContext;
+
+    using SpanFunction = void (RDP::*)(RdpPixelContext& ctx, const QueuedPrimitive& primitive,
+                                       const Span& span);
+    using TexelFunction = void (RDP::*)(RdpPixelContext& ctx, const TileDescriptor& tile,
+                                        int32_t s, int32_t t);
+
+    // The span rasterizer specialised on the modes a primitive is drawn with, and the texel
+    // fetch for the format of its tile. Picked once per primitive so the pixel loop doesn't
+    // have to look at the modes
+    struct RdpPipeline
+    {
+        SpanFunction render_span;
+        TexelFunction fetch_texels;
+        // Combines and blends the pixels of a span together, see RdpPixelBatch
+        bool batch;
+    };
+
+    // A primitive waiting to be rasterized, its spans are binned into the tiles they cover
+    struct QueuedPrimitive
+    {
+        RdpPipeline pipeline;
+        uint32_t state;
+        int32_t DrDx, DgDx, DbDx, DaDx;
+        int32_t DsDx, DtDx, DwDx;
+        int32_t DzDx;
+        int16_t DzPix;
+        size_t tile_index;
+        bool right_major;
+    };
+
+    struct BinnedSpan
+    {
+        uint32_t primitive;
+        Span span;
+    };
+
+    // The pixels of a span that get drawn, gathered so the SIMD combiner and blender can work
+    // on several at once. The arrays they read are padded to whole vectors
+    struct RdpPixelBatch
+    {
+        static constexpr size_t LANES = 4;
+        static constexpr size_t SIZE = 1024 + LANES;
+
+        size_t count = 0;
+        std::array<int16_t, 1024> x;
+        std::array<int32_t, 1024> z;
+        std::array<uint8_t, 1024> coverage;
+        alignas(16) std::array<uint32_t, SIZE> shade;
+        alignas(16) std::array<uint32_t, SIZE> noise;
+        alignas(16) std::array<uint32_t, SIZE> texel;
+        alignas(16) std::array<uint32_t, SIZE> texel_alpha;
+        alignas(16) std::array<uint32_t, SIZE> framebuffer;
+        // All ones where the coverage overflowed
+        alignas(16) std::array<uint32_t, SIZE> coverage_overflow;
+        alignas(16) std::array<uint32_t, SIZE> combined;
+        alignas(16) std::array<uint32_t, SIZE> color;
+    };
+
+    // The attributes of every pixel of a span, stepped and corrected ahead of the pixel loop
+    // when the SIMD path is on. Indexed by the pixel's position in the span
+    struct RdpSpanAttributes
+    {
+        static constexpr size_t SIZE = 1024 + RdpPixelBatch::LANES;
+
+        alignas(16) std::array<uint32_t, SIZE> shade;
+        alignas(16) std::array<uint32_t, SIZE> shade_alpha;
+        alignas(16) std::array<int32_t, SIZE> z;
+        alignas(16) std::array<int32_t, SIZE> s;
+        alignas(16) std::array<int32_t, SIZE> t;
+    };
+
+    // Warnings a rasterizer worker already gave in the tile it draws, so pixels don't go through
+    // the logger one by one
+    struct RdpWarnings
+    {
+        // State the blender divided by zero with, per cycle
+        std::array<const RdpState*, 2> blender{};
+        bool perspective = false;
+        bool interpenetrating = false;
+    };
+
+    // The per pixel values of the pipeline, every rasterizer worker has its own
+    struct alignas(64) RdpPixelContext
+    {
+        const RdpState* state = nullptr;
+        std::array<uint32_t, static_cast<size_t>(CombinerInput::Count)> inputs;
+        uint32_t framebuffer_color;
+        uint32_t current_coverage;
+        uint32_t old_coverage;
+        bool coverage_overflow;
+        // Noise seed of the tile being drawn
+        uint32_t* seed;
+        std::array<uint16_t, 1024> coverage_mask_buffer;
+        RdpPixelBatch batch;
+        RdpSpanAttributes attributes;
+        RdpWarnings warned;
+
+        uint32_t& operator[](CombinerInput input)
+        {
+            return inputs[static_cast<size_t>(input)];
+        }
+
+        // Values carried over from pixel to pixel start out the same in every tile
+        void Reset();
+        void SetState(const RdpState& state);
+    };
+
+    // Spans are whole rows, so the screen is split into tiles of this many full rows
+    constexpr int RDP_TILE_ROWS = 8;
+    constexpr int RDP_TILE_COUNT = 1024 / RDP_TILE_ROWS;
+    // Rasterizer threads used by default at most, on top of the one running the RDP
+    constexpr unsigned RDP_DEFAULT_MAX_THREADS = 7;
+    // Queued spans after which the RDP draws what it has without waiting for a sync
+    constexpr size_t RDP_MAX_QUEUED_SPANS = 0x10000;
+    // CPU cycles the render thread is given per command word before the CPU raises the
+    // interrupt of a SyncFull. Only keeps the timing deterministic, the CPU waits for the
+    // thread if it's behind
+    constexpr uint64_t RDP_SYNC_CYCLES_PER_WORD = 8;
+
+    class RdpWorkerPool;
+    class RdpThread;
+
     class RDP final
     {
     public:
         RDP();
+        ~RDP();
         void InstallBuses(uint8_t* rdram_ptr, uint8_t* spmem_ptr);
 
         void SetInterruptCallback(std::function<void(bool)> callback)
@@ -195,6 +409,30 @@ namespace hydra::N64
         void WriteWord(uint32_t addr, uint32_t data);
         void Reset();
 
+        // Threads that rasterize besides the one running the RDP, the output doesn't depend
+        // on it
+        void SetThreads(unsigned threads);
+
+        // Picks between the SSE4.1 combiner and blender and the scalar ones, which are kept as
+        // the reference. The SIMD ones are used by default when the host supports them
+        void SetSimd(bool enabled);
+
+        // Draws the command lists on a thread of their own, see RdpThread
+        void SetAsync(bool enabled);
+
+        // Called with the cycles after which the CPU thread should call Sync, once a list
+        // with a SyncFull was handed to the render thread
+        void SetSyncCallback(std::function<void(uint64_t)> callback)
+        {
+            sync_callback_ = callback;
+        }
+
+        // Waits for the render thread and raises the interrupt of the SyncFulls it was sent
+        void Sync();
+
+        // Waits for the render thread if it may still be drawing to the range
+        void WaitForRange(uint32_t address, uint32_t length);
+
         // Used for QA
         void SendCommand(const std::vector<uint64_t>& command);
 
@@ -206,124 +444,120 @@ namespace hydra::N64
         uint32_t end_address_;
         uint32_t current_address_;
 
-        uint32_t zbuffer_dram_address_;
-
-        uint32_t framebuffer_dram_address_;
-        uint16_t framebuffer_width_;
-        uint8_t framebuffer_format_;
-        uint8_t framebuffer_pixel_size_;
-
-        uint32_t fill_color_32_;
-        uint16_t fill_color_16_0_, fill_color_16_1_;
-        uint32_t blend_color_;
-        uint32_t fog_color_;
-        uint32_t combined_color_;
-        uint32_t shade_color_;
-        uint32_t primitive_color_;
-        uint32_t texel_color_[2];
-        uint32_t texel_alpha_[2];
-        uint32_t environment_color_;
-        uint32_t framebuffer_color_;
-        uint32_t noise_color_;
-
-        uint32_t combined_alpha_;
-        uint32_t primitive_alpha_;
-        uint32_t shade_alpha_;
-        uint32_t environment_alpha_;
-        uint32_t fog_alpha_;
-        uint32_t current_coverage_;
-        uint32_t old_coverage_;
-
-        uint32_t* color_sub_a_[2];
-        uint32_t* color_sub_b_[2];
-        uint32_t* color_multiplier_[2];
-        uint32_t* color_adder_[2];
-
-        uint32_t* alpha_sub_a_[2];
-        uint32_t* alpha_sub_b_[2];
-        uint32_t* alpha_multiplier_[2];
-        uint32_t* alpha_adder_[2];
-
-        uint8_t blender_1a_[2];
-        uint8_t blender_1b_[2];
-        uint8_t blender_2a_[2];
-        uint8_t blender_2b_[2];
-
-        uint32_t color_zero_ = 0;
-        uint32_t color_one_ = 0xFFFF'FFFF;
+        RdpState state_;
 
         uint32_t texture_dram_address_latch_;
         uint32_t texture_width_latch_;
         uint32_t texture_pixel_size_latch_;
         Format texture_format_latch_;
 
-        std::array<TileDescriptor, 8> tiles_;
         std::array<uint8_t, 4096> tmem_;
-        std::vector<bool> rdram_9th_bit_;
+        // One byte per bit, neighbouring rows can be drawn by different threads
+        std::vector<uint8_t> rdram_9th_bit_;
         std::array<uint32_t, 0x4000> z_decompress_lut_;
         std::array<uint32_t, 0x40000> z_compress_lut_;
-        std::array<uint16_t, 1024> coverage_mask_buffer_;
         std::function<void(bool)> interrupt_callback_;
 
-        bool z_update_en_ = false;
-        bool z_compare_en_ = false;
-        bool z_source_sel_ = false;
-        bool image_read_en_ = false;
-        bool alpha_compare_en_ = false;
-        bool antialias_en_ = false;
-        bool color_on_cvg_ = false;
-        bool coverage_overflow_ = false;
-        CoverageMode cvg_dest_ = CoverageMode::Clamp;
-        uint8_t z_mode_ : 2 = 0;
-        uint32_t primitive_depth_ = 0;
-        uint16_t primitive_depth_delta_ = 0;
-
         uint16_t scissor_xh_ = 0;
         uint16_t scissor_yh_ = 0;
         uint16_t scissor_xl_ = 0;
         uint16_t scissor_yl_ = 0;
 
-        uint32_t seed_;
-        persp_func_ptr perspective_correction_func_;
-
-        enum CycleType
-        {
-            Cycle1,
-            Cycle2,
-            Copy,
-            Fill
-        } cycle_type_;
+        // Primitives are queued and binned by tile until a sync, a TMEM load or the end of
+        // the command list. Every tile is then drawn in command order by a single worker
+        std::vector<RdpState> states_;
+        std::vector<QueuedPrimitive> primitives_;
+        std::array<std::vector<BinnedSpan>, RDP_TILE_COUNT> bins_;
+        std::vector<uint16_t> used_tiles_;
+        std::array<uint32_t, RDP_TILE_COUNT> tile_seeds_;
+        size_t queued_spans_ = 0;
+        bool state_dirty_ = true;
+        std::unique_ptr<RdpWorkerPool> pool_;
+        std::vector<RdpPixelContext> contexts_;
+        // Pipelines of the current state per tile, rebuilt after the modes, the color image or
+        // a tile change
+        std::array<RdpPipeline, 8> pipelines_;
+        bool pipelines_dirty_ = true;
+        bool simd_ = false;
+
+        // Commands copied for the render thread since the last submit
+        std::vector<uint64_t> pending_commands_;
+        bool pending_sync_full_ = false;
+        bool interrupt_pending_ = false;
+        uint64_t unsynced_words_ = 0;
+        // Ranges of the images written by lists the render thread may not have drawn yet. The
+        // images are tracked as the commands are copied, the render thread has its own
+        std::vector<std::pair<uint32_t, uint32_t>> busy_ranges_;
+        uint32_t queued_color_image_ = 0;
+        uint32_t queued_color_row_ = 0;
+        uint32_t queued_z_image_ = 0;
+        uint32_t queued_z_row_ = 0;
+        uint32_t queued_rows_ = 1024;
+        bool queued_images_dirty_ = true;
+        std::function<void(uint64_t)> sync_callback_;
+        bool on_worker_ = false;
+        // Last so it stops before anything it draws with goes away
+        std::unique_ptr<RdpThread> thread_;
 
         void process_commands();
+        // Executes the command, or copies it for the render thread
+        void queue_command(const std::vector<uint64_t>& data);
+        // Hands the copied commands to the render thread, or draws what's queued
+        void submit();
+        void run_commands(const std::vector<uint64_t>& commands);
+        void track_images(const std::vector<uint64_t>& data);
+        void raise_interrupt();
+        void wait();
         void execute_command(const std::vector<uint64_t>& data);
         void draw_triangle(const std::vector<uint64_t>& data);
-        inline void draw_pixel(int x, int y);
-        void color_combiner(int cycle);
-        uint32_t blender(int cycle);
-
-        bool depth_test(int x, int y, int32_t z, int16_t dz);
-        inline uint32_t z_get(int x, int y);
-        inline uint16_t dz_get(int x, int y);
-        inline uint8_t coverage_get(int x, int y);
-        inline void z_set(int x, int y, uint32_t z);
-        inline void dz_set(int x, int y, uint16_t dz);
-        inline void coverage_set(int x, int y, uint8_t coverage);
-        void compute_coverage(const Span& span);
+        template <CycleType Cycle, bool Framebuffer16>
+        inline void draw_pixel(RdpPixelContext& ctx, int x, int y);
+        void color_combiner(RdpPixelContext& ctx, int cycle);
+        uint32_t blender(RdpPixelContext& ctx, int cycle);
+        template <bool Framebuffer16, bool ZUpdate>
+        void draw_batch(RdpPixelContext& ctx, int y, int16_t dz);
+        bool can_batch(const RdpState& state, const Span& span);
+#if RDP_SIMD_SUPPORTED
+        // Fills the color of the batch from the rest of it, like color_combiner and blender
+        void combine_batch(RdpPixelContext& ctx);
+        // Fills ctx.attributes for the length + 1 pixels of a span, starting at its first
+        // pixel in drawing order
+        void interpolate_span(RdpPixelContext& ctx, const QueuedPrimitive& primitive,
+                              const Span& span, int32_t z, int32_t DzDx, int x_inc, int length,
+                              bool perspective);
+#endif
+
+        template <bool ZCompare, bool Framebuffer16>
+        inline bool depth_test(RdpPixelContext& ctx, int x, int y, int32_t z, int16_t dz);
+        inline uint32_t z_get(const RdpState& state, int x, int y);
+        inline uint16_t dz_get(const RdpState& state, int x, int y);
+        template <bool Framebuffer16>
+        inline uint8_t coverage_get(const RdpState& state, int x, int y);
+        inline void z_set(const RdpState& state, int x, int y, uint32_t z);
+        inline void dz_set(const RdpState& state, int x, int y, uint16_t dz);
+        template <bool Framebuffer16>
+        inline void coverage_set(const RdpState& state, int x, int y, uint8_t coverage);
+        void compute_coverage(RdpPixelContext& ctx, const Span& span);
         inline uint32_t z_compress(uint32_t z);
         inline uint32_t z_decompress(uint32_t z);
         inline uint8_t dz_compress(uint16_t dz);
         inline uint16_t dz_decompress(uint8_t dz);
         void init_depth_luts();
-        void fetch_texels(int texel, int tile, int32_t s, int32_t t);
-        void get_noise();
+        // Fetches the texel of both cycles, they always come from the same tile
+        template <Format TexelFormat, int TexelSize>
+        void fetch_texels(RdpPixelContext& ctx, const TileDescriptor& td, int32_t s, int32_t t);
+        void warn_unsupported_texels(const TileDescriptor& td);
+        void fetch_unsupported_texels(RdpPixelContext& ctx, const TileDescriptor& td, int32_t s,
+                                      int32_t t);
+        void get_noise(RdpPixelContext& ctx);
         void load_tile(const LoadTileCommand& command);
 
-        uint32_t* color_get_sub_a(uint8_t sub_a);
-        uint32_t* color_get_sub_b(uint8_t sub_b);
-        uint32_t* color_get_mul(uint8_t mul);
-        uint32_t* color_get_add(uint8_t add);
-        uint32_t* alpha_get_sub_add(uint8_t sub_a);
-        uint32_t* alpha_get_mul(uint8_t mul);
+        CombinerInput color_get_sub_a(uint8_t sub_a);
+        CombinerInput color_get_sub_b(uint8_t sub_b);
+        CombinerInput color_get_mul(uint8_t mul);
+        CombinerInput color_get_add(uint8_t add);
+        CombinerInput alpha_get_sub_add(uint8_t sub_a);
+        CombinerInput alpha_get_mul(uint8_t mul);
 
         EdgewalkerInput triangle_get_edgewalker_input(const std::vector<uint64_t>& data, bool shade,
                                                       bool texture, bool depth);
@@ -332,8 +566,17 @@ namespace hydra::N64
         EdgewalkerInput rectangle_get_edgewalker_input(const std::vector<uint64_t>& data);
 
         Primitive edgewalker(const EdgewalkerInput& data);
-        void render_primitive(const Primitive& primitive);
+        void queue_primitive(const Primitive& primitive);
+        // Draws everything queued and waits for it
+        void flush();
+        void draw_tile(RdpPixelContext& ctx, int tile);
+        RdpPipeline make_pipeline(const TileDescriptor& tile);
+        template <CycleType Cycle, bool Framebuffer16, bool ZCompare, bool ZUpdate, bool Antialias,
+                  bool Perspective>
+        void render_span(RdpPixelContext& ctx, const QueuedPrimitive& primitive, const Span& span);
 
         friend class hydra::N64::RSP;
+        friend class hydra::N64::GraphicsHle;
+        friend class hydra::N64::RdpThread;
     };
 } // namespace hydra::N64
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include <core/n64_rdp_pool.hxx>
+
+namespace hydra::N64
+{
+    RdpWorkerPool::RdpWorkerPool(unsigned threads)
+    {
+        threads_.reserve(threads);
+        for (unsigned i = 0; i < threads; i++)
+        {
+            threads_.emplace_back(&RdpWorkerPool::run, this, i + 1);
+        }
+    }
+
+    RdpWorkerPool::~RdpWorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            quit_ = true;
+        }
+        start_cv_.notify_all();
+        for (auto& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    void RdpWorkerPool::Run(size_t count, const Job& job)
+    {
+        if (threads_.empty() || count <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                job(0, i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &job;
+            count_ = count;
+            next_.store(0, std::memory_order_relaxed);
+            active_ = threads_.size();
+            generation_++;
+        }
+        start_cv_.notify_all();
+
+        work(0);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this] { return active_ == 0; });
+        job_ = nullptr;
+    }
+
+    void RdpWorkerPool::run(unsigned worker)
+    {
+        uint64_t generation = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            start_cv_.wait(lock, [&] { return quit_ || generation_ != generation; });
+            if (quit_)
+            {
+                return;
+            }
+
+            generation = generation_;
+            lock.unlock();
+            work(worker);
+            lock.lock();
+
+            if (--active_ == 0)
+            {
+                done_cv_.notify_all();
+            }
+        }
+    }
+
+    void RdpWorkerPool::work(unsigned worker)
+    {
+        size_t job;
+        while ((job = next_.fetch_add(1, std::memory_order_relaxed)) < count_)
+        {
+            (*job_)(worker, job);
+        }
+    }
+} // namespace hydra::N64
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hydra::N64
+{
+    /**
+        Persistent worker threads for the RDP rasterizer
+
+        Run hands out the jobs 0 to count - 1 to the workers and the calling thread and returns
+        once all of them are done. The calling thread is always worker 0 and the threads are
+        1 and up, so every worker can own a context for the length of a run
+    */
+    class RdpWorkerPool final
+    {
+    public:
+        using Job = std::function<void(unsigned worker, size_t job)>;
+
+        explicit RdpWorkerPool(unsigned threads);
+        ~RdpWorkerPool();
+        RdpWorkerPool(const RdpWorkerPool&) = delete;
+        RdpWorkerPool& operator=(const RdpWorkerPool&) = delete;
+
+        unsigned GetWorkerCount() const
+        {
+            return threads_.size() + 1;
+        }
+
+        void Run(size_t count, const Job& job);
+
+    private:
+        void run(unsigned worker);
+        void work(unsigned worker);
+
+        std::mutex mutex_;
+        std::condition_variable start_cv_;
+        std::condition_variable done_cv_;
+        const Job* job_ = nullptr;
+        size_t count_ = 0;
+        std::atomic<size_t> next_ = 0;
+        // Threads still working on the current run
+        unsigned active_ = 0;
+        uint64_t generation_ = 0;
+        bool quit_ = false;
+        std::vector<std::thread> threads_;
+    };
+} // namespace hydra::N64
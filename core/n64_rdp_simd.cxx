@@ -0,0 +1,338 @@
+#include <core/n64_log.hxx>
+#include <core/n64_rdp.hxx>
+
+#if RDP_SIMD_SUPPORTED
+#include <smmintrin.h>
+
+// Only these functions use SSE4.1, the rest of the core keeps the baseline target and the
+// RDP checks for support at runtime before batching pixels
+#define SIMD_TARGET __attribute__((target("sse4.1")))
+
+namespace hydra::N64
+{
+    namespace
+    {
+        constexpr size_t LANES = RdpPixelBatch::LANES;
+        constexpr size_t INPUT_COUNT = static_cast<size_t>(CombinerInput::Count);
+        using Inputs = __m128i[INPUT_COUNT];
+
+        SIMD_TARGET inline __m128i load(const std::array<uint32_t, RdpPixelBatch::SIZE>& array,
+                                        size_t index)
+        {
+            return _mm_load_si128(reinterpret_cast<const __m128i*>(&array[index]));
+        }
+
+        template <typename T>
+        SIMD_TARGET inline void store(std::array<T, RdpPixelBatch::SIZE>& array, size_t index,
+                                      __m128i value)
+        {
+            _mm_store_si128(reinterpret_cast<__m128i*>(&array[index]), value);
+        }
+
+        SIMD_TARGET inline __m128i input(const Inputs& inputs, CombinerInput input)
+        {
+            return inputs[static_cast<size_t>(input)];
+        }
+
+        template <int Shift>
+        SIMD_TARGET inline __m128i channel(__m128i color)
+        {
+            return _mm_and_si128(_mm_srli_epi32(color, Shift), _mm_set1_epi32(0xFF));
+        }
+
+        // Copies the top byte into the other three
+        SIMD_TARGET inline __m128i splat_alpha(__m128i color)
+        {
+            return _mm_mullo_epi32(_mm_srli_epi32(color, 24), _mm_set1_epi32(0x01010101));
+        }
+
+        // (a - b) * c / 0xFF + d on one channel of 4 pixels like combine. The product of two
+        // bytes divided by 0xFF is the same as multiplying it by 0x8081 and shifting it right
+        // by 23, which keeps the division off the pixel loop
+        SIMD_TARGET inline __m128i combine(__m128i a, __m128i b, __m128i c, __m128i d)
+        {
+            __m128i product = _mm_mullo_epi32(_mm_sub_epi32(a, b), c);
+            __m128i quotient = _mm_srli_epi32(
+                _mm_mullo_epi32(_mm_abs_epi32(product), _mm_set1_epi32(0x8081)), 23);
+            __m128i sum = _mm_add_epi32(_mm_sign_epi32(quotient, product), d);
+            return _mm_and_si128(sum, _mm_set1_epi32(0xFF));
+        }
+
+        SIMD_TARGET void combine_colors(const RdpState& state, Inputs& inputs, int cycle)
+        {
+            __m128i sub_a = input(inputs, state.color_sub_a[cycle]);
+            __m128i sub_b = input(inputs, state.color_sub_b[cycle]);
+            __m128i multiplier = input(inputs, state.color_multiplier[cycle]);
+            __m128i adder = input(inputs, state.color_adder[cycle]);
+            __m128i r = combine(channel<0>(sub_a), channel<0>(sub_b), channel<0>(multiplier),
+                                channel<0>(adder));
+            __m128i g = combine(channel<8>(sub_a), channel<8>(sub_b), channel<8>(multiplier),
+                                channel<8>(adder));
+            __m128i b = combine(channel<16>(sub_a), channel<16>(sub_b), channel<16>(multiplier),
+                                channel<16>(adder));
+            __m128i a = combine(channel<0>(input(inputs, state.alpha_sub_a[cycle])),
+                                channel<0>(input(inputs, state.alpha_sub_b[cycle])),
+                                channel<0>(input(inputs, state.alpha_multiplier[cycle])),
+                                channel<0>(input(inputs, state.alpha_adder[cycle])));
+            __m128i combined = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                                            _mm_or_si128(_mm_slli_epi32(b, 16),
+                                                         _mm_slli_epi32(a, 24)));
+            inputs[static_cast<size_t>(CombinerInput::Combined)] = combined;
+            inputs[static_cast<size_t>(CombinerInput::CombinedAlpha)] =
+                _mm_mullo_epi32(a, _mm_set1_epi32(0x01010101));
+        }
+
+        SIMD_TARGET __m128i blender_color(const RdpState& state, const Inputs& inputs,
+                                          __m128i framebuffer, uint8_t select)
+        {
+            switch (select & 0b11)
+            {
+                case 0:
+                    return input(inputs, CombinerInput::Combined);
+                case 1:
+                    return framebuffer;
+                case 2:
+                    return _mm_set1_epi32(state.blend_color);
+                default:
+                    return _mm_set1_epi32(state.fog_color);
+            }
+        }
+
+        // (color1 * multiplier1 + color2 * multiplier2) / (multiplier1 + multiplier2) on one
+        // channel. Both products fit in a float and the quotient is at most 0xFF, so the
+        // rounding of the float division never crosses a whole number
+        template <int Shift>
+        SIMD_TARGET inline __m128i blend(__m128i color1, __m128i color2, __m128i multiplier1,
+                                         __m128i multiplier2, __m128 divisor, __m128i mask)
+        {
+            __m128i second = channel<Shift>(color2);
+            __m128i sum = _mm_add_epi32(_mm_mullo_epi32(channel<Shift>(color1), multiplier1),
+                                        _mm_mullo_epi32(second, multiplier2));
+            __m128i quotient = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(sum), divisor));
+            return _mm_slli_epi32(_mm_blendv_epi8(second, quotient, mask), Shift);
+        }
+
+        // RDP::blender on 4 pixels, Output false only checks the multipliers
+        template <bool Output>
+        SIMD_TARGET __m128i blend_colors(const RdpState& state, const Inputs& inputs, int cycle,
+                                         __m128i framebuffer, __m128i coverage_overflow,
+                                         __m128i valid, RdpWarnings& warned)
+        {
+            __m128i multiplier1, multiplier2;
+            switch (state.blender_1b[cycle] & 0b11)
+            {
+                case 0:
+                    multiplier1 = _mm_srli_epi32(input(inputs, CombinerInput::CombinedAlpha), 24);
+                    break;
+                case 1:
+                    multiplier1 = _mm_set1_epi32(state.fog_alpha >> 24);
+                    break;
+                case 2:
+                    multiplier1 = _mm_srli_epi32(input(inputs, CombinerInput::ShadeAlpha), 24);
+                    break;
+                default:
+                    multiplier1 = _mm_setzero_si128();
+                    break;
+            }
+
+            switch (state.blender_2b[cycle] & 0b11)
+            {
+                case 0:
+                    multiplier2 = _mm_xor_si128(multiplier1, _mm_set1_epi32(0xFF));
+                    break;
+                case 2:
+                    multiplier2 = _mm_set1_epi32(0xFF);
+                    break;
+                default:
+                    multiplier2 = _mm_setzero_si128();
+                    break;
+            }
+
+            __m128i divisor = _mm_add_epi32(multiplier1, multiplier2);
+            __m128i zero_multipliers = _mm_cmpeq_epi32(divisor, _mm_setzero_si128());
+            if (warned.blender[cycle] != &state && !_mm_testz_si128(zero_multipliers, valid))
+            {
+                warned.blender[cycle] = &state;
+                Logger::WarnOnce("Blender division by zero - blender settings: {} {} {} {}",
+                                 state.blender_1a[cycle], state.blender_2a[cycle],
+                                 state.blender_1b[cycle], state.blender_2b[cycle]);
+            }
+
+            if constexpr (!Output)
+            {
+                return _mm_setzero_si128();
+            }
+
+            __m128i color1 = blender_color(state, inputs, framebuffer, state.blender_1a[cycle]);
+            __m128i color2 = blender_color(state, inputs, framebuffer, state.blender_2a[cycle]);
+            __m128i mask = state.color_on_cvg ? coverage_overflow : _mm_set1_epi32(-1);
+            mask = _mm_andnot_si128(zero_multipliers, mask);
+            __m128 divisor_ps = _mm_cvtepi32_ps(divisor);
+            __m128i r = blend<0>(color1, color2, multiplier1, multiplier2, divisor_ps, mask);
+            __m128i g = blend<8>(color1, color2, multiplier1, multiplier2, divisor_ps, mask);
+            __m128i b = blend<16>(color1, color2, multiplier1, multiplier2, divisor_ps, mask);
+            return _mm_or_si128(_mm_or_si128(r, g), b);
+        }
+
+        // An attribute of 4 neighbouring pixels and how much it moves to the next 4
+        struct Ramp
+        {
+            __m128i value;
+            __m128i step;
+        };
+
+        SIMD_TARGET inline Ramp ramp(int32_t start, int32_t delta, int x_inc)
+        {
+            __m128i pixel_step = _mm_mullo_epi32(_mm_set1_epi32(delta), _mm_set1_epi32(x_inc));
+            __m128i value = _mm_add_epi32(
+                _mm_set1_epi32(start), _mm_mullo_epi32(pixel_step, _mm_setr_epi32(0, 1, 2, 3)));
+            return {value, _mm_slli_epi32(pixel_step, 2)};
+        }
+
+        SIMD_TARGET inline void advance(Ramp& ramp)
+        {
+            ramp.value = _mm_add_epi32(ramp.value, ramp.step);
+        }
+
+        // color_clamp and z_correct on 4 pixels, the two bits above the value pick between
+        // it, the maximum when it went over and 0 when it went under
+        template <int Shift>
+        SIMD_TARGET inline __m128i clamp(__m128i value, int32_t max)
+        {
+            __m128i select = _mm_and_si128(_mm_srli_epi32(value, Shift), _mm_set1_epi32(3));
+            __m128i over = _mm_cmpeq_epi32(select, _mm_set1_epi32(2));
+            __m128i under = _mm_cmpeq_epi32(select, _mm_set1_epi32(3));
+            __m128i clamped = _mm_or_si128(_mm_and_si128(value, _mm_set1_epi32(max)),
+                                           _mm_and_si128(over, _mm_set1_epi32(max)));
+            return _mm_andnot_si128(under, clamped);
+        }
+
+        // Integer division of 4 pixels. A double is precise enough that truncating the
+        // quotient of two 32 bit integers gives the same result as dividing them
+        SIMD_TARGET inline __m128i divide(__m128i dividend, __m128i divisor)
+        {
+            __m128i low = _mm_cvttpd_epi32(
+                _mm_div_pd(_mm_cvtepi32_pd(dividend), _mm_cvtepi32_pd(divisor)));
+            __m128i high = _mm_cvttpd_epi32(
+                _mm_div_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(dividend, dividend)),
+                           _mm_cvtepi32_pd(_mm_unpackhi_epi64(divisor, divisor))));
+            return _mm_unpacklo_epi64(low, high);
+        }
+    } // namespace
+
+    SIMD_TARGET void RDP::interpolate_span(RdpPixelContext& ctx, const QueuedPrimitive& primitive,
+                                           const Span& span, int32_t z, int32_t DzDx, int x_inc,
+                                           int length, bool perspective)
+    {
+        RdpSpanAttributes& attributes = ctx.attributes;
+        Ramp r = ramp(span.r, primitive.DrDx, x_inc);
+        Ramp g = ramp(span.g, primitive.DgDx, x_inc);
+        Ramp b = ramp(span.b, primitive.DbDx, x_inc);
+        Ramp a = ramp(span.a, primitive.DaDx, x_inc);
+        Ramp s = ramp(span.s, primitive.DsDx, x_inc);
+        Ramp t = ramp(span.t, primitive.DtDx, x_inc);
+        Ramp w = ramp(span.w, primitive.DwDx, x_inc);
+        Ramp depth = ramp(z, DzDx, x_inc);
+
+        const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+        __m128i zero_divisors = _mm_setzero_si128();
+        for (int i = 0; i <= length; i += LANES)
+        {
+            __m128i r8 = clamp<7>(_mm_srai_epi32(r.value, 16), 0xFF);
+            __m128i g8 = clamp<7>(_mm_srai_epi32(g.value, 16), 0xFF);
+            __m128i b8 = clamp<7>(_mm_srai_epi32(b.value, 16), 0xFF);
+            __m128i a8 = clamp<7>(_mm_srai_epi32(a.value, 16), 0xFF);
+            __m128i shade = _mm_or_si128(_mm_or_si128(r8, _mm_slli_epi32(g8, 8)),
+                                         _mm_or_si128(_mm_slli_epi32(b8, 16),
+                                                      _mm_slli_epi32(a8, 24)));
+            store(attributes.shade, i, shade);
+            store(attributes.shade_alpha, i, _mm_mullo_epi32(a8, _mm_set1_epi32(0x01010101)));
+
+            __m128i z_cur = _mm_and_si128(_mm_srli_epi32(depth.value, 13), _mm_set1_epi32(0x7FFFF));
+            store(attributes.z, i, clamp<17>(z_cur, 0x3FFFF));
+
+            if (perspective)
+            {
+                __m128i divisor = _mm_srai_epi32(w.value, 15);
+                __m128i zero = _mm_cmpeq_epi32(divisor, _mm_setzero_si128());
+                __m128i valid = _mm_cmpgt_epi32(_mm_set1_epi32(length + 1 - i), lanes);
+                zero_divisors = _mm_or_si128(zero_divisors, _mm_and_si128(zero, valid));
+                store(attributes.s, i,
+                      _mm_andnot_si128(zero, _mm_srai_epi32(divide(s.value, divisor), 5)));
+                store(attributes.t, i,
+                      _mm_andnot_si128(zero, _mm_srai_epi32(divide(t.value, divisor), 5)));
+            }
+            else
+            {
+                store(attributes.s, i, _mm_srai_epi32(s.value, 16));
+                store(attributes.t, i, _mm_srai_epi32(t.value, 16));
+            }
+
+            advance(r);
+            advance(g);
+            advance(b);
+            advance(a);
+            advance(s);
+            advance(t);
+            advance(w);
+            advance(depth);
+        }
+
+        if (!ctx.warned.perspective && !_mm_testz_si128(zero_divisors, zero_divisors))
+        {
+            ctx.warned.perspective = true;
+            Logger::WarnOnce("Division by zero in perspective correction");
+        }
+    }
+
+    SIMD_TARGET void RDP::combine_batch(RdpPixelContext& ctx)
+    {
+        const RdpState& state = *ctx.state;
+        RdpPixelBatch& pixels = ctx.batch;
+
+        Inputs inputs;
+        for (size_t i = 0; i < INPUT_COUNT; i++)
+        {
+            inputs[i] = _mm_set1_epi32(ctx.inputs[i]);
+        }
+
+        const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+        for (size_t i = 0; i < pixels.count; i += LANES)
+        {
+            __m128i valid = _mm_cmpgt_epi32(_mm_set1_epi32(pixels.count - i), lanes);
+            __m128i texel = load(pixels.texel, i);
+            __m128i texel_alpha = load(pixels.texel_alpha, i);
+            __m128i shade = load(pixels.shade, i);
+            inputs[static_cast<size_t>(CombinerInput::Texel0)] = texel;
+            inputs[static_cast<size_t>(CombinerInput::Texel1)] = texel;
+            inputs[static_cast<size_t>(CombinerInput::Texel0Alpha)] = texel_alpha;
+            inputs[static_cast<size_t>(CombinerInput::Texel1Alpha)] = texel_alpha;
+            inputs[static_cast<size_t>(CombinerInput::Shade)] = shade;
+            inputs[static_cast<size_t>(CombinerInput::ShadeAlpha)] = splat_alpha(shade);
+            inputs[static_cast<size_t>(CombinerInput::Noise)] = load(pixels.noise, i);
+
+            __m128i framebuffer = load(pixels.framebuffer, i);
+            __m128i coverage_overflow = load(pixels.coverage_overflow, i);
+            __m128i color;
+            if (state.cycle_type == CycleType::Cycle2)
+            {
+                combine_colors(state, inputs, 0);
+                combine_colors(state, inputs, 1);
+                blend_colors<false>(state, inputs, 0, framebuffer, coverage_overflow, valid,
+                                    ctx.warned);
+                color = blend_colors<true>(state, inputs, 1, framebuffer, coverage_overflow,
+                                           valid, ctx.warned);
+            }
+            else
+            {
+                combine_colors(state, inputs, 1);
+                color = blend_colors<true>(state, inputs, 0, framebuffer, coverage_overflow,
+                                           valid, ctx.warned);
+            }
+
+            store(pixels.combined, i, input(inputs, CombinerInput::Combined));
+            store(pixels.color, i, color);
+        }
+    }
+} // namespace hydra::N64
+#endif
@@ -0,0 +1,57 @@
+#include <core/n64_rdp.hxx>
+#include <core/n64_rdp_thread.hxx>
+
+namespace hydra::N64
+{
+    RdpThread::RdpThread(RDP& rdp) : rdp_(rdp), thread_(&RdpThread::run, this) {}
+
+    RdpThread::~RdpThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            quit_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    void RdpThread::Submit(std::vector<uint64_t>&& commands)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            lists_.push_back(std::move(commands));
+        }
+        cv_.notify_all();
+    }
+
+    void RdpThread::Wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return lists_.empty() && !busy_; });
+    }
+
+    void RdpThread::run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            cv_.wait(lock, [this] { return quit_ || !lists_.empty(); });
+            if (quit_)
+            {
+                return;
+            }
+
+            std::vector<uint64_t> commands = std::move(lists_.front());
+            lists_.pop_front();
+            busy_ = true;
+            lock.unlock();
+            rdp_.on_worker_ = true;
+            rdp_.run_commands(commands);
+            rdp_.on_worker_ = false;
+            lock.lock();
+
+            busy_ = false;
+            cv_.notify_all();
+        }
+    }
+} // namespace hydra::N64
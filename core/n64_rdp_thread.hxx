@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hydra::N64
+{
+    class RDP;
+
+    /**
+        Draws the RDP's command lists on a host thread of its own
+
+        The CPU thread copies every command list when DP_END is written and hands it over, the
+        worker draws the lists in the order they came in. The CPU thread only waits for it
+        where the result can be observed (see RDP::Sync). The interrupt of a SyncFull is left
+        to the CPU thread too
+    */
+    class RdpThread final
+    {
+    public:
+        explicit RdpThread(RDP& rdp);
+        ~RdpThread();
+        RdpThread(const RdpThread&) = delete;
+        RdpThread& operator=(const RdpThread&) = delete;
+
+        void Submit(std::vector<uint64_t>&& commands);
+
+        // Waits until every submitted list has been drawn
+        void Wait();
+
+    private:
+        void run();
+
+        RDP& rdp_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<std::vector<uint64_t>> lists_;
+        bool busy_ = false;
+        bool quit_ = false;
+        std::thread thread_;
+    };
+} // namespace hydra::N64
@@ -1,10 +1,13 @@
 #include <algorithm>
+#include <cfenv>
 #include <compatibility.hxx>
 #include <core/n64_log.hxx>
 #include <core/n64_addresses.hxx>
+#include <core/n64_cpu.hxx>
 #include <core/n64_rdp.hxx>
 #include <core/n64_rsp.hxx>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -205,6 +208,32 @@ namespace hydra::N64
     {
         status_.halt = true;
         mem_.fill(0);
+#if RSP_SIMD_SUPPORTED
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            vu_table_ = &vu_simd_instruction_table_;
+            simd_load_store_ = true;
+        }
+#endif
+    }
+
+    void RSP::SetSimdVectorUnit(bool enabled)
+    {
+        vu_table_ = &vu_instruction_table_;
+        simd_load_store_ = false;
+        if (!enabled)
+        {
+            return;
+        }
+#if RSP_SIMD_SUPPORTED
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            vu_table_ = &vu_simd_instruction_table_;
+            simd_load_store_ = true;
+            return;
+        }
+#endif
+        Logger::Warn("The SIMD vector unit needs SSE4.1, using the scalar one");
     }
 
     void RSP::Reset()
@@ -212,9 +241,12 @@ namespace hydra::N64
         status_.full = 0;
         status_.halt = true;
         mem_.fill(0);
+        imem_dirty_ = true;
         std::for_each(gpr_regs_.begin(), gpr_regs_.end(), [](auto& reg) { reg.UW = 0; });
         std::for_each(vu_regs_.begin(), vu_regs_.end(), [](auto& reg) { reg.fill(0); });
-        std::for_each(accumulator_.begin(), accumulator_.end(), [](auto& reg) { reg.Set(0); });
+        accumulator_.Clear();
+        audio_hle_.Reset();
+        graphics_hle_.Reset();
         vco_.Clear();
         vce_.Clear();
         vcc_.Clear();
@@ -224,13 +256,20 @@ namespace hydra::N64
         instruction_.full = 0;
         mem_addr_ = 0;
         pending_mem_addr_ = 0;
-        dma_imem_ = false;
         rdram_addr_ = 0;
         pending_rdram_addr_ = 0;
         dma_len_ = 0;
+        dma_pending_ = {};
+        dma_done_clock_ = 0;
+        clock_ = 0;
+        vector_retired_ = 0;
         pc_ = 0;
         next_pc_ = 4;
         semaphore_ = false;
+        yield_ = false;
+        deferred_interrupt_.reset();
+        deferred_rdp_writes_.clear();
+        deferred_rdram_writes_.clear();
     }
 
     void RSP::Tick()
@@ -246,6 +285,184 @@ namespace hydra::N64
         execute_instruction();
     }
 
+    uint64_t RSP::RunFor(uint64_t cycles)
+    {
+        yield_ = false;
+        if (status_.halt)
+        {
+            return wait_dma(cycles);
+        }
+
+        uint64_t executed = 0;
+        uint64_t vector_retired = vector_retired_;
+        profiler_.EnterRun();
+        running_ = true;
+        if (use_block_cache_ || use_jit_)
+        {
+            executed = run_cached(cycles);
+        }
+        else if (profiler_.IsRunning())
+        {
+            while (executed < cycles && !status_.halt && !yield_)
+            {
+                Tick();
+                vector_retired_ += rsp_is_vector(instruction_);
+                executed++;
+                clock_++;
+            }
+        }
+        else
+        {
+            while (executed < cycles && !status_.halt && !yield_)
+            {
+                Tick();
+                executed++;
+                clock_++;
+            }
+        }
+        running_ = false;
+        update_dma();
+
+        if (profiler_.IsRunning())
+        {
+            profiler_.Retire(executed, vector_retired_ - vector_retired);
+            profiler_.LeaveRun();
+            if (status_.halt)
+            {
+                profiler_.EndTask(clock_);
+            }
+        }
+        return executed;
+    }
+
+    uint64_t RSP::run_cached(uint64_t cycles)
+    {
+        uint64_t executed = 0;
+        // SP_PC writes leave next_pc_ unmasked, inside blocks it always is
+        next_pc_ &= 0xFFF;
+        bool use_jit = use_jit_ && jit_buffer_.IsAvailable();
+        bool profiling = profiler_.IsRunning();
+        while (executed < cycles && !status_.halt && !yield_)
+        {
+            if (use_jit && !jit_buffer_.HasSpace(JIT_MAX_BLOCK_SIZE)) [[unlikely]]
+            {
+                // Blocks point into the buffer, so both are thrown away together
+                block_cache_.Clear();
+                jit_buffer_.Reset();
+                imem_dirty_ = true;
+            }
+
+            if (imem_dirty_) [[unlikely]]
+            {
+                block_cache_.Select(&mem_[0x1000]);
+                imem_dirty_ = false;
+            }
+
+            // Blocks assume they run sequentially, a delay slot left over from the last
+            // slice is stepped on its own
+            if (next_pc_ != ((pc_ + 4) & 0xFFF)) [[unlikely]]
+            {
+                Tick();
+                if (profiling)
+                {
+                    vector_retired_ += rsp_is_vector(instruction_);
+                }
+                executed++;
+                clock_++;
+                continue;
+            }
+
+            RspBlock* block = block_cache_.Lookup(pc_);
+            if (!block) [[unlikely]]
+            {
+                block = &compile_block(pc_);
+            }
+
+            if (use_jit)
+            {
+                if (!block->jit_compiled)
+                {
+                    compile_jit_block(*block, pc_);
+                }
+
+                // Generated code always runs the whole block, the rest of the budget is
+                // interpreted
+                if (block->jit_code && block->instructions.size() <= cycles - executed)
+                {
+                    block->jit_code(this);
+                    executed += block->instructions.size();
+                    clock_ += block->instructions.size();
+                    vector_retired_ += block->vector_instructions;
+                    continue;
+                }
+            }
+
+            size_t count = std::min<uint64_t>(block->instructions.size(), cycles - executed);
+            for (size_t i = 0; i < count; i++)
+            {
+                const RspDecodedInstruction& decoded = block->instructions[i];
+                gpr_regs_[0].UW = 0;
+                instruction_.full = decoded.instruction;
+                pc_ = next_pc_;
+                next_pc_ = (pc_ + 4) & 0xFFF;
+                decoded.handler(this);
+            }
+
+            if (count == block->instructions.size())
+            {
+                vector_retired_ += block->vector_instructions;
+            }
+            else if (profiling)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    Instruction instruction;
+                    instruction.full = block->instructions[i].instruction;
+                    vector_retired_ += rsp_is_vector(instruction);
+                }
+            }
+            executed += count;
+            clock_ += count;
+        }
+        return executed;
+    }
+
+    RspBlock& RSP::compile_block(uint32_t pc)
+    {
+        RspBlock& block = block_cache_.Allocate(pc);
+        bool delay_slot = false;
+        for (uint32_t address = pc; address < RSP_IMEM_SIZE; address += 4)
+        {
+            Instruction instruction;
+            instruction.full = hydra::bswap32(
+                *reinterpret_cast<uint32_t*>(&mem_[0x1000 + address]));
+
+            func_ptr handler;
+            switch (instruction.IType.op)
+            {
+                case 0:
+                    handler = special_table_[instruction.RType.func];
+                    break;
+                case 1:
+                    handler = regimm_table_[instruction.RType.rt];
+                    break;
+                default:
+                    handler = instruction_table_[instruction.IType.op];
+                    break;
+            }
+            block.instructions.push_back({instruction.full, handler});
+            block.vector_instructions += rsp_is_vector(instruction);
+
+            if (delay_slot || rsp_ends_block(instruction) ||
+                block.instructions.size() == RSP_BLOCK_MAX_INSTRUCTIONS)
+            {
+                break;
+            }
+            delay_slot = rsp_is_branch(instruction);
+        }
+        return block;
+    }
+
     void RSP::execute_instruction()
     {
         (instruction_table_[instruction_.IType.op])(this);
@@ -315,63 +532,132 @@ namespace hydra::N64
         gpr_regs_[reg].UW = pc_ + 4;
     }
 
-    inline void dma(uint8_t*& dest, uint8_t*& source, uint32_t& dma_len, bool dma_imem, bool rdram_to_mem)
+    void RSP::queue_dma(uint32_t length, bool to_rsp)
+    {
+        update_dma();
+        RspDmaRequest request = {pending_mem_addr_, pending_rdram_addr_, length, to_rsp};
+        if (!status_.dma_busy)
+        {
+            start_dma(request, clock_);
+        }
+        else if (!status_.dma_full)
+        {
+            dma_pending_ = request;
+            status_.dma_full = true;
+        }
+        else
+        {
+            Logger::Warn("RSP DMA requested while the queue is full");
+        }
+    }
+
+    void RSP::start_dma(const RspDmaRequest& request, uint64_t start)
     {
-        uint32_t bytes_per_row = dma_len & 0xFFF;
-        uint32_t row_count = (dma_len >> 12) & 0xFF;
-        uint32_t row_stride = (dma_len >> 20) & 0xFF8;
+        // Rows are copied in whole 8 byte words
+        uint32_t row_length = (request.length & 0xFF8) + 8;
+        uint32_t rows = ((request.length >> 12) & 0xFF) + 1;
+        uint32_t skip = (request.length >> 20) & 0xFF8;
+        uint32_t bank = request.mem_addr & 0x1000;
+        uint32_t mem_addr = request.mem_addr & 0xFF8;
+        uint32_t rdram_start = request.rdram_addr & 0xFFFFF8;
+        uint32_t rdram_addr = rdram_start;
 
-        do {
-            for (uint32_t j = 0; j <= bytes_per_row; j+=8)
+        if (skip == 0)
+        {
+            // Both sides are contiguous, one copy does it
+            copy_dma(bank | mem_addr, rdram_addr, row_length * rows, request.to_rsp);
+            mem_addr = (mem_addr + row_length * rows) & 0xFFF;
+            rdram_addr += row_length * rows;
+        }
+        else
+        {
+            for (uint32_t row = 0; row < rows; row++)
             {
-                memcpy(dest, source, 8);
-                dest += 8;
-                source += 8;
+                copy_dma(bank | mem_addr, rdram_addr, row_length, request.to_rsp);
+                mem_addr = (mem_addr + row_length) & 0xFFF;
+                rdram_addr += row_length + (row + 1 < rows ? skip : 0);
             }
+        }
 
-            if (row_count == 0) {
-                break;
-            }
-            row_count--;
-            if (rdram_to_mem) {
-                source += row_stride;
-            } else {
-                dest += row_stride;
-            }
-        } while (1);
+        if (request.to_rsp)
+        {
+            imem_dirty_ |= bank != 0;
+        }
+        else if (rdram_start < RDRAM_SIZE)
+        {
+            uint32_t rdram_end = std::min<uint32_t>(rdram_addr, RDRAM_SIZE);
+            notify_rdram_write(rdram_start, rdram_end - rdram_start);
+        }
 
+        mem_addr_ = bank | mem_addr;
+        rdram_addr_ = rdram_addr;
         // After the DMA transfer is finished, this field contains the value 0xFF8
         // The reason is that the field is internally decremented by 8 for each transferred word
         // so the final value will be -8 (in hex, 0xFF8)
-        dma_len = (row_stride << 20) | 0xFF8;
+        dma_len_ = (skip << 20) | 0xFF8;
+        status_.dma_busy = true;
+        dma_done_clock_ = start + rows * (RSP_DMA_ROW_CYCLES + row_length / 8);
+        profiler_.Dma(row_length * rows, request.to_rsp);
     }
 
-    void RSP::read_dma()
+    void RSP::copy_dma(uint32_t mem_addr, uint32_t rdram_addr, uint32_t length, bool to_rsp)
     {
-        rdram_addr_ = pending_rdram_addr_;
-        mem_addr_ = pending_mem_addr_;
-        uint8_t* dest = dma_imem_ ? &mem_[0x1000] : &mem_[0];
-        uint8_t* source = rdram_ptr_;
-        dest = &dest[mem_addr_ & 0xFF8];
-        source = &source[rdram_addr_ & 0xFFFFF8];
-        dma(dest, source, dma_len_, dma_imem_, true);
-        mem_addr_ = (uint64_t)(dest - &mem_[0]);
-        mem_addr_ |= dma_imem_ ? 0x1000 : 0;
-        rdram_addr_ = (uint64_t)(source - rdram_ptr_);
+        // DMEM and IMEM wrap around on their own
+        uint8_t* bank = &mem_[mem_addr & 0x1000];
+        mem_addr &= 0xFFF;
+        while (length != 0)
+        {
+            uint32_t chunk = std::min(length, 0x1000 - mem_addr);
+            // Past the end of RDRAM reads come back as zero and writes are dropped
+            uint32_t valid = rdram_addr < RDRAM_SIZE
+                                 ? std::min<uint32_t>(chunk, RDRAM_SIZE - rdram_addr)
+                                 : 0;
+            if (to_rsp)
+            {
+                if (valid != 0)
+                {
+                    std::memcpy(&bank[mem_addr], &rdram_ptr_[rdram_addr], valid);
+                }
+                std::memset(&bank[mem_addr + valid], 0, chunk - valid);
+            }
+            else if (valid != 0)
+            {
+                std::memcpy(&rdram_ptr_[rdram_addr], &bank[mem_addr], valid);
+            }
+            mem_addr = (mem_addr + chunk) & 0xFFF;
+            rdram_addr += chunk;
+            length -= chunk;
+        }
     }
 
-    void RSP::write_dma()
+    // Retires the DMA in flight once the clock reaches its end, the queued one starts right
+    // after it
+    void RSP::update_dma()
     {
-        rdram_addr_ = pending_rdram_addr_;
-        mem_addr_ = pending_mem_addr_;
-        uint8_t* dest = rdram_ptr_;
-        uint8_t* source = dma_imem_ ? &mem_[0x1000] : &mem_[0];
-        dest = &dest[rdram_addr_ & 0xFFFFF8];
-        source = &source[mem_addr_ & 0xFF8];
-        dma(dest, source, dma_len_, dma_imem_, false);
-        mem_addr_ = (uint64_t)(source - &mem_[0]);
-        mem_addr_ |= dma_imem_ ? 0x1000 : 0;
-        rdram_addr_ = (uint64_t)(dest - rdram_ptr_);
+        while (status_.dma_busy && clock_ >= dma_done_clock_)
+        {
+            status_.dma_busy = false;
+            if (status_.dma_full)
+            {
+                status_.dma_full = false;
+                start_dma(dma_pending_, dma_done_clock_);
+            }
+        }
+    }
+
+    uint64_t RSP::wait_dma(uint64_t cycles)
+    {
+        uint64_t waited = 0;
+        update_dma();
+        while (status_.dma_busy && waited < cycles)
+        {
+            // update_dma leaves the clock short of the end of the DMA in flight
+            uint64_t step = std::min(cycles - waited, dma_done_clock_ - clock_);
+            clock_ += step;
+            waited += step;
+            update_dma();
+        }
+        return waited;
     }
 
     void RSP::dump_mem()
@@ -391,8 +677,7 @@ namespace hydra::N64
         {
             case RSPHWIO::Cache:
             {
-                pending_mem_addr_ = data & 0b1111'1111'1111;
-                dma_imem_ = data & 0b1'0000'0000'0000;
+                pending_mem_addr_ = data & 0b1'1111'1111'1111;
                 break;
             }
             case RSPHWIO::DramAddr:
@@ -402,24 +687,18 @@ namespace hydra::N64
             }
             case RSPHWIO::RdLen:
             {
-                dma_len_ = data;
-                read_dma();
+                queue_dma(data, true);
                 break;
             }
             case RSPHWIO::WrLen:
             {
-                dma_len_ = data;
-                write_dma();
+                queue_dma(data, false);
                 break;
             }
             case RSPHWIO::Full:
-            {
-                status_.dma_full = data;
-                break;
-            }
             case RSPHWIO::Busy:
             {
-                status_.dma_busy = data;
+                // Read only, they follow the DMA queue
                 break;
             }
             case RSPHWIO::Semaphore:
@@ -433,12 +712,12 @@ namespace hydra::N64
                 sp_write.full = data;
                 if (sp_write.clear_intr && !sp_write.set_intr)
                 {
-                    interrupt_callback_(false);
+                    set_interrupt(false);
                 }
                 else if (!sp_write.clear_intr && sp_write.set_intr)
                 {
                     Logger::Debug("Raising SP interrupt");
-                    interrupt_callback_(true);
+                    set_interrupt(true);
                 }
                 if (sp_write.clear_broke)
                 {
@@ -461,25 +740,57 @@ namespace hydra::N64
                 flag(signal_5);
                 flag(signal_6);
                 flag(signal_7);
+                bool was_halted = status_.halt;
                 flag(halt);
                 flag(intr_break);
                 flag(sstep);
 #undef flag
+                if (was_halted && !status_.halt)
+                {
+                    profiler_.StartTask(&mem_[0], &mem_[0x1000], rdram_ptr_, pc_, clock_);
+                    profiler_.EnterRun();
+                    // Started from a CPU store, so the host may be set to the guest's FPU
+                    // rounding mode. The float math of graphics HLE expects round to nearest
+                    int rounding = std::fegetround();
+                    if (rounding != FE_TONEAREST)
+                    {
+                        std::fesetround(FE_TONEAREST);
+                    }
+                    bool hle = run_hle_task();
+                    if (rounding != FE_TONEAREST)
+                    {
+                        std::fesetround(rounding);
+                    }
+                    profiler_.LeaveRun();
+                    if (hle)
+                    {
+                        // Finish the task like the ucode would, signal 2 is the task done flag
+                        status_.signal_2 = true;
+                        s_BREAK();
+                        profiler_.MarkHle();
+                        profiler_.EndTask(clock_);
+                    }
+                }
+                else if (!was_halted && status_.halt && !running_)
+                {
+                    // Halted by the CPU, RunFor ends the task when the RSP halts itself
+                    profiler_.EndTask(clock_);
+                }
                 break;
             }
             case RSPHWIO::CmdStart:
             {
-                rdp_ptr_->WriteWord(DP_START, data);
+                write_rdp(DP_START, data);
                 break;
             }
             case RSPHWIO::CmdEnd:
             {
-                rdp_ptr_->WriteWord(DP_END, data);
+                write_rdp(DP_END, data);
                 break;
             }
             case RSPHWIO::CmdStatus:
             {
-                rdp_ptr_->WriteWord(DP_STATUS, data);
+                write_rdp(DP_STATUS, data);
                 break;
             }
             default:
@@ -492,6 +803,7 @@ namespace hydra::N64
 
     uint32_t RSP::read_hwio(RSPHWIO addr)
     {
+        update_dma();
         switch (addr)
         {
             case RSPHWIO::Cache:
@@ -563,10 +875,74 @@ namespace hydra::N64
         return status_.halt;
     }
 
+    bool RSP::IsIdle()
+    {
+        return status_.halt && !status_.dma_busy;
+    }
+
     void RSP::InstallBuses(uint8_t* rdram_ptr, RDP* rdp_ptr)
     {
         rdram_ptr_ = rdram_ptr;
         rdp_ptr_ = rdp_ptr;
+        audio_hle_.InstallBuses(rdram_ptr);
+        graphics_hle_.InstallBuses(rdram_ptr, rdp_ptr);
+    }
+
+    void RSP::set_interrupt(bool value)
+    {
+        if (on_worker_)
+        {
+            deferred_interrupt_ = value;
+            yield_ = true;
+            return;
+        }
+        interrupt_callback_(value);
+    }
+
+    void RSP::write_rdp(uint32_t addr, uint32_t data)
+    {
+        if (on_worker_)
+        {
+            // The RDP runs on the CPU thread, the RSP waits for it
+            deferred_rdp_writes_.emplace_back(addr, data);
+            yield_ = true;
+            return;
+        }
+        rdp_ptr_->WriteWord(addr, data);
+    }
+
+    void RSP::notify_rdram_write(uint32_t addr, uint32_t length)
+    {
+        if (on_worker_)
+        {
+            deferred_rdram_writes_.emplace_back(addr, length);
+        }
+        else if (rdram_write_callback_)
+        {
+            rdram_write_callback_(addr, length);
+        }
+    }
+
+    void RSP::ApplyDeferred()
+    {
+        if (rdram_write_callback_)
+        {
+            for (auto [addr, length] : deferred_rdram_writes_)
+            {
+                rdram_write_callback_(addr, length);
+            }
+        }
+        deferred_rdram_writes_.clear();
+        for (auto [addr, data] : deferred_rdp_writes_)
+        {
+            rdp_ptr_->WriteWord(addr, data);
+        }
+        deferred_rdp_writes_.clear();
+        if (deferred_interrupt_)
+        {
+            interrupt_callback_(*deferred_interrupt_);
+            deferred_interrupt_.reset();
+        }
     }
 
     void RSP::SetInterruptCallback(std::function<void(bool)> callback)
@@ -574,6 +950,101 @@ namespace hydra::N64
         interrupt_callback_ = callback;
     }
 
+    void RSP::SetRdramWriteCallback(std::function<void(uint32_t, uint32_t)> callback)
+    {
+        rdram_write_callback_ = callback;
+        audio_hle_.SetRdramWriteCallback(callback);
+    }
+
+    void RSP::SetAudioHle(bool enabled)
+    {
+        audio_hle_enabled_ = enabled;
+    }
+
+    void RSP::SetGraphicsHle(bool enabled)
+    {
+        graphics_hle_enabled_ = enabled;
+    }
+
+    void RSP::SetCachedInterpreter(bool enabled)
+    {
+        use_block_cache_ = enabled;
+        imem_dirty_ = true;
+    }
+
+    void RSP::SetProfiling(bool enabled)
+    {
+        profiler_.SetEnabled(enabled);
+    }
+
+    std::vector<RspUcodeProfile> RSP::GetProfiles() const
+    {
+        return profiler_.GetProfiles();
+    }
+
+    void RSP::ClearProfiles()
+    {
+        profiler_.Clear();
+    }
+
+    void RSP::SetJit(bool enabled)
+    {
+        if (enabled && !jit_buffer_.IsAvailable())
+        {
+            Logger::Warn("The RSP recompiler isn't available, using the block cache");
+        }
+        use_jit_ = enabled;
+        imem_dirty_ = true;
+    }
+
+    // Tasks started through libultra have their OSTask at the end of DMEM and begin in the
+    // boot code at the start of IMEM. The ucode itself isn't loaded yet at that point, it's
+    // recognized from its data section instead
+    bool RSP::run_hle_task()
+    {
+        constexpr uint16_t TASK_TYPE = 0xFC0;
+        constexpr uint16_t TASK_FLAGS = 0xFC4;
+        constexpr uint16_t TASK_UCODE_DATA = 0xFD8;
+        constexpr uint16_t TASK_UCODE_DATA_SIZE = 0xFDC;
+        constexpr uint16_t TASK_DATA_PTR = 0xFF0;
+        constexpr uint16_t TASK_DATA_SIZE = 0xFF4;
+        constexpr uint32_t M_GFXTASK = 1;
+        constexpr uint32_t M_AUDTASK = 2;
+        constexpr uint32_t OS_TASK_YIELDED = 1;
+
+        if (pc_ != 0)
+        {
+            return false;
+        }
+
+        uint32_t ucode_data = load_word(TASK_UCODE_DATA) & 0xFFFFFF;
+        uint32_t data_ptr = load_word(TASK_DATA_PTR) & 0xFFFFFF;
+        switch (load_word(TASK_TYPE))
+        {
+            case M_GFXTASK:
+            {
+                // A yielded task resumes from the state the ucode saved, only the RSP has it
+                if (!graphics_hle_enabled_ || (load_word(TASK_FLAGS) & OS_TASK_YIELDED))
+                {
+                    return false;
+                }
+                uint32_t ucode_data_size = load_word(TASK_UCODE_DATA_SIZE);
+                return graphics_hle_.RunTask(ucode_data, ucode_data_size, data_ptr);
+            }
+            case M_AUDTASK:
+            {
+                if (!audio_hle_enabled_)
+                {
+                    return false;
+                }
+                uint32_t data_size = load_word(TASK_DATA_SIZE);
+                return audio_hle_.RunTask(ucode_data, data_ptr, data_size);
+            }
+            default:
+                return false;
+        }
+    }
+
     using Elements = std::array<uint8_t, 8>;
 
     std::array<Elements, 16> elements = {{{0, 1, 2, 3, 4, 5, 6, 7},
@@ -652,12 +1123,12 @@ namespace hydra::N64
         switch (reg & 0b11)
         {
             case 0:
-                return *vco_;
+                return vco_.Pack();
             case 1:
-                return *vcc_;
+                return vcc_.Pack();
             case 2:
             case 3:
-                return *vce_;
+                return vce_.Pack();
         }
         return 0;
     }
@@ -667,14 +1138,14 @@ namespace hydra::N64
         switch (reg & 0b11)
         {
             case 0:
-                *vco_ = value;
+                vco_.Unpack(value);
                 break;
             case 1:
-                *vcc_ = value;
+                vcc_.Unpack(value);
                 break;
             case 2:
             case 3:
-                *vce_ = value;
+                vce_.Unpack(value);
                 break;
         }
     }
@@ -686,10 +1157,16 @@ namespace hydra::N64
 
     void RSP::LWC2()
     {
+#if RSP_SIMD_SUPPORTED
+        if (simd_load_store_ && LWC2_SIMD())
+        {
+            return;
+        }
+#endif
         switch (instruction_.WCType.opcode)
         {
             case 0x0:
-                exit(1); return LBV();
+                return LBV();
             case 0x1:
                 return LSV();
             case 0x2:
@@ -715,6 +1192,12 @@ namespace hydra::N64
 
     void RSP::SWC2()
     {
+#if RSP_SIMD_SUPPORTED
+        if (simd_load_store_ && SWC2_SIMD())
+        {
+            return;
+        }
+#endif
         switch (instruction_.WCType.opcode)
         {
             case 0x0:
@@ -882,6 +1365,17 @@ namespace hydra::N64
         }
     }
 
+    void RSP::LBV()
+    {
+        int reg = instruction_.WCType.vt;
+        int lane = instruction_.WCType.element;
+        uint32_t address = gpr_regs_[instruction_.WCType.base].UW +
+                           (static_cast<int8_t>(instruction_.WCType.offset << 1) >> 1);
+        uint16_t& element = vu_regs_[reg][lane >> 1];
+        uint8_t value = load_byte(address);
+        element = lane & 1 ? (element & 0xFF00) | value : (element & 0x00FF) | (value << 8);
+    }
+
     void RSP::LSV()
     {
         int reg = instruction_.WCType.vt;
@@ -1455,7 +1949,7 @@ namespace hydra::N64
         {
             int16_t vsi = static_cast<int16_t>(vs[i]);
             int16_t vti = static_cast<int16_t>(vt[e[i]]);
-            bool test = (vsi != vti || (*vco_ & (0x100 << i)));
+            bool test = (vsi != vti || vco_.GetHigh(i));
             accumulator_[i].SetLow(test ? vsi : vti);
             vcc_.SetLow(i, test);
         }
@@ -1481,7 +1975,7 @@ namespace hydra::N64
         {
             int16_t vsi = static_cast<int16_t>(vs[i]);
             int16_t vti = static_cast<int16_t>(vt[e[i]]);
-            bool test = (vsi > vti || (vsi == vti && !(((*vco_ & (*vco_ >> 8)) >> i) & 1)));
+            bool test = (vsi > vti || (vsi == vti && !(vco_.GetLow(i) && vco_.GetHigh(i))));
             accumulator_[i].SetLow(test ? vsi : vti);
             vcc_.SetLow(i, test);
         }
@@ -2073,7 +2567,7 @@ namespace hydra::N64
         if (status_.intr_break)
         {
             Logger::Debug("Raising SP interrupt");
-            interrupt_callback_(true);
+            set_interrupt(true);
         }
     }
 
@@ -2256,7 +2750,7 @@ namespace hydra::N64
                 return CTC2();
             default:
             {
-                (vu_instruction_table_[instruction_.FType.func])(this);
+                ((*vu_table_)[instruction_.FType.func])(this);
                 break;
             }
         }
@@ -1,7 +1,21 @@
 #pragma once
 
+#include <core/n64_cpu_jit.hxx>
+#include <core/n64_rsp_audio.hxx>
+#include <core/n64_rsp_cache.hxx>
+#include <core/n64_rsp_gfx.hxx>
+#include <core/n64_rsp_profile.hxx>
 #include <core/n64_types.hxx>
 #include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__)
+#define RSP_SIMD_SUPPORTED 1
+#else
+#define RSP_SIMD_SUPPORTED 0
+#endif
 
 namespace hydra::N64
 {
@@ -25,135 +39,228 @@ namespace hydra::N64
         CmdTmemBusy = 15,
     };
 
+    // RSP cycles a DMA spends on each row before the data moves at 8 bytes per cycle
+    constexpr uint64_t RSP_DMA_ROW_CYCLES = 8;
+
+    // A DMA as latched when its length register is written
+    struct RspDmaRequest
+    {
+        // Bit 12 selects IMEM
+        uint32_t mem_addr;
+        uint32_t rdram_addr;
+        // RD_LEN or WR_LEN, the row length minus one, row count minus one and skip
+        uint32_t length;
+        bool to_rsp;
+    };
+
     class CPU;
     class CPUBus;
     class RCP;
     class RSP;
     class RDP;
+    class RSPRecompiler;
+    class RspThread;
     using VectorRegister = std::array<uint16_t, 8>;
 
+    // One lane of the accumulator. The accumulator is stored as three slices of eight lanes
+    // so the SIMD vector unit can load them directly, this gives the scalar code a 48-bit view
     struct AccumulatorLane
     {
+        AccumulatorLane(uint16_t& high, uint16_t& middle, uint16_t& low)
+            : high_(high), middle_(middle), low_(low)
+        {
+        }
+
         void Set(uint64_t new_value)
         {
-            value_ = new_value & 0xFFFF'FFFF'FFFF;
+            high_ = new_value >> 32;
+            middle_ = new_value >> 16;
+            low_ = new_value;
         }
 
         void SetHigh(uint16_t new_value)
         {
-            value_ = (static_cast<uint64_t>(new_value) << 32) | (value_ & 0xFFFF'FFFF);
+            high_ = new_value;
         }
 
         void SetMiddle(uint16_t new_value)
         {
-            value_ = (static_cast<uint64_t>(new_value) << 16) | (value_ & 0xFFFF'0000'FFFF);
+            middle_ = new_value;
         }
 
         void SetLow(uint16_t new_value)
         {
-            value_ = (value_ & 0xFFFF'FFFF'0000) | new_value;
+            low_ = new_value;
         }
 
         uint64_t Get() const
         {
-            return value_;
+            return (static_cast<uint64_t>(high_) << 32) | (static_cast<uint64_t>(middle_) << 16) |
+                   low_;
         }
 
         int64_t GetSigned() const
         {
-            return static_cast<int64_t>(value_ << 16) >> 16;
+            return static_cast<int64_t>(Get() << 16) >> 16;
         }
 
         uint16_t GetHigh() const
         {
-            return value_ >> 32;
+            return high_;
         }
 
         uint16_t GetMiddle() const
         {
-            return (value_ >> 16) & 0xFFFF;
+            return middle_;
         }
 
         uint16_t GetLow() const
         {
-            return value_ & 0xFFFF;
+            return low_;
         }
 
         int16_t GetHighSigned() const
         {
-            return value_ >> 32;
+            return high_;
         }
 
         void Add(int64_t value)
         {
-            value_ = static_cast<int64_t>(value_) + value;
-            value_ &= 0xFFFF'FFFF'FFFF;
+            Set(static_cast<int64_t>(Get()) + value);
         }
 
     private:
-        uint64_t value_ = 0;
+        uint16_t& high_;
+        uint16_t& middle_;
+        uint16_t& low_;
+    };
+
+    struct Accumulator
+    {
+        AccumulatorLane operator[](int lane)
+        {
+            return AccumulatorLane(high[lane], middle[lane], low[lane]);
+        }
+
+        void Clear()
+        {
+            high.fill(0);
+            middle.fill(0);
+            low.fill(0);
+        }
+
+        alignas(16) VectorRegister high{};
+        alignas(16) VectorRegister middle{};
+        alignas(16) VectorRegister low{};
     };
 
+    // The flags are kept as lane masks, 0xFFFF for a set flag, so the SIMD vector unit can
+    // use them as blend masks. Pack and Unpack convert from and to the CFC2/CTC2 layout
     struct VUControl16
     {
         bool GetLow(int index) const
         {
-            return (full_ >> index) & 1;
+            return low_[index];
         }
 
         bool GetHigh(int index) const
         {
-            return (full_ >> (index + 8)) & 1;
+            return high_[index];
         }
 
         void SetLow(int index, bool value)
         {
-            full_ = (full_ & ~(1 << index)) | (value << index);
+            low_[index] = value ? 0xFFFF : 0;
         }
 
         void SetHigh(int index, bool value)
         {
-            full_ = (full_ & ~(1 << (index + 8))) | (value << (index + 8));
+            high_[index] = value ? 0xFFFF : 0;
         }
 
         void Clear()
         {
-            full_ = 0;
+            low_.fill(0);
+            high_.fill(0);
         }
 
-        uint16_t& operator*()
+        uint16_t Pack() const
         {
-            return full_;
+            uint16_t value = 0;
+            for (int i = 0; i < 8; i++)
+            {
+                value |= (low_[i] & 1) << i;
+                value |= (high_[i] & 1) << (i + 8);
+            }
+            return value;
+        }
+
+        void Unpack(uint16_t value)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                SetLow(i, (value >> i) & 1);
+                SetHigh(i, (value >> (i + 8)) & 1);
+            }
+        }
+
+        VectorRegister& Low()
+        {
+            return low_;
+        }
+
+        VectorRegister& High()
+        {
+            return high_;
         }
 
     private:
-        uint16_t full_ = 0;
+        alignas(16) VectorRegister low_{};
+        alignas(16) VectorRegister high_{};
     };
 
     struct VUControl8
     {
         bool Get(int index) const
         {
-            return (full_ >> index) & 1;
+            return lanes_[index];
         }
 
         void Set(int index, bool value)
         {
-            full_ = (full_ & ~(1 << index)) | (value << index);
+            lanes_[index] = value ? 0xFFFF : 0;
         }
 
         void Clear()
         {
-            full_ = 0;
+            lanes_.fill(0);
+        }
+
+        uint8_t Pack() const
+        {
+            uint8_t value = 0;
+            for (int i = 0; i < 8; i++)
+            {
+                value |= (lanes_[i] & 1) << i;
+            }
+            return value;
         }
 
-        uint8_t& operator*()
+        void Unpack(uint8_t value)
         {
-            return full_;
+            for (int i = 0; i < 8; i++)
+            {
+                Set(i, (value >> i) & 1);
+            }
+        }
+
+        VectorRegister& Lanes()
+        {
+            return lanes_;
         }
 
     private:
-        uint8_t full_ = 0;
+        alignas(16) VectorRegister lanes_{};
     };
 
     union RSPStatus
@@ -220,6 +327,10 @@ namespace hydra::N64
 
     static_assert(sizeof(RSPStatusWrite) == sizeof(uint32_t));
 
+    // The divide unit's reciprocal and inverse square root, shared with the recompiler
+    uint32_t rcp(int32_t sinput);
+    uint32_t rsq(uint32_t input);
+
     template <auto MemberFunc>
     static void lut_wrapper(RSP* cpu)
     {
@@ -231,10 +342,42 @@ namespace hydra::N64
     public:
         RSP();
         void Tick();
+        // Runs until the budget is spent or the RSP halts, returns the cycles consumed
+        uint64_t RunFor(uint64_t cycles);
         void Reset();
         bool IsHalted();
+        // Halted with no DMA in flight, nothing happens until the CPU starts either again
+        bool IsIdle();
         void InstallBuses(uint8_t* rdram_ptr, RDP* rdp_ptr);
         void SetInterruptCallback(std::function<void(bool)> callback);
+        void SetRdramWriteCallback(std::function<void(uint32_t, uint32_t)> callback);
+        // Picks between the SSE4.1 vector unit and the scalar one, which is kept as the
+        // reference implementation. The SIMD one is used by default when the host supports it
+        void SetSimdVectorUnit(bool enabled);
+        // Runs known audio microcodes natively when a task starts, anything else still runs
+        // on the RSP
+        void SetAudioHle(bool enabled);
+        // Same for graphics tasks, off by default as the RDP output isn't bit exact
+        void SetGraphicsHle(bool enabled);
+        // Switches between the regular interpreter and the block cache
+        void SetCachedInterpreter(bool enabled);
+        // Switches to the x86-64 recompiler, which works on the blocks of the block cache.
+        // The interpreter stays the reference and runs whatever the recompiler doesn't handle
+        void SetJit(bool enabled);
+        // Groups the tasks by microcode and collects statistics on them, off by default
+        void SetProfiling(bool enabled);
+        // Totals and the last task of every microcode seen since profiling was enabled
+        std::vector<RspUcodeProfile> GetProfiles() const;
+        void ClearProfiles();
+        // Applies the interrupt, RDP register writes and RDRAM invalidations the last run on
+        // the worker thread left for the CPU thread
+        void ApplyDeferred();
+
+        // For writes to IMEM that don't go through the RSP itself
+        void InvalidateImem()
+        {
+            imem_dirty_ = true;
+        }
 
     private:
         using func_ptr = void (*)(RSP*);
@@ -248,6 +391,14 @@ namespace hydra::N64
             VCR(), VMRG(), VRCP(), VRCPL(), VRCPH(), VMOV(), VRSQ(), VRSQL(), VMULQ(), VMACQ(),
             VZERO(), VNOP();
 
+        void VMULF_SIMD(), VMULU_SIMD(), VMUDL_SIMD(), VMUDM_SIMD(), VMUDN_SIMD(), VMUDH_SIMD(),
+            VMACF_SIMD(), VMACU_SIMD(), VMADL_SIMD(), VMADM_SIMD(), VMADN_SIMD(), VMADH_SIMD(),
+            VADD_SIMD(), VABS_SIMD(), VADDC_SIMD(), VSAR_SIMD(), VAND_SIMD(), VNAND_SIMD(),
+            VOR_SIMD(), VNOR_SIMD(), VXOR_SIMD(), VNXOR_SIMD(), VSUB_SIMD(), VLT_SIMD(),
+            VSUBC_SIMD(), VEQ_SIMD(), VNE_SIMD(), VGE_SIMD(), VCL_SIMD(), VCH_SIMD(), VCR_SIMD(),
+            VMRG_SIMD(), VZERO_SIMD();
+        bool LWC2_SIMD(), SWC2_SIMD();
+
         void SPECIAL(), REGIMM(), J(), JAL(), BEQ(), BNE(), BLEZ(), BGTZ(), ADDI(), ADDIU(), SLTI(),
             SLTIU(), ANDI(), ORI(), XORI(), LUI(), COP0(), COP1(), COP2(), LB(), LH(), LW(), LBU(),
             LHU(), LWU(), SB(), SH(), SW(), CACHE(), LWC2(), SWC2();
@@ -340,6 +491,45 @@ namespace hydra::N64
             &lut_wrapper<&RSP::VNOP>,
         };
 
+#if RSP_SIMD_SUPPORTED
+        // Same layout as vu_instruction_table_, the divide, VMOV and VMULQ/VMACQ instructions
+        // only touch single lanes or are rare enough to share the scalar versions
+        constexpr static std::array<func_ptr, 64> vu_simd_instruction_table_ = {
+            &lut_wrapper<&RSP::VMULF_SIMD>, &lut_wrapper<&RSP::VMULU_SIMD>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VMULQ>,
+            &lut_wrapper<&RSP::VMUDL_SIMD>, &lut_wrapper<&RSP::VMUDM_SIMD>,
+            &lut_wrapper<&RSP::VMUDN_SIMD>, &lut_wrapper<&RSP::VMUDH_SIMD>,
+            &lut_wrapper<&RSP::VMACF_SIMD>, &lut_wrapper<&RSP::VMACU_SIMD>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VZERO_SIMD>,
+            &lut_wrapper<&RSP::VMADL_SIMD>, &lut_wrapper<&RSP::VMADM_SIMD>,
+            &lut_wrapper<&RSP::VMADN_SIMD>, &lut_wrapper<&RSP::VMADH_SIMD>,
+            &lut_wrapper<&RSP::VADD_SIMD>,  &lut_wrapper<&RSP::VSUB_SIMD>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VABS_SIMD>,
+            &lut_wrapper<&RSP::VADDC_SIMD>, &lut_wrapper<&RSP::VSUBC_SIMD>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VZERO_SIMD>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VZERO_SIMD>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VZERO_SIMD>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VSAR_SIMD>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VZERO_SIMD>,
+            &lut_wrapper<&RSP::VLT_SIMD>,   &lut_wrapper<&RSP::VEQ_SIMD>,
+            &lut_wrapper<&RSP::VNE_SIMD>,   &lut_wrapper<&RSP::VGE_SIMD>,
+            &lut_wrapper<&RSP::VCL_SIMD>,   &lut_wrapper<&RSP::VCH_SIMD>,
+            &lut_wrapper<&RSP::VCR_SIMD>,   &lut_wrapper<&RSP::VMRG_SIMD>,
+            &lut_wrapper<&RSP::VAND_SIMD>,  &lut_wrapper<&RSP::VNAND_SIMD>,
+            &lut_wrapper<&RSP::VOR_SIMD>,   &lut_wrapper<&RSP::VNOR_SIMD>,
+            &lut_wrapper<&RSP::VXOR_SIMD>,  &lut_wrapper<&RSP::VNXOR_SIMD>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VZERO_SIMD>,
+            &lut_wrapper<&RSP::VRCP>,       &lut_wrapper<&RSP::VRCPL>,
+            &lut_wrapper<&RSP::VRCPH>,      &lut_wrapper<&RSP::VMOV>,
+            &lut_wrapper<&RSP::VRSQ>,       &lut_wrapper<&RSP::VRSQL>,
+            &lut_wrapper<&RSP::VRCPH>,      &lut_wrapper<&RSP::VNOP>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VZERO_SIMD>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VZERO_SIMD>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VZERO_SIMD>,
+            &lut_wrapper<&RSP::VZERO_SIMD>, &lut_wrapper<&RSP::VNOP>,
+        };
+#endif
+
         constexpr static std::array<func_ptr, 32> regimm_table_ = {
             &lut_wrapper<&RSP::r_BLTZ>, &lut_wrapper<&RSP::r_BGEZ>,   &lut_wrapper<&RSP::ERROR2>,
             &lut_wrapper<&RSP::ERROR2>, &lut_wrapper<&RSP::ERROR2>,   &lut_wrapper<&RSP::ERROR2>,
@@ -365,15 +555,25 @@ namespace hydra::N64
         void branch_to(uint16_t address);
         void conditional_branch(bool condition, uint16_t address);
         void link_register(uint8_t reg);
-        void read_dma();
-        void write_dma();
+        void queue_dma(uint32_t length, bool to_rsp);
+        void start_dma(const RspDmaRequest& request, uint64_t start);
+        void copy_dma(uint32_t mem_addr, uint32_t rdram_addr, uint32_t length, bool to_rsp);
+        void update_dma();
+        uint64_t wait_dma(uint64_t cycles);
         void dump_mem();
         int16_t get_lane(int reg, int lane);
         void set_lane(int reg, int lane, int16_t value);
         int16_t get_control(int reg);
         void set_control(int reg, int16_t value);
         void write_hwio(RSPHWIO addr, uint32_t data);
+        bool run_hle_task();
+        uint64_t run_cached(uint64_t cycles);
+        RspBlock& compile_block(uint32_t pc);
+        void compile_jit_block(RspBlock& block, uint32_t pc);
         uint32_t read_hwio(RSPHWIO addr);
+        void set_interrupt(bool value);
+        void write_rdp(uint32_t addr, uint32_t data);
+        void notify_rdram_write(uint32_t addr, uint32_t length);
 
         VectorRegister& get_vs();
         VectorRegister& get_vt();
@@ -384,7 +584,7 @@ namespace hydra::N64
 
         std::array<uint8_t, 0x2000> mem_{};
         std::array<MemDataUnionW, 32> gpr_regs_;
-        std::array<VectorRegister, 32> vu_regs_;
+        alignas(16) std::array<VectorRegister, 32> vu_regs_;
         VUControl16 vco_, vcc_;
         VUControl8 vce_;
         int16_t div_in_, div_out_;
@@ -393,14 +593,23 @@ namespace hydra::N64
         // Each vector slice has a 48-bit accumulator associated with it. Each 16-bit
         // element of a vector register maps to a vector slice, and therefore to a different
         // 48-bit accumulato
-        std::array<AccumulatorLane, 8> accumulator_;
+        Accumulator accumulator_;
+        const std::array<func_ptr, 64>* vu_table_ = &vu_instruction_table_;
+        // Vector loads and stores go through SIMD along with the vector unit
+        bool simd_load_store_ = false;
 
         // TODO: some are probably not needed
         Instruction instruction_;
         uint32_t mem_addr_, pending_mem_addr_;
-        bool dma_imem_;
         uint32_t rdram_addr_, pending_rdram_addr_;
         uint32_t dma_len_;
+        // The DMA waiting for the one in flight while status_.dma_full is set. The data of a
+        // DMA moves when it starts, status_.dma_busy stays set until clock_ reaches
+        // dma_done_clock_
+        RspDmaRequest dma_pending_;
+        uint64_t dma_done_clock_ = 0;
+        // RSP cycles run since reset, also ticks while halted with a DMA in flight
+        uint64_t clock_ = 0;
         RSPStatus status_;
         uint32_t pc_ = 0;
         uint32_t next_pc_ = 4;
@@ -408,9 +617,35 @@ namespace hydra::N64
         uint8_t* rdram_ptr_ = nullptr;
         RDP* rdp_ptr_ = nullptr;
         std::function<void(bool)> interrupt_callback_;
+        std::function<void(uint32_t, uint32_t)> rdram_write_callback_;
+        AudioHle audio_hle_;
+        bool audio_hle_enabled_ = true;
+        GraphicsHle graphics_hle_;
+        bool graphics_hle_enabled_ = false;
+        RspBlockCache block_cache_;
+        bool use_block_cache_ = false;
+        // Set when IMEM may no longer match the image the block cache has selected
+        bool imem_dirty_ = true;
+        X64CodeBuffer jit_buffer_{8 * 1024 * 1024};
+        bool use_jit_ = false;
+        RspProfiler profiler_;
+        // Vector instructions run since reset, counted whether profiling or not
+        uint64_t vector_retired_ = 0;
+        // Set while RunFor executes instructions, the task then ends when it returns
+        bool running_ = false;
+        // Set while RunFor runs on the RspThread worker. Anything that reaches the rest of the
+        // console is then queued for the CPU thread, and RunFor stops after an instruction
+        // that raised an interrupt or wrote an RDP register
+        bool on_worker_ = false;
+        bool yield_ = false;
+        std::optional<bool> deferred_interrupt_;
+        std::vector<std::pair<uint32_t, uint32_t>> deferred_rdp_writes_;
+        std::vector<std::pair<uint32_t, uint32_t>> deferred_rdram_writes_;
 
         friend class hydra::N64::CPU;
         friend class hydra::N64::CPUBus;
         friend class hydra::N64::RCP;
+        friend class hydra::N64::RSPRecompiler;
+        friend class hydra::N64::RspThread;
     };
 } // namespace hydra::N64
\ No newline at end of file
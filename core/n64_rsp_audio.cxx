@@ -0,0 +1,1508 @@
+#include <algorithm>
+#include <core/n64_log.hxx>
+#include <core/n64_rsp_audio.hxx>
+#include <core/n64_rsp_memory.hxx>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace hydra::N64
+{
+    namespace
+    {
+        // ABI1 command buffers are relative to this
+        constexpr uint16_t DMEM_BASE = 0x5c0;
+
+        // naudio works on fixed buffers of NAUDIO_COUNT bytes
+        constexpr uint16_t NAUDIO_COUNT = 0x170;
+        constexpr uint16_t NAUDIO_MAIN = 0x4f0;
+        constexpr uint16_t NAUDIO_MAIN2 = 0x660;
+        constexpr uint16_t NAUDIO_DRY_LEFT = 0x9d0;
+        constexpr uint16_t NAUDIO_DRY_RIGHT = 0xb40;
+        constexpr uint16_t NAUDIO_WET_LEFT = 0xcb0;
+        constexpr uint16_t NAUDIO_WET_RIGHT = 0xe20;
+
+        enum AbiFlags
+        {
+            A_INIT = 0x01,
+            A_LOOP = 0x02,
+            A_LEFT = 0x02,
+            A_VOL = 0x04,
+            A_AUX = 0x08,
+        };
+
+        // Four tap interpolation filter of the resampler, indexed by the top 6 bits of the
+        // fractional position. The second half is the first one mirrored
+        constexpr std::array<int16_t, 32 * 4> RESAMPLE_LUT_HALF = {
+            0x0c39, 0x66ad, 0x0d46, -0x0021, 0x0b39, 0x6696, 0x0e5f, -0x0028,
+            0x0a44, 0x6669, 0x0f83, -0x0030, 0x095a, 0x6626, 0x10b4, -0x0038,
+            0x087d, 0x65cd, 0x11f0, -0x0041, 0x07ab, 0x655e, 0x1338, -0x004a,
+            0x06e4, 0x64d9, 0x148c, -0x0054, 0x0628, 0x643f, 0x15eb, -0x005f,
+            0x0577, 0x638f, 0x1756, -0x006a, 0x04d1, 0x62cb, 0x18cb, -0x0076,
+            0x0435, 0x61f3, 0x1a4c, -0x0082, 0x03a4, 0x6106, 0x1bd7, -0x008f,
+            0x031c, 0x6007, 0x1d6c, -0x009c, 0x029f, 0x5ef5, 0x1f0b, -0x00aa,
+            0x022a, 0x5dd0, 0x20b3, -0x00b8, 0x01be, 0x5c9a, 0x2264, -0x00c6,
+            0x015b, 0x5b53, 0x241e, -0x00d4, 0x0101, 0x59fc, 0x25e0, -0x00e2,
+            0x00ae, 0x5896, 0x27a9, -0x00f0, 0x0063, 0x5720, 0x297a, -0x00fe,
+            0x001f, 0x559d, 0x2b50, -0x010c, -0x001e, 0x540d, 0x2d2c, -0x0118,
+            -0x0054, 0x5270, 0x2f0d, -0x0125, -0x0084, 0x50c7, 0x30f3, -0x0130,
+            -0x00ad, 0x4f14, 0x32dc, -0x013a, -0x00d2, 0x4d57, 0x34c8, -0x0143,
+            -0x00f1, 0x4b91, 0x36b6, -0x014a, -0x010b, 0x49c2, 0x38a5, -0x0150,
+            -0x0121, 0x47ed, 0x3a95, -0x0154, -0x0132, 0x4611, 0x3c85, -0x0155,
+            -0x0140, 0x4430, 0x3e74, -0x0154, -0x014a, 0x424a, 0x4060, -0x0151,
+        };
+
+        constexpr std::array<int16_t, 64 * 4> RESAMPLE_LUT = [] {
+            std::array<int16_t, 64 * 4> lut{};
+            for (int i = 0; i < 32 * 4; i++)
+            {
+                lut[i] = RESAMPLE_LUT_HALF[i];
+                lut[64 * 4 - 1 - i] = RESAMPLE_LUT_HALF[i];
+            }
+            return lut;
+        }();
+
+        // Matches the ucode signatures below to the command tables
+        struct UcodeSignature
+        {
+            uint32_t value;
+            AudioUcode ucode;
+        };
+
+        constexpr std::array<UcodeSignature, 3> ABI1_SIGNATURES = {{
+            {0x1e24138c, AudioUcode::Abi1},
+            {0x1dc8138c, AudioUcode::Abi1Ge}, // GoldenEye
+            {0x1e3c1390, AudioUcode::Abi1Ge}, // Blast Corps, Diddy Kong Racing
+        }};
+
+        constexpr std::array<UcodeSignature, 13> NEAD_SIGNATURES = {{
+            {0x11181350, AudioUcode::NeadMk},    // Mario Kart 64, Wave Race 64
+            {0x111812e0, AudioUcode::NeadSfj},   // Star Fox 64 (J)
+            {0x110412ac, AudioUcode::NeadWrjb},  // Wave Race 64 Shindou
+            {0x110412cc, AudioUcode::NeadSf},    // Star Fox 64
+            {0x1cd01250, AudioUcode::NeadFz},    // F-Zero X
+            {0x1f08122c, AudioUcode::NeadZelda}, // Yoshi's Story
+            {0x1f38122c, AudioUcode::NeadZelda}, // 1080 Snowboarding
+            {0x1f681230, AudioUcode::NeadZelda}, // Ocarina of Time
+            {0x1f801250, AudioUcode::NeadZelda}, // Majora's Mask
+            {0x109411f8, AudioUcode::NeadZelda}, // Majora's Mask beta
+            {0x1eac11b8, AudioUcode::NeadZelda}, // Animal Crossing
+            {0x1f701238, AudioUcode::NeadZelda}, // Mario Artist Talent Studio
+            {0x1f4c1230, AudioUcode::NeadZelda}, // F-Zero X Expansion
+        }};
+
+        constexpr std::array<UcodeSignature, 3> NAUDIO_SIGNATURES = {{
+            {0x0000127c, AudioUcode::NAudio},
+            {0x00001280, AudioUcode::NAudio}, // Banjo-Kazooie
+            {0x1c58126c, AudioUcode::NAudioDk}, // Donkey Kong 64
+        }};
+
+        template <size_t Size>
+        AudioUcode find_signature(const std::array<UcodeSignature, Size>& signatures,
+                                  uint32_t value)
+        {
+            for (const auto& signature : signatures)
+            {
+                if (signature.value == value)
+                {
+                    return signature.ucode;
+                }
+            }
+            return AudioUcode::Unknown;
+        }
+
+        int16_t clamp_s16(int32_t value)
+        {
+            return static_cast<int16_t>(std::clamp(value, -32768, 32767));
+        }
+
+        // Dot product of the first n coefficients against the n previous samples
+        int32_t rdot(size_t n, const int16_t* x, const int16_t* y)
+        {
+            int32_t accu = 0;
+            y += n;
+            while (n != 0)
+            {
+                accu += *(x++) * *(--y);
+                --n;
+            }
+            return accu;
+        }
+
+        int16_t adpcm_predict_sample(uint8_t byte, uint8_t mask, unsigned lshift, unsigned rshift)
+        {
+            int16_t sample = static_cast<int16_t>(static_cast<uint16_t>(byte & mask) << lshift);
+            return static_cast<int16_t>(sample >> rshift);
+        }
+
+        void adpcm_compute_residuals(int16_t* dst, const int16_t* src, const int16_t* cb_entry,
+                                     const int16_t* last_samples)
+        {
+            const int16_t* book1 = cb_entry;
+            const int16_t* book2 = cb_entry + 8;
+            const int16_t l1 = last_samples[0];
+            const int16_t l2 = last_samples[1];
+            for (size_t i = 0; i < 8; i++)
+            {
+                int32_t accu = static_cast<int32_t>(src[i]) << 11;
+                accu += book1[i] * l1 + book2[i] * l2 + rdot(i, book2, src);
+                dst[i] = clamp_s16(accu >> 11);
+            }
+        }
+
+        uint16_t align(uint16_t value, uint16_t alignment)
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        // Volume ramp in 16.16 fixed point
+        struct Ramp
+        {
+            int32_t value;
+            int32_t step;
+            int32_t target;
+
+            int16_t Step()
+            {
+                value += step;
+                bool reached = step <= 0 ? value <= target : value >= target;
+                if (reached)
+                {
+                    value = target;
+                    step = 0;
+                }
+                return static_cast<int16_t>(value >> 16);
+            }
+        };
+    } // namespace
+
+    AudioUcode identify_audio_ucode(const uint8_t* rdram, uint32_t ucode_data)
+    {
+        if (rsp_read_word(rdram, ucode_data, RDRAM_MASK) == 0x0000'0001)
+        {
+            if (rsp_read_word(rdram, ucode_data + 0x30, RDRAM_MASK) == 0xf000'0f00)
+            {
+                return find_signature(ABI1_SIGNATURES,
+                                      rsp_read_word(rdram, ucode_data + 0x28, RDRAM_MASK));
+            }
+            return find_signature(NEAD_SIGNATURES,
+                                  rsp_read_word(rdram, ucode_data + 0x10, RDRAM_MASK));
+        }
+        return find_signature(NAUDIO_SIGNATURES,
+                              rsp_read_word(rdram, ucode_data + 0x10, RDRAM_MASK));
+    }
+
+    const char* audio_ucode_name(AudioUcode ucode)
+    {
+        switch (ucode)
+        {
+            case AudioUcode::Abi1:
+                return "ABI1";
+            case AudioUcode::Abi1Ge:
+                return "ABI1 (GoldenEye)";
+            case AudioUcode::NAudio:
+                return "naudio";
+            case AudioUcode::NAudioDk:
+                return "naudio (Donkey Kong 64)";
+            case AudioUcode::NeadMk:
+                return "nead (Mario Kart 64)";
+            case AudioUcode::NeadSf:
+            case AudioUcode::NeadSfj:
+                return "nead (Star Fox 64)";
+            case AudioUcode::NeadFz:
+                return "nead (F-Zero X)";
+            case AudioUcode::NeadWrjb:
+                return "nead (Wave Race 64 Shindou)";
+            case AudioUcode::NeadZelda:
+                return "nead (Zelda)";
+            default:
+                return "unknown";
+        }
+    }
+
+    void AudioHle::InstallBuses(uint8_t* rdram_ptr)
+    {
+        rdram_ptr_ = rdram_ptr;
+    }
+
+    void AudioHle::SetRdramWriteCallback(std::function<void(uint32_t, uint32_t)> callback)
+    {
+        rdram_write_callback_ = callback;
+    }
+
+    void AudioHle::Reset()
+    {
+        buffer_.fill(0);
+        ucode_ = AudioUcode::Unknown;
+        segments_.fill(0);
+        codebook_.fill(0);
+        in_ = out_ = count_ = 0;
+        dry_right_ = wet_left_ = wet_right_ = 0;
+        dry_ = wet_ = 0;
+        volume_.fill(0);
+        target_.fill(0);
+        rate_.fill(0);
+        loop_ = 0;
+        env_values_.fill(0);
+        env_steps_.fill(0);
+        filter_count_ = 0;
+        filter_lut_address_.fill(0);
+    }
+
+    bool AudioHle::RunTask(uint32_t ucode_data, uint32_t data_ptr, uint32_t data_size)
+    {
+        AudioUcode ucode = identify_audio_ucode(rdram_ptr_, ucode_data);
+        const CommandTable* table = nullptr;
+        switch (ucode)
+        {
+            case AudioUcode::Unknown:
+                return false;
+            case AudioUcode::Abi1:
+                table = &abi1_table_;
+                break;
+            case AudioUcode::Abi1Ge:
+                table = &abi1_ge_table_;
+                break;
+            case AudioUcode::NAudio:
+                table = &naudio_table_;
+                break;
+            case AudioUcode::NAudioDk:
+                table = &naudio_dk_table_;
+                break;
+            case AudioUcode::NeadMk:
+                table = &nead_mk_table_;
+                break;
+            case AudioUcode::NeadSf:
+                table = &nead_sf_table_;
+                break;
+            case AudioUcode::NeadSfj:
+                table = &nead_sfj_table_;
+                break;
+            case AudioUcode::NeadFz:
+                table = &nead_fz_table_;
+                break;
+            case AudioUcode::NeadWrjb:
+                table = &nead_wrjb_table_;
+                break;
+            case AudioUcode::NeadZelda:
+                table = &nead_zelda_table_;
+                break;
+        }
+
+        if (ucode != ucode_)
+        {
+            Logger::Info("Running {} audio microcode in HLE", audio_ucode_name(ucode));
+            ucode_ = ucode;
+        }
+
+        segments_.fill(0);
+        for (uint32_t i = 0; i + 8 <= data_size; i += 8)
+        {
+            uint32_t w1 = dram_read32(data_ptr + i);
+            uint32_t w2 = dram_read32(data_ptr + i + 4);
+            uint32_t command = (w1 >> 24) & 0x7f;
+            if (command < table->size())
+            {
+                ((*table)[command])(this, w1, w2);
+            }
+            else
+            {
+                UNKNOWN(w1, w2);
+            }
+        }
+        return true;
+    }
+
+    int16_t& AudioHle::sample(uint16_t address)
+    {
+        return buffer_[(address >> 1) & 0x7FF];
+    }
+
+    uint8_t& AudioHle::byte(uint16_t address)
+    {
+        // The buffer holds host order halfwords, DMEM is big endian
+        return reinterpret_cast<uint8_t*>(buffer_.data())[(address ^ 1) & 0xFFF];
+    }
+
+    int16_t* AudioHle::contiguous(uint16_t address, uint32_t size)
+    {
+        address &= 0xFFF;
+        if ((address & 1) || address + size > 0x1000)
+        {
+            return nullptr;
+        }
+        return &buffer_[address >> 1];
+    }
+
+    uint16_t AudioHle::dram_read16(uint32_t address)
+    {
+        return (rdram_ptr_[address & RDRAM_MASK] << 8) | rdram_ptr_[(address + 1) & RDRAM_MASK];
+    }
+
+    void AudioHle::dram_write16(uint32_t address, uint16_t value)
+    {
+        rdram_ptr_[address & RDRAM_MASK] = value >> 8;
+        rdram_ptr_[(address + 1) & RDRAM_MASK] = value & 0xFF;
+    }
+
+    uint32_t AudioHle::dram_read32(uint32_t address)
+    {
+        return rsp_read_word(rdram_ptr_, address, RDRAM_MASK);
+    }
+
+    void AudioHle::dram_write32(uint32_t address, uint32_t value)
+    {
+        dram_write16(address, value >> 16);
+        dram_write16(address + 2, value & 0xFFFF);
+    }
+
+    void AudioHle::dram_written(uint32_t address, uint32_t size)
+    {
+        if (rdram_write_callback_)
+        {
+            rdram_write_callback_(address & RDRAM_MASK, size);
+        }
+    }
+
+    uint32_t AudioHle::segment_address(uint32_t address)
+    {
+        uint32_t segment = (address >> 24) & 0x3f;
+        uint32_t offset = address & 0xffffff;
+        if (segment >= segments_.size())
+        {
+            Logger::WarnOnce("Audio HLE: invalid segment {}", segment);
+            return offset;
+        }
+        return segments_[segment] + offset;
+    }
+
+    void AudioHle::clear(uint16_t dmem, uint16_t count)
+    {
+        if (int16_t* dst = contiguous(dmem, count); dst && !(count & 1))
+        {
+            std::fill_n(dst, count >> 1, 0);
+            return;
+        }
+        while (count != 0)
+        {
+            byte(dmem++) = 0;
+            --count;
+        }
+    }
+
+    void AudioHle::load(uint16_t dmem, uint32_t address, uint16_t count)
+    {
+        // DMA alignment constraints
+        dmem &= ~3;
+        address &= ~7;
+        count = align(count, 8);
+        for (uint16_t i = 0; i < count; i += 2)
+        {
+            sample(dmem + i) = dram_read16(address + i);
+        }
+    }
+
+    void AudioHle::save(uint16_t dmem, uint32_t address, uint16_t count)
+    {
+        dmem &= ~3;
+        address &= ~7;
+        count = align(count, 8);
+        for (uint16_t i = 0; i < count; i += 2)
+        {
+            dram_write16(address + i, sample(dmem + i));
+        }
+        dram_written(address, count);
+    }
+
+    void AudioHle::move(uint16_t dmemo, uint16_t dmemi, uint16_t count)
+    {
+        // The ucode copies forwards one element at a time, so overlapping moves repeat data
+        if (!((dmemo | dmemi | count) & 1))
+        {
+            for (; count != 0; count -= 2, dmemo += 2, dmemi += 2)
+            {
+                sample(dmemo) = sample(dmemi);
+            }
+            return;
+        }
+        while (count != 0)
+        {
+            byte(dmemo++) = byte(dmemi++);
+            --count;
+        }
+    }
+
+    void AudioHle::load_codebook(uint32_t address, uint16_t count)
+    {
+        count = std::min<uint16_t>(count >> 1, codebook_.size());
+        for (uint16_t i = 0; i < count; i++)
+        {
+            codebook_[i] = dram_read16(address + i * 2);
+        }
+    }
+
+    void AudioHle::adpcm(bool init, bool loop, bool two_bit_per_sample, uint16_t dmemo,
+                         uint16_t dmemi, uint16_t count, uint32_t address)
+    {
+        std::array<int16_t, 16> last_frame{};
+        if (!init)
+        {
+            uint32_t source = loop ? loop_ : address;
+            for (int i = 0; i < 16; i++)
+            {
+                last_frame[i] = dram_read16(source + i * 2);
+            }
+        }
+
+        for (int i = 0; i < 16; i++, dmemo += 2)
+        {
+            sample(dmemo) = last_frame[i];
+        }
+
+        while (count != 0)
+        {
+            std::array<int16_t, 16> frame;
+            uint8_t code = byte(dmemi++);
+            unsigned scale = code >> 4;
+            const int16_t* cb_entry = &codebook_[(code & 0xf) << 4];
+
+            if (two_bit_per_sample)
+            {
+                unsigned rshift = scale < 14 ? 14 - scale : 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    uint8_t data = byte(dmemi++);
+                    frame[i * 4 + 0] = adpcm_predict_sample(data, 0xc0, 8, rshift);
+                    frame[i * 4 + 1] = adpcm_predict_sample(data, 0x30, 10, rshift);
+                    frame[i * 4 + 2] = adpcm_predict_sample(data, 0x0c, 12, rshift);
+                    frame[i * 4 + 3] = adpcm_predict_sample(data, 0x03, 14, rshift);
+                }
+            }
+            else
+            {
+                unsigned rshift = scale < 12 ? 12 - scale : 0;
+                for (int i = 0; i < 8; i++)
+                {
+                    uint8_t data = byte(dmemi++);
+                    frame[i * 2 + 0] = adpcm_predict_sample(data, 0xf0, 8, rshift);
+                    frame[i * 2 + 1] = adpcm_predict_sample(data, 0x0f, 12, rshift);
+                }
+            }
+
+            adpcm_compute_residuals(&last_frame[0], &frame[0], cb_entry, &last_frame[14]);
+            adpcm_compute_residuals(&last_frame[8], &frame[8], cb_entry, &last_frame[6]);
+
+            for (int i = 0; i < 16; i++, dmemo += 2)
+            {
+                sample(dmemo) = last_frame[i];
+            }
+            count -= 32;
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            dram_write16(address + i * 2, last_frame[i]);
+        }
+        dram_written(address, 32);
+    }
+
+    void AudioHle::resample(bool init, uint16_t dmemo, uint16_t dmemi, uint16_t count,
+                            uint32_t pitch, uint32_t address)
+    {
+        uint16_t opos = dmemo >> 1;
+        uint16_t ipos = (dmemi >> 1) - 4;
+        uint32_t pitch_accu = 0;
+        auto at = [this](uint16_t position) -> int16_t& { return buffer_[position & 0x7FF]; };
+
+        for (int i = 0; i < 4; i++)
+        {
+            at(ipos + i) = init ? 0 : dram_read16(address + i * 2);
+        }
+        if (!init)
+        {
+            pitch_accu = dram_read16(address + 8);
+        }
+
+        for (count >>= 1; count != 0; --count)
+        {
+            const int16_t* lut = &RESAMPLE_LUT[(pitch_accu & 0xfc00) >> 8];
+            at(opos++) = clamp_s16((at(ipos) * lut[0] + at(ipos + 1) * lut[1] +
+                                    at(ipos + 2) * lut[2] + at(ipos + 3) * lut[3]) >>
+                                   15);
+            pitch_accu += pitch;
+            ipos += pitch_accu >> 16;
+            pitch_accu &= 0xffff;
+        }
+
+        for (int i = 0; i < 4; i++)
+        {
+            dram_write16(address + i * 2, at(ipos + i));
+        }
+        dram_write16(address + 8, pitch_accu);
+        dram_written(address, 10);
+    }
+
+    void AudioHle::resample_zoh(uint16_t dmemo, uint16_t dmemi, uint16_t count, uint32_t pitch,
+                                uint32_t pitch_accu)
+    {
+        uint16_t opos = dmemo >> 1;
+        uint16_t ipos = dmemi >> 1;
+        for (count >>= 1; count != 0; --count)
+        {
+            buffer_[opos++ & 0x7FF] = buffer_[ipos & 0x7FF];
+            pitch_accu += pitch;
+            ipos += pitch_accu >> 16;
+            pitch_accu &= 0xffff;
+        }
+    }
+
+    void AudioHle::mix(uint16_t dmemo, uint16_t dmemi, uint16_t count, int16_t gain)
+    {
+        count &= ~1;
+        int16_t* dst = contiguous(dmemo, count);
+        int16_t* src = contiguous(dmemi, count);
+        if (dst && src)
+        {
+            size_t samples = count >> 1;
+            size_t i = 0;
+#if defined(__SSE2__)
+            __m128i gains = _mm_set1_epi16(gain);
+            for (; i + 8 <= samples; i += 8)
+            {
+                __m128i in = _mm_loadu_si128(reinterpret_cast<__m128i*>(src + i));
+                __m128i out = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst + i));
+                __m128i low = _mm_mullo_epi16(in, gains);
+                __m128i high = _mm_mulhi_epi16(in, gains);
+                __m128i product_lo = _mm_srai_epi32(_mm_unpacklo_epi16(low, high), 15);
+                __m128i product_hi = _mm_srai_epi32(_mm_unpackhi_epi16(low, high), 15);
+                __m128i out_lo = _mm_srai_epi32(_mm_unpacklo_epi16(out, out), 16);
+                __m128i out_hi = _mm_srai_epi32(_mm_unpackhi_epi16(out, out), 16);
+                out = _mm_packs_epi32(_mm_add_epi32(out_lo, product_lo),
+                                      _mm_add_epi32(out_hi, product_hi));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+            }
+#endif
+            for (; i < samples; i++)
+            {
+                dst[i] = clamp_s16(dst[i] + ((src[i] * gain) >> 15));
+            }
+            return;
+        }
+
+        for (; count != 0; count -= 2, dmemo += 2, dmemi += 2)
+        {
+            sample(dmemo) = clamp_s16(sample(dmemo) + ((sample(dmemi) * gain) >> 15));
+        }
+    }
+
+    void AudioHle::add(uint16_t dmemo, uint16_t dmemi, uint16_t count)
+    {
+        count &= ~1;
+        int16_t* dst = contiguous(dmemo, count);
+        int16_t* src = contiguous(dmemi, count);
+        if (dst && src)
+        {
+            size_t samples = count >> 1;
+            size_t i = 0;
+#if defined(__SSE2__)
+            for (; i + 8 <= samples; i += 8)
+            {
+                __m128i in = _mm_loadu_si128(reinterpret_cast<__m128i*>(src + i));
+                __m128i out = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_adds_epi16(out, in));
+            }
+#endif
+            for (; i < samples; i++)
+            {
+                dst[i] = clamp_s16(dst[i] + src[i]);
+            }
+            return;
+        }
+
+        for (; count != 0; count -= 2, dmemo += 2, dmemi += 2)
+        {
+            sample(dmemo) = clamp_s16(sample(dmemo) + sample(dmemi));
+        }
+    }
+
+    void AudioHle::multiply_q44(uint16_t dmem, uint16_t count, int8_t gain)
+    {
+        count &= ~1;
+        if (int16_t* dst = contiguous(dmem, count))
+        {
+            size_t samples = count >> 1;
+            size_t i = 0;
+#if defined(__SSE2__)
+            __m128i gains = _mm_set1_epi16(gain);
+            for (; i + 8 <= samples; i += 8)
+            {
+                __m128i in = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst + i));
+                __m128i low = _mm_mullo_epi16(in, gains);
+                __m128i high = _mm_mulhi_epi16(in, gains);
+                __m128i product_lo = _mm_srai_epi32(_mm_unpacklo_epi16(low, high), 4);
+                __m128i product_hi = _mm_srai_epi32(_mm_unpackhi_epi16(low, high), 4);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                                 _mm_packs_epi32(product_lo, product_hi));
+            }
+#endif
+            for (; i < samples; i++)
+            {
+                dst[i] = clamp_s16((dst[i] * gain) >> 4);
+            }
+            return;
+        }
+
+        for (; count != 0; count -= 2, dmem += 2)
+        {
+            sample(dmem) = clamp_s16((sample(dmem) * gain) >> 4);
+        }
+    }
+
+    void AudioHle::interleave(uint16_t dmemo, uint16_t left, uint16_t right, uint16_t count)
+    {
+        // count is the size of each channel, the output is twice as big
+        count &= ~3;
+        int16_t* dst = contiguous(dmemo, count * 2);
+        int16_t* src_left = contiguous(left, count);
+        int16_t* src_right = contiguous(right, count);
+        size_t samples = count >> 1;
+        auto disjoint = [dst, samples](const int16_t* src) {
+            return src + samples <= dst || dst + samples * 2 <= src;
+        };
+        if (dst && src_left && src_right && disjoint(src_left) && disjoint(src_right))
+        {
+            size_t i = 0;
+#if defined(__SSE2__)
+            for (; i + 8 <= samples; i += 8)
+            {
+                __m128i l = _mm_loadu_si128(reinterpret_cast<__m128i*>(src_left + i));
+                __m128i r = _mm_loadu_si128(reinterpret_cast<__m128i*>(src_right + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2),
+                                 _mm_unpacklo_epi16(l, r));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2 + 8),
+                                 _mm_unpackhi_epi16(l, r));
+            }
+#endif
+            for (; i < samples; i++)
+            {
+                dst[i * 2] = src_left[i];
+                dst[i * 2 + 1] = src_right[i];
+            }
+            return;
+        }
+
+        // The ucode reads two samples from each side before it writes four
+        for (count >>= 2; count != 0; --count)
+        {
+            int16_t l1 = sample(left), l2 = sample(left + 2);
+            int16_t r1 = sample(right), r2 = sample(right + 2);
+            sample(dmemo) = l1;
+            sample(dmemo + 2) = r1;
+            sample(dmemo + 4) = l2;
+            sample(dmemo + 6) = r2;
+            left += 4;
+            right += 4;
+            dmemo += 8;
+        }
+    }
+
+    void AudioHle::copy_every_other_sample(uint16_t dmemo, uint16_t dmemi, uint16_t count)
+    {
+        for (; count != 0; --count, dmemo += 2, dmemi += 4)
+        {
+            sample(dmemo) = sample(dmemi);
+        }
+    }
+
+    void AudioHle::repeat64(uint16_t dmemo, uint16_t dmemi, uint8_t count)
+    {
+        std::array<int16_t, 64> block;
+        for (int i = 0; i < 64; i++)
+        {
+            block[i] = sample(dmemi + i * 2);
+        }
+        for (; count != 0; --count)
+        {
+            for (int i = 0; i < 64; i++, dmemo += 2)
+            {
+                sample(dmemo) = block[i];
+            }
+        }
+    }
+
+    void AudioHle::copy_blocks(uint16_t dmemo, uint16_t dmemi, uint16_t block_size,
+                               uint8_t count)
+    {
+        int blocks_left = count;
+        do
+        {
+            int bytes_left = block_size;
+            uint16_t source = dmemi;
+            do
+            {
+                move(dmemo, source, 0x20);
+                bytes_left -= 0x20;
+                source += 0x20;
+                dmemo += 0x20;
+            } while (bytes_left > 0);
+        } while (--blocks_left > 0);
+    }
+
+    void AudioHle::polef(bool init, uint16_t dmemo, uint16_t dmemi, uint16_t count,
+                         uint16_t gain, uint32_t address)
+    {
+        const int16_t* h1 = &codebook_[0];
+        int16_t* h2 = &codebook_[8];
+        std::array<int16_t, 8> h2_before;
+        int16_t l1 = 0, l2 = 0;
+        int16_t sgain = static_cast<int16_t>(gain);
+
+        count = align(count, 16);
+        if (!init)
+        {
+            l1 = dram_read16(address + 4);
+            l2 = dram_read16(address + 6);
+        }
+
+        // The ucode scales the coefficients in place, later tasks see the scaled ones
+        for (int i = 0; i < 8; i++)
+        {
+            h2_before[i] = h2[i];
+            h2[i] = static_cast<int16_t>((h2[i] * sgain) >> 14);
+        }
+
+        std::array<int16_t, 8> out{};
+        while (count != 0)
+        {
+            std::array<int16_t, 8> frame;
+            for (int i = 0; i < 8; i++, dmemi += 2)
+            {
+                frame[i] = sample(dmemi);
+            }
+            for (size_t i = 0; i < 8; i++)
+            {
+                int32_t accu = frame[i] * sgain;
+                accu += h1[i] * l1 + h2_before[i] * l2 + rdot(i, h2, &frame[0]);
+                out[i] = clamp_s16(accu >> 14);
+            }
+            for (int i = 0; i < 8; i++, dmemo += 2)
+            {
+                sample(dmemo) = out[i];
+            }
+            l1 = out[6];
+            l2 = out[7];
+            count -= 16;
+        }
+
+        for (int i = 0; i < 4; i++)
+        {
+            dram_write16(address + i * 2, out[4 + i]);
+        }
+        dram_written(address, 8);
+    }
+
+    void AudioHle::filter(uint16_t dmem, uint16_t count, uint32_t address)
+    {
+        std::array<int16_t, 8> lut;
+        for (int i = 0; i < 8; i++)
+        {
+            int16_t t6 = dram_read16(filter_lut_address_[0] + i * 2);
+            int16_t t5 = dram_read16(filter_lut_address_[1] + i * 2);
+            lut[i] = static_cast<int16_t>((t5 + t6) >> 1);
+        }
+        for (int i = 0; i < 8; i++)
+        {
+            dram_write16(filter_lut_address_[0] + i * 2, lut[i]);
+            dram_write16(filter_lut_address_[1] + i * 2, lut[i]);
+        }
+        dram_written(filter_lut_address_[0], 16);
+        dram_written(filter_lut_address_[1], 16);
+
+        // Eight tap FIR filter with the history of the previous call in front of the input.
+        // The count comes from the guest, more samples than DMEM holds would only wrap around
+        size_t samples = std::min<size_t>((count >> 1) & ~7, 0x800);
+        std::array<int16_t, 8 + 0x800> history;
+        for (int i = 0; i < 8; i++)
+        {
+            history[i] = dram_read16(address + i * 2);
+        }
+        for (size_t i = 0; i < samples; i++)
+        {
+            history[8 + i] = sample(static_cast<uint16_t>(dmem + i * 2));
+        }
+        for (size_t i = 0; i < samples; i++)
+        {
+            int32_t accu = 0x4000;
+            for (size_t k = 0; k < 8; k++)
+            {
+                accu += history[8 + i - k] * lut[k];
+            }
+            sample(static_cast<uint16_t>(dmem + i * 2)) = clamp_s16(accu >> 15);
+        }
+        for (int i = 0; i < 8; i++)
+        {
+            dram_write16(address + i * 2, history[samples + i]);
+        }
+        dram_written(address, 16);
+    }
+
+    namespace
+    {
+        // Envelope state kept in RDRAM between tasks, the layout is our own
+        struct EnvelopeState
+        {
+            int16_t wet, dry;
+            std::array<Ramp, 2> ramps;
+            std::array<int32_t, 2> exp_seq, exp_rates;
+        };
+    } // namespace
+
+#define ENVELOPE_LOAD()                                               \
+    EnvelopeState state;                                              \
+    state.wet = dram_read16(address);                                 \
+    state.dry = dram_read16(address + 2);                             \
+    state.ramps[0].target = dram_read32(address + 4);                 \
+    state.ramps[1].target = dram_read32(address + 8);                 \
+    state.exp_rates[0] = state.ramps[0].step = dram_read32(address + 12); \
+    state.exp_rates[1] = state.ramps[1].step = dram_read32(address + 16); \
+    state.exp_seq[0] = dram_read32(address + 20);                     \
+    state.exp_seq[1] = dram_read32(address + 24);                     \
+    state.ramps[0].value = dram_read32(address + 28);                 \
+    state.ramps[1].value = dram_read32(address + 32)
+
+#define ENVELOPE_SAVE(rate0, rate1)                   \
+    dram_write16(address, state.wet);                 \
+    dram_write16(address + 2, state.dry);             \
+    dram_write32(address + 4, state.ramps[0].target); \
+    dram_write32(address + 8, state.ramps[1].target); \
+    dram_write32(address + 12, rate0);                \
+    dram_write32(address + 16, rate1);                \
+    dram_write32(address + 20, state.exp_seq[0]);     \
+    dram_write32(address + 24, state.exp_seq[1]);     \
+    dram_write32(address + 28, state.ramps[0].value); \
+    dram_write32(address + 32, state.ramps[1].value); \
+    dram_written(address, 36)
+
+    void AudioHle::envmix_exp(bool init, bool aux, uint16_t dmem_dl, uint16_t dmem_dr,
+                              uint16_t dmem_wl, uint16_t dmem_wr, uint16_t dmemi, uint16_t count,
+                              uint32_t address)
+    {
+        ENVELOPE_LOAD();
+        if (init)
+        {
+            state.wet = wet_;
+            state.dry = dry_;
+            for (int i = 0; i < 2; i++)
+            {
+                state.ramps[i].value = volume_[i] << 16;
+                state.ramps[i].target = target_[i] << 16;
+                state.exp_rates[i] = rate_[i];
+                state.exp_seq[i] = static_cast<int32_t>(static_cast<int64_t>(volume_[i]) *
+                                                        rate_[i]);
+            }
+        }
+
+        // A step of zero means the target is already reached
+        for (int i = 0; i < 2; i++)
+        {
+            state.ramps[i].step = state.ramps[i].target - state.ramps[i].value;
+        }
+
+        for (uint16_t y = 0; y < count; y += 16)
+        {
+            for (int i = 0; i < 2; i++)
+            {
+                if (state.ramps[i].step != 0)
+                {
+                    state.exp_seq[i] = (static_cast<int64_t>(state.exp_seq[i]) *
+                                        state.exp_rates[i]) >>
+                                       16;
+                    state.ramps[i].step = (state.exp_seq[i] - state.ramps[i].value) >> 3;
+                }
+            }
+
+            for (int x = 0; x < 8; x++, dmemi += 2, dmem_dl += 2, dmem_dr += 2, dmem_wl += 2,
+                     dmem_wr += 2)
+            {
+                int16_t l_vol = state.ramps[0].Step();
+                int16_t r_vol = state.ramps[1].Step();
+                int16_t in = sample(dmemi);
+                auto accumulate = [this, in](uint16_t dmem, int32_t volume, int32_t gain) {
+                    int16_t scaled = clamp_s16((volume * gain + 0x4000) >> 15);
+                    sample(dmem) = clamp_s16(sample(dmem) + ((in * scaled) >> 15));
+                };
+                accumulate(dmem_dl, l_vol, state.dry);
+                accumulate(dmem_dr, r_vol, state.dry);
+                if (aux)
+                {
+                    accumulate(dmem_wl, l_vol, state.wet);
+                    accumulate(dmem_wr, r_vol, state.wet);
+                }
+            }
+        }
+
+        ENVELOPE_SAVE(state.exp_rates[0], state.exp_rates[1]);
+    }
+
+    void AudioHle::envmix_lin(bool init, bool aux, uint16_t dmem_dl, uint16_t dmem_dr,
+                              uint16_t dmem_wl, uint16_t dmem_wr, uint16_t dmemi, uint16_t count,
+                              uint32_t address)
+    {
+        ENVELOPE_LOAD();
+        if (init)
+        {
+            state.wet = wet_;
+            state.dry = dry_;
+            for (int i = 0; i < 2; i++)
+            {
+                state.ramps[i].value = volume_[i] << 16;
+                state.ramps[i].target = target_[i] << 16;
+                state.ramps[i].step = rate_[i] / 8;
+                state.exp_seq[i] = 0;
+            }
+        }
+
+        for (count >>= 1; count != 0; --count, dmemi += 2, dmem_dl += 2, dmem_dr += 2,
+                                      dmem_wl += 2, dmem_wr += 2)
+        {
+            int16_t l_vol = state.ramps[0].Step();
+            int16_t r_vol = state.ramps[1].Step();
+            int16_t in = sample(dmemi);
+            auto accumulate = [this, in](uint16_t dmem, int32_t volume, int32_t gain) {
+                int16_t scaled = clamp_s16((volume * gain + 0x4000) >> 15);
+                sample(dmem) = clamp_s16(sample(dmem) + ((in * scaled) >> 15));
+            };
+            accumulate(dmem_dl, l_vol, state.dry);
+            accumulate(dmem_dr, r_vol, state.dry);
+            if (aux)
+            {
+                accumulate(dmem_wl, l_vol, state.wet);
+                accumulate(dmem_wr, r_vol, state.wet);
+            }
+        }
+
+        ENVELOPE_SAVE(state.ramps[0].step, state.ramps[1].step);
+    }
+
+#undef ENVELOPE_LOAD
+#undef ENVELOPE_SAVE
+
+    void AudioHle::envmix_nead(bool swap_wet_lr, uint16_t dmem_dl, uint16_t dmem_dr,
+                               uint16_t dmem_wl, uint16_t dmem_wr, uint16_t dmemi, unsigned count,
+                               const std::array<int16_t, 4>& xors)
+    {
+        if (swap_wet_lr)
+        {
+            std::swap(dmem_wl, dmem_wr);
+        }
+
+        // Signed sample times unsigned envelope, keeping the top half of the product
+        auto scale = [](int16_t value, uint16_t envelope) -> int16_t {
+            return static_cast<int16_t>((static_cast<uint32_t>(value) * envelope) >> 16);
+        };
+
+        for (count = (count + 7) & ~7; count != 0; count -= 8)
+        {
+            int16_t* in = contiguous(dmemi, 16);
+            int16_t* dl = contiguous(dmem_dl, 16);
+            int16_t* dr = contiguous(dmem_dr, 16);
+            int16_t* wl = contiguous(dmem_wl, 16);
+            int16_t* wr = contiguous(dmem_wr, 16);
+#if defined(__SSE2__)
+            if (in && dl && dr && wl && wr)
+            {
+                // mulhi is signed, adding the sample back when the envelope's top bit is set
+                // turns it into a signed by unsigned multiply
+                auto scale_simd = [](__m128i value, uint16_t envelope) {
+                    __m128i env = _mm_set1_epi16(static_cast<int16_t>(envelope));
+                    __m128i high = _mm_mulhi_epi16(value, env);
+                    return _mm_add_epi16(high, _mm_and_si128(_mm_srai_epi16(env, 15), value));
+                };
+                auto accumulate = [](int16_t* dst, __m128i value) {
+                    __m128i out = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_adds_epi16(out, value));
+                };
+                __m128i samples = _mm_loadu_si128(reinterpret_cast<__m128i*>(in));
+                __m128i l = _mm_xor_si128(scale_simd(samples, env_values_[0]),
+                                          _mm_set1_epi16(xors[0]));
+                __m128i r = _mm_xor_si128(scale_simd(samples, env_values_[1]),
+                                          _mm_set1_epi16(xors[1]));
+                __m128i l2 =
+                    _mm_xor_si128(scale_simd(l, env_values_[2]), _mm_set1_epi16(xors[2]));
+                __m128i r2 =
+                    _mm_xor_si128(scale_simd(r, env_values_[2]), _mm_set1_epi16(xors[3]));
+                accumulate(dl, l);
+                accumulate(dr, r);
+                accumulate(wl, l2);
+                accumulate(wr, r2);
+            }
+            else
+#endif
+            {
+                for (int i = 0; i < 8; i++)
+                {
+                    int16_t input = sample(dmemi + i * 2);
+                    int16_t l = scale(input, env_values_[0]) ^ xors[0];
+                    int16_t r = scale(input, env_values_[1]) ^ xors[1];
+                    int16_t l2 = scale(l, env_values_[2]) ^ xors[2];
+                    int16_t r2 = scale(r, env_values_[2]) ^ xors[3];
+                    sample(dmem_dl + i * 2) = clamp_s16(sample(dmem_dl + i * 2) + l);
+                    sample(dmem_dr + i * 2) = clamp_s16(sample(dmem_dr + i * 2) + r);
+                    sample(dmem_wl + i * 2) = clamp_s16(sample(dmem_wl + i * 2) + l2);
+                    sample(dmem_wr + i * 2) = clamp_s16(sample(dmem_wr + i * 2) + r2);
+                }
+            }
+
+            for (int i = 0; i < 3; i++)
+            {
+                env_values_[i] += env_steps_[i];
+            }
+            dmemi += 16;
+            dmem_dl += 16;
+            dmem_dr += 16;
+            dmem_wl += 16;
+            dmem_wr += 16;
+        }
+    }
+
+    void AudioHle::SPNOOP(uint32_t, uint32_t) {}
+
+    void AudioHle::UNKNOWN(uint32_t w1, uint32_t w2)
+    {
+        Logger::WarnOnce("Audio HLE: unknown command {:08x} {:08x}", w1, w2);
+    }
+
+    // ABI1
+
+    void AudioHle::a_ADPCM(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        adpcm(flags & A_INIT, flags & A_LOOP, false, out_, in_, align(count_, 32),
+              segment_address(w2));
+    }
+
+    void AudioHle::a_CLEARBUFF(uint32_t w1, uint32_t w2)
+    {
+        uint16_t count = w2;
+        if (count != 0)
+        {
+            clear(w1 + DMEM_BASE, align(count, 16));
+        }
+    }
+
+    void AudioHle::a_ENVMIXER(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        envmix_exp(flags & A_INIT, flags & A_AUX, out_, dry_right_, wet_left_, wet_right_, in_,
+                   count_, segment_address(w2));
+    }
+
+    void AudioHle::a_ENVMIXER_GE(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        envmix_lin(flags & A_INIT, flags & A_AUX, out_, dry_right_, wet_left_, wet_right_, in_,
+                   count_, segment_address(w2));
+    }
+
+    void AudioHle::a_LOADBUFF(uint32_t, uint32_t w2)
+    {
+        if (count_ != 0)
+        {
+            load(in_, segment_address(w2), count_);
+        }
+    }
+
+    void AudioHle::a_RESAMPLE(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        uint16_t pitch = w1;
+        resample(flags & A_INIT, out_, in_, align(count_, 16), pitch << 1, segment_address(w2));
+    }
+
+    void AudioHle::a_SAVEBUFF(uint32_t, uint32_t w2)
+    {
+        if (count_ != 0)
+        {
+            save(out_, segment_address(w2), count_);
+        }
+    }
+
+    void AudioHle::a_SEGMENT(uint32_t, uint32_t w2)
+    {
+        uint32_t segment = (w2 >> 24) & 0x3f;
+        if (segment >= segments_.size())
+        {
+            Logger::WarnOnce("Audio HLE: invalid segment {}", segment);
+            return;
+        }
+        segments_[segment] = w2 & 0xffffff;
+    }
+
+    void AudioHle::a_SETBUFF(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        if (flags & A_AUX)
+        {
+            dry_right_ = w1 + DMEM_BASE;
+            wet_left_ = (w2 >> 16) + DMEM_BASE;
+            wet_right_ = w2 + DMEM_BASE;
+        }
+        else
+        {
+            in_ = w1 + DMEM_BASE;
+            out_ = (w2 >> 16) + DMEM_BASE;
+            count_ = w2;
+        }
+    }
+
+    void AudioHle::a_SETVOL(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        if (flags & A_AUX)
+        {
+            dry_ = w1;
+            wet_ = w2;
+        }
+        else
+        {
+            int lr = (flags & A_LEFT) ? 0 : 1;
+            if (flags & A_VOL)
+            {
+                volume_[lr] = w1;
+            }
+            else
+            {
+                target_[lr] = w1;
+                rate_[lr] = w2;
+            }
+        }
+    }
+
+    void AudioHle::a_DMEMMOVE(uint32_t w1, uint32_t w2)
+    {
+        uint16_t count = w2;
+        if (count != 0)
+        {
+            move((w2 >> 16) + DMEM_BASE, w1 + DMEM_BASE, align(count, 16));
+        }
+    }
+
+    void AudioHle::a_LOADADPCM(uint32_t w1, uint32_t w2)
+    {
+        load_codebook(segment_address(w2), align(w1 & 0xffff, 8));
+    }
+
+    void AudioHle::a_MIXER(uint32_t w1, uint32_t w2)
+    {
+        if (count_ != 0)
+        {
+            mix(w2 + DMEM_BASE, (w2 >> 16) + DMEM_BASE, count_, w1);
+        }
+    }
+
+    void AudioHle::a_INTERLEAVE(uint32_t, uint32_t w2)
+    {
+        if (count_ != 0)
+        {
+            interleave(out_, (w2 >> 16) + DMEM_BASE, w2 + DMEM_BASE, count_);
+        }
+    }
+
+    void AudioHle::a_POLEF(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        if (count_ != 0)
+        {
+            polef(flags & A_INIT, out_, in_, count_, w1, segment_address(w2));
+        }
+    }
+
+    void AudioHle::a_SETLOOP(uint32_t, uint32_t w2)
+    {
+        loop_ = segment_address(w2);
+    }
+
+    // naudio, the game visible buffers start after the fixed ones
+
+    void AudioHle::n_ADPCM(uint32_t w1, uint32_t w2)
+    {
+        uint32_t address = w1 & 0xffffff;
+        uint8_t flags = w2 >> 28;
+        uint16_t count = (w2 >> 16) & 0xfff;
+        uint16_t dmemi = (w2 & 0xfff) + NAUDIO_COUNT;
+        adpcm(flags & A_INIT, flags & A_LOOP, false, NAUDIO_MAIN, dmemi, align(count, 32),
+              address);
+    }
+
+    void AudioHle::n_CLEARBUFF(uint32_t w1, uint32_t w2)
+    {
+        clear((w1 & 0xffff) + NAUDIO_COUNT, w2 & 0xfff);
+    }
+
+    void AudioHle::n_ENVMIXER(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        envmix_lin(flags & A_INIT, true, NAUDIO_DRY_LEFT, NAUDIO_DRY_RIGHT, NAUDIO_WET_LEFT,
+                   NAUDIO_WET_RIGHT, NAUDIO_MAIN, NAUDIO_COUNT, w2 & 0xffffff);
+    }
+
+    void AudioHle::n_LOADBUFF(uint32_t w1, uint32_t w2)
+    {
+        load((w1 & 0xfff) + NAUDIO_COUNT, w2 & 0xffffff, (w1 >> 12) & 0xfff);
+    }
+
+    void AudioHle::n_RESAMPLE(uint32_t w1, uint32_t w2)
+    {
+        uint32_t address = w1 & 0xffffff;
+        uint8_t flags = w2 >> 30;
+        uint16_t pitch = w2 >> 14;
+        uint16_t dmemi = ((w2 >> 2) & 0xfff) + NAUDIO_COUNT;
+        uint16_t dmemo = (w2 & 0x3) ? NAUDIO_MAIN2 : NAUDIO_MAIN;
+        resample(flags & A_INIT, dmemo, dmemi, NAUDIO_COUNT, pitch << 1, address);
+    }
+
+    void AudioHle::n_SAVEBUFF(uint32_t w1, uint32_t w2)
+    {
+        save((w1 & 0xfff) + NAUDIO_COUNT, w2 & 0xffffff, (w1 >> 12) & 0xfff);
+    }
+
+    void AudioHle::n_SETVOL(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        if (flags & A_VOL)
+        {
+            if (flags & A_LEFT)
+            {
+                volume_[0] = w1;
+                dry_ = w2 >> 16;
+                wet_ = w2;
+            }
+            else
+            {
+                target_[1] = w1;
+                rate_[1] = w2;
+            }
+        }
+        else
+        {
+            target_[0] = w1;
+            rate_[0] = w2;
+        }
+    }
+
+    void AudioHle::n_DMEMMOVE(uint32_t w1, uint32_t w2)
+    {
+        uint16_t dmemi = (w1 & 0xffff) + NAUDIO_COUNT;
+        uint16_t dmemo = (w2 >> 16) + NAUDIO_COUNT;
+        move(dmemo, dmemi, align(w2 & 0xffff, 4));
+    }
+
+    void AudioHle::n_LOADADPCM(uint32_t w1, uint32_t w2)
+    {
+        load_codebook(w2 & 0xffffff, w1 & 0xffff);
+    }
+
+    void AudioHle::n_MIXER(uint32_t w1, uint32_t w2)
+    {
+        mix((w2 & 0xffff) + NAUDIO_COUNT, (w2 >> 16) + NAUDIO_COUNT, NAUDIO_COUNT, w1);
+    }
+
+    void AudioHle::n_INTERLEAVE(uint32_t, uint32_t)
+    {
+        interleave(NAUDIO_MAIN, NAUDIO_DRY_LEFT, NAUDIO_DRY_RIGHT, NAUDIO_COUNT);
+    }
+
+    void AudioHle::n_02B0(uint32_t, uint32_t w2)
+    {
+        // Jumps into the middle of SETVOL to only replace the low half of the right rate
+        rate_[1] = (rate_[1] & ~0xffff) | (w2 & 0xffff);
+    }
+
+    void AudioHle::n_SETLOOP(uint32_t, uint32_t w2)
+    {
+        loop_ = w2 & 0xffffff;
+    }
+
+    // nead
+
+    void AudioHle::e_ADPCM(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        adpcm(flags & A_INIT, flags & A_LOOP, flags & 0x4, out_, in_, align(count_, 32),
+              w2 & 0xffffff);
+    }
+
+    void AudioHle::e_CLEARBUFF(uint32_t w1, uint32_t w2)
+    {
+        uint16_t count = w2 & 0xfff;
+        if (count != 0)
+        {
+            clear(w1, count);
+        }
+    }
+
+    void AudioHle::e_ADDMIXER(uint32_t w1, uint32_t w2)
+    {
+        add(w2, w2 >> 16, (w1 >> 12) & 0xff0);
+    }
+
+    void AudioHle::e_RESAMPLE(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        uint16_t pitch = w1;
+        resample(flags & A_INIT, out_, in_, align(count_, 16), pitch << 1, w2 & 0xffffff);
+    }
+
+    void AudioHle::e_RESAMPLE_ZOH(uint32_t w1, uint32_t w2)
+    {
+        uint16_t pitch = w1;
+        uint16_t pitch_accu = w2;
+        resample_zoh(out_, in_, count_, pitch << 1, pitch_accu);
+    }
+
+    void AudioHle::e_FILTER(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        uint32_t address = w2 & 0xffffff;
+        if (flags > 1)
+        {
+            filter_count_ = w1;
+            filter_lut_address_[0] = address;
+        }
+        else
+        {
+            filter_lut_address_[1] = address + 0x10;
+            filter(w1, filter_count_, address);
+        }
+    }
+
+    void AudioHle::e_SETBUFF(uint32_t w1, uint32_t w2)
+    {
+        in_ = w1;
+        out_ = w2 >> 16;
+        count_ = w2;
+    }
+
+    void AudioHle::e_DUPLICATE(uint32_t w1, uint32_t w2)
+    {
+        repeat64(w2 >> 16, w1, w1 >> 16);
+    }
+
+    void AudioHle::e_DMEMMOVE(uint32_t w1, uint32_t w2)
+    {
+        uint16_t count = w2;
+        if (count != 0)
+        {
+            move(w2 >> 16, w1, align(count, 4));
+        }
+    }
+
+    void AudioHle::e_LOADADPCM(uint32_t w1, uint32_t w2)
+    {
+        load_codebook(w2 & 0xffffff, w1 & 0xffff);
+    }
+
+    void AudioHle::e_MIXER(uint32_t w1, uint32_t w2)
+    {
+        mix(w2, w2 >> 16, (w1 >> 12) & 0xff0, w1);
+    }
+
+    void AudioHle::e_INTERLEAVE(uint32_t w1, uint32_t w2)
+    {
+        interleave(w1, w2 >> 16, w2, (w1 >> 12) & 0xff0);
+    }
+
+    void AudioHle::e_INTERLEAVE_MK(uint32_t, uint32_t w2)
+    {
+        if (count_ != 0)
+        {
+            interleave(out_, w2 >> 16, w2, count_);
+        }
+    }
+
+    void AudioHle::e_HILOGAIN(uint32_t w1, uint32_t w2)
+    {
+        multiply_q44(w2 >> 16, w1 & 0xfff, static_cast<int8_t>(w1 >> 16));
+    }
+
+    void AudioHle::e_SETLOOP(uint32_t, uint32_t w2)
+    {
+        loop_ = w2 & 0xffffff;
+    }
+
+    void AudioHle::e_COPYBLOCKS(uint32_t w1, uint32_t w2)
+    {
+        copy_blocks(w2 >> 16, w1, w2, w1 >> 16);
+    }
+
+    void AudioHle::e_INTERL(uint32_t w1, uint32_t w2)
+    {
+        copy_every_other_sample(w2, w2 >> 16, w1);
+    }
+
+    void AudioHle::e_ENVSETUP1(uint32_t w1, uint32_t w2)
+    {
+        env_values_[2] = (w1 >> 8) & 0xff00;
+        env_steps_[2] = w1;
+        env_steps_[0] = w2 >> 16;
+        env_steps_[1] = w2;
+    }
+
+    void AudioHle::e_ENVSETUP1_MK(uint32_t w1, uint32_t w2)
+    {
+        env_values_[2] = (w1 >> 8) & 0xff00;
+        env_steps_[2] = 0;
+        env_steps_[0] = w2 >> 16;
+        env_steps_[1] = w2;
+    }
+
+    void AudioHle::e_ENVSETUP2(uint32_t, uint32_t w2)
+    {
+        env_values_[0] = w2 >> 16;
+        env_values_[1] = w2;
+    }
+
+    void AudioHle::e_ENVMIXER(uint32_t w1, uint32_t w2)
+    {
+        std::array<int16_t, 4> xors = {
+            static_cast<int16_t>(-((w1 >> 1) & 1)),
+            static_cast<int16_t>(-(w1 & 1)),
+            static_cast<int16_t>(-((w1 >> 3) & 1)),
+            static_cast<int16_t>(-((w1 >> 2) & 1)),
+        };
+        envmix_nead((w1 >> 4) & 1, (w2 >> 20) & 0xff0, (w2 >> 12) & 0xff0, (w2 >> 4) & 0xff0,
+                    (w2 << 4) & 0xff0, (w1 >> 12) & 0xff0, (w1 >> 8) & 0xff, xors);
+    }
+
+    void AudioHle::e_ENVMIXER_MK(uint32_t w1, uint32_t w2)
+    {
+        std::array<int16_t, 4> xors = {
+            static_cast<int16_t>(-((w1 >> 1) & 1)),
+            static_cast<int16_t>(-(w1 & 1)),
+            0,
+            0,
+        };
+        envmix_nead(false, (w2 >> 20) & 0xff0, (w2 >> 12) & 0xff0, (w2 >> 4) & 0xff0,
+                    (w2 << 4) & 0xff0, (w1 >> 12) & 0xff0, (w1 >> 8) & 0xff, xors);
+    }
+
+    void AudioHle::e_LOADBUFF(uint32_t w1, uint32_t w2)
+    {
+        load(w1 & 0xfff, w2 & 0xffffff, (w1 >> 12) & 0xfff);
+    }
+
+    void AudioHle::e_SAVEBUFF(uint32_t w1, uint32_t w2)
+    {
+        save(w1 & 0xfff, w2 & 0xffffff, (w1 >> 12) & 0xfff);
+    }
+
+    void AudioHle::e_POLEF(uint32_t w1, uint32_t w2)
+    {
+        uint8_t flags = w1 >> 16;
+        if (count_ != 0)
+        {
+            polef(flags & A_INIT, out_, in_, count_, w1, w2 & 0xffffff);
+        }
+    }
+} // namespace hydra::N64
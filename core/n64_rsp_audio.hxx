@@ -0,0 +1,270 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+namespace hydra::N64
+{
+    // Audio microcode families that can run without the RSP, most of them only differ in
+    // their command tables
+    enum class AudioUcode
+    {
+        Unknown,
+        Abi1,
+        Abi1Ge,
+        NAudio,
+        NAudioDk,
+        NeadMk,
+        NeadSf,
+        NeadSfj,
+        NeadFz,
+        NeadWrjb,
+        NeadZelda,
+    };
+
+    // Identifies the audio microcode from the signature words in its data section
+    AudioUcode identify_audio_ucode(const uint8_t* rdram, uint32_t ucode_data);
+    const char* audio_ucode_name(AudioUcode ucode);
+
+    class AudioHle;
+    using AudioCommand = void (*)(AudioHle*, uint32_t, uint32_t);
+
+    template <auto MemberFunc>
+    static void audio_command(AudioHle* hle, uint32_t w1, uint32_t w2)
+    {
+        (hle->*MemberFunc)(w1, w2);
+    }
+
+    /**
+        Runs the command lists of audio tasks natively
+
+        The microcodes keep their samples in a 4 KiB scratch area in DMEM that nothing else
+        looks at, so it's emulated by a private buffer in host byte order. Only the buffers the
+        commands save and the state they keep between tasks end up in RDRAM
+    */
+    class AudioHle final
+    {
+    public:
+        void InstallBuses(uint8_t* rdram_ptr);
+        void SetRdramWriteCallback(std::function<void(uint32_t, uint32_t)> callback);
+        void Reset();
+        // Returns false if the microcode isn't known, in which case the task has to run on
+        // the RSP
+        bool RunTask(uint32_t ucode_data, uint32_t data_ptr, uint32_t data_size);
+
+    private:
+        void SPNOOP(uint32_t w1, uint32_t w2), UNKNOWN(uint32_t w1, uint32_t w2);
+
+        // ABI1, the original audio microcode
+        void a_ADPCM(uint32_t w1, uint32_t w2), a_CLEARBUFF(uint32_t w1, uint32_t w2),
+            a_ENVMIXER(uint32_t w1, uint32_t w2), a_ENVMIXER_GE(uint32_t w1, uint32_t w2),
+            a_LOADBUFF(uint32_t w1, uint32_t w2), a_RESAMPLE(uint32_t w1, uint32_t w2),
+            a_SAVEBUFF(uint32_t w1, uint32_t w2), a_SEGMENT(uint32_t w1, uint32_t w2),
+            a_SETBUFF(uint32_t w1, uint32_t w2), a_SETVOL(uint32_t w1, uint32_t w2),
+            a_DMEMMOVE(uint32_t w1, uint32_t w2), a_LOADADPCM(uint32_t w1, uint32_t w2),
+            a_MIXER(uint32_t w1, uint32_t w2), a_INTERLEAVE(uint32_t w1, uint32_t w2),
+            a_POLEF(uint32_t w1, uint32_t w2), a_SETLOOP(uint32_t w1, uint32_t w2);
+
+        // naudio, which works on fixed buffers
+        void n_ADPCM(uint32_t w1, uint32_t w2), n_CLEARBUFF(uint32_t w1, uint32_t w2),
+            n_ENVMIXER(uint32_t w1, uint32_t w2), n_LOADBUFF(uint32_t w1, uint32_t w2),
+            n_RESAMPLE(uint32_t w1, uint32_t w2), n_SAVEBUFF(uint32_t w1, uint32_t w2),
+            n_SETVOL(uint32_t w1, uint32_t w2), n_DMEMMOVE(uint32_t w1, uint32_t w2),
+            n_LOADADPCM(uint32_t w1, uint32_t w2), n_MIXER(uint32_t w1, uint32_t w2),
+            n_INTERLEAVE(uint32_t w1, uint32_t w2), n_02B0(uint32_t w1, uint32_t w2),
+            n_SETLOOP(uint32_t w1, uint32_t w2);
+
+        // nead, also known as ABI2
+        void e_ADPCM(uint32_t w1, uint32_t w2), e_CLEARBUFF(uint32_t w1, uint32_t w2),
+            e_ADDMIXER(uint32_t w1, uint32_t w2), e_RESAMPLE(uint32_t w1, uint32_t w2),
+            e_RESAMPLE_ZOH(uint32_t w1, uint32_t w2), e_FILTER(uint32_t w1, uint32_t w2),
+            e_SETBUFF(uint32_t w1, uint32_t w2), e_DUPLICATE(uint32_t w1, uint32_t w2),
+            e_DMEMMOVE(uint32_t w1, uint32_t w2), e_LOADADPCM(uint32_t w1, uint32_t w2),
+            e_MIXER(uint32_t w1, uint32_t w2), e_INTERLEAVE(uint32_t w1, uint32_t w2),
+            e_INTERLEAVE_MK(uint32_t w1, uint32_t w2), e_HILOGAIN(uint32_t w1, uint32_t w2),
+            e_SETLOOP(uint32_t w1, uint32_t w2), e_COPYBLOCKS(uint32_t w1, uint32_t w2),
+            e_INTERL(uint32_t w1, uint32_t w2), e_ENVSETUP1(uint32_t w1, uint32_t w2),
+            e_ENVSETUP1_MK(uint32_t w1, uint32_t w2), e_ENVMIXER(uint32_t w1, uint32_t w2),
+            e_ENVMIXER_MK(uint32_t w1, uint32_t w2), e_LOADBUFF(uint32_t w1, uint32_t w2),
+            e_SAVEBUFF(uint32_t w1, uint32_t w2), e_ENVSETUP2(uint32_t w1, uint32_t w2),
+            e_POLEF(uint32_t w1, uint32_t w2);
+
+        using CommandTable = std::array<AudioCommand, 32>;
+
+#define cmd(x) &audio_command<&AudioHle::x>
+        constexpr static CommandTable abi1_table_ = {
+            cmd(SPNOOP),     cmd(a_ADPCM),   cmd(a_CLEARBUFF), cmd(a_ENVMIXER),
+            cmd(a_LOADBUFF), cmd(a_RESAMPLE), cmd(a_SAVEBUFF), cmd(a_SEGMENT),
+            cmd(a_SETBUFF),  cmd(a_SETVOL),  cmd(a_DMEMMOVE), cmd(a_LOADADPCM),
+            cmd(a_MIXER),    cmd(a_INTERLEAVE), cmd(a_POLEF), cmd(a_SETLOOP),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+        };
+
+        constexpr static CommandTable abi1_ge_table_ = {
+            cmd(SPNOOP),     cmd(a_ADPCM),   cmd(a_CLEARBUFF), cmd(a_ENVMIXER_GE),
+            cmd(a_LOADBUFF), cmd(a_RESAMPLE), cmd(a_SAVEBUFF), cmd(a_SEGMENT),
+            cmd(a_SETBUFF),  cmd(a_SETVOL),  cmd(a_DMEMMOVE), cmd(a_LOADADPCM),
+            cmd(a_MIXER),    cmd(a_INTERLEAVE), cmd(a_POLEF), cmd(a_SETLOOP),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+        };
+
+        constexpr static CommandTable naudio_table_ = {
+            cmd(SPNOOP),     cmd(n_ADPCM),   cmd(n_CLEARBUFF), cmd(n_ENVMIXER),
+            cmd(n_LOADBUFF), cmd(n_RESAMPLE), cmd(n_SAVEBUFF), cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(n_SETVOL),  cmd(n_DMEMMOVE), cmd(n_LOADADPCM),
+            cmd(n_MIXER),    cmd(n_INTERLEAVE), cmd(n_02B0),  cmd(n_SETLOOP),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+        };
+
+        constexpr static CommandTable naudio_dk_table_ = {
+            cmd(SPNOOP),     cmd(n_ADPCM),   cmd(n_CLEARBUFF), cmd(n_ENVMIXER),
+            cmd(n_LOADBUFF), cmd(n_RESAMPLE), cmd(n_SAVEBUFF), cmd(n_MIXER),
+            cmd(n_MIXER),    cmd(n_SETVOL),  cmd(n_DMEMMOVE), cmd(n_LOADADPCM),
+            cmd(n_MIXER),    cmd(n_INTERLEAVE), cmd(n_02B0),  cmd(n_SETLOOP),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+            cmd(UNKNOWN),    cmd(UNKNOWN),   cmd(UNKNOWN),    cmd(UNKNOWN),
+        };
+
+        constexpr static CommandTable nead_mk_table_ = {
+            cmd(SPNOOP),       cmd(e_ADPCM),       cmd(e_CLEARBUFF),    cmd(SPNOOP),
+            cmd(SPNOOP),       cmd(e_RESAMPLE),    cmd(SPNOOP),         cmd(SPNOOP),
+            cmd(e_SETBUFF),    cmd(SPNOOP),        cmd(e_DMEMMOVE),     cmd(e_LOADADPCM),
+            cmd(e_MIXER),      cmd(e_INTERLEAVE_MK), cmd(e_POLEF),      cmd(e_SETLOOP),
+            cmd(e_COPYBLOCKS), cmd(e_INTERL),      cmd(e_ENVSETUP1_MK), cmd(e_ENVMIXER_MK),
+            cmd(e_LOADBUFF),   cmd(e_SAVEBUFF),    cmd(e_ENVSETUP2),    cmd(SPNOOP),
+            cmd(SPNOOP),       cmd(SPNOOP),        cmd(SPNOOP),         cmd(SPNOOP),
+            cmd(SPNOOP),       cmd(SPNOOP),        cmd(SPNOOP),         cmd(SPNOOP),
+        };
+
+        constexpr static CommandTable nead_sf_table_ = {
+            cmd(SPNOOP),       cmd(e_ADPCM),       cmd(e_CLEARBUFF),    cmd(SPNOOP),
+            cmd(e_ADDMIXER),   cmd(e_RESAMPLE),    cmd(e_RESAMPLE_ZOH), cmd(SPNOOP),
+            cmd(e_SETBUFF),    cmd(SPNOOP),        cmd(e_DMEMMOVE),     cmd(e_LOADADPCM),
+            cmd(e_MIXER),      cmd(e_INTERLEAVE_MK), cmd(e_POLEF),      cmd(e_SETLOOP),
+            cmd(e_COPYBLOCKS), cmd(e_INTERL),      cmd(e_ENVSETUP1),    cmd(e_ENVMIXER),
+            cmd(e_LOADBUFF),   cmd(e_SAVEBUFF),    cmd(e_ENVSETUP2),    cmd(SPNOOP),
+            cmd(e_HILOGAIN),   cmd(UNKNOWN),       cmd(e_DUPLICATE),    cmd(SPNOOP),
+            cmd(SPNOOP),       cmd(SPNOOP),        cmd(SPNOOP),         cmd(SPNOOP),
+        };
+
+        constexpr static CommandTable nead_sfj_table_ = {
+            cmd(SPNOOP),       cmd(e_ADPCM),       cmd(e_CLEARBUFF),    cmd(SPNOOP),
+            cmd(e_ADDMIXER),   cmd(e_RESAMPLE),    cmd(e_RESAMPLE_ZOH), cmd(SPNOOP),
+            cmd(e_SETBUFF),    cmd(SPNOOP),        cmd(e_DMEMMOVE),     cmd(e_LOADADPCM),
+            cmd(e_MIXER),      cmd(e_INTERLEAVE_MK), cmd(e_POLEF),      cmd(e_SETLOOP),
+            cmd(e_COPYBLOCKS), cmd(e_INTERL),      cmd(e_ENVSETUP1),    cmd(e_ENVMIXER),
+            cmd(e_LOADBUFF),   cmd(e_SAVEBUFF),    cmd(e_ENVSETUP2),    cmd(UNKNOWN),
+            cmd(e_HILOGAIN),   cmd(UNKNOWN),       cmd(e_DUPLICATE),    cmd(SPNOOP),
+            cmd(SPNOOP),       cmd(SPNOOP),        cmd(SPNOOP),         cmd(SPNOOP),
+        };
+
+        constexpr static CommandTable nead_fz_table_ = {
+            cmd(UNKNOWN),      cmd(e_ADPCM),       cmd(e_CLEARBUFF),    cmd(SPNOOP),
+            cmd(e_ADDMIXER),   cmd(e_RESAMPLE),    cmd(SPNOOP),         cmd(SPNOOP),
+            cmd(e_SETBUFF),    cmd(SPNOOP),        cmd(e_DMEMMOVE),     cmd(e_LOADADPCM),
+            cmd(e_MIXER),      cmd(e_INTERLEAVE),  cmd(SPNOOP),         cmd(e_SETLOOP),
+            cmd(e_COPYBLOCKS), cmd(e_INTERL),      cmd(e_ENVSETUP1),    cmd(e_ENVMIXER),
+            cmd(e_LOADBUFF),   cmd(e_SAVEBUFF),    cmd(e_ENVSETUP2),    cmd(UNKNOWN),
+            cmd(SPNOOP),       cmd(UNKNOWN),       cmd(e_DUPLICATE),    cmd(SPNOOP),
+            cmd(SPNOOP),       cmd(SPNOOP),        cmd(SPNOOP),         cmd(SPNOOP),
+        };
+
+        constexpr static CommandTable nead_wrjb_table_ = {
+            cmd(SPNOOP),       cmd(e_ADPCM),       cmd(e_CLEARBUFF),    cmd(UNKNOWN),
+            cmd(e_ADDMIXER),   cmd(e_RESAMPLE),    cmd(e_RESAMPLE_ZOH), cmd(SPNOOP),
+            cmd(e_SETBUFF),    cmd(SPNOOP),        cmd(e_DMEMMOVE),     cmd(e_LOADADPCM),
+            cmd(e_MIXER),      cmd(e_INTERLEAVE),  cmd(SPNOOP),         cmd(e_SETLOOP),
+            cmd(e_COPYBLOCKS), cmd(e_INTERL),      cmd(e_ENVSETUP1),    cmd(e_ENVMIXER),
+            cmd(e_LOADBUFF),   cmd(e_SAVEBUFF),    cmd(e_ENVSETUP2),    cmd(UNKNOWN),
+            cmd(e_HILOGAIN),   cmd(UNKNOWN),       cmd(e_DUPLICATE),    cmd(e_FILTER),
+            cmd(SPNOOP),       cmd(SPNOOP),        cmd(SPNOOP),         cmd(SPNOOP),
+        };
+
+        // Yoshi's Story, 1080, both Zelda games, Animal Crossing and F-Zero X Expansion
+        constexpr static CommandTable nead_zelda_table_ = {
+            cmd(UNKNOWN),      cmd(e_ADPCM),       cmd(e_CLEARBUFF),    cmd(UNKNOWN),
+            cmd(e_ADDMIXER),   cmd(e_RESAMPLE),    cmd(e_RESAMPLE_ZOH), cmd(e_FILTER),
+            cmd(e_SETBUFF),    cmd(e_DUPLICATE),   cmd(e_DMEMMOVE),     cmd(e_LOADADPCM),
+            cmd(e_MIXER),      cmd(e_INTERLEAVE),  cmd(e_HILOGAIN),     cmd(e_SETLOOP),
+            cmd(e_COPYBLOCKS), cmd(e_INTERL),      cmd(e_ENVSETUP1),    cmd(e_ENVMIXER),
+            cmd(e_LOADBUFF),   cmd(e_SAVEBUFF),    cmd(e_ENVSETUP2),    cmd(UNKNOWN),
+            cmd(UNKNOWN),      cmd(UNKNOWN),       cmd(UNKNOWN),        cmd(UNKNOWN),
+            cmd(UNKNOWN),      cmd(UNKNOWN),       cmd(UNKNOWN),        cmd(UNKNOWN),
+        };
+#undef cmd
+
+        // Sample buffer access, addresses are DMEM byte addresses. contiguous checks that a
+        // range doesn't wrap around so the SIMD paths can work on it directly
+        int16_t& sample(uint16_t address);
+        uint8_t& byte(uint16_t address);
+        int16_t* contiguous(uint16_t address, uint32_t size);
+        uint16_t dram_read16(uint32_t address);
+        void dram_write16(uint32_t address, uint16_t value);
+        uint32_t dram_read32(uint32_t address);
+        void dram_write32(uint32_t address, uint32_t value);
+        void dram_written(uint32_t address, uint32_t size);
+        uint32_t segment_address(uint32_t address);
+
+        void clear(uint16_t dmem, uint16_t count);
+        void load(uint16_t dmem, uint32_t address, uint16_t count);
+        void save(uint16_t dmem, uint32_t address, uint16_t count);
+        void move(uint16_t dmemo, uint16_t dmemi, uint16_t count);
+        void load_codebook(uint32_t address, uint16_t count);
+        void adpcm(bool init, bool loop, bool two_bit_per_sample, uint16_t dmemo, uint16_t dmemi,
+                   uint16_t count, uint32_t address);
+        void resample(bool init, uint16_t dmemo, uint16_t dmemi, uint16_t count, uint32_t pitch,
+                      uint32_t address);
+        void resample_zoh(uint16_t dmemo, uint16_t dmemi, uint16_t count, uint32_t pitch,
+                          uint32_t pitch_accu);
+        void mix(uint16_t dmemo, uint16_t dmemi, uint16_t count, int16_t gain);
+        void add(uint16_t dmemo, uint16_t dmemi, uint16_t count);
+        void multiply_q44(uint16_t dmem, uint16_t count, int8_t gain);
+        void interleave(uint16_t dmemo, uint16_t left, uint16_t right, uint16_t count);
+        void copy_every_other_sample(uint16_t dmemo, uint16_t dmemi, uint16_t count);
+        void repeat64(uint16_t dmemo, uint16_t dmemi, uint8_t count);
+        void copy_blocks(uint16_t dmemo, uint16_t dmemi, uint16_t block_size, uint8_t count);
+        void polef(bool init, uint16_t dmemo, uint16_t dmemi, uint16_t count, uint16_t gain,
+                   uint32_t address);
+        void filter(uint16_t dmem, uint16_t count, uint32_t address);
+        void envmix_exp(bool init, bool aux, uint16_t dmem_dl, uint16_t dmem_dr,
+                        uint16_t dmem_wl, uint16_t dmem_wr, uint16_t dmemi, uint16_t count,
+                        uint32_t address);
+        void envmix_lin(bool init, bool aux, uint16_t dmem_dl, uint16_t dmem_dr,
+                        uint16_t dmem_wl, uint16_t dmem_wr, uint16_t dmemi, uint16_t count,
+                        uint32_t address);
+        void envmix_nead(bool swap_wet_lr, uint16_t dmem_dl, uint16_t dmem_dr, uint16_t dmem_wl,
+                         uint16_t dmem_wr, uint16_t dmemi, unsigned count,
+                         const std::array<int16_t, 4>& xors);
+
+        // The scratch area, one DMEM sized buffer of samples
+        alignas(16) std::array<int16_t, 0x800> buffer_{};
+        uint8_t* rdram_ptr_ = nullptr;
+        std::function<void(uint32_t, uint32_t)> rdram_write_callback_;
+        AudioUcode ucode_ = AudioUcode::Unknown;
+
+        // Command state that persists between commands and tasks
+        std::array<uint32_t, 16> segments_{};
+        std::array<int16_t, 0x100> codebook_{};
+        uint16_t in_ = 0, out_ = 0, count_ = 0;
+        uint16_t dry_right_ = 0, wet_left_ = 0, wet_right_ = 0;
+        int16_t dry_ = 0, wet_ = 0;
+        std::array<int16_t, 2> volume_{}, target_{};
+        std::array<int32_t, 2> rate_{};
+        uint32_t loop_ = 0;
+        std::array<uint16_t, 3> env_values_{}, env_steps_{};
+        uint16_t filter_count_ = 0;
+        std::array<uint32_t, 2> filter_lut_address_{};
+    };
+} // namespace hydra::N64
@@ -0,0 +1,63 @@
+#include <core/n64_log.hxx>
+#include <core/n64_rsp_cache.hxx>
+#include <cstring>
+
+namespace hydra::N64
+{
+    uint64_t rsp_hash_imem(const uint8_t* imem)
+    {
+        uint64_t hash = 0xcbf2'9ce4'8422'2325;
+        for (uint32_t i = 0; i < RSP_IMEM_SIZE; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, imem + i, sizeof(uint64_t));
+            hash = (hash ^ word) * 0x0000'0100'0000'01b3;
+            hash ^= hash >> 29;
+        }
+        return hash;
+    }
+
+    void RspBlockCache::Select(const uint8_t* imem)
+    {
+        uint64_t hash = rsp_hash_imem(imem);
+        auto it = images_.find(hash);
+        if (it != images_.end())
+        {
+            image_ = it->second.get();
+            if (memcmp(image_->imem.data(), imem, RSP_IMEM_SIZE) != 0) [[unlikely]]
+            {
+                // Hash collision, the old image is replaced
+                memcpy(image_->imem.data(), imem, RSP_IMEM_SIZE);
+                for (auto& block : image_->blocks)
+                {
+                    block.reset();
+                }
+            }
+            return;
+        }
+
+        if (images_.size() >= RSP_MAX_IMAGES)
+        {
+            Logger::Debug("RSP block cache full, starting over");
+            images_.clear();
+        }
+
+        auto image = std::make_unique<RspImage>();
+        memcpy(image->imem.data(), imem, RSP_IMEM_SIZE);
+        image_ = image.get();
+        images_[hash] = std::move(image);
+    }
+
+    RspBlock& RspBlockCache::Allocate(uint32_t pc)
+    {
+        auto& block = image_->blocks[(pc & (RSP_IMEM_SIZE - 1)) >> 2];
+        block = std::make_unique<RspBlock>();
+        return *block;
+    }
+
+    void RspBlockCache::Clear()
+    {
+        images_.clear();
+        image_ = nullptr;
+    }
+} // namespace hydra::N64
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <core/n64_types.hxx>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace hydra::N64
+{
+    class RSP;
+
+    constexpr uint32_t RSP_IMEM_SIZE = 0x1000;
+    constexpr size_t RSP_BLOCK_MAX_INSTRUCTIONS = 64;
+    // Distinct IMEM images kept around before the cache starts over
+    constexpr size_t RSP_MAX_IMAGES = 32;
+
+    uint64_t rsp_hash_imem(const uint8_t* imem);
+
+    // Branches and jumps, the block ends after their delay slot
+    inline bool rsp_is_branch(Instruction instruction)
+    {
+        switch (instruction.IType.op)
+        {
+            case 0:
+                // JR, JALR
+                return instruction.RType.func == 8 || instruction.RType.func == 9;
+            case 1:
+            case 2:
+            case 3:
+            case 4:
+            case 5:
+            case 6:
+            case 7:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Computational COP2 instructions, the ones the vector unit executes
+    inline bool rsp_is_vector(Instruction instruction)
+    {
+        return instruction.IType.op == 18 && (instruction.RType.rs & 0x10);
+    }
+
+    // BREAK halts the RSP, and COP0 accesses may halt it, start a DMA into IMEM or wait on
+    // the CPU
+    inline bool rsp_ends_block(Instruction instruction)
+    {
+        return (instruction.IType.op == 0 && instruction.RType.func == 13) ||
+               instruction.IType.op == 16;
+    }
+
+    struct RspDecodedInstruction
+    {
+        uint32_t instruction;
+        // Already resolved through the SPECIAL and REGIMM tables
+        void (*handler)(RSP*);
+    };
+
+    // A straight-line run of instructions starting at an IMEM address. Blocks end after the
+    // delay slot of a branch, after anything that can halt the RSP or start a DMA (BREAK and
+    // COP0) and at the end of IMEM
+    struct RspBlock
+    {
+        std::vector<RspDecodedInstruction> instructions;
+        uint32_t vector_instructions = 0;
+        // Host code of the whole block, compiled on first use while the JIT is enabled. Stays
+        // null for blocks the recompiler doesn't handle
+        void (*jit_code)(RSP*) = nullptr;
+        bool jit_compiled = false;
+    };
+
+    // Every block compiled from one IMEM image
+    struct RspImage
+    {
+        std::array<uint8_t, RSP_IMEM_SIZE> imem;
+        std::array<std::unique_ptr<RspBlock>, RSP_IMEM_SIZE / 4> blocks;
+    };
+
+    /**
+        Blocks are grouped by the IMEM contents they were compiled from, so switching back and
+        forth between microcodes (or overlays of the same one) finds the blocks of the old
+        image again instead of compiling them from scratch
+    */
+    class RspBlockCache final
+    {
+    public:
+        // Switches to the image matching the current IMEM contents, called whenever IMEM
+        // may have changed
+        void Select(const uint8_t* imem);
+
+        RspBlock* Lookup(uint32_t pc)
+        {
+            return image_->blocks[(pc & (RSP_IMEM_SIZE - 1)) >> 2].get();
+        }
+
+        RspBlock& Allocate(uint32_t pc);
+        void Clear();
+
+    private:
+        std::unordered_map<uint64_t, std::unique_ptr<RspImage>> images_;
+        RspImage* image_ = nullptr;
+    };
+} // namespace hydra::N64
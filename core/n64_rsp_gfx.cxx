@@ -0,0 +1,1392 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <core/n64_log.hxx>
+#include <core/n64_rdp.hxx>
+#include <core/n64_rsp_gfx.hxx>
+#include <core/n64_rsp_memory.hxx>
+#include <numbers>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace hydra::N64
+{
+    namespace
+    {
+        // Upper bound on commands per task so a broken display list can't hang the emulator
+        constexpr uint32_t MAX_COMMANDS = 1 << 20;
+
+        // Bit 19 of the high othermode word
+        constexpr uint32_t TEXTURE_PERSPECTIVE = 1 << 19;
+
+        enum Outcode : uint8_t
+        {
+            OUT_LEFT = 1,
+            OUT_RIGHT = 2,
+            OUT_BOTTOM = 4,
+            OUT_TOP = 8,
+            OUT_NEAR = 16,
+            OUT_FAR = 32,
+        };
+
+        // Geometry mode bits, indexed by GraphicsHle::Geometry
+        constexpr std::array<uint32_t, 9> GBI1_GEOMETRY = {
+            0x1, 0x4, 0x200, 0x1000, 0x2000, 0x10000, 0x20000, 0x40000, 0x80000,
+        };
+
+        constexpr std::array<uint32_t, 9> GBI2_GEOMETRY = {
+            0x1, 0x4, 0x200000, 0x200, 0x400, 0x10000, 0x20000, 0x40000, 0x80000,
+        };
+
+        const char* ucode_name(GraphicsUcode ucode)
+        {
+            switch (ucode)
+            {
+                case GraphicsUcode::Fast3D:
+                    return "Fast3D";
+                case GraphicsUcode::F3DEX:
+                    return "F3DEX";
+                case GraphicsUcode::F3DEX2:
+                    return "F3DEX2";
+                default:
+                    return "unknown";
+            }
+        }
+
+        int32_t to_fixed(float value)
+        {
+            return static_cast<int32_t>(
+                std::clamp(value * 65536.0f, -2147483648.0f, 2147483520.0f));
+        }
+
+        // Integer and fraction halves of four s15.16 values, the layout used by the shade and
+        // texture blocks of triangle commands
+        uint64_t integers(const std::array<int32_t, 4>& values)
+        {
+            uint64_t result = 0;
+            for (int32_t value : values)
+            {
+                result = (result << 16) | ((value >> 16) & 0xFFFF);
+            }
+            return result;
+        }
+
+        uint64_t fractions(const std::array<int32_t, 4>& values)
+        {
+            uint64_t result = 0;
+            for (int32_t value : values)
+            {
+                result = (result << 16) | (value & 0xFFFF);
+            }
+            return result;
+        }
+
+        std::array<float, 3> normalize(std::array<float, 3> vector)
+        {
+            float length = std::sqrt(vector[0] * vector[0] + vector[1] * vector[1] +
+                                     vector[2] * vector[2]);
+            if (length > 0.0f)
+            {
+                for (float& component : vector)
+                {
+                    component /= length;
+                }
+            }
+            return vector;
+        }
+
+        float dot(const std::array<float, 3>& a, const std::array<float, 3>& b)
+        {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+    } // namespace
+
+    std::string graphics_ucode_name(const uint8_t* rdram, uint32_t ucode_data,
+                                    uint32_t ucode_data_size)
+    {
+        constexpr std::string_view GFX_UCODE = "RSP Gfx ucode ";
+        constexpr std::string_view FAST3D = "RSP SW Version: 2.0";
+
+        // The version string lives in the data section, the text section has nothing that
+        // tells the microcodes apart reliably
+        std::string data(std::min<uint32_t>(ucode_data_size, 0x800), '\0');
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = rdram[(ucode_data + i) & RDRAM_MASK];
+        }
+
+        if (data.find(FAST3D) != std::string::npos)
+        {
+            return "Fast3D";
+        }
+
+        size_t name = data.find(GFX_UCODE);
+        if (name == std::string::npos)
+        {
+            return {};
+        }
+        name += GFX_UCODE.size();
+        size_t end = name;
+        while (end < data.size() && end - name < 64 && data[end] >= ' ' && data[end] <= '~')
+        {
+            end++;
+        }
+        return data.substr(name, end - name);
+    }
+
+    GraphicsUcode identify_graphics_ucode(const uint8_t* rdram, uint32_t ucode_data,
+                                          uint32_t ucode_data_size)
+    {
+        std::string name = graphics_ucode_name(rdram, ucode_data, ucode_data_size);
+        if (name == "Fast3D")
+        {
+            return GraphicsUcode::Fast3D;
+        }
+
+        std::string_view rest = name;
+        bool f3dex_family = rest.starts_with("F3DEX") || rest.starts_with("F3DLX") ||
+                            rest.starts_with("F3DLP") || rest.starts_with("F3DZEX");
+        if (!f3dex_family)
+        {
+            return GraphicsUcode::Unknown;
+        }
+
+        // Skip the name, variants like F3DLX2.Rej carry digits of their own
+        size_t version = rest.find(' ');
+        for (; version != std::string_view::npos && version + 1 < rest.size(); version++)
+        {
+            if (rest[version] >= '0' && rest[version] <= '9' && rest[version + 1] == '.')
+            {
+                switch (rest[version])
+                {
+                    case '0':
+                    case '1':
+                        return GraphicsUcode::F3DEX;
+                    case '2':
+                        return GraphicsUcode::F3DEX2;
+                    default:
+                        return GraphicsUcode::Unknown;
+                }
+            }
+        }
+        return GraphicsUcode::Unknown;
+    }
+
+#define cmd(x) &gfx_command<&GraphicsHle::x>
+    constexpr GraphicsHle::CommandTable GraphicsHle::make_table(GraphicsUcode ucode)
+    {
+        CommandTable table{};
+        table.fill(cmd(UNKNOWN));
+        for (int i = 0xE4; i <= 0xFF; i++)
+        {
+            table[i] = cmd(RDP_PASSTHROUGH);
+        }
+        table[0xE4] = cmd(RDP_TEXRECT);
+        table[0xE5] = cmd(RDP_TEXRECT);
+        table[0xEF] = cmd(RDP_SETOTHERMODE);
+        table[0xFD] = cmd(RDP_SETIMAGE);
+        table[0xFE] = cmd(RDP_SETIMAGE);
+        table[0xFF] = cmd(RDP_SETIMAGE);
+
+        if (ucode == GraphicsUcode::F3DEX2)
+        {
+            table[0x00] = cmd(NOOP);
+            table[0x01] = cmd(VTX);
+            table[0x02] = cmd(MODIFYVTX);
+            table[0x03] = cmd(CULLDL);
+            table[0x04] = cmd(BRANCH_Z);
+            table[0x05] = cmd(TRI1);
+            table[0x06] = cmd(TRI2);
+            table[0x07] = cmd(QUAD);
+            table[0xD7] = cmd(TEXTURE);
+            table[0xD8] = cmd(POPMTX);
+            table[0xD9] = cmd(GEOMETRYMODE);
+            table[0xDA] = cmd(MTX);
+            table[0xDB] = cmd(MOVEWORD);
+            table[0xDC] = cmd(MOVEMEM);
+            table[0xDD] = cmd(LOAD_UCODE);
+            table[0xDE] = cmd(DL);
+            table[0xDF] = cmd(ENDDL);
+            table[0xE0] = cmd(NOOP);
+            table[0xE1] = cmd(RDPHALF_1);
+            table[0xE2] = cmd(SETOTHERMODE_L);
+            table[0xE3] = cmd(SETOTHERMODE_H);
+            table[0xF1] = cmd(RDPHALF_2);
+            return table;
+        }
+
+        table[0x00] = cmd(NOOP);
+        table[0x01] = cmd(MTX);
+        table[0x03] = cmd(MOVEMEM);
+        table[0x04] = cmd(VTX);
+        table[0x06] = cmd(DL);
+        table[0xB3] = cmd(RDPHALF_2);
+        table[0xB4] = cmd(RDPHALF_1);
+        table[0xB6] = cmd(CLEARGEOMETRYMODE);
+        table[0xB7] = cmd(SETGEOMETRYMODE);
+        table[0xB8] = cmd(ENDDL);
+        table[0xB9] = cmd(SETOTHERMODE_L);
+        table[0xBA] = cmd(SETOTHERMODE_H);
+        table[0xBB] = cmd(TEXTURE);
+        table[0xBC] = cmd(MOVEWORD);
+        table[0xBD] = cmd(POPMTX);
+        table[0xBE] = cmd(CULLDL);
+        table[0xBF] = cmd(TRI1);
+        table[0xC0] = cmd(NOOP);
+        if (ucode == GraphicsUcode::F3DEX)
+        {
+            table[0xAF] = cmd(LOAD_UCODE);
+            table[0xB0] = cmd(BRANCH_Z);
+            table[0xB1] = cmd(TRI2);
+            table[0xB2] = cmd(MODIFYVTX);
+            table[0xB5] = cmd(QUAD);
+        }
+        else
+        {
+            table[0xB2] = cmd(NOOP);
+        }
+        return table;
+    }
+#undef cmd
+
+    constexpr GraphicsHle::CommandTable GraphicsHle::fast3d_table_ =
+        make_table(GraphicsUcode::Fast3D);
+    constexpr GraphicsHle::CommandTable GraphicsHle::f3dex_table_ =
+        make_table(GraphicsUcode::F3DEX);
+    constexpr GraphicsHle::CommandTable GraphicsHle::f3dex2_table_ =
+        make_table(GraphicsUcode::F3DEX2);
+
+    GraphicsHle::Matrix GraphicsHle::Matrix::operator*(const Matrix& other) const
+    {
+        Matrix result;
+        for (int i = 0; i < 4; i++)
+        {
+#if defined(__SSE2__)
+            __m128 row = _mm_mul_ps(_mm_set1_ps(m[i][0]), _mm_load_ps(other.m[0].data()));
+            for (int k = 1; k < 4; k++)
+            {
+                row = _mm_add_ps(
+                    row, _mm_mul_ps(_mm_set1_ps(m[i][k]), _mm_load_ps(other.m[k].data())));
+            }
+            _mm_store_ps(result.m[i].data(), row);
+#else
+            for (int j = 0; j < 4; j++)
+            {
+                result.m[i][j] = m[i][0] * other.m[0][j] + m[i][1] * other.m[1][j] +
+                                 m[i][2] * other.m[2][j] + m[i][3] * other.m[3][j];
+            }
+#endif
+        }
+        return result;
+    }
+
+    void GraphicsHle::InstallBuses(uint8_t* rdram_ptr, RDP* rdp_ptr)
+    {
+        rdram_ptr_ = rdram_ptr;
+        rdp_ptr_ = rdp_ptr;
+    }
+
+    void GraphicsHle::Reset()
+    {
+        ucode_ = GraphicsUcode::Unknown;
+        table_ = &fast3d_table_;
+        reset_state();
+    }
+
+    // Every task reloads the microcode data into DMEM, so nothing but the microcode itself
+    // survives from one task to the next
+    void GraphicsHle::reset_state()
+    {
+        Matrix identity{};
+        for (int i = 0; i < 4; i++)
+        {
+            identity.m[i][i] = 1.0f;
+        }
+
+        pc_ = 0;
+        running_ = false;
+        dl_stack_.fill(0);
+        dl_depth_ = 0;
+        segments_.fill(0);
+        rdp_half_1_ = rdp_half_2_ = 0;
+        modelview_stack_.fill(identity);
+        modelview_index_ = 0;
+        projection_ = identity;
+        combined_ = identity;
+        combined_dirty_ = true;
+        viewport_scale_.fill(0);
+        viewport_translate_.fill(0);
+        clip_ratio_ = 2.0f;
+        fog_multiplier_ = fog_offset_ = 0;
+        vertices_ = {};
+        lights_ = {};
+        lookat_ = {};
+        num_lights_ = 0;
+        geometry_mode_ = 0;
+        othermode_h_ = othermode_l_ = 0;
+        texture_on_ = false;
+        texture_tile_ = texture_level_ = 0;
+        texture_scale_s_ = texture_scale_t_ = 0;
+    }
+
+    bool GraphicsHle::RunTask(uint32_t ucode_data, uint32_t ucode_data_size, uint32_t data_ptr)
+    {
+        GraphicsUcode ucode = identify_graphics_ucode(rdram_ptr_, ucode_data, ucode_data_size);
+        if (ucode == GraphicsUcode::Unknown)
+        {
+            return false;
+        }
+
+        reset_state();
+        set_ucode(ucode);
+        pc_ = data_ptr;
+        running_ = true;
+
+        uint32_t budget = MAX_COMMANDS;
+        while (running_)
+        {
+            if (budget-- == 0)
+            {
+                Logger::WarnOnce("Graphics HLE: display list at {:08x} doesn't end", data_ptr);
+                break;
+            }
+
+            uint32_t w0 = dram_read32(pc_);
+            uint32_t w1 = dram_read32(pc_ + 4);
+            pc_ += 8;
+            ((*table_)[w0 >> 24])(this, w0, w1);
+        }
+        rdp_ptr_->submit();
+        return true;
+    }
+
+    void GraphicsHle::set_ucode(GraphicsUcode ucode)
+    {
+        if (ucode != ucode_)
+        {
+            Logger::Info("Running {} graphics microcode in HLE", ucode_name(ucode));
+            ucode_ = ucode;
+        }
+
+        switch (ucode)
+        {
+            case GraphicsUcode::F3DEX:
+                table_ = &f3dex_table_;
+                break;
+            case GraphicsUcode::F3DEX2:
+                table_ = &f3dex2_table_;
+                break;
+            default:
+                table_ = &fast3d_table_;
+                break;
+        }
+    }
+
+    uint32_t GraphicsHle::dram_read32(uint32_t address)
+    {
+        return rsp_read_word(rdram_ptr_, address, RDRAM_MASK);
+    }
+
+    uint16_t GraphicsHle::dram_read16(uint32_t address)
+    {
+        return (dram_read8(address) << 8) | dram_read8(address + 1);
+    }
+
+    uint8_t GraphicsHle::dram_read8(uint32_t address)
+    {
+        return rdram_ptr_[address & RDRAM_MASK];
+    }
+
+    uint32_t GraphicsHle::segment_address(uint32_t address)
+    {
+        return (segments_[(address >> 24) & 0xF] + address) & 0xFFFFFF;
+    }
+
+    bool GraphicsHle::geometry(Geometry flag)
+    {
+        const auto& bits = ucode_ == GraphicsUcode::F3DEX2 ? GBI2_GEOMETRY : GBI1_GEOMETRY;
+        return geometry_mode_ & bits[static_cast<int>(flag)];
+    }
+
+    unsigned GraphicsHle::vertex_index(uint32_t value)
+    {
+        return ucode_ == GraphicsUcode::Fast3D ? (value & 0xFF) / 10 : (value & 0xFF) / 2;
+    }
+
+    // Matrices are 16 s16 integer parts followed by 16 u16 fractions, both row major
+    GraphicsHle::Matrix GraphicsHle::load_matrix(uint32_t address)
+    {
+        Matrix matrix;
+        for (int i = 0; i < 16; i++)
+        {
+            int32_t value =
+                (dram_read16(address + i * 2) << 16) | dram_read16(address + 32 + i * 2);
+            matrix.m[i / 4][i % 4] = value / 65536.0f;
+        }
+        return matrix;
+    }
+
+    GraphicsHle::Light GraphicsHle::load_light(uint32_t address)
+    {
+        Light light;
+        for (int i = 0; i < 3; i++)
+        {
+            light.color[i] = dram_read8(address + i);
+            light.direction[i] = static_cast<int8_t>(dram_read8(address + 8 + i));
+        }
+        light.direction = normalize(light.direction);
+        return light;
+    }
+
+    void GraphicsHle::update_combined_matrix()
+    {
+        if (combined_dirty_)
+        {
+            combined_ = modelview_stack_[modelview_index_] * projection_;
+            combined_dirty_ = false;
+        }
+    }
+
+    void GraphicsHle::send(std::initializer_list<uint64_t> words)
+    {
+        command_.assign(words);
+        rdp_ptr_->queue_command(command_);
+    }
+
+    void GraphicsHle::send_othermode()
+    {
+        send({(0xEFull << 56) | (static_cast<uint64_t>(othermode_h_ & 0xFFFFFF) << 32) |
+              othermode_l_});
+    }
+
+    void GraphicsHle::end_display_list()
+    {
+        if (dl_depth_ == 0)
+        {
+            running_ = false;
+            return;
+        }
+        pc_ = dl_stack_[--dl_depth_];
+    }
+
+    void GraphicsHle::NOOP(uint32_t, uint32_t) {}
+
+    void GraphicsHle::UNKNOWN(uint32_t w0, uint32_t w1)
+    {
+        Logger::WarnOnce("Graphics HLE: unknown command {:08x} {:08x} in {}", w0, w1,
+                         ucode_name(ucode_));
+    }
+
+    void GraphicsHle::MTX(uint32_t w0, uint32_t w1)
+    {
+        bool projection, load, push;
+        if (ucode_ == GraphicsUcode::F3DEX2)
+        {
+            // The push flag is inverted in F3DEX2
+            projection = w0 & 4;
+            load = w0 & 2;
+            push = !(w0 & 1);
+        }
+        else
+        {
+            uint8_t params = (w0 >> 16) & 0xFF;
+            projection = params & 1;
+            load = params & 2;
+            push = params & 4;
+        }
+
+        Matrix matrix = load_matrix(segment_address(w1));
+        if (projection)
+        {
+            projection_ = load ? matrix : matrix * projection_;
+        }
+        else
+        {
+            if (push)
+            {
+                if (modelview_index_ + 1 < modelview_stack_.size())
+                {
+                    modelview_stack_[modelview_index_ + 1] = modelview_stack_[modelview_index_];
+                    modelview_index_++;
+                }
+                else
+                {
+                    Logger::WarnOnce("Graphics HLE: matrix stack overflow");
+                }
+            }
+            Matrix& modelview = modelview_stack_[modelview_index_];
+            modelview = load ? matrix : matrix * modelview;
+        }
+        combined_dirty_ = true;
+    }
+
+    void GraphicsHle::POPMTX(uint32_t, uint32_t w1)
+    {
+        unsigned count = ucode_ == GraphicsUcode::F3DEX2 ? w1 / 64 : 1;
+        modelview_index_ -= std::min(count, modelview_index_);
+        combined_dirty_ = true;
+    }
+
+    void GraphicsHle::MOVEMEM(uint32_t w0, uint32_t w1)
+    {
+        uint32_t address = segment_address(w1);
+        enum
+        {
+            Viewport,
+            LookatX,
+            LookatY,
+            LightN,
+            ForcedMatrix,
+            Other,
+        } target = Other;
+        unsigned light = 0;
+
+        if (ucode_ == GraphicsUcode::F3DEX2)
+        {
+            uint8_t index = w0 & 0xFF;
+            uint32_t offset = ((w0 >> 8) & 0xFF) * 8;
+            if (index == 8)
+            {
+                target = Viewport;
+            }
+            else if (index == 10)
+            {
+                // Lights are 24 bytes apart, the two lookat vectors come first
+                unsigned slot = offset / 24;
+                target = slot == 0 ? LookatX : slot == 1 ? LookatY : LightN;
+                light = slot - 2;
+            }
+            else if (index == 14)
+            {
+                target = ForcedMatrix;
+            }
+        }
+        else
+        {
+            uint8_t index = (w0 >> 16) & 0xFF;
+            if (index == 0x80)
+            {
+                target = Viewport;
+            }
+            else if (index == 0x82)
+            {
+                target = LookatY;
+            }
+            else if (index == 0x84)
+            {
+                target = LookatX;
+            }
+            else if (index >= 0x86 && index <= 0x94)
+            {
+                target = LightN;
+                light = (index - 0x86) / 2;
+            }
+        }
+
+        switch (target)
+        {
+            case Viewport:
+            {
+                // x and y are in quarter pixels
+                for (int i = 0; i < 3; i++)
+                {
+                    float divisor = i == 2 ? 1.0f : 4.0f;
+                    viewport_scale_[i] =
+                        static_cast<int16_t>(dram_read16(address + i * 2)) / divisor;
+                    viewport_translate_[i] =
+                        static_cast<int16_t>(dram_read16(address + 8 + i * 2)) / divisor;
+                }
+                break;
+            }
+            case LookatX:
+            case LookatY:
+            {
+                lookat_[target == LookatX ? 0 : 1] = load_light(address).direction;
+                break;
+            }
+            case LightN:
+            {
+                if (light < lights_.size())
+                {
+                    lights_[light] = load_light(address);
+                }
+                break;
+            }
+            case ForcedMatrix:
+            {
+                update_combined_matrix();
+                combined_ = load_matrix(address);
+                break;
+            }
+            case Other:
+            {
+                Logger::WarnOnce("Graphics HLE: unhandled MOVEMEM {:08x}", w0);
+                break;
+            }
+        }
+    }
+
+    void GraphicsHle::MOVEWORD(uint32_t w0, uint32_t w1)
+    {
+        uint8_t index;
+        uint16_t offset;
+        if (ucode_ == GraphicsUcode::F3DEX2)
+        {
+            index = (w0 >> 16) & 0xFF;
+            offset = w0 & 0xFFFF;
+        }
+        else
+        {
+            index = w0 & 0xFF;
+            offset = (w0 >> 8) & 0xFFFF;
+        }
+
+        switch (index)
+        {
+            case 0x02:
+            {
+                num_lights_ = ucode_ == GraphicsUcode::F3DEX2 ? w1 / 24
+                                                              : ((w1 - 0x80000000) / 32) - 1;
+                num_lights_ = std::min<unsigned>(num_lights_, lights_.size() - 1);
+                break;
+            }
+            case 0x04:
+            {
+                // The four clip ratio words hold the same ratio, negated for the low planes
+                int16_t ratio = w1 & 0xFFFF;
+                if (ratio != 0)
+                {
+                    clip_ratio_ = std::abs(ratio);
+                }
+                break;
+            }
+            case 0x06:
+            {
+                segments_[(offset >> 2) & 0xF] = w1 & 0xFFFFFF;
+                break;
+            }
+            case 0x08:
+            {
+                fog_multiplier_ = static_cast<int16_t>(w1 >> 16);
+                fog_offset_ = static_cast<int16_t>(w1 & 0xFFFF);
+                break;
+            }
+            case 0x0A:
+            {
+                unsigned stride = ucode_ == GraphicsUcode::F3DEX2 ? 0x18 : 0x20;
+                unsigned light = offset / stride;
+                if (light < lights_.size() && offset % stride == 0)
+                {
+                    lights_[light].color = {static_cast<float>(w1 >> 24),
+                                            static_cast<float>((w1 >> 16) & 0xFF),
+                                            static_cast<float>((w1 >> 8) & 0xFF)};
+                }
+                break;
+            }
+            case 0x0C:
+            {
+                if (ucode_ != GraphicsUcode::F3DEX2)
+                {
+                    modify_vertex(offset / 40, offset % 40, w1);
+                }
+                break;
+            }
+            case 0x0E:
+            {
+                // Perspective normalization only matters to the fixed point transform
+                break;
+            }
+            default:
+            {
+                Logger::WarnOnce("Graphics HLE: unhandled MOVEWORD {:02x}", index);
+                break;
+            }
+        }
+    }
+
+    void GraphicsHle::VTX(uint32_t w0, uint32_t w1)
+    {
+        unsigned first, count;
+        switch (ucode_)
+        {
+            case GraphicsUcode::F3DEX2:
+            {
+                count = (w0 >> 12) & 0xFF;
+                first = ((w0 >> 1) & 0x7F) - count;
+                break;
+            }
+            case GraphicsUcode::F3DEX:
+            {
+                first = ((w0 >> 16) & 0xFF) / 2;
+                count = (w0 >> 10) & 0x3F;
+                break;
+            }
+            default:
+            {
+                first = (w0 >> 16) & 0xF;
+                count = ((w0 >> 20) & 0xF) + 1;
+                break;
+            }
+        }
+        load_vertices(segment_address(w1), first & 0x7F, count);
+    }
+
+    void GraphicsHle::load_vertices(uint32_t address, unsigned first, unsigned count)
+    {
+        update_combined_matrix();
+
+        bool lighting = geometry(Geometry::Lighting);
+        bool texgen = geometry(Geometry::TexGen);
+        bool fog = geometry(Geometry::Fog);
+
+        // Bring the lights into object space once instead of every normal into eye space
+        std::array<std::array<float, 3>, 8> directions;
+        std::array<std::array<float, 3>, 2> lookat;
+        if (lighting)
+        {
+            const Matrix& modelview = modelview_stack_[modelview_index_];
+            auto to_object = [&modelview](const std::array<float, 3>& vector) {
+                std::array<float, 3> result;
+                for (int i = 0; i < 3; i++)
+                {
+                    result[i] = modelview.m[i][0] * vector[0] + modelview.m[i][1] * vector[1] +
+                                modelview.m[i][2] * vector[2];
+                }
+                return normalize(result);
+            };
+            for (unsigned i = 0; i < num_lights_; i++)
+            {
+                directions[i] = to_object(lights_[i].direction);
+            }
+            lookat[0] = to_object(lookat_[0]);
+            lookat[1] = to_object(lookat_[1]);
+        }
+
+#if defined(__SSE2__)
+        __m128 row0 = _mm_load_ps(combined_.m[0].data());
+        __m128 row1 = _mm_load_ps(combined_.m[1].data());
+        __m128 row2 = _mm_load_ps(combined_.m[2].data());
+        __m128 row3 = _mm_load_ps(combined_.m[3].data());
+#endif
+
+        for (unsigned i = 0; i < count && first + i < vertices_.size(); i++)
+        {
+            uint32_t base = address + i * 16;
+            Vertex& vertex = vertices_[first + i];
+            float x = static_cast<int16_t>(dram_read16(base));
+            float y = static_cast<int16_t>(dram_read16(base + 2));
+            float z = static_cast<int16_t>(dram_read16(base + 4));
+
+#if defined(__SSE2__)
+            __m128 clip = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(x), row0), _mm_mul_ps(_mm_set1_ps(y), row1)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(z), row2), row3));
+            _mm_storeu_ps(&vertex.x, clip);
+#else
+            const auto& m = combined_.m;
+            vertex.x = x * m[0][0] + y * m[1][0] + z * m[2][0] + m[3][0];
+            vertex.y = x * m[0][1] + y * m[1][1] + z * m[2][1] + m[3][1];
+            vertex.z = x * m[0][2] + y * m[1][2] + z * m[2][2] + m[3][2];
+            vertex.w = x * m[0][3] + y * m[1][3] + z * m[2][3] + m[3][3];
+#endif
+
+            float s = static_cast<int16_t>(dram_read16(base + 8));
+            float t = static_cast<int16_t>(dram_read16(base + 10));
+            for (int c = 0; c < 4; c++)
+            {
+                (&vertex.r)[c] = dram_read8(base + 12 + c);
+            }
+
+            if (lighting)
+            {
+                std::array<float, 3> normal = {
+                    static_cast<int8_t>(dram_read8(base + 12)) / 128.0f,
+                    static_cast<int8_t>(dram_read8(base + 13)) / 128.0f,
+                    static_cast<int8_t>(dram_read8(base + 14)) / 128.0f,
+                };
+
+                std::array<float, 3> color = lights_[num_lights_].color;
+                for (unsigned l = 0; l < num_lights_; l++)
+                {
+                    float intensity = std::max(0.0f, dot(normal, directions[l]));
+                    for (int c = 0; c < 3; c++)
+                    {
+                        color[c] += intensity * lights_[l].color[c];
+                    }
+                }
+                vertex.r = std::min(color[0], 255.0f);
+                vertex.g = std::min(color[1], 255.0f);
+                vertex.b = std::min(color[2], 255.0f);
+
+                if (texgen)
+                {
+                    normal = normalize(normal);
+                    float dx = std::clamp(dot(normal, lookat[0]), -1.0f, 1.0f);
+                    float dy = std::clamp(dot(normal, lookat[1]), -1.0f, 1.0f);
+                    if (geometry(Geometry::TexGenLinear))
+                    {
+                        s = std::acos(-dx) * (32768.0f / std::numbers::pi_v<float>);
+                        t = std::acos(-dy) * (32768.0f / std::numbers::pi_v<float>);
+                    }
+                    else
+                    {
+                        s = (dx + 1.0f) * 16384.0f;
+                        t = (dy + 1.0f) * 16384.0f;
+                    }
+                }
+            }
+
+            vertex.s = s * texture_scale_s_;
+            vertex.t = t * texture_scale_t_;
+
+            if (fog && vertex.w != 0.0f)
+            {
+                float depth = vertex.z / vertex.w;
+                vertex.a = std::clamp(depth * fog_multiplier_ + fog_offset_, 0.0f, 255.0f);
+            }
+
+            project(vertex);
+            compute_outcodes(vertex);
+        }
+    }
+
+    void GraphicsHle::project(Vertex& vertex)
+    {
+        float inverse_w = 1.0f / (std::abs(vertex.w) < 1e-6f ? 1e-6f : vertex.w);
+        vertex.sx = vertex.x * inverse_w * viewport_scale_[0] + viewport_translate_[0];
+        vertex.sy = -vertex.y * inverse_w * viewport_scale_[1] + viewport_translate_[1];
+        // Depth is 10 bits in the viewport and s15.16 on the RDP
+        vertex.sz = (vertex.z * inverse_w * viewport_scale_[2] + viewport_translate_[2]) * 32.0f;
+    }
+
+    void GraphicsHle::compute_outcodes(Vertex& vertex)
+    {
+        auto outcode = [&vertex](float limit) {
+            uint8_t code = 0;
+            code |= vertex.x < -limit ? OUT_LEFT : 0;
+            code |= vertex.x > limit ? OUT_RIGHT : 0;
+            code |= vertex.y < -limit ? OUT_BOTTOM : 0;
+            code |= vertex.y > limit ? OUT_TOP : 0;
+            code |= vertex.z < -vertex.w ? OUT_NEAR : 0;
+            code |= vertex.z > vertex.w ? OUT_FAR : 0;
+            return code;
+        };
+        vertex.clip = outcode(vertex.w * clip_ratio_);
+        vertex.cull = outcode(vertex.w);
+    }
+
+    void GraphicsHle::MODIFYVTX(uint32_t w0, uint32_t w1)
+    {
+        modify_vertex((w0 & 0xFFFF) / 2, (w0 >> 16) & 0xFF, w1);
+    }
+
+    void GraphicsHle::modify_vertex(unsigned index, uint32_t where, uint32_t value)
+    {
+        if (index >= vertices_.size())
+        {
+            return;
+        }
+
+        Vertex& vertex = vertices_[index];
+        switch (where)
+        {
+            case 0x10:
+            {
+                vertex.r = value >> 24;
+                vertex.g = (value >> 16) & 0xFF;
+                vertex.b = (value >> 8) & 0xFF;
+                vertex.a = value & 0xFF;
+                break;
+            }
+            case 0x14:
+            {
+                vertex.s = static_cast<int16_t>(value >> 16);
+                vertex.t = static_cast<int16_t>(value & 0xFFFF);
+                break;
+            }
+            case 0x18:
+            {
+                // The screen position now comes from the display list, clipping can't
+                // recompute it
+                vertex.sx = static_cast<int16_t>(value >> 16) / 4.0f;
+                vertex.sy = static_cast<int16_t>(value & 0xFFFF) / 4.0f;
+                vertex.clip = vertex.cull = 0;
+                break;
+            }
+            case 0x1C:
+            {
+                vertex.sz = static_cast<int32_t>(value) / 65536.0f * 32.0f;
+                break;
+            }
+            default:
+            {
+                Logger::WarnOnce("Graphics HLE: unhandled vertex modification {:02x}", where);
+                break;
+            }
+        }
+    }
+
+    void GraphicsHle::TRI1(uint32_t w0, uint32_t w1)
+    {
+        uint32_t indices = ucode_ == GraphicsUcode::F3DEX2 ? w0 : w1;
+        draw_triangle(vertex_index(indices >> 16), vertex_index(indices >> 8),
+                      vertex_index(indices));
+    }
+
+    void GraphicsHle::TRI2(uint32_t w0, uint32_t w1)
+    {
+        draw_triangle(vertex_index(w0 >> 16), vertex_index(w0 >> 8), vertex_index(w0));
+        draw_triangle(vertex_index(w1 >> 16), vertex_index(w1 >> 8), vertex_index(w1));
+    }
+
+    void GraphicsHle::QUAD(uint32_t w0, uint32_t w1)
+    {
+        if (ucode_ == GraphicsUcode::F3DEX2)
+        {
+            TRI2(w0, w1);
+            return;
+        }
+
+        unsigned v0 = vertex_index(w1 >> 24), v1 = vertex_index(w1 >> 16),
+                 v2 = vertex_index(w1 >> 8), v3 = vertex_index(w1);
+        draw_triangle(v0, v1, v2);
+        draw_triangle(v0, v2, v3);
+    }
+
+    void GraphicsHle::CULLDL(uint32_t w0, uint32_t w1)
+    {
+        unsigned first, last;
+        if (ucode_ == GraphicsUcode::Fast3D)
+        {
+            first = (w0 & 0xFFFF) / 40;
+            last = (w1 & 0xFFFF) / 40 - 1;
+        }
+        else
+        {
+            first = (w0 & 0xFFFF) / 2;
+            last = (w1 & 0xFFFF) / 2;
+        }
+
+        uint8_t outside = 0x3F;
+        for (unsigned i = first; i <= last && i < vertices_.size(); i++)
+        {
+            outside &= vertices_[i].cull;
+        }
+        if (outside)
+        {
+            end_display_list();
+        }
+    }
+
+    void GraphicsHle::BRANCH_Z(uint32_t w0, uint32_t w1)
+    {
+        unsigned index = (w0 & 0xFFF) / 2;
+        if (index >= vertices_.size())
+        {
+            return;
+        }
+
+        // The compare value is the 10 bit viewport depth in 16.16
+        float depth = vertices_[index].sz / 32.0f;
+        if (to_fixed(depth) <= static_cast<int32_t>(w1))
+        {
+            pc_ = segment_address(rdp_half_1_);
+        }
+    }
+
+    void GraphicsHle::DL(uint32_t w0, uint32_t w1)
+    {
+        bool push = ((w0 >> 16) & 0xFF) == 0;
+        if (push)
+        {
+            if (dl_depth_ == dl_stack_.size())
+            {
+                Logger::WarnOnce("Graphics HLE: display list stack overflow");
+                return;
+            }
+            dl_stack_[dl_depth_++] = pc_;
+        }
+        pc_ = segment_address(w1);
+    }
+
+    void GraphicsHle::ENDDL(uint32_t, uint32_t)
+    {
+        end_display_list();
+    }
+
+    void GraphicsHle::TEXTURE(uint32_t w0, uint32_t w1)
+    {
+        texture_level_ = (w0 >> 11) & 7;
+        texture_tile_ = (w0 >> 8) & 7;
+        texture_on_ = ucode_ == GraphicsUcode::F3DEX2 ? (w0 >> 1) & 0x7F : w0 & 0xFF;
+        texture_scale_s_ = (w1 >> 16) / 65536.0f;
+        texture_scale_t_ = (w1 & 0xFFFF) / 65536.0f;
+    }
+
+    void GraphicsHle::SETGEOMETRYMODE(uint32_t, uint32_t w1)
+    {
+        geometry_mode_ |= w1;
+    }
+
+    void GraphicsHle::CLEARGEOMETRYMODE(uint32_t, uint32_t w1)
+    {
+        geometry_mode_ &= ~w1;
+    }
+
+    void GraphicsHle::GEOMETRYMODE(uint32_t w0, uint32_t w1)
+    {
+        geometry_mode_ = (geometry_mode_ & (w0 & 0xFFFFFF)) | w1;
+    }
+
+    void GraphicsHle::SETOTHERMODE_H(uint32_t w0, uint32_t w1)
+    {
+        uint32_t length, shift;
+        if (ucode_ == GraphicsUcode::F3DEX2)
+        {
+            length = (w0 & 0xFF) + 1;
+            shift = 32 - ((w0 >> 8) & 0xFF) - length;
+        }
+        else
+        {
+            length = w0 & 0xFF;
+            shift = (w0 >> 8) & 0xFF;
+        }
+        uint32_t mask = static_cast<uint32_t>(((1ull << length) - 1) << shift);
+        othermode_h_ = (othermode_h_ & ~mask) | (w1 & mask);
+        send_othermode();
+    }
+
+    void GraphicsHle::SETOTHERMODE_L(uint32_t w0, uint32_t w1)
+    {
+        uint32_t length, shift;
+        if (ucode_ == GraphicsUcode::F3DEX2)
+        {
+            length = (w0 & 0xFF) + 1;
+            shift = 32 - ((w0 >> 8) & 0xFF) - length;
+        }
+        else
+        {
+            length = w0 & 0xFF;
+            shift = (w0 >> 8) & 0xFF;
+        }
+        uint32_t mask = static_cast<uint32_t>(((1ull << length) - 1) << shift);
+        othermode_l_ = (othermode_l_ & ~mask) | (w1 & mask);
+        send_othermode();
+    }
+
+    void GraphicsHle::RDPHALF_1(uint32_t, uint32_t w1)
+    {
+        rdp_half_1_ = w1;
+    }
+
+    void GraphicsHle::RDPHALF_2(uint32_t, uint32_t w1)
+    {
+        rdp_half_2_ = w1;
+    }
+
+    void GraphicsHle::LOAD_UCODE(uint32_t w0, uint32_t)
+    {
+        // The data section address comes in through RDPHALF_1
+        GraphicsUcode ucode =
+            identify_graphics_ucode(rdram_ptr_, segment_address(rdp_half_1_), (w0 & 0xFFFF) + 1);
+        if (ucode == GraphicsUcode::Unknown)
+        {
+            Logger::WarnOnce("Graphics HLE: display list switched to an unknown microcode");
+            running_ = false;
+            return;
+        }
+        set_ucode(ucode);
+    }
+
+    void GraphicsHle::RDP_PASSTHROUGH(uint32_t w0, uint32_t w1)
+    {
+        send({(static_cast<uint64_t>(w0) << 32) | w1});
+    }
+
+    void GraphicsHle::RDP_SETIMAGE(uint32_t w0, uint32_t w1)
+    {
+        send({(static_cast<uint64_t>(w0) << 32) | segment_address(w1)});
+    }
+
+    void GraphicsHle::RDP_SETOTHERMODE(uint32_t w0, uint32_t w1)
+    {
+        othermode_h_ = w0 & 0xFFFFFF;
+        othermode_l_ = w1;
+        send_othermode();
+    }
+
+    // The texture coordinates and their steps follow in the w1 of the next two commands
+    void GraphicsHle::RDP_TEXRECT(uint32_t w0, uint32_t w1)
+    {
+        rdp_half_1_ = dram_read32(pc_ + 4);
+        rdp_half_2_ = dram_read32(pc_ + 12);
+        pc_ += 16;
+        send({(static_cast<uint64_t>(w0) << 32) | w1,
+              (static_cast<uint64_t>(rdp_half_1_) << 32) | rdp_half_2_});
+    }
+
+    void GraphicsHle::draw_triangle(unsigned v0, unsigned v1, unsigned v2)
+    {
+        if (v0 >= vertices_.size() || v1 >= vertices_.size() || v2 >= vertices_.size())
+        {
+            Logger::WarnOnce("Graphics HLE: vertex index out of range");
+            return;
+        }
+
+        const Vertex& a = vertices_[v0];
+        const Vertex& b = vertices_[v1];
+        const Vertex& c = vertices_[v2];
+        if (a.clip & b.clip & c.clip)
+        {
+            return;
+        }
+
+        if ((a.clip | b.clip | c.clip) & ~OUT_FAR)
+        {
+            clip_triangle(a, b, c);
+        }
+        else
+        {
+            setup_triangle(&a, &b, &c);
+        }
+    }
+
+    // Sutherland-Hodgman against the near plane and whichever guard band planes are crossed
+    void GraphicsHle::clip_triangle(const Vertex& v0, const Vertex& v1, const Vertex& v2)
+    {
+        std::array<Vertex, 16> buffers[2];
+        unsigned count = 3;
+        buffers[0][0] = v0;
+        buffers[0][1] = v1;
+        buffers[0][2] = v2;
+        if (!geometry(Geometry::ShadingSmooth))
+        {
+            for (unsigned i = 1; i < 3; i++)
+            {
+                std::copy_n(&v0.r, 4, &buffers[0][i].r);
+            }
+        }
+
+        uint8_t crossed = (v0.clip | v1.clip | v2.clip) & ~OUT_FAR;
+        float ratio = clip_ratio_;
+        int current = 0;
+        for (uint8_t plane = OUT_LEFT; plane <= OUT_NEAR; plane <<= 1)
+        {
+            if (!(crossed & plane))
+            {
+                continue;
+            }
+
+            auto distance = [plane, ratio](const Vertex& v) {
+                switch (plane)
+                {
+                    case OUT_LEFT:
+                        return v.x + ratio * v.w;
+                    case OUT_RIGHT:
+                        return ratio * v.w - v.x;
+                    case OUT_BOTTOM:
+                        return v.y + ratio * v.w;
+                    case OUT_TOP:
+                        return ratio * v.w - v.y;
+                    default:
+                        return v.z + v.w;
+                }
+            };
+
+            const auto& in = buffers[current];
+            auto& out = buffers[current ^ 1];
+            unsigned out_count = 0;
+            for (unsigned i = 0; i < count; i++)
+            {
+                const Vertex& from = in[i];
+                const Vertex& to = in[(i + 1) % count];
+                float d0 = distance(from);
+                float d1 = distance(to);
+                if (d0 >= 0.0f)
+                {
+                    out[out_count++] = from;
+                }
+                if ((d0 >= 0.0f) != (d1 >= 0.0f) && out_count < out.size())
+                {
+                    float t = d0 / (d0 - d1);
+                    Vertex& result = out[out_count++];
+                    result = from;
+                    auto lerp = [t](float a, float b) { return a + (b - a) * t; };
+                    for (int k = 0; k < 4; k++)
+                    {
+                        (&result.x)[k] = lerp((&from.x)[k], (&to.x)[k]);
+                        (&result.r)[k] = lerp((&from.r)[k], (&to.r)[k]);
+                    }
+                    result.s = lerp(from.s, to.s);
+                    result.t = lerp(from.t, to.t);
+                }
+            }
+            count = out_count;
+            current ^= 1;
+            if (count < 3)
+            {
+                return;
+            }
+        }
+
+        auto& polygon = buffers[current];
+        for (unsigned i = 0; i < count; i++)
+        {
+            project(polygon[i]);
+        }
+        for (unsigned i = 1; i + 1 < count; i++)
+        {
+            setup_triangle(&polygon[0], &polygon[i], &polygon[i + 1]);
+        }
+    }
+
+    // Same setup as the microcode, the edges start at the top vertex and every attribute gets
+    // its gradient along x and along the major edge
+    void GraphicsHle::setup_triangle(const Vertex* v0, const Vertex* v1, const Vertex* v2)
+    {
+        // Screen y points down, so front faces wind clockwise here
+        float area = (v1->sx - v0->sx) * (v2->sy - v0->sy) - (v1->sy - v0->sy) * (v2->sx - v0->sx);
+        if (area == 0.0f || (area > 0.0f && geometry(Geometry::CullBack)) ||
+            (area < 0.0f && geometry(Geometry::CullFront)))
+        {
+            return;
+        }
+
+        const Vertex* flat = v0;
+        if (v0->sy > v1->sy)
+            std::swap(v0, v1);
+        if (v1->sy > v2->sy)
+            std::swap(v1, v2);
+        if (v0->sy > v1->sy)
+            std::swap(v0, v1);
+
+        const float x1 = v0->sx, y1 = v0->sy;
+        const float x2 = v1->sx, y2 = v1->sy;
+        const float x3 = v2->sx, y3 = v2->sy;
+
+        const float hx = x3 - x1, hy = y3 - y1;
+        const float mx = x2 - x1, my = y2 - y1;
+        const float nz = hx * my - hy * mx;
+        if (nz == 0.0f)
+        {
+            return;
+        }
+        const bool left = nz < 0.0f;
+
+        const float ish = hy != 0.0f ? hx / hy : 0.0f;
+        const float ism = my != 0.0f ? mx / my : 0.0f;
+        const float isl = (y3 - y2) != 0.0f ? (x3 - x2) / (y3 - y2) : 0.0f;
+        const float fy = std::floor(y1) - y1;
+
+        const float xh = x1 + fy * ish;
+        const float xm = x1 + fy * ism;
+        const float xl = x2;
+
+        auto subpixel = [](float y) {
+            return static_cast<uint64_t>(
+                       std::clamp<int32_t>(std::floor(y * 4.0f), -4096 * 4, 4095 * 4)) &
+                   0x3FFF;
+        };
+        auto edge = [](float x, float slope) {
+            return (static_cast<uint64_t>(static_cast<uint32_t>(to_fixed(x))) << 32) |
+                   static_cast<uint32_t>(to_fixed(slope));
+        };
+
+        bool shade = geometry(Geometry::Shade);
+        bool texture = texture_on_;
+        bool depth = geometry(Geometry::ZBuffer);
+        uint64_t id = 0x08 | (shade << 2) | (texture << 1) | depth;
+
+        command_.clear();
+        command_.push_back((id << 56) | (static_cast<uint64_t>(left) << 55) |
+                           (static_cast<uint64_t>(texture_level_) << 51) |
+                           (static_cast<uint64_t>(texture_tile_) << 48) | (subpixel(y3) << 32) |
+                           (subpixel(y2) << 16) | subpixel(y1));
+        command_.push_back(edge(xl, isl));
+        command_.push_back(edge(xh, ish));
+        command_.push_back(edge(xm, ism));
+
+        // Gradients of one attribute given its value at the three sorted vertices
+        const float factor = -1.0f / nz;
+        struct Gradient
+        {
+            int32_t start, dx, de, dy;
+        };
+        auto gradient = [&](float a1, float a2, float a3) {
+            float ma = a2 - a1, ha = a3 - a1;
+            float dx = (hy * ma - my * ha) * factor;
+            float dy = (ha * mx - ma * hx) * factor;
+            float de = dy + dx * ish;
+            return Gradient{to_fixed(a1 + fy * de), to_fixed(dx), to_fixed(de), to_fixed(dy)};
+        };
+        auto block = [this](const std::array<Gradient, 4>& g) {
+            auto pick = [&g](int32_t Gradient::*field) {
+                return std::array<int32_t, 4>{g[0].*field, g[1].*field, g[2].*field,
+                                              g[3].*field};
+            };
+            command_.push_back(integers(pick(&Gradient::start)));
+            command_.push_back(integers(pick(&Gradient::dx)));
+            command_.push_back(fractions(pick(&Gradient::start)));
+            command_.push_back(fractions(pick(&Gradient::dx)));
+            command_.push_back(integers(pick(&Gradient::de)));
+            command_.push_back(integers(pick(&Gradient::dy)));
+            command_.push_back(fractions(pick(&Gradient::de)));
+            command_.push_back(fractions(pick(&Gradient::dy)));
+        };
+
+        if (shade)
+        {
+            bool smooth = geometry(Geometry::ShadingSmooth);
+            std::array<Gradient, 4> colors;
+            for (int c = 0; c < 4; c++)
+            {
+                if (smooth)
+                {
+                    colors[c] = gradient((&v0->r)[c], (&v1->r)[c], (&v2->r)[c]);
+                }
+                else
+                {
+                    colors[c] = Gradient{to_fixed((&flat->r)[c]), 0, 0, 0};
+                }
+            }
+            block(colors);
+        }
+
+        if (texture)
+        {
+            std::array<float, 3> s = {v0->s, v1->s, v2->s};
+            std::array<float, 3> t = {v0->t, v1->t, v2->t};
+            std::array<float, 3> w = {0, 0, 0};
+            if (othermode_h_ & TEXTURE_PERSPECTIVE)
+            {
+                // W is normalized so the closest vertex gets the most precision
+                std::array<float, 3> inverse_w = {1.0f / v0->w, 1.0f / v1->w, 1.0f / v2->w};
+                float max_w = std::max({inverse_w[0], inverse_w[1], inverse_w[2]});
+                for (int i = 0; i < 3; i++)
+                {
+                    float normalized = inverse_w[i] / max_w;
+                    s[i] *= normalized;
+                    t[i] *= normalized;
+                    w[i] = normalized * 0x7FFF;
+                }
+            }
+            block({gradient(s[0], s[1], s[2]), gradient(t[0], t[1], t[2]),
+                   gradient(w[0], w[1], w[2]), Gradient{}});
+        }
+
+        if (depth)
+        {
+            Gradient z = gradient(v0->sz, v1->sz, v2->sz);
+            command_.push_back((static_cast<uint64_t>(static_cast<uint32_t>(z.start)) << 32) |
+                               static_cast<uint32_t>(z.dx));
+            command_.push_back((static_cast<uint64_t>(static_cast<uint32_t>(z.de)) << 32) |
+                               static_cast<uint32_t>(z.dy));
+        }
+
+        rdp_ptr_->queue_command(command_);
+    }
+} // namespace hydra::N64
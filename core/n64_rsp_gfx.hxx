@@ -0,0 +1,181 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace hydra::N64
+{
+    class RDP;
+
+    // Graphics microcode families that share a display list format, F3DEX covers the 1.x
+    // versions of F3DEX, F3DLX and F3DLP and F3DEX2 covers F3DZEX as well
+    enum class GraphicsUcode
+    {
+        Unknown,
+        Fast3D,
+        F3DEX,
+        F3DEX2,
+    };
+
+    // The name and version the data section of a graphics microcode carries, like
+    // "F3DEX 1.23 Yoshitaka Yasumoto 1996.", or "Fast3D" which only has a generic one. Empty if
+    // there's neither
+    std::string graphics_ucode_name(const uint8_t* rdram, uint32_t ucode_data,
+                                    uint32_t ucode_data_size);
+
+    // Identifies the graphics microcode from the version string in its data section
+    GraphicsUcode identify_graphics_ucode(const uint8_t* rdram, uint32_t ucode_data,
+                                          uint32_t ucode_data_size);
+
+    class GraphicsHle;
+    using GraphicsCommand = void (*)(GraphicsHle*, uint32_t, uint32_t);
+
+    template <auto MemberFunc>
+    static void gfx_command(GraphicsHle* hle, uint32_t w0, uint32_t w1)
+    {
+        (hle->*MemberFunc)(w0, w1);
+    }
+
+    /**
+        Walks the display lists of graphics tasks natively
+
+        Vertices are transformed, lit and clipped here and the resulting triangles are set up
+        the same way the microcode does, then handed to the RDP directly instead of going
+        through an output buffer. Commands that are meant for the RDP are passed through
+    */
+    class GraphicsHle final
+    {
+    public:
+        void InstallBuses(uint8_t* rdram_ptr, RDP* rdp_ptr);
+        void Reset();
+        // Returns false if the microcode isn't known, in which case the task has to run on
+        // the RSP
+        bool RunTask(uint32_t ucode_data, uint32_t ucode_data_size, uint32_t data_ptr);
+
+    private:
+        struct Matrix
+        {
+            alignas(16) std::array<std::array<float, 4>, 4> m;
+
+            Matrix operator*(const Matrix& other) const;
+        };
+
+        struct Vertex
+        {
+            // Clip space position and the screen position derived from it, z is in RDP units
+            float x, y, z, w;
+            float sx, sy, sz;
+            float r, g, b, a;
+            // Texture coordinates in s10.5 texels, already scaled by G_TEXTURE
+            float s, t;
+            // Outcodes against the guard band and against the screen
+            uint8_t clip, cull;
+        };
+
+        enum class Geometry
+        {
+            ZBuffer,
+            Shade,
+            ShadingSmooth,
+            CullFront,
+            CullBack,
+            Fog,
+            Lighting,
+            TexGen,
+            TexGenLinear,
+        };
+
+        struct Light
+        {
+            std::array<float, 3> color;
+            std::array<float, 3> direction;
+        };
+
+        void NOOP(uint32_t w0, uint32_t w1), UNKNOWN(uint32_t w0, uint32_t w1),
+            MTX(uint32_t w0, uint32_t w1), MOVEMEM(uint32_t w0, uint32_t w1),
+            VTX(uint32_t w0, uint32_t w1), DL(uint32_t w0, uint32_t w1),
+            ENDDL(uint32_t w0, uint32_t w1), TRI1(uint32_t w0, uint32_t w1),
+            TRI2(uint32_t w0, uint32_t w1), QUAD(uint32_t w0, uint32_t w1),
+            CULLDL(uint32_t w0, uint32_t w1), POPMTX(uint32_t w0, uint32_t w1),
+            MOVEWORD(uint32_t w0, uint32_t w1), TEXTURE(uint32_t w0, uint32_t w1),
+            SETOTHERMODE_H(uint32_t w0, uint32_t w1), SETOTHERMODE_L(uint32_t w0, uint32_t w1),
+            SETGEOMETRYMODE(uint32_t w0, uint32_t w1),
+            CLEARGEOMETRYMODE(uint32_t w0, uint32_t w1), GEOMETRYMODE(uint32_t w0, uint32_t w1),
+            RDPHALF_1(uint32_t w0, uint32_t w1), RDPHALF_2(uint32_t w0, uint32_t w1),
+            MODIFYVTX(uint32_t w0, uint32_t w1), BRANCH_Z(uint32_t w0, uint32_t w1),
+            LOAD_UCODE(uint32_t w0, uint32_t w1), RDP_PASSTHROUGH(uint32_t w0, uint32_t w1),
+            RDP_SETIMAGE(uint32_t w0, uint32_t w1), RDP_SETOTHERMODE(uint32_t w0, uint32_t w1),
+            RDP_TEXRECT(uint32_t w0, uint32_t w1);
+
+        using CommandTable = std::array<GraphicsCommand, 256>;
+
+        // The RDP commands at the top are shared by all of them
+        constexpr static CommandTable make_table(GraphicsUcode ucode);
+
+        static const CommandTable fast3d_table_;
+        static const CommandTable f3dex_table_;
+        static const CommandTable f3dex2_table_;
+
+        void reset_state();
+        void set_ucode(GraphicsUcode ucode);
+        uint32_t dram_read32(uint32_t address);
+        uint16_t dram_read16(uint32_t address);
+        uint8_t dram_read8(uint32_t address);
+        uint32_t segment_address(uint32_t address);
+        Matrix load_matrix(uint32_t address);
+        Light load_light(uint32_t address);
+        void update_combined_matrix();
+        void load_vertices(uint32_t address, unsigned first, unsigned count);
+        void modify_vertex(unsigned index, uint32_t where, uint32_t value);
+        void draw_triangle(unsigned v0, unsigned v1, unsigned v2);
+        void clip_triangle(const Vertex& v0, const Vertex& v1, const Vertex& v2);
+        void project(Vertex& vertex);
+        void compute_outcodes(Vertex& vertex);
+        void setup_triangle(const Vertex* v0, const Vertex* v1, const Vertex* v2);
+        void send(std::initializer_list<uint64_t> words);
+        void send_othermode();
+        void end_display_list();
+        unsigned vertex_index(uint32_t value);
+        bool geometry(Geometry flag);
+
+        uint8_t* rdram_ptr_ = nullptr;
+        RDP* rdp_ptr_ = nullptr;
+        GraphicsUcode ucode_ = GraphicsUcode::Unknown;
+        const CommandTable* table_ = &fast3d_table_;
+        std::vector<uint64_t> command_;
+
+        // Display list state
+        uint32_t pc_ = 0;
+        bool running_ = false;
+        std::array<uint32_t, 18> dl_stack_{};
+        unsigned dl_depth_ = 0;
+        std::array<uint32_t, 16> segments_{};
+        uint32_t rdp_half_1_ = 0, rdp_half_2_ = 0;
+
+        // Transform state
+        std::array<Matrix, 32> modelview_stack_{};
+        unsigned modelview_index_ = 0;
+        Matrix projection_{};
+        Matrix combined_{};
+        bool combined_dirty_ = true;
+        std::array<float, 3> viewport_scale_{}, viewport_translate_{};
+        float clip_ratio_ = 2.0f;
+        float fog_multiplier_ = 0, fog_offset_ = 0;
+
+        // Vertex and lighting state
+        alignas(16) std::array<Vertex, 64> vertices_{};
+        std::array<Light, 8> lights_{};
+        std::array<std::array<float, 3>, 2> lookat_{};
+        unsigned num_lights_ = 0;
+
+        // Render state
+        uint32_t geometry_mode_ = 0;
+        uint32_t othermode_h_ = 0, othermode_l_ = 0;
+        bool texture_on_ = false;
+        uint8_t texture_tile_ = 0, texture_level_ = 0;
+        float texture_scale_s_ = 0, texture_scale_t_ = 0;
+    };
+} // namespace hydra::N64
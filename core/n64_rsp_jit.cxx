@@ -0,0 +1,1347 @@
+#include <core/n64_rsp.hxx>
+#include <cstring>
+
+namespace hydra::N64
+{
+    /**
+        Translates an RspBlock to host code
+
+        Scalar registers stay in gpr_regs_. Vector registers and the accumulator are kept in
+        host registers while the block runs generated code and are written back before
+        anything else can look at them, that is before every call and at the end of the
+        block. Multiplies, VCL/VCH/VCR and the divides are emitted with SSE2, the other vector
+        instructions and the vector loads and stores call the interpreter's handlers. COP0
+        accesses go straight to read_hwio and write_hwio. The generated function always runs
+        the whole block
+
+        rbx: RSP*
+        r12: mem_
+        r13: address the current branch continues at after its delay slot
+        xmm0-xmm7: temporaries
+        xmm8-xmm12: cached vector registers
+        xmm13-xmm15: high, middle and low slice of the accumulator
+    */
+    class RSPRecompiler final
+    {
+    public:
+        RSPRecompiler(RSP& rsp, RspBlock& block, uint32_t pc) : rsp_(rsp), block_(block), pc_(pc)
+        {
+        }
+
+        // Returns false if the block has to be interpreted
+        bool Compile()
+        {
+            const std::vector<RspDecodedInstruction>& instructions = block_.instructions;
+            for (size_t i = 1; i < instructions.size(); i++)
+            {
+                // A branch in a delay slot branches relative to the first target, that is
+                // left to the interpreter
+                if (is_branch(i) && is_branch(i - 1))
+                {
+                    return false;
+                }
+            }
+
+            emit_prologue();
+            for (size_t i = 0; i < instructions.size(); i++)
+            {
+                Instruction instruction = decode(i);
+                if (is_branch(i))
+                {
+                    if (!emit_branch(instruction, i))
+                    {
+                        emit_fallback(instructions[i], i);
+                        e_.mov32(X64Reg::R13, X64Reg::RBX, offset(&rsp_.next_pc_));
+                    }
+                }
+                else if (!emit_native(instruction, i))
+                {
+                    emit_fallback(instructions[i], i);
+                }
+            }
+            emit_epilogue(instructions.size() - 1);
+            return true;
+        }
+
+        const std::vector<uint8_t>& Code()
+        {
+            return e_.Code();
+        }
+
+    private:
+        static constexpr X64Xmm T0 = X64Xmm::XMM0;
+        static constexpr X64Xmm T1 = X64Xmm::XMM1;
+        static constexpr X64Xmm T2 = X64Xmm::XMM2;
+        static constexpr X64Xmm T3 = X64Xmm::XMM3;
+        static constexpr X64Xmm T4 = X64Xmm::XMM4;
+        static constexpr X64Xmm T5 = X64Xmm::XMM5;
+        static constexpr X64Xmm T6 = X64Xmm::XMM6;
+        static constexpr X64Xmm T7 = X64Xmm::XMM7;
+        static constexpr size_t CACHED_VECTORS = 5;
+
+        enum Slice
+        {
+            High,
+            Middle,
+            Low,
+        };
+
+        struct CachedVector
+        {
+            int guest = -1;
+            bool dirty = false;
+            uint32_t last_use = 0;
+        };
+
+        struct CachedSlice
+        {
+            bool valid = false;
+            bool dirty = false;
+        };
+
+        static uint32_t read_cop0(RSP* rsp, uint32_t reg)
+        {
+            return rsp->read_hwio(static_cast<RSPHWIO>(reg));
+        }
+
+        static void write_cop0(RSP* rsp, uint32_t reg, uint32_t value)
+        {
+            rsp->write_hwio(static_cast<RSPHWIO>(reg), value);
+        }
+
+        Instruction decode(size_t index)
+        {
+            Instruction instruction;
+            instruction.full = block_.instructions[index].instruction;
+            return instruction;
+        }
+
+        bool is_branch(size_t index)
+        {
+            return rsp_is_branch(decode(index));
+        }
+
+        bool in_delay_slot(size_t index)
+        {
+            return index != 0 && is_branch(index - 1);
+        }
+
+        uint32_t address(size_t index)
+        {
+            return pc_ + index * 4;
+        }
+
+        int32_t offset(const void* member)
+        {
+            return static_cast<int32_t>(reinterpret_cast<const uint8_t*>(member) -
+                                        reinterpret_cast<const uint8_t*>(&rsp_));
+        }
+
+        int32_t gpr(uint32_t reg)
+        {
+            return offset(&rsp_.gpr_regs_[reg]);
+        }
+
+        void load32(X64Reg dst, uint32_t reg)
+        {
+            if (reg == 0)
+                e_.xor32(dst, dst);
+            else
+                e_.mov32(dst, X64Reg::RBX, gpr(reg));
+        }
+
+        void load32_signed(X64Reg dst, uint32_t reg)
+        {
+            if (reg == 0)
+                e_.xor32(dst, dst);
+            else
+                e_.movsxd(dst, X64Reg::RBX, gpr(reg));
+        }
+
+        void store32(uint32_t reg, X64Reg src)
+        {
+            e_.store32(X64Reg::RBX, gpr(reg), src);
+        }
+
+        // pc_ and next_pc_ as the interpreter has them while it runs the instruction
+        void write_pc_state(size_t index)
+        {
+            if (in_delay_slot(index))
+            {
+                e_.store32(X64Reg::RBX, offset(&rsp_.pc_), X64Reg::R13);
+                e_.lea64(X64Reg::RAX, X64Reg::R13, 4);
+                e_.and_imm(false, X64Reg::RAX, 0xFFF);
+                e_.store32(X64Reg::RBX, offset(&rsp_.next_pc_), X64Reg::RAX);
+            }
+            else
+            {
+                e_.store32_imm(X64Reg::RBX, offset(&rsp_.pc_), (address(index) + 4) & 0xFFF);
+                e_.store32_imm(X64Reg::RBX, offset(&rsp_.next_pc_),
+                               (address(index) + 8) & 0xFFF);
+            }
+        }
+
+        void emit_prologue()
+        {
+            // Three pushes keep the stack 16 byte aligned for the calls
+            e_.push(X64Reg::RBX);
+            e_.push(X64Reg::R12);
+            e_.push(X64Reg::R13);
+            e_.mov64(X64Reg::RBX, X64Reg::RDI);
+            e_.lea64(X64Reg::R12, X64Reg::RBX, offset(rsp_.mem_.data()));
+            e_.store32_imm(X64Reg::RBX, gpr(0), 0);
+        }
+
+        void emit_epilogue(size_t last)
+        {
+            writeback();
+            e_.store32_imm(X64Reg::RBX, offset(&rsp_.instruction_),
+                           block_.instructions[last].instruction);
+            if (is_branch(last))
+            {
+                // The delay slot is in the next block
+                e_.store32_imm(X64Reg::RBX, offset(&rsp_.pc_), (address(last) + 4) & 0xFFF);
+                e_.store32(X64Reg::RBX, offset(&rsp_.next_pc_), X64Reg::R13);
+            }
+            else
+            {
+                write_pc_state(last);
+            }
+            e_.pop(X64Reg::R13);
+            e_.pop(X64Reg::R12);
+            e_.pop(X64Reg::RBX);
+            e_.ret();
+        }
+
+        // Sets up the state the handler expects and calls it, the caller takes care of the
+        // host registers
+        void emit_call(const RspDecodedInstruction& cached, size_t index)
+        {
+            e_.store32_imm(X64Reg::RBX, offset(&rsp_.instruction_), cached.instruction);
+            write_pc_state(index);
+            e_.mov64(X64Reg::RDI, X64Reg::RBX);
+            e_.mov64_imm(X64Reg::RAX, reinterpret_cast<uint64_t>(cached.handler));
+            e_.call(X64Reg::RAX);
+            e_.store32_imm(X64Reg::RBX, gpr(0), 0);
+        }
+
+        void emit_fallback(const RspDecodedInstruction& cached, size_t index)
+        {
+            flush();
+            emit_call(cached, index);
+        }
+
+        // Vector register and accumulator caching. Calls clobber every xmm register, so
+        // everything is written back and forgotten before them
+        X64Xmm vector_host(size_t slot)
+        {
+            return static_cast<X64Xmm>(static_cast<uint8_t>(X64Xmm::XMM8) + slot);
+        }
+
+        X64Xmm slice_host(Slice slice)
+        {
+            return static_cast<X64Xmm>(static_cast<uint8_t>(X64Xmm::XMM13) + slice);
+        }
+
+        int32_t vector_offset(uint32_t reg)
+        {
+            return offset(rsp_.vu_regs_[reg].data());
+        }
+
+        int32_t slice_offset(Slice slice)
+        {
+            switch (slice)
+            {
+                case High:
+                    return offset(rsp_.accumulator_.high.data());
+                case Middle:
+                    return offset(rsp_.accumulator_.middle.data());
+                default:
+                    return offset(rsp_.accumulator_.low.data());
+            }
+        }
+
+        X64Xmm cache_vector(uint32_t reg, bool load)
+        {
+            size_t victim = 0;
+            for (size_t i = 0; i < CACHED_VECTORS; i++)
+            {
+                if (vectors_[i].guest == static_cast<int>(reg))
+                {
+                    vectors_[i].last_use = ++use_counter_;
+                    return vector_host(i);
+                }
+                if (vectors_[i].last_use < vectors_[victim].last_use)
+                {
+                    victim = i;
+                }
+            }
+
+            CachedVector& slot = vectors_[victim];
+            if (slot.guest != -1 && slot.dirty)
+            {
+                e_.movdqu(X64Reg::RBX, vector_offset(slot.guest), vector_host(victim));
+            }
+            if (load)
+            {
+                e_.movdqu(vector_host(victim), X64Reg::RBX, vector_offset(reg));
+            }
+            slot = {static_cast<int>(reg), false, ++use_counter_};
+            return vector_host(victim);
+        }
+
+        void mark_dirty(uint32_t reg)
+        {
+            for (CachedVector& slot : vectors_)
+            {
+                if (slot.guest == static_cast<int>(reg))
+                {
+                    slot.dirty = true;
+                }
+            }
+        }
+
+        X64Xmm read_vector(uint32_t reg)
+        {
+            return cache_vector(reg, true);
+        }
+
+        // For results that replace all lanes
+        X64Xmm write_vector(uint32_t reg)
+        {
+            X64Xmm host = cache_vector(reg, false);
+            mark_dirty(reg);
+            return host;
+        }
+
+        X64Xmm modify_vector(uint32_t reg)
+        {
+            X64Xmm host = cache_vector(reg, true);
+            mark_dirty(reg);
+            return host;
+        }
+
+        X64Xmm read_slice(Slice slice)
+        {
+            if (!slices_[slice].valid)
+            {
+                e_.movdqu(slice_host(slice), X64Reg::RBX, slice_offset(slice));
+                slices_[slice].valid = true;
+            }
+            return slice_host(slice);
+        }
+
+        X64Xmm write_slice(Slice slice)
+        {
+            slices_[slice] = {true, true};
+            return slice_host(slice);
+        }
+
+        void writeback()
+        {
+            for (size_t i = 0; i < CACHED_VECTORS; i++)
+            {
+                if (vectors_[i].guest != -1 && vectors_[i].dirty)
+                {
+                    e_.movdqu(X64Reg::RBX, vector_offset(vectors_[i].guest), vector_host(i));
+                }
+            }
+            for (Slice slice : {High, Middle, Low})
+            {
+                if (slices_[slice].dirty)
+                {
+                    e_.movdqu(X64Reg::RBX, slice_offset(slice), slice_host(slice));
+                }
+            }
+        }
+
+        // Reloads everything cached after a call on a path that kept the cache state
+        void reload()
+        {
+            for (size_t i = 0; i < CACHED_VECTORS; i++)
+            {
+                if (vectors_[i].guest != -1)
+                {
+                    e_.movdqu(vector_host(i), X64Reg::RBX, vector_offset(vectors_[i].guest));
+                }
+            }
+            for (Slice slice : {High, Middle, Low})
+            {
+                if (slices_[slice].valid)
+                {
+                    e_.movdqu(slice_host(slice), X64Reg::RBX, slice_offset(slice));
+                }
+            }
+        }
+
+        void flush()
+        {
+            writeback();
+            vectors_ = {};
+            slices_ = {};
+        }
+
+        bool emit_branch(Instruction instruction, size_t index)
+        {
+            uint32_t rs = instruction.RType.rs;
+            uint32_t rt = instruction.RType.rt;
+            // Same arithmetic as the interpreter, pc_ already points to the delay slot
+            uint32_t pc = (address(index) + 4) & 0xFFF;
+            int16_t offset16 = instruction.IType.immediate << 2;
+            int32_t seoffset = offset16;
+            uint32_t target = (pc + seoffset) & 0xFFC;
+            uint32_t link = pc + 4;
+            X64Cond cond;
+            bool and_link = false;
+            switch (instruction.IType.op)
+            {
+                case 0:
+                {
+                    // JR, JALR
+                    uint32_t rd = instruction.RType.rd;
+                    load32(X64Reg::R13, rs);
+                    e_.and_imm(false, X64Reg::R13, 0xFFC);
+                    if (instruction.RType.func == 9 && rd != 0)
+                    {
+                        e_.store32_imm(X64Reg::RBX, gpr(rd), link);
+                    }
+                    return true;
+                }
+                case 1:
+                {
+                    switch (rt)
+                    {
+                        case 0:
+                        case 16:
+                            cond = X64Cond::L;
+                            break;
+                        case 1:
+                        case 17:
+                            cond = X64Cond::GE;
+                            break;
+                        default:
+                            return false;
+                    }
+                    and_link = rt & 0x10;
+                    load32_signed(X64Reg::RAX, rs);
+                    e_.test(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                }
+                case 2:
+                case 3:
+                {
+                    if (instruction.IType.op == 3)
+                    {
+                        e_.store32_imm(X64Reg::RBX, gpr(31), link);
+                    }
+                    e_.mov64_imm(X64Reg::R13, (instruction.JType.target << 2) & 0xFFC);
+                    return true;
+                }
+                case 4:
+                case 5:
+                    load32(X64Reg::RAX, rs);
+                    load32(X64Reg::RCX, rt);
+                    e_.cmp(X64Reg::RAX, X64Reg::RCX);
+                    cond = instruction.IType.op == 4 ? X64Cond::E : X64Cond::NE;
+                    break;
+                case 6:
+                case 7:
+                    load32_signed(X64Reg::RAX, rs);
+                    e_.test(X64Reg::RAX, X64Reg::RAX);
+                    cond = instruction.IType.op == 6 ? X64Cond::LE : X64Cond::G;
+                    break;
+                default:
+                    return false;
+            }
+
+            // None of these touch the flags
+            if (and_link)
+            {
+                e_.store32_imm(X64Reg::RBX, gpr(31), link);
+            }
+            e_.mov64_imm(X64Reg::R13, (pc + 4) & 0xFFF);
+            e_.mov64_imm(X64Reg::RDX, target);
+            e_.cmovcc(cond, X64Reg::R13, X64Reg::RDX);
+            return true;
+        }
+
+        bool emit_native(Instruction instruction, size_t index)
+        {
+            uint32_t rs = instruction.IType.rs;
+            uint32_t rt = instruction.IType.rt;
+            uint32_t immediate = instruction.IType.immediate;
+            int32_t seimm = static_cast<int16_t>(immediate);
+            switch (instruction.IType.op)
+            {
+                case 0:
+                    return emit_special(instruction);
+                case 9:
+                case 10:
+                case 11:
+                case 12:
+                case 13:
+                case 14:
+                case 15:
+                    break;
+                case 16:
+                    return emit_cop0(instruction, index);
+                case 18:
+                    return (instruction.RType.rs & 0x10) && emit_vector(instruction);
+                case 32:
+                case 33:
+                case 35:
+                case 36:
+                case 37:
+                case 39:
+                case 40:
+                case 41:
+                case 43:
+                    emit_memory(instruction, index);
+                    return true;
+                default:
+                    return false;
+            }
+
+            if (rt == 0)
+            {
+                return true;
+            }
+
+            switch (instruction.IType.op)
+            {
+                case 9:
+                    // ADDIU
+                    load32(X64Reg::RAX, rs);
+                    e_.add_imm(false, X64Reg::RAX, seimm);
+                    break;
+                case 10:
+                    // SLTI
+                    load32_signed(X64Reg::RAX, rs);
+                    e_.cmp_imm(X64Reg::RAX, seimm);
+                    e_.setcc(X64Cond::L, X64Reg::RAX);
+                    e_.movzx8(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 11:
+                    // SLTIU
+                    load32(X64Reg::RAX, rs);
+                    e_.mov64_imm(X64Reg::RCX, static_cast<uint32_t>(seimm));
+                    e_.cmp(X64Reg::RAX, X64Reg::RCX);
+                    e_.setcc(X64Cond::B, X64Reg::RAX);
+                    e_.movzx8(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 12:
+                    // ANDI
+                    load32(X64Reg::RAX, rs);
+                    e_.and_imm(false, X64Reg::RAX, immediate);
+                    break;
+                case 13:
+                    // ORI
+                    load32(X64Reg::RAX, rs);
+                    e_.or_imm(X64Reg::RAX, immediate);
+                    break;
+                case 14:
+                    // XORI
+                    load32(X64Reg::RAX, rs);
+                    e_.xor_imm(X64Reg::RAX, immediate);
+                    break;
+                case 15:
+                    // LUI
+                    e_.store32_imm(X64Reg::RBX, gpr(rt), immediate << 16);
+                    return true;
+            }
+            store32(rt, X64Reg::RAX);
+            return true;
+        }
+
+        bool emit_special(Instruction instruction)
+        {
+            uint32_t rs = instruction.RType.rs;
+            uint32_t rt = instruction.RType.rt;
+            uint32_t rd = instruction.RType.rd;
+            uint8_t sa = instruction.RType.sa;
+            switch (instruction.RType.func)
+            {
+                case 0:
+                case 2:
+                case 3:
+                case 4:
+                case 6:
+                case 7:
+                case 32:
+                case 33:
+                case 34:
+                case 35:
+                case 36:
+                case 37:
+                case 38:
+                case 39:
+                case 42:
+                case 43:
+                    break;
+                default:
+                    return false;
+            }
+
+            if (rd == 0)
+            {
+                return true;
+            }
+
+            switch (instruction.RType.func)
+            {
+                case 0:
+                    // SLL
+                    load32(X64Reg::RAX, rt);
+                    e_.shl_imm(false, X64Reg::RAX, sa);
+                    break;
+                case 2:
+                    // SRL
+                    load32(X64Reg::RAX, rt);
+                    e_.shr_imm(false, X64Reg::RAX, sa);
+                    break;
+                case 3:
+                    // SRA
+                    load32(X64Reg::RAX, rt);
+                    e_.sar_imm(false, X64Reg::RAX, sa);
+                    break;
+                case 4:
+                    // SLLV, the host masks the amount the same way
+                    load32(X64Reg::RAX, rt);
+                    load32(X64Reg::RCX, rs);
+                    e_.shl_cl(false, X64Reg::RAX);
+                    break;
+                case 6:
+                    // SRLV
+                    load32(X64Reg::RAX, rt);
+                    load32(X64Reg::RCX, rs);
+                    e_.shr_cl(false, X64Reg::RAX);
+                    break;
+                case 7:
+                    // SRAV
+                    load32(X64Reg::RAX, rt);
+                    load32(X64Reg::RCX, rs);
+                    e_.sar_cl(false, X64Reg::RAX);
+                    break;
+                case 32:
+                case 33:
+                    // ADDU
+                    load32(X64Reg::RAX, rs);
+                    load32(X64Reg::RCX, rt);
+                    e_.add(false, X64Reg::RAX, X64Reg::RCX);
+                    break;
+                case 34:
+                case 35:
+                    // SUBU
+                    load32(X64Reg::RAX, rs);
+                    load32(X64Reg::RCX, rt);
+                    e_.sub(false, X64Reg::RAX, X64Reg::RCX);
+                    break;
+                case 36:
+                    // AND
+                    load32(X64Reg::RAX, rs);
+                    load32(X64Reg::RCX, rt);
+                    e_.and_(X64Reg::RAX, X64Reg::RCX);
+                    break;
+                case 37:
+                    // OR
+                    load32(X64Reg::RAX, rs);
+                    load32(X64Reg::RCX, rt);
+                    e_.or_(X64Reg::RAX, X64Reg::RCX);
+                    break;
+                case 38:
+                    // XOR
+                    load32(X64Reg::RAX, rs);
+                    load32(X64Reg::RCX, rt);
+                    e_.xor_(X64Reg::RAX, X64Reg::RCX);
+                    break;
+                case 39:
+                    // NOR
+                    load32(X64Reg::RAX, rs);
+                    load32(X64Reg::RCX, rt);
+                    e_.or_(X64Reg::RAX, X64Reg::RCX);
+                    e_.not_(X64Reg::RAX);
+                    break;
+                case 42:
+                    // SLT
+                    load32_signed(X64Reg::RAX, rs);
+                    load32_signed(X64Reg::RCX, rt);
+                    e_.cmp(X64Reg::RAX, X64Reg::RCX);
+                    e_.setcc(X64Cond::L, X64Reg::RAX);
+                    e_.movzx8(X64Reg::RAX, X64Reg::RAX);
+                    break;
+                case 43:
+                    // SLTU
+                    load32(X64Reg::RAX, rs);
+                    load32(X64Reg::RCX, rt);
+                    e_.cmp(X64Reg::RAX, X64Reg::RCX);
+                    e_.setcc(X64Cond::B, X64Reg::RAX);
+                    e_.movzx8(X64Reg::RAX, X64Reg::RAX);
+                    break;
+            }
+            store32(rd, X64Reg::RAX);
+            return true;
+        }
+
+        // Accesses that wrap around the end of DMEM go through the handler
+        void emit_memory(Instruction instruction, size_t index)
+        {
+            uint32_t op = instruction.IType.op;
+            uint32_t rt = instruction.IType.rt;
+            bool load = op < 40;
+            if (load && rt == 0)
+            {
+                return;
+            }
+
+            load32(X64Reg::RAX, instruction.IType.rs);
+            e_.add_imm(false, X64Reg::RAX, static_cast<int16_t>(instruction.IType.immediate));
+            e_.and_imm(false, X64Reg::RAX, 0xFFF);
+
+            X64Emitter::Label slow_path = 0;
+            // The low two bits of the opcode are 0, 1 and 3 for bytes, halfwords and words
+            uint32_t size = (op & 0b11) == 3 ? 4 : 1 << (op & 0b11);
+            if (size == 2)
+            {
+                e_.cmp_imm(X64Reg::RAX, 0xFFF);
+                slow_path = e_.jcc(X64Cond::E);
+            }
+            else if (size == 4)
+            {
+                e_.cmp_imm(X64Reg::RAX, 0xFFC);
+                slow_path = e_.jcc(X64Cond::A);
+            }
+
+            if (!load)
+            {
+                load32(X64Reg::RCX, rt);
+            }
+            switch (op)
+            {
+                case 32:
+                    // LB
+                    e_.movsx8(X64Reg::RCX, X64Reg::R12, X64Reg::RAX);
+                    break;
+                case 33:
+                    // LH
+                    e_.movzx16(X64Reg::RCX, X64Reg::R12, X64Reg::RAX);
+                    e_.rol16_imm(X64Reg::RCX, 8);
+                    e_.movsx16(X64Reg::RCX, X64Reg::RCX);
+                    break;
+                case 35:
+                case 39:
+                    // LW, LWU
+                    e_.mov32(X64Reg::RCX, X64Reg::R12, X64Reg::RAX);
+                    e_.bswap(false, X64Reg::RCX);
+                    break;
+                case 36:
+                    // LBU
+                    e_.movzx8(X64Reg::RCX, X64Reg::R12, X64Reg::RAX);
+                    break;
+                case 37:
+                    // LHU
+                    e_.movzx16(X64Reg::RCX, X64Reg::R12, X64Reg::RAX);
+                    e_.rol16_imm(X64Reg::RCX, 8);
+                    break;
+                case 40:
+                    // SB
+                    e_.store8(X64Reg::R12, X64Reg::RAX, X64Reg::RCX);
+                    break;
+                case 41:
+                    // SH
+                    e_.rol16_imm(X64Reg::RCX, 8);
+                    e_.store16(X64Reg::R12, X64Reg::RAX, X64Reg::RCX);
+                    break;
+                case 43:
+                    // SW
+                    e_.bswap(false, X64Reg::RCX);
+                    e_.store32(X64Reg::R12, X64Reg::RAX, X64Reg::RCX);
+                    break;
+            }
+            if (load)
+            {
+                store32(rt, X64Reg::RCX);
+            }
+
+            if (size != 1)
+            {
+                X64Emitter::Label done = e_.jmp();
+                e_.Bind(slow_path);
+                // The cache state has to match the fast path afterwards
+                writeback();
+                emit_call(block_.instructions[index], index);
+                reload();
+                e_.Bind(done);
+            }
+        }
+
+        bool emit_cop0(Instruction instruction, size_t index)
+        {
+            uint32_t rt = instruction.RType.rt;
+            uint32_t rd = instruction.RType.rd;
+            bool move_to = instruction.RType.rs == 4;
+            if (instruction.RType.rs != 0 && !move_to)
+            {
+                return false;
+            }
+
+            flush();
+            e_.store32_imm(X64Reg::RBX, offset(&rsp_.instruction_),
+                           block_.instructions[index].instruction);
+            write_pc_state(index);
+            if (move_to)
+            {
+                load32(X64Reg::RDX, rt);
+            }
+            e_.mov64(X64Reg::RDI, X64Reg::RBX);
+            e_.mov64_imm(X64Reg::RSI, rd);
+            e_.mov64_imm(X64Reg::RAX, move_to ? reinterpret_cast<uint64_t>(&write_cop0)
+                                              : reinterpret_cast<uint64_t>(&read_cop0));
+            e_.call(X64Reg::RAX);
+            if (!move_to && rt != 0)
+            {
+                store32(rt, X64Reg::RAX);
+            }
+            return true;
+        }
+
+        // dst = mask ? value : dst, tmp may be value when that isn't needed anymore
+        void blend(X64Xmm dst, X64Xmm mask, X64Xmm value, X64Xmm tmp)
+        {
+            if (tmp != value)
+            {
+                e_.movdqa(tmp, value);
+            }
+            e_.pxor(tmp, dst);
+            e_.pand(tmp, mask);
+            e_.pxor(dst, tmp);
+        }
+
+        void ones(X64Xmm reg)
+        {
+            e_.pcmpeqw(reg, reg);
+        }
+
+        void zero(X64Xmm reg)
+        {
+            e_.pxor(reg, reg);
+        }
+
+        // Broadcasts the lanes like the element field of an instruction does
+        void broadcast(X64Xmm reg, uint32_t element)
+        {
+            if (element >= 8)
+            {
+                uint32_t lane = element & 0b111;
+                if (lane < 4)
+                {
+                    e_.pshuflw(reg, reg, lane * 0x55);
+                    e_.pshufd(reg, reg, 0x00);
+                }
+                else
+                {
+                    e_.pshufhw(reg, reg, (lane - 4) * 0x55);
+                    e_.pshufd(reg, reg, 0xFF);
+                }
+            }
+            else if (element >= 4)
+            {
+                e_.pshuflw(reg, reg, (element & 0b11) * 0x55);
+                e_.pshufhw(reg, reg, (element & 0b11) * 0x55);
+            }
+            else if (element >= 2)
+            {
+                uint8_t order = (element & 1) ? 0xF5 : 0xA0;
+                e_.pshuflw(reg, reg, order);
+                e_.pshufhw(reg, reg, order);
+            }
+        }
+
+        // vs in T0 and the broadcast vt in T1
+        void load_operands(VUInstruction instruction)
+        {
+            e_.movdqa(T0, read_vector(instruction.vs));
+            e_.movdqa(T1, read_vector(instruction.vt));
+            broadcast(T1, instruction.element);
+        }
+
+        // Signed 32-bit products of the lanes of a and b, high halves in T2 and low ones in
+        // T3. Mixed treats b as unsigned
+        void multiply(X64Xmm a, X64Xmm b, bool mixed)
+        {
+            e_.movdqa(T2, a);
+            e_.pmulhw(T2, b);
+            e_.movdqa(T3, a);
+            e_.pmullw(T3, b);
+            if (mixed)
+            {
+                // pmulhw treats b as signed, a << 16 is added back where b has the top bit set
+                e_.movdqa(T7, b);
+                e_.psraw_imm(T7, 15);
+                e_.pand(T7, a);
+                e_.paddw(T2, T7);
+            }
+        }
+
+        // Adds the 48-bit value in T2:T3:T4 to the accumulator with carries between the
+        // slices, clobbers T2-T7
+        void accumulate()
+        {
+            X64Xmm high = read_slice(High);
+            X64Xmm middle = read_slice(Middle);
+            X64Xmm low = read_slice(Low);
+            slices_[High].dirty = slices_[Middle].dirty = slices_[Low].dirty = true;
+
+            e_.paddw(T4, low);
+            // Carried out of the low slice when the old value is above the sum
+            e_.movdqa(T6, low);
+            e_.psubusw(T6, T4);
+            e_.movdqa(low, T4);
+            zero(T4);
+            e_.pcmpeqw(T6, T4);
+            ones(T7);
+            e_.pxor(T6, T7);
+
+            e_.paddw(T3, middle);
+            e_.movdqa(T5, middle);
+            e_.psubusw(T5, T3);
+            e_.pcmpeqw(T5, T4);
+            e_.pxor(T5, T7);
+            // The low carry only ripples into the high slice when the middle one is all ones
+            e_.movdqa(T4, T3);
+            e_.pcmpeqw(T4, T7);
+            e_.pand(T4, T6);
+            e_.por(T5, T4);
+
+            e_.movdqa(middle, T3);
+            e_.psubw(middle, T6);
+            e_.paddw(high, T2);
+            e_.psubw(high, T5);
+        }
+
+        // clamp_signed(accumulator >> 16)
+        void clamp_signed(X64Xmm dst)
+        {
+            X64Xmm high = read_slice(High);
+            X64Xmm middle = read_slice(Middle);
+            e_.movdqa(dst, middle);
+            e_.punpcklwd(dst, high);
+            e_.movdqa(T6, middle);
+            e_.punpckhwd(T6, high);
+            e_.packssdw(dst, T6);
+        }
+
+        // clamp_unsigned(accumulator >> 16)
+        void clamp_unsigned(X64Xmm dst)
+        {
+            X64Xmm high = read_slice(High);
+            X64Xmm middle = read_slice(Middle);
+            // accumulator >> 31 saturated to 16 bits, 0 when the value fits
+            e_.movdqa(dst, middle);
+            e_.punpcklwd(dst, high);
+            e_.psrad_imm(dst, 15);
+            e_.movdqa(T6, middle);
+            e_.punpckhwd(T6, high);
+            e_.psrad_imm(T6, 15);
+            e_.packssdw(dst, T6);
+            zero(T7);
+            e_.movdqa(T6, dst);
+            e_.pcmpeqw(T6, T7);
+            e_.pcmpgtw(dst, T7);
+            e_.pand(T6, middle);
+            e_.por(dst, T6);
+        }
+
+        // The low slice when the high one is a sign extension of the middle one, otherwise
+        // 0 or 0xFFFF depending on the sign
+        void clamp_low(X64Xmm dst)
+        {
+            X64Xmm high = read_slice(High);
+            X64Xmm middle = read_slice(Middle);
+            X64Xmm low = read_slice(Low);
+            e_.movdqa(T6, middle);
+            e_.psraw_imm(T6, 15);
+            e_.pcmpeqw(T6, high);
+            e_.movdqa(dst, high);
+            e_.psraw_imm(dst, 15);
+            ones(T7);
+            e_.pxor(dst, T7);
+            blend(dst, T6, low, T7);
+        }
+
+        // VMULF through VMADH, same steps as the SSE4.1 interpreter
+        void emit_multiply(VUInstruction instruction, uint32_t func)
+        {
+            load_operands(instruction);
+            bool accumulating = func & 0b1000;
+            X64Xmm result = T0;
+            switch (func & 0b111)
+            {
+                case 0:
+                case 1:
+                    // VMULF, VMULU, VMACF, VMACU work on the doubled product
+                    multiply(T0, T1, false);
+                    e_.movdqa(T4, T3);
+                    e_.psllw_imm(T4, 1);
+                    e_.psrlw_imm(T3, 15);
+                    e_.movdqa(T5, T2);
+                    e_.psllw_imm(T5, 1);
+                    e_.por(T3, T5);
+                    e_.psraw_imm(T2, 15);
+                    if (!accumulating)
+                    {
+                        // The product becomes the accumulator and gets rounded
+                        e_.movdqa(write_slice(High), T2);
+                        e_.movdqa(write_slice(Middle), T3);
+                        e_.movdqa(write_slice(Low), T4);
+                        zero(T2);
+                        zero(T3);
+                        ones(T4);
+                        e_.psllw_imm(T4, 15);
+                    }
+                    accumulate();
+                    if (func & 1)
+                        clamp_unsigned(result);
+                    else
+                        clamp_signed(result);
+                    break;
+                case 4:
+                    // VMUDL, VMADL
+                    e_.movdqa(T4, T0);
+                    e_.pmulhuw(T4, T1);
+                    if (!accumulating)
+                    {
+                        zero(write_slice(High));
+                        zero(write_slice(Middle));
+                        e_.movdqa(write_slice(Low), T4);
+                        result = T4;
+                        break;
+                    }
+                    zero(T2);
+                    zero(T3);
+                    accumulate();
+                    clamp_low(result);
+                    break;
+                case 5:
+                case 6:
+                    // VMUDM, VMUDN, VMADM, VMADN, the unsigned operand is vt or vs
+                    if ((func & 0b111) == 5)
+                        multiply(T0, T1, true);
+                    else
+                        multiply(T1, T0, true);
+                    if (!accumulating)
+                    {
+                        e_.movdqa(write_slice(High), T2);
+                        e_.psraw_imm(write_slice(High), 15);
+                        e_.movdqa(write_slice(Middle), T2);
+                        e_.movdqa(write_slice(Low), T3);
+                        result = (func & 0b111) == 5 ? T2 : T3;
+                        break;
+                    }
+                    e_.movdqa(T4, T3);
+                    e_.movdqa(T3, T2);
+                    e_.psraw_imm(T2, 15);
+                    accumulate();
+                    if ((func & 0b111) == 5)
+                        clamp_signed(result);
+                    else
+                        clamp_low(result);
+                    break;
+                case 7:
+                    // VMUDH, VMADH
+                    multiply(T0, T1, false);
+                    if (!accumulating)
+                    {
+                        e_.movdqa(write_slice(High), T2);
+                        e_.movdqa(write_slice(Middle), T3);
+                        zero(write_slice(Low));
+                    }
+                    else
+                    {
+                        zero(T4);
+                        accumulate();
+                    }
+                    clamp_signed(result);
+                    break;
+            }
+            e_.movdqa(write_vector(instruction.vd), result);
+        }
+
+        void emit_vch(VUInstruction instruction)
+        {
+            load_operands(instruction);
+            // sign in T2, vt < 0 in T3
+            e_.movdqa(T2, T0);
+            e_.pxor(T2, T1);
+            e_.psraw_imm(T2, 15);
+            e_.movdqa(T3, T1);
+            e_.psraw_imm(T3, 15);
+            e_.movdqu(X64Reg::RBX, offset(rsp_.vco_.Low().data()), T2);
+            // Sum in T4, difference in T5
+            e_.movdqa(T4, T0);
+            e_.paddw(T4, T1);
+            e_.movdqa(T5, T0);
+            e_.psubw(T5, T1);
+
+            // VCO high is set unless the compared value is zero or vs is ~vt
+            e_.movdqa(T6, T5);
+            blend(T6, T2, T4, T7);
+            zero(T7);
+            e_.pcmpeqw(T6, T7);
+            ones(T7);
+            e_.pxor(T7, T1);
+            e_.pcmpeqw(T7, T0);
+            e_.por(T6, T7);
+            ones(T7);
+            e_.pxor(T6, T7);
+            e_.movdqu(X64Reg::RBX, offset(rsp_.vco_.High().data()), T6);
+
+            ones(T6);
+            e_.pcmpeqw(T6, T4);
+            e_.pand(T6, T2);
+            e_.movdqu(X64Reg::RBX, offset(rsp_.vce_.Lanes().data()), T6);
+
+            // sum <= 0 in T6, difference >= 0 in T4
+            ones(T6);
+            e_.psrlw_imm(T6, 15);
+            e_.pcmpgtw(T6, T4);
+            ones(T4);
+            e_.movdqa(T7, T5);
+            e_.psraw_imm(T7, 15);
+            e_.pxor(T4, T7);
+
+            e_.movdqa(T5, T3);
+            blend(T5, T2, T6, T7);
+            e_.movdqu(X64Reg::RBX, offset(rsp_.vcc_.Low().data()), T5);
+            e_.movdqa(T5, T4);
+            blend(T5, T2, T3, T7);
+            e_.movdqu(X64Reg::RBX, offset(rsp_.vcc_.High().data()), T5);
+
+            e_.movdqa(T5, T0);
+            blend(T5, T4, T1, T7);
+            zero(T3);
+            e_.psubw(T3, T1);
+            e_.movdqa(T4, T0);
+            blend(T4, T6, T3, T3);
+            blend(T5, T2, T4, T4);
+            e_.movdqa(write_slice(Low), T5);
+            e_.movdqa(write_vector(instruction.vd), T5);
+        }
+
+        void emit_vcr(VUInstruction instruction)
+        {
+            load_operands(instruction);
+            e_.movdqa(T2, T0);
+            e_.pxor(T2, T1);
+            e_.psraw_imm(T2, 15);
+            e_.movdqa(T3, T1);
+            e_.psraw_imm(T3, 15);
+
+            // Greater or equal in T4, less or equal in T5
+            e_.movdqa(T4, T1);
+            e_.pcmpgtw(T4, T0);
+            ones(T5);
+            e_.pxor(T4, T5);
+            blend(T4, T2, T3, T7);
+            e_.movdqa(T6, T0);
+            e_.paddw(T6, T1);
+            e_.psraw_imm(T6, 15);
+            e_.movdqa(T5, T3);
+            blend(T5, T2, T6, T6);
+
+            e_.movdqa(T6, T4);
+            blend(T6, T2, T5, T7);
+            e_.movdqa(T3, T1);
+            e_.pxor(T3, T2);
+            blend(T0, T6, T3, T3);
+
+            e_.movdqu(X64Reg::RBX, offset(rsp_.vcc_.Low().data()), T5);
+            e_.movdqu(X64Reg::RBX, offset(rsp_.vcc_.High().data()), T4);
+            clear_vco_vce();
+            e_.movdqa(write_slice(Low), T0);
+            e_.movdqa(write_vector(instruction.vd), T0);
+        }
+
+        void emit_vcl(VUInstruction instruction)
+        {
+            load_operands(instruction);
+            // Sum in T7, no carry in T2, sum == 0 in T7
+            e_.movdqa(T7, T0);
+            e_.paddw(T7, T1);
+            e_.movdqa(T2, T0);
+            e_.psubusw(T2, T7);
+            zero(T3);
+            e_.pcmpeqw(T2, T3);
+            e_.pcmpeqw(T7, T3);
+
+            // Less or equal in T3, picked by VCE
+            e_.movdqa(T3, T2);
+            e_.pand(T3, T7);
+            e_.por(T2, T7);
+            e_.movdqu(T4, X64Reg::RBX, offset(rsp_.vce_.Lanes().data()));
+            blend(T3, T4, T2, T2);
+
+            // Greater or equal in T2
+            e_.movdqa(T2, T1);
+            e_.psubusw(T2, T0);
+            zero(T4);
+            e_.pcmpeqw(T2, T4);
+
+            // Each flag is only updated in the lanes where VCO says the comparison is needed
+            e_.movdqu(T4, X64Reg::RBX, offset(rsp_.vco_.Low().data()));
+            e_.movdqu(T5, X64Reg::RBX, offset(rsp_.vco_.High().data()));
+            e_.movdqa(T6, T5);
+            e_.pandn(T6, T4);
+            e_.movdqu(T7, X64Reg::RBX, offset(rsp_.vcc_.Low().data()));
+            blend(T7, T6, T3, T3);
+            e_.movdqu(X64Reg::RBX, offset(rsp_.vcc_.Low().data()), T7);
+            e_.movdqa(T6, T4);
+            e_.por(T6, T5);
+            e_.movdqu(T5, X64Reg::RBX, offset(rsp_.vcc_.High().data()));
+            blend(T2, T6, T5, T5);
+            e_.movdqu(X64Reg::RBX, offset(rsp_.vcc_.High().data()), T2);
+
+            e_.movdqa(T5, T0);
+            blend(T5, T2, T1, T6);
+            zero(T3);
+            e_.psubw(T3, T1);
+            e_.movdqa(T6, T0);
+            blend(T6, T7, T3, T3);
+            blend(T5, T4, T6, T6);
+
+            clear_vco_vce();
+            e_.movdqa(write_slice(Low), T5);
+            e_.movdqa(write_vector(instruction.vd), T5);
+        }
+
+        void clear_vco_vce()
+        {
+            zero(T1);
+            e_.movdqu(X64Reg::RBX, offset(rsp_.vco_.Low().data()), T1);
+            e_.movdqu(X64Reg::RBX, offset(rsp_.vco_.High().data()), T1);
+            e_.movdqu(X64Reg::RBX, offset(rsp_.vce_.Lanes().data()), T1);
+        }
+
+        // VRCP, VRCPL, VRCPH, VRSQ, VRSQL. The accumulator and the lanes are handled here,
+        // the table lookups are shared with the interpreter
+        void emit_divide(VUInstruction instruction, uint32_t func)
+        {
+            uint8_t source = instruction.element & 0b111;
+            uint8_t destination = instruction.vs & 0b111;
+            int32_t div_in = offset(&rsp_.div_in_);
+            int32_t div_in_ready = offset(&rsp_.div_in_ready_);
+            int32_t div_out = offset(&rsp_.div_out_);
+
+            X64Xmm vt = read_vector(instruction.vt);
+            e_.pextrw(X64Reg::RSI, vt, source);
+            e_.movdqa(T0, vt);
+            broadcast(T0, instruction.element);
+            e_.movdqa(write_slice(Low), T0);
+
+            if (func == 50 || func == 54)
+            {
+                // VRCPH
+                e_.store16(X64Reg::RBX, div_in, X64Reg::RSI);
+                e_.store8_imm(X64Reg::RBX, div_in_ready, 1);
+                e_.movzx16(X64Reg::RCX, X64Reg::RBX, div_out);
+                e_.pinsrw(modify_vector(instruction.vd), X64Reg::RCX, destination);
+                return;
+            }
+
+            e_.movsx16(X64Reg::RDI, X64Reg::RSI);
+            if (func == 49 || func == 53)
+            {
+                // The low half of a double precision input from VRCPH
+                e_.cmp8_mem_imm(X64Reg::RBX, div_in_ready, 0);
+                X64Emitter::Label single = e_.jcc(X64Cond::E);
+                e_.movzx16(X64Reg::RDI, X64Reg::RBX, div_in);
+                e_.shl_imm(false, X64Reg::RDI, 16);
+                e_.or_(X64Reg::RDI, X64Reg::RSI);
+                e_.Bind(single);
+                e_.xor32(X64Reg::RCX, X64Reg::RCX);
+                e_.store16(X64Reg::RBX, div_in, X64Reg::RCX);
+                e_.store8_imm(X64Reg::RBX, div_in_ready, 0);
+            }
+
+            flush();
+            bool rsq_table = func >= 52;
+            e_.mov64_imm(X64Reg::RAX, rsq_table ? reinterpret_cast<uint64_t>(&rsq)
+                                                : reinterpret_cast<uint64_t>(&rcp));
+            e_.call(X64Reg::RAX);
+            e_.mov64(X64Reg::RCX, X64Reg::RAX);
+            e_.shr_imm(false, X64Reg::RCX, 16);
+            e_.store16(X64Reg::RBX, div_out, X64Reg::RCX);
+            e_.pinsrw(modify_vector(instruction.vd), X64Reg::RAX, destination);
+        }
+
+        bool emit_vector(Instruction instruction)
+        {
+            VUInstruction vu(instruction.full);
+            uint32_t func = instruction.FType.func;
+            switch (func)
+            {
+                case 0:
+                case 1:
+                case 4:
+                case 5:
+                case 6:
+                case 7:
+                case 8:
+                case 9:
+                case 12:
+                case 13:
+                case 14:
+                case 15:
+                    emit_multiply(vu, func);
+                    return true;
+                case 36:
+                    emit_vcl(vu);
+                    return true;
+                case 37:
+                    emit_vch(vu);
+                    return true;
+                case 38:
+                    emit_vcr(vu);
+                    return true;
+                case 48:
+                case 49:
+                case 50:
+                case 52:
+                case 53:
+                case 54:
+                    emit_divide(vu, func);
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        RSP& rsp_;
+        RspBlock& block_;
+        uint32_t pc_;
+        X64Emitter e_;
+        std::array<CachedVector, CACHED_VECTORS> vectors_{};
+        std::array<CachedSlice, 3> slices_{};
+        uint32_t use_counter_ = 0;
+    };
+
+    void RSP::compile_jit_block(RspBlock& block, uint32_t pc)
+    {
+        block.jit_compiled = true;
+        block.jit_code = nullptr;
+#if CPU_JIT_SUPPORTED
+        RSPRecompiler recompiler(*this, block, pc);
+        if (!recompiler.Compile())
+        {
+            return;
+        }
+
+        const std::vector<uint8_t>& code = recompiler.Code();
+        uint8_t* memory = jit_buffer_.Current();
+        memcpy(memory, code.data(), code.size());
+        jit_buffer_.Commit(code.size());
+        block.jit_code = reinterpret_cast<void (*)(RSP*)>(memory);
+#else
+        (void)pc;
+#endif
+    }
+} // namespace hydra::N64
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <core/n64_cpu.hxx>
+#include <cstdint>
+
+namespace hydra::N64
+{
+    // Code that reads RDRAM on behalf of the RSP wraps addresses around instead of checking them
+    constexpr uint32_t RDRAM_MASK = RDRAM_SIZE - 1;
+
+    // Big endian word from DMEM or RDRAM, each byte address wraps around with mask
+    inline uint32_t rsp_read_word(const uint8_t* memory, uint32_t address, uint32_t mask)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            value = (value << 8) | memory[(address + i) & mask];
+        }
+        return value;
+    }
+} // namespace hydra::N64
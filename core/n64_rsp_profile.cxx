@@ -0,0 +1,161 @@
+#include <array>
+#include <core/n64_rsp_audio.hxx>
+#include <core/n64_rsp_cache.hxx>
+#include <core/n64_rsp_gfx.hxx>
+#include <core/n64_rsp_memory.hxx>
+#include <core/n64_rsp_profile.hxx>
+
+namespace hydra::N64
+{
+    namespace
+    {
+        // The OS task header the boot microcode reads from the end of DMEM
+        constexpr uint16_t TASK_TYPE = 0xFC0;
+        constexpr uint16_t TASK_UCODE = 0xFD0;
+        constexpr uint16_t TASK_UCODE_DATA = 0xFD8;
+        constexpr uint16_t TASK_UCODE_DATA_SIZE = 0xFDC;
+
+        constexpr std::array<const char*, 6> TASK_TYPES = {
+            "", "Graphics", "Audio", "Video", "JPEG", "Null",
+        };
+    } // namespace
+
+    RspTaskStats& RspTaskStats::operator+=(const RspTaskStats& other)
+    {
+        instructions += other.instructions;
+        vector_instructions += other.vector_instructions;
+        dma_bytes_in += other.dma_bytes_in;
+        dma_bytes_out += other.dma_bytes_out;
+        cycles += other.cycles;
+        wall_time += other.wall_time;
+        return *this;
+    }
+
+    std::string name_rsp_task(const uint8_t* dmem, const uint8_t* rdram)
+    {
+        uint32_t type = rsp_read_word(dmem, TASK_TYPE, 0xFFF);
+        if (type == 0 || type >= TASK_TYPES.size())
+        {
+            return {};
+        }
+
+        uint32_t ucode_data = rsp_read_word(dmem, TASK_UCODE_DATA, 0xFFF) & RDRAM_MASK;
+        switch (type)
+        {
+            case 1:
+            {
+                uint32_t ucode_data_size = rsp_read_word(dmem, TASK_UCODE_DATA_SIZE, 0xFFF);
+                std::string name = graphics_ucode_name(rdram, ucode_data, ucode_data_size);
+                return name.empty() ? TASK_TYPES[type] : name;
+            }
+            case 2:
+            {
+                AudioUcode ucode = identify_audio_ucode(rdram, ucode_data);
+                return ucode == AudioUcode::Unknown ? TASK_TYPES[type] : audio_ucode_name(ucode);
+            }
+            default:
+                return TASK_TYPES[type];
+        }
+    }
+
+    void RspProfiler::SetEnabled(bool enabled)
+    {
+        enabled_ = enabled;
+        if (!enabled)
+        {
+            current_ = nullptr;
+            in_run_ = false;
+        }
+    }
+
+    void RspProfiler::Clear()
+    {
+        profiles_.clear();
+        current_ = nullptr;
+        in_run_ = false;
+    }
+
+    std::vector<RspUcodeProfile> RspProfiler::GetProfiles() const
+    {
+        std::vector<RspUcodeProfile> profiles;
+        profiles.reserve(profiles_.size());
+        for (const auto& [fingerprint, profile] : profiles_)
+        {
+            profiles.push_back(profile);
+        }
+        return profiles;
+    }
+
+    void RspProfiler::StartTask(const uint8_t* dmem, const uint8_t* imem, const uint8_t* rdram,
+                                uint32_t pc, uint64_t clock)
+    {
+        if (!enabled_)
+        {
+            return;
+        }
+
+        uint64_t fingerprint = rsp_hash_imem(imem);
+        // Tasks started through the OS all begin in the same boot microcode, which then loads
+        // the one named in the task header
+        std::string name = pc == 0 ? name_rsp_task(dmem, rdram) : std::string();
+        if (!name.empty())
+        {
+            std::array<uint8_t, RSP_IMEM_SIZE> text;
+            uint32_t ucode = rsp_read_word(dmem, TASK_UCODE, 0xFFF);
+            for (uint32_t i = 0; i < RSP_IMEM_SIZE; i++)
+            {
+                text[i] = rdram[(ucode + i) & RDRAM_MASK];
+            }
+            fingerprint = fingerprint * 31 + rsp_hash_imem(text.data());
+        }
+
+        auto [it, inserted] = profiles_.try_emplace(fingerprint);
+        if (inserted)
+        {
+            it->second.fingerprint = fingerprint;
+            it->second.name = name.empty() ? "Unknown" : std::move(name);
+        }
+        current_ = &it->second;
+        task_ = {};
+        hle_ = false;
+        start_clock_ = clock;
+    }
+
+    void RspProfiler::EndTask(uint64_t clock)
+    {
+        if (!current_)
+        {
+            return;
+        }
+
+        task_.cycles = clock - start_clock_;
+        current_->tasks++;
+        current_->hle_tasks += hle_;
+        current_->total += task_;
+        current_->last = task_;
+        current_ = nullptr;
+    }
+
+    void RspProfiler::MarkHle()
+    {
+        hle_ = true;
+    }
+
+    void RspProfiler::EnterRun()
+    {
+        if (current_)
+        {
+            run_start_ = std::chrono::steady_clock::now();
+            in_run_ = true;
+        }
+    }
+
+    void RspProfiler::LeaveRun()
+    {
+        if (in_run_)
+        {
+            task_.wall_time += std::chrono::steady_clock::now() - run_start_;
+            in_run_ = false;
+        }
+    }
+} // namespace hydra::N64
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hydra::N64
+{
+    struct RspTaskStats
+    {
+        uint64_t instructions = 0;
+        // Computational COP2 instructions, the ones issued to the vector unit. Everything else,
+        // vector loads and stores included, goes through the scalar unit
+        uint64_t vector_instructions = 0;
+        uint64_t dma_bytes_in = 0;
+        uint64_t dma_bytes_out = 0;
+        uint64_t cycles = 0;
+        // Host time spent running the task, on the RSP or natively
+        std::chrono::nanoseconds wall_time{};
+
+        RspTaskStats& operator+=(const RspTaskStats& other);
+    };
+
+    // Everything run with one microcode
+    struct RspUcodeProfile
+    {
+        // IMEM when the task started, combined with the text the boot microcode loads for
+        // tasks started through the OS
+        uint64_t fingerprint = 0;
+        std::string name;
+        uint64_t tasks = 0;
+        // Tasks that ran natively instead of on the RSP
+        uint64_t hle_tasks = 0;
+        RspTaskStats total;
+        RspTaskStats last;
+    };
+
+    // Identifies the microcode of a task from the OS task header in DMEM, or returns an empty
+    // string if it doesn't look like one
+    std::string name_rsp_task(const uint8_t* dmem, const uint8_t* rdram);
+
+    /**
+        Collects statistics on the tasks the RSP runs, grouped by microcode. A task lasts from
+        the halt bit being cleared to it being set again. Off by default, while it's disabled
+        the RSP skips counting vector instructions one at a time
+    */
+    class RspProfiler final
+    {
+    public:
+        void SetEnabled(bool enabled);
+        void Clear();
+        std::vector<RspUcodeProfile> GetProfiles() const;
+
+        // imem and dmem point at RSP memory, pc is where the task starts
+        void StartTask(const uint8_t* dmem, const uint8_t* imem, const uint8_t* rdram,
+                       uint32_t pc, uint64_t clock);
+        void EndTask(uint64_t clock);
+        void MarkHle();
+        // Bracket the host time spent on the task, EndTask has to come after LeaveRun
+        void EnterRun();
+        void LeaveRun();
+
+        bool IsRunning() const
+        {
+            return current_ != nullptr;
+        }
+
+        void Retire(uint64_t instructions, uint64_t vector_instructions)
+        {
+            task_.instructions += instructions;
+            task_.vector_instructions += vector_instructions;
+        }
+
+        void Dma(uint32_t bytes, bool to_rsp)
+        {
+            (to_rsp ? task_.dma_bytes_in : task_.dma_bytes_out) += bytes;
+        }
+
+    private:
+        std::unordered_map<uint64_t, RspUcodeProfile> profiles_;
+        RspUcodeProfile* current_ = nullptr;
+        RspTaskStats task_;
+        bool hle_ = false;
+        uint64_t start_clock_ = 0;
+        std::chrono::steady_clock::time_point run_start_;
+        bool in_run_ = false;
+        bool enabled_ = false;
+    };
+} // namespace hydra::N64
@@ -0,0 +1,68 @@
+#include <core/n64_rsp.hxx>
+#include <core/n64_rsp_thread.hxx>
+
+namespace hydra::N64
+{
+    RspThread::RspThread(RSP& rsp) : rsp_(rsp), thread_(&RspThread::run, this) {}
+
+    RspThread::~RspThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            quit_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    void RspThread::Start(uint64_t cycles)
+    {
+        if (cycles == 0)
+        {
+            return;
+        }
+
+        pending_ = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cycles_ = cycles;
+            busy_.store(true, std::memory_order_release);
+        }
+        cv_.notify_all();
+    }
+
+    uint64_t RspThread::Finish()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !busy_.load(std::memory_order_acquire); });
+        uint64_t executed = executed_;
+        executed_ = 0;
+        pending_ = false;
+        return executed;
+    }
+
+    void RspThread::run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            cv_.wait(lock, [this] { return quit_ || cycles_ != 0; });
+            if (quit_)
+            {
+                return;
+            }
+
+            uint64_t cycles = cycles_;
+            cycles_ = 0;
+            lock.unlock();
+            rsp_.on_worker_ = true;
+            uint64_t executed = rsp_.RunFor(cycles);
+            rsp_.on_worker_ = false;
+            lock.lock();
+
+            executed_ = executed;
+            busy_.store(false, std::memory_order_release);
+            cv_.notify_all();
+        }
+    }
+} // namespace hydra::N64
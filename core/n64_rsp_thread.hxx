@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace hydra::N64
+{
+    class RSP;
+
+    /**
+        Runs the RSP on a host thread of its own
+
+        The CPU thread hands the worker the cycles the RSP owes and keeps going. It only waits
+        for the worker where it could observe the RSP (see CPUBus::sync_rsp). Interrupts, RDP
+        register writes and block cache invalidations are left to the CPU thread, the RSP
+        stops after an instruction that raised an interrupt or wrote an RDP register and waits
+        until the CPU thread has collected the run and applied them. RDRAM is shared without
+        synchronization, like on the console
+    */
+    class RspThread final
+    {
+    public:
+        explicit RspThread(RSP& rsp);
+        ~RspThread();
+        RspThread(const RspThread&) = delete;
+        RspThread& operator=(const RspThread&) = delete;
+
+        // Only while the worker is idle and the last run has been collected
+        void Start(uint64_t cycles);
+
+        bool IsBusy() const
+        {
+            return busy_.load(std::memory_order_acquire);
+        }
+
+        // A run was started and hasn't been collected by Finish yet, only used by the CPU thread
+        bool IsPending() const
+        {
+            return pending_;
+        }
+
+        // Waits for the current run and returns the cycles it executed, 0 if there is none
+        uint64_t Finish();
+
+    private:
+        void run();
+
+        RSP& rsp_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        uint64_t cycles_ = 0;
+        uint64_t executed_ = 0;
+        std::atomic<bool> busy_ = false;
+        bool quit_ = false;
+        bool pending_ = false;
+        std::thread thread_;
+    };
+} // namespace hydra::N64
@@ -0,0 +1,810 @@
+#include <algorithm>
+#include <core/n64_rsp.hxx>
+#include <cstring>
+
+#if RSP_SIMD_SUPPORTED
+#include <smmintrin.h>
+
+// Only these functions use SSE4.1, the rest of the core keeps the baseline target and the
+// RSP checks for support at runtime before picking the SIMD table
+#define SIMD_TARGET __attribute__((target("sse4.1")))
+
+namespace hydra::N64
+{
+#define vuinstr (VUInstruction(instruction_.full))
+
+    namespace
+    {
+        // pshufb controls that broadcast the lanes of vt like the element field of an
+        // instruction does
+        constexpr std::array<std::array<uint8_t, 16>, 16> make_element_shuffles()
+        {
+            std::array<std::array<uint8_t, 16>, 16> shuffles{};
+            for (int element = 0; element < 16; element++)
+            {
+                for (int i = 0; i < 8; i++)
+                {
+                    int lane = i;
+                    if (element >= 8)
+                    {
+                        lane = element & 0b111;
+                    }
+                    else if (element >= 4)
+                    {
+                        lane = (i & ~0b11) | (element & 0b11);
+                    }
+                    else if (element >= 2)
+                    {
+                        lane = (i & ~0b1) | (element & 0b1);
+                    }
+                    shuffles[element][i * 2] = lane * 2;
+                    shuffles[element][i * 2 + 1] = lane * 2 + 1;
+                }
+            }
+            return shuffles;
+        }
+
+        alignas(16) constexpr std::array<std::array<uint8_t, 16>, 16> ELEMENT_SHUFFLES =
+            make_element_shuffles();
+
+        SIMD_TARGET inline __m128i load(const VectorRegister& reg)
+        {
+            return _mm_load_si128(reinterpret_cast<const __m128i*>(reg.data()));
+        }
+
+        SIMD_TARGET inline void store(VectorRegister& reg, __m128i value)
+        {
+            _mm_store_si128(reinterpret_cast<__m128i*>(reg.data()), value);
+        }
+
+        SIMD_TARGET inline __m128i broadcast(const VectorRegister& reg, int element)
+        {
+            __m128i shuffle = _mm_load_si128(
+                reinterpret_cast<const __m128i*>(ELEMENT_SHUFFLES[element].data()));
+            return _mm_shuffle_epi8(load(reg), shuffle);
+        }
+
+        SIMD_TARGET inline __m128i ones()
+        {
+            return _mm_set1_epi16(-1);
+        }
+
+        SIMD_TARGET inline __m128i bit_not(__m128i value)
+        {
+            return _mm_xor_si128(value, ones());
+        }
+
+        // Mask of the lanes where a + b carried out of 16 bits
+        SIMD_TARGET inline __m128i carry_out(__m128i a, __m128i sum)
+        {
+            return bit_not(_mm_cmpeq_epi16(_mm_min_epu16(sum, a), a));
+        }
+
+        // Adds a 48-bit value given as three slices to the accumulator, wrapping like
+        // AccumulatorLane::Add
+        SIMD_TARGET inline void accumulate(__m128i& high, __m128i& middle, __m128i& low,
+                                           __m128i add_high, __m128i add_middle,
+                                           __m128i add_low)
+        {
+            __m128i sum_low = _mm_add_epi16(low, add_low);
+            __m128i carry_low = carry_out(low, sum_low);
+            __m128i sum_middle = _mm_add_epi16(middle, add_middle);
+            __m128i carry_middle = carry_out(middle, sum_middle);
+            // The low carry only ripples into the high slice when the middle one is all ones
+            carry_middle = _mm_or_si128(
+                carry_middle, _mm_and_si128(carry_low, _mm_cmpeq_epi16(sum_middle, ones())));
+            low = sum_low;
+            middle = _mm_sub_epi16(sum_middle, carry_low);
+            high = _mm_sub_epi16(_mm_add_epi16(high, add_high), carry_middle);
+        }
+
+        // Signed 32-bit products of 16-bit lanes, as high and low halves
+        struct Product
+        {
+            __m128i high;
+            __m128i low;
+        };
+
+        SIMD_TARGET inline Product multiply_signed(__m128i vs, __m128i vt)
+        {
+            return {_mm_mulhi_epi16(vs, vt), _mm_mullo_epi16(vs, vt)};
+        }
+
+        // vs is signed and vt unsigned, pmulhw treats vt as signed so vs << 16 is added back
+        // where vt has the top bit set
+        SIMD_TARGET inline Product multiply_mixed(__m128i vs, __m128i vt)
+        {
+            __m128i high = _mm_mulhi_epi16(vs, vt);
+            high = _mm_add_epi16(high, _mm_and_si128(_mm_srai_epi16(vt, 15), vs));
+            return {high, _mm_mullo_epi16(vs, vt)};
+        }
+
+        // clamp_signed(accumulator >> 16)
+        SIMD_TARGET inline __m128i clamp_signed(__m128i high, __m128i middle)
+        {
+            return _mm_packs_epi32(_mm_unpacklo_epi16(middle, high),
+                                   _mm_unpackhi_epi16(middle, high));
+        }
+
+        // clamp_unsigned(accumulator >> 16)
+        SIMD_TARGET inline __m128i clamp_unsigned(__m128i high, __m128i middle)
+        {
+            // Saturates accumulator >> 31 to 16 bits, which is 0 when the value fits
+            __m128i top = _mm_packs_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(middle, high), 15),
+                                          _mm_srai_epi32(_mm_unpackhi_epi16(middle, high), 15));
+            __m128i fits = _mm_cmpeq_epi16(top, _mm_setzero_si128());
+            __m128i over = _mm_cmpgt_epi16(top, _mm_setzero_si128());
+            return _mm_or_si128(_mm_and_si128(fits, middle), over);
+        }
+
+        // The low slice when high is a sign extension of middle, otherwise 0 or 0xFFFF
+        // depending on the sign
+        SIMD_TARGET inline __m128i clamp_low(__m128i high, __m128i middle, __m128i low)
+        {
+            __m128i extension = _mm_cmpeq_epi16(high, _mm_srai_epi16(middle, 15));
+            __m128i clamped = bit_not(_mm_srai_epi16(high, 15));
+            return _mm_blendv_epi8(clamped, low, extension);
+        }
+
+        alignas(16) constexpr std::array<uint8_t, 16> BYTE_INDICES = {
+            0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        };
+
+        alignas(16) constexpr std::array<uint8_t, 16> BYTE_SWAP = {
+            1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+        };
+
+        SIMD_TARGET inline __m128i byte_indices()
+        {
+            return _mm_load_si128(reinterpret_cast<const __m128i*>(BYTE_INDICES.data()));
+        }
+
+        // Switches between the lane order of a register and the byte order loads and stores
+        // see it in, which matches DMEM
+        SIMD_TARGET inline __m128i swap_bytes(__m128i value)
+        {
+            return _mm_shuffle_epi8(
+                value, _mm_load_si128(reinterpret_cast<const __m128i*>(BYTE_SWAP.data())));
+        }
+
+        // Byte k of the result is byte (k + shift) & 15 of value
+        SIMD_TARGET inline __m128i rotate_bytes(__m128i value, int shift)
+        {
+            __m128i index = _mm_add_epi8(byte_indices(), _mm_set1_epi8(shift & 15));
+            return _mm_shuffle_epi8(value, _mm_and_si128(index, _mm_set1_epi8(15)));
+        }
+
+        // Bytes first to end - 1, empty if first is past the end
+        SIMD_TARGET inline __m128i byte_range(int first, int end)
+        {
+            __m128i index = byte_indices();
+            return _mm_and_si128(_mm_cmpgt_epi8(index, _mm_set1_epi8(first - 1)),
+                                 _mm_cmplt_epi8(index, _mm_set1_epi8(end)));
+        }
+
+        // Replaces count bytes of dest starting at first with the bytes of source starting at
+        // source_first, clipped to the end of dest like the loads are
+        SIMD_TARGET inline __m128i insert_bytes(__m128i dest, __m128i source, int first,
+                                                int count, int source_first)
+        {
+            return _mm_blendv_epi8(dest, rotate_bytes(source, source_first - first),
+                                   byte_range(first, std::min(first + count, 16)));
+        }
+
+        SIMD_TARGET inline __m128i load_memory(const uint8_t* memory, int size)
+        {
+            uint64_t value = 0;
+            memcpy(&value, memory, size);
+            return _mm_cvtsi64_si128(value);
+        }
+
+        SIMD_TARGET inline void store_memory(uint8_t* memory, __m128i value, int size)
+        {
+            uint64_t low = _mm_cvtsi128_si64(value);
+            memcpy(memory, &low, size);
+        }
+    } // namespace
+
+#define VU_OPERANDS                                                                                \
+    __m128i vs = load(get_vs());                                                                   \
+    __m128i vt = broadcast(get_vt(), vuinstr.element)
+
+#define VU_ACCUMULATOR                                                                             \
+    __m128i acc_high = load(accumulator_.high);                                                    \
+    __m128i acc_middle = load(accumulator_.middle);                                                \
+    __m128i acc_low = load(accumulator_.low)
+
+#define VU_STORE_ACCUMULATOR                                                                       \
+    store(accumulator_.high, acc_high);                                                            \
+    store(accumulator_.middle, acc_middle);                                                        \
+    store(accumulator_.low, acc_low)
+
+    SIMD_TARGET void RSP::VMULF_SIMD()
+    {
+        VU_OPERANDS;
+        Product product = multiply_signed(vs, vt);
+        __m128i acc_high = _mm_srai_epi16(product.high, 15);
+        __m128i acc_middle =
+            _mm_or_si128(_mm_slli_epi16(product.high, 1), _mm_srli_epi16(product.low, 15));
+        __m128i acc_low = _mm_slli_epi16(product.low, 1);
+        accumulate(acc_high, acc_middle, acc_low, _mm_setzero_si128(), _mm_setzero_si128(),
+                   _mm_set1_epi16(0x8000));
+        VU_STORE_ACCUMULATOR;
+        store(get_vd(), clamp_signed(acc_high, acc_middle));
+    }
+
+    SIMD_TARGET void RSP::VMULU_SIMD()
+    {
+        VU_OPERANDS;
+        Product product = multiply_signed(vs, vt);
+        __m128i acc_high = _mm_srai_epi16(product.high, 15);
+        __m128i acc_middle =
+            _mm_or_si128(_mm_slli_epi16(product.high, 1), _mm_srli_epi16(product.low, 15));
+        __m128i acc_low = _mm_slli_epi16(product.low, 1);
+        accumulate(acc_high, acc_middle, acc_low, _mm_setzero_si128(), _mm_setzero_si128(),
+                   _mm_set1_epi16(0x8000));
+        VU_STORE_ACCUMULATOR;
+        store(get_vd(), clamp_unsigned(acc_high, acc_middle));
+    }
+
+    SIMD_TARGET void RSP::VMUDL_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i acc_low = _mm_mulhi_epu16(vs, vt);
+        store(accumulator_.high, _mm_setzero_si128());
+        store(accumulator_.middle, _mm_setzero_si128());
+        store(accumulator_.low, acc_low);
+        store(get_vd(), acc_low);
+    }
+
+    SIMD_TARGET void RSP::VMUDM_SIMD()
+    {
+        VU_OPERANDS;
+        Product product = multiply_mixed(vs, vt);
+        store(accumulator_.high, _mm_srai_epi16(product.high, 15));
+        store(accumulator_.middle, product.high);
+        store(accumulator_.low, product.low);
+        store(get_vd(), product.high);
+    }
+
+    SIMD_TARGET void RSP::VMUDN_SIMD()
+    {
+        VU_OPERANDS;
+        Product product = multiply_mixed(vt, vs);
+        store(accumulator_.high, _mm_srai_epi16(product.high, 15));
+        store(accumulator_.middle, product.high);
+        store(accumulator_.low, product.low);
+        store(get_vd(), product.low);
+    }
+
+    SIMD_TARGET void RSP::VMUDH_SIMD()
+    {
+        VU_OPERANDS;
+        Product product = multiply_signed(vs, vt);
+        store(accumulator_.high, product.high);
+        store(accumulator_.middle, product.low);
+        store(accumulator_.low, _mm_setzero_si128());
+        store(get_vd(), clamp_signed(product.high, product.low));
+    }
+
+    SIMD_TARGET void RSP::VMACF_SIMD()
+    {
+        VU_OPERANDS;
+        VU_ACCUMULATOR;
+        Product product = multiply_signed(vs, vt);
+        accumulate(acc_high, acc_middle, acc_low, _mm_srai_epi16(product.high, 15),
+                   _mm_or_si128(_mm_slli_epi16(product.high, 1), _mm_srli_epi16(product.low, 15)),
+                   _mm_slli_epi16(product.low, 1));
+        VU_STORE_ACCUMULATOR;
+        store(get_vd(), clamp_signed(acc_high, acc_middle));
+    }
+
+    SIMD_TARGET void RSP::VMACU_SIMD()
+    {
+        VU_OPERANDS;
+        VU_ACCUMULATOR;
+        Product product = multiply_signed(vs, vt);
+        accumulate(acc_high, acc_middle, acc_low, _mm_srai_epi16(product.high, 15),
+                   _mm_or_si128(_mm_slli_epi16(product.high, 1), _mm_srli_epi16(product.low, 15)),
+                   _mm_slli_epi16(product.low, 1));
+        VU_STORE_ACCUMULATOR;
+        store(get_vd(), clamp_unsigned(acc_high, acc_middle));
+    }
+
+    SIMD_TARGET void RSP::VMADL_SIMD()
+    {
+        VU_OPERANDS;
+        VU_ACCUMULATOR;
+        accumulate(acc_high, acc_middle, acc_low, _mm_setzero_si128(), _mm_setzero_si128(),
+                   _mm_mulhi_epu16(vs, vt));
+        VU_STORE_ACCUMULATOR;
+        store(get_vd(), clamp_low(acc_high, acc_middle, acc_low));
+    }
+
+    SIMD_TARGET void RSP::VMADM_SIMD()
+    {
+        VU_OPERANDS;
+        VU_ACCUMULATOR;
+        Product product = multiply_mixed(vs, vt);
+        accumulate(acc_high, acc_middle, acc_low, _mm_srai_epi16(product.high, 15),
+                   product.high, product.low);
+        VU_STORE_ACCUMULATOR;
+        store(get_vd(), clamp_signed(acc_high, acc_middle));
+    }
+
+    SIMD_TARGET void RSP::VMADN_SIMD()
+    {
+        VU_OPERANDS;
+        VU_ACCUMULATOR;
+        Product product = multiply_mixed(vt, vs);
+        accumulate(acc_high, acc_middle, acc_low, _mm_srai_epi16(product.high, 15),
+                   product.high, product.low);
+        VU_STORE_ACCUMULATOR;
+        store(get_vd(), clamp_low(acc_high, acc_middle, acc_low));
+    }
+
+    SIMD_TARGET void RSP::VMADH_SIMD()
+    {
+        VU_OPERANDS;
+        VU_ACCUMULATOR;
+        Product product = multiply_signed(vs, vt);
+        accumulate(acc_high, acc_middle, acc_low, product.high, product.low,
+                   _mm_setzero_si128());
+        VU_STORE_ACCUMULATOR;
+        store(get_vd(), clamp_signed(acc_high, acc_middle));
+    }
+
+    SIMD_TARGET void RSP::VADD_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i carry = load(vco_.Low());
+        // Adding the carry to the smaller operand first keeps the saturated sum exact
+        __m128i min = _mm_subs_epi16(_mm_min_epi16(vs, vt), carry);
+        __m128i max = _mm_max_epi16(vs, vt);
+        store(accumulator_.low, _mm_sub_epi16(_mm_add_epi16(vs, vt), carry));
+        store(get_vd(), _mm_adds_epi16(min, max));
+        vco_.Clear();
+    }
+
+    SIMD_TARGET void RSP::VADDC_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i sum = _mm_add_epi16(vs, vt);
+        store(accumulator_.low, sum);
+        store(vco_.Low(), carry_out(vs, sum));
+        store(vco_.High(), _mm_setzero_si128());
+        store(get_vd(), sum);
+    }
+
+    SIMD_TARGET void RSP::VSUB_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i carry = load(vco_.Low());
+        // vt plus the carry, both wrapped and saturated, the difference fixes up the one
+        // case where the saturated subtraction would be off by one
+        __m128i wrapped = _mm_sub_epi16(vt, carry);
+        __m128i saturated = _mm_subs_epi16(vt, carry);
+        __m128i overflow = _mm_cmpgt_epi16(saturated, wrapped);
+        store(accumulator_.low, _mm_sub_epi16(vs, wrapped));
+        store(get_vd(), _mm_adds_epi16(_mm_subs_epi16(vs, saturated), overflow));
+        vco_.Clear();
+    }
+
+    SIMD_TARGET void RSP::VSUBC_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i difference = _mm_sub_epi16(vs, vt);
+        __m128i borrow = bit_not(_mm_cmpeq_epi16(_mm_max_epu16(vs, vt), vs));
+        store(accumulator_.low, difference);
+        store(vco_.Low(), borrow);
+        store(vco_.High(), bit_not(_mm_cmpeq_epi16(vs, vt)));
+        store(get_vd(), difference);
+    }
+
+    SIMD_TARGET void RSP::VABS_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i result = _mm_sign_epi16(vt, vs);
+        // -0x8000 wraps in the accumulator but clamps to 0x7FFF in vd
+        __m128i edge_case = _mm_and_si128(_mm_srai_epi16(vs, 15),
+                                          _mm_cmpeq_epi16(vt, _mm_set1_epi16(0x8000)));
+        store(accumulator_.low, result);
+        store(get_vd(), _mm_xor_si128(result, edge_case));
+    }
+
+    SIMD_TARGET void RSP::VZERO_SIMD()
+    {
+        VU_OPERANDS;
+        store(accumulator_.low, _mm_add_epi16(vs, vt));
+        store(get_vd(), _mm_setzero_si128());
+    }
+
+    SIMD_TARGET void RSP::VSAR_SIMD()
+    {
+        __m128i result;
+        switch (vuinstr.element)
+        {
+            case 0x8:
+                result = load(accumulator_.high);
+                break;
+            case 0x9:
+                result = load(accumulator_.middle);
+                break;
+            case 0xA:
+                result = load(accumulator_.low);
+                break;
+            default:
+                result = _mm_setzero_si128();
+                break;
+        }
+        store(get_vd(), result);
+    }
+
+    SIMD_TARGET void RSP::VAND_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i result = _mm_and_si128(vs, vt);
+        store(accumulator_.low, result);
+        store(get_vd(), result);
+    }
+
+    SIMD_TARGET void RSP::VNAND_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i result = bit_not(_mm_and_si128(vs, vt));
+        store(accumulator_.low, result);
+        store(get_vd(), result);
+    }
+
+    SIMD_TARGET void RSP::VOR_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i result = _mm_or_si128(vs, vt);
+        store(accumulator_.low, result);
+        store(get_vd(), result);
+    }
+
+    SIMD_TARGET void RSP::VNOR_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i result = bit_not(_mm_or_si128(vs, vt));
+        store(accumulator_.low, result);
+        store(get_vd(), result);
+    }
+
+    SIMD_TARGET void RSP::VXOR_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i result = _mm_xor_si128(vs, vt);
+        store(accumulator_.low, result);
+        store(get_vd(), result);
+    }
+
+    SIMD_TARGET void RSP::VNXOR_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i result = bit_not(_mm_xor_si128(vs, vt));
+        store(accumulator_.low, result);
+        store(get_vd(), result);
+    }
+
+    SIMD_TARGET void RSP::VLT_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i equal = _mm_and_si128(_mm_cmpeq_epi16(vs, vt),
+                                      _mm_and_si128(load(vco_.Low()), load(vco_.High())));
+        __m128i test = _mm_or_si128(equal, _mm_cmplt_epi16(vs, vt));
+        __m128i result = _mm_blendv_epi8(vt, vs, test);
+        store(accumulator_.low, result);
+        store(vcc_.Low(), test);
+        store(vcc_.High(), _mm_setzero_si128());
+        store(get_vd(), result);
+        vco_.Clear();
+    }
+
+    SIMD_TARGET void RSP::VEQ_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i test = _mm_andnot_si128(load(vco_.High()), _mm_cmpeq_epi16(vs, vt));
+        __m128i result = _mm_blendv_epi8(vt, vs, test);
+        store(accumulator_.low, result);
+        store(vcc_.Low(), test);
+        store(vcc_.High(), _mm_setzero_si128());
+        store(get_vd(), result);
+        vco_.Clear();
+    }
+
+    SIMD_TARGET void RSP::VNE_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i test = _mm_or_si128(load(vco_.High()), bit_not(_mm_cmpeq_epi16(vs, vt)));
+        __m128i result = _mm_blendv_epi8(vt, vs, test);
+        store(accumulator_.low, result);
+        store(vcc_.Low(), test);
+        store(vcc_.High(), _mm_setzero_si128());
+        store(get_vd(), result);
+        vco_.Clear();
+    }
+
+    SIMD_TARGET void RSP::VGE_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i carry = _mm_and_si128(load(vco_.Low()), load(vco_.High()));
+        __m128i equal = _mm_andnot_si128(carry, _mm_cmpeq_epi16(vs, vt));
+        __m128i test = _mm_or_si128(equal, _mm_cmpgt_epi16(vs, vt));
+        __m128i result = _mm_blendv_epi8(vt, vs, test);
+        store(accumulator_.low, result);
+        store(vcc_.Low(), test);
+        store(vcc_.High(), _mm_setzero_si128());
+        store(get_vd(), result);
+        vco_.Clear();
+    }
+
+    SIMD_TARGET void RSP::VMRG_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i result = _mm_blendv_epi8(vt, vs, load(vcc_.Low()));
+        store(accumulator_.low, result);
+        store(get_vd(), result);
+        vco_.Clear();
+    }
+
+    SIMD_TARGET void RSP::VCH_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i sign = _mm_srai_epi16(_mm_xor_si128(vs, vt), 15);
+        __m128i vt_negative = _mm_srai_epi16(vt, 15);
+        __m128i sum = _mm_add_epi16(vs, vt);
+        __m128i difference = _mm_sub_epi16(vs, vt);
+        __m128i sum_le_zero = _mm_cmplt_epi16(sum, _mm_set1_epi16(1));
+        __m128i difference_ge_zero = bit_not(_mm_srai_epi16(difference, 15));
+
+        __m128i result = _mm_blendv_epi8(_mm_blendv_epi8(vs, vt, difference_ge_zero),
+                                         _mm_blendv_epi8(vs, _mm_sub_epi16(_mm_setzero_si128(), vt),
+                                                         sum_le_zero),
+                                         sign);
+        __m128i zero = _mm_cmpeq_epi16(_mm_blendv_epi8(difference, sum, sign), _mm_setzero_si128());
+        __m128i vs_is_inverse = _mm_cmpeq_epi16(vs, bit_not(vt));
+
+        store(accumulator_.low, result);
+        store(vcc_.Low(), _mm_blendv_epi8(vt_negative, sum_le_zero, sign));
+        store(vcc_.High(), _mm_blendv_epi8(difference_ge_zero, vt_negative, sign));
+        store(vco_.Low(), sign);
+        store(vco_.High(), bit_not(_mm_or_si128(zero, vs_is_inverse)));
+        store(vce_.Lanes(), _mm_and_si128(sign, _mm_cmpeq_epi16(sum, ones())));
+        store(get_vd(), result);
+    }
+
+    SIMD_TARGET void RSP::VCR_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i sign = _mm_srai_epi16(_mm_xor_si128(vs, vt), 15);
+        __m128i vt_negative = _mm_srai_epi16(vt, 15);
+        __m128i gte = _mm_blendv_epi8(bit_not(_mm_cmpgt_epi16(vt, vs)), vt_negative, sign);
+        __m128i lte =
+            _mm_blendv_epi8(vt_negative, _mm_srai_epi16(_mm_add_epi16(vs, vt), 15), sign);
+        __m128i check = _mm_blendv_epi8(gte, lte, sign);
+        __m128i result = _mm_blendv_epi8(vs, _mm_xor_si128(vt, sign), check);
+
+        store(accumulator_.low, result);
+        store(vcc_.Low(), lte);
+        store(vcc_.High(), gte);
+        store(get_vd(), result);
+        vco_.Clear();
+        vce_.Clear();
+    }
+
+    SIMD_TARGET void RSP::VCL_SIMD()
+    {
+        VU_OPERANDS;
+        __m128i vco_low = load(vco_.Low());
+        __m128i vco_high = load(vco_.High());
+        __m128i vce = load(vce_.Lanes());
+        __m128i vcc_low = load(vcc_.Low());
+        __m128i vcc_high = load(vcc_.High());
+
+        __m128i sum = _mm_add_epi16(vs, vt);
+        __m128i no_carry = _mm_cmpeq_epi16(_mm_min_epu16(sum, vs), vs);
+        __m128i zero = _mm_cmpeq_epi16(sum, _mm_setzero_si128());
+        __m128i lte = _mm_blendv_epi8(_mm_and_si128(zero, no_carry),
+                                      _mm_or_si128(zero, no_carry), vce);
+        __m128i gte = _mm_cmpeq_epi16(_mm_max_epu16(vs, vt), vs);
+
+        // Each flag is only updated in the lanes where VCO says the comparison is needed
+        vcc_low = _mm_blendv_epi8(vcc_low, lte, _mm_andnot_si128(vco_high, vco_low));
+        vcc_high = _mm_blendv_epi8(gte, vcc_high, _mm_or_si128(vco_low, vco_high));
+        __m128i result =
+            _mm_blendv_epi8(_mm_blendv_epi8(vs, vt, vcc_high),
+                            _mm_blendv_epi8(vs, _mm_sub_epi16(_mm_setzero_si128(), vt), vcc_low),
+                            vco_low);
+
+        store(accumulator_.low, result);
+        store(vcc_.Low(), vcc_low);
+        store(vcc_.High(), vcc_high);
+        store(get_vd(), result);
+        vco_.Clear();
+        vce_.Clear();
+    }
+
+    // The vector loads and stores, in DMEM byte order. Returns false for the accesses that wrap
+    // around the end of DMEM, those are left to the scalar versions
+    SIMD_TARGET bool RSP::LWC2_SIMD()
+    {
+        int reg = instruction_.WCType.vt;
+        int element = instruction_.WCType.element;
+        uint32_t opcode = instruction_.WCType.opcode;
+        // The offset is scaled by the access size, 16 bytes for LQV, LRV and LTV
+        int shift = opcode < 4 ? opcode : (opcode == 6 || opcode == 7 ? 3 : 4);
+        uint32_t address = (gpr_regs_[instruction_.WCType.base].UW +
+                            (static_cast<int8_t>(instruction_.WCType.offset << 1) >> 1 << shift)) &
+                           0xFFF;
+        uint32_t line = address & 0xFF0;
+        int offset = address & 0xF;
+        __m128i vt = swap_bytes(load(vu_regs_[reg]));
+
+        switch (opcode)
+        {
+            // LBV, LSV, LLV, LDV
+            case 0x0:
+            case 0x1:
+            case 0x2:
+            case 0x3:
+            {
+                int size = 1 << opcode;
+                if (address + size > 0x1000)
+                {
+                    return false;
+                }
+                vt = insert_bytes(vt, load_memory(&mem_[address], size), element, size, 0);
+                break;
+            }
+            // LQV, LRV, these stay within one 16 byte line
+            case 0x4:
+            case 0x5:
+            {
+                __m128i memory = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&mem_[line]));
+                if (opcode == 0x4)
+                {
+                    vt = insert_bytes(vt, memory, element, 16 - offset, offset);
+                }
+                else
+                {
+                    vt = insert_bytes(vt, memory, element + 16 - offset, offset, 0);
+                }
+                break;
+            }
+            // LPV, LUV, a byte into the top of each lane
+            case 0x6:
+            case 0x7:
+            {
+                if (address + 8 > 0x1000)
+                {
+                    return false;
+                }
+                __m128i lanes = _mm_cvtepu8_epi16(load_memory(&mem_[address], 8));
+                lanes = opcode == 0x6 ? _mm_slli_epi16(lanes, 8) : _mm_slli_epi16(lanes, 7);
+                vt = insert_bytes(vt, swap_bytes(lanes), element, 16 - element, 0);
+                break;
+            }
+            // LTV, one lane into each of a group of 8 registers
+            case 0xB:
+            {
+                uint32_t base = address & ~7;
+                if (base + 16 > 0x1000)
+                {
+                    return false;
+                }
+                int start = (base + (((address & 8) + element) & 15)) & 15;
+                __m128i memory = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&mem_[base]));
+                alignas(16) VectorRegister lanes;
+                store(lanes, swap_bytes(rotate_bytes(memory, start)));
+                int group = reg & ~7;
+                for (int i = 0; i < 8; i++)
+                {
+                    vu_regs_[group + (((element >> 1) + i) & 7)][i] = lanes[i];
+                }
+                return true;
+            }
+            default:
+                return false;
+        }
+
+        store(vu_regs_[reg], swap_bytes(vt));
+        return true;
+    }
+
+    SIMD_TARGET bool RSP::SWC2_SIMD()
+    {
+        int reg = instruction_.WCType.vt;
+        int element = instruction_.WCType.element;
+        uint32_t opcode = instruction_.WCType.opcode;
+        int shift = opcode < 4 ? opcode : (opcode == 6 || opcode == 7 ? 3 : 4);
+        uint32_t address = (gpr_regs_[instruction_.WCType.base].UW +
+                            (static_cast<int8_t>(instruction_.WCType.offset << 1) >> 1 << shift)) &
+                           0xFFF;
+        uint32_t line = address & 0xFF0;
+        int offset = address & 0xF;
+
+        switch (opcode)
+        {
+            // SBV, SSV, SLV, SDV
+            case 0x0:
+            case 0x1:
+            case 0x2:
+            case 0x3:
+            {
+                int size = 1 << opcode;
+                if (address + size > 0x1000)
+                {
+                    return false;
+                }
+                __m128i vt = swap_bytes(load(vu_regs_[reg]));
+                store_memory(&mem_[address], rotate_bytes(vt, element), size);
+                return true;
+            }
+            // SQV, SRV
+            case 0x4:
+            case 0x5:
+            {
+                __m128i vt = swap_bytes(load(vu_regs_[reg]));
+                __m128i* memory = reinterpret_cast<__m128i*>(&mem_[line]);
+                __m128i value = _mm_loadu_si128(memory);
+                if (opcode == 0x4)
+                {
+                    value = _mm_blendv_epi8(value, rotate_bytes(vt, element - offset),
+                                            byte_range(offset, 16));
+                }
+                else
+                {
+                    value = _mm_blendv_epi8(value, rotate_bytes(vt, element + 16 - offset),
+                                            byte_range(0, offset));
+                }
+                _mm_storeu_si128(memory, value);
+                return true;
+            }
+            // SPV, SUV, the top of each lane shifted by 8 or 7 depending on the element
+            case 0x6:
+            case 0x7:
+            {
+                if (address + 8 > 0x1000)
+                {
+                    return false;
+                }
+                __m128i lanes = rotate_bytes(load(vu_regs_[reg]), element * 2);
+                __m128i index = _mm_add_epi16(
+                    _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7), _mm_set1_epi16(element));
+                __m128i low_half = _mm_cmplt_epi16(_mm_and_si128(index, _mm_set1_epi16(15)),
+                                                   _mm_set1_epi16(8));
+                __m128i by_8 = _mm_srli_epi16(lanes, 8);
+                __m128i by_7 = _mm_and_si128(_mm_srli_epi16(lanes, 7), _mm_set1_epi16(0xFF));
+                __m128i bytes = opcode == 0x6 ? _mm_blendv_epi8(by_7, by_8, low_half)
+                                              : _mm_blendv_epi8(by_8, by_7, low_half);
+                store_memory(&mem_[address], _mm_packus_epi16(bytes, bytes), 8);
+                return true;
+            }
+            // STV, one lane of each of a group of 8 registers
+            case 0xB:
+            {
+                uint32_t base = address & ~7;
+                if (base + 16 > 0x1000)
+                {
+                    return false;
+                }
+                int group = reg & ~7;
+                int first = (16 - (element & ~1)) >> 1;
+                alignas(16) VectorRegister lanes;
+                for (int i = 0; i < 8; i++)
+                {
+                    lanes[i] = vu_regs_[group + i][(first + i) & 7];
+                }
+                int start = ((address & 7) - (element & ~1)) & 15;
+                __m128i value = rotate_bytes(swap_bytes(load(lanes)), -start);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&mem_[base]), value);
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+} // namespace hydra::N64
+#endif
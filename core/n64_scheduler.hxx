@@ -1,15 +1,127 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <queue>
+#include <vector>
 
-enum class TaskType {
-    
-};
+namespace hydra::N64
+{
+    enum class TaskType
+    {
+        Halfline,
+        AiSample,
+        Compare,
+        PiDma,
+        SiDma,
+        RspSlice,
+        RdpSync,
+        Count,
+    };
 
-struct Task {
+    struct Task
+    {
+        uint64_t time;
+        // Tasks due at the same time run in the order they were scheduled in
+        uint64_t sequence;
+        TaskType type;
+        uint32_t generation;
 
-};
+        bool operator>(const Task& other) const
+        {
+            return time > other.time || (time == other.time && sequence > other.sequence);
+        }
+    };
 
-class Scheduler : private std::priority_queue<Task> {
+    // Cycle timestamped tasks, at most one pending per type. Rescheduling or cancelling a type
+    // bumps its generation, and the stale entry is dropped once it reaches the top of the queue
+    class Scheduler : private std::priority_queue<Task, std::vector<Task>, std::greater<Task>>
+    {
+    public:
+        void Reset()
+        {
+            c.clear();
+            now_ = 0;
+            next_time_ = std::numeric_limits<uint64_t>::max();
+            sequence_ = 0;
+            generations_.fill(0);
+            pending_.fill(false);
+        }
 
-};
\ No newline at end of file
+        uint64_t Now() const
+        {
+            return now_;
+        }
+
+        uint64_t NextTime() const
+        {
+            return next_time_;
+        }
+
+        // How far the emulated components can run before the scheduler has to be serviced
+        uint64_t CyclesUntilNextTask() const
+        {
+            return next_time_ > now_ ? next_time_ - now_ : 0;
+        }
+
+        void Advance(uint64_t cycles)
+        {
+            now_ += cycles;
+        }
+
+        bool IsPending(TaskType type) const
+        {
+            return pending_[static_cast<size_t>(type)];
+        }
+
+        void Schedule(TaskType type, uint64_t delay)
+        {
+            size_t index = static_cast<size_t>(type);
+            generations_[index]++;
+            pending_[index] = true;
+            push({now_ + delay, sequence_++, type, generations_[index]});
+            update_next_time();
+        }
+
+        void Cancel(TaskType type)
+        {
+            size_t index = static_cast<size_t>(type);
+            generations_[index]++;
+            pending_[index] = false;
+            update_next_time();
+        }
+
+        // Removes the next task that is due, returns false if there is none
+        bool PopDue(TaskType& type)
+        {
+            if (next_time_ > now_)
+            {
+                return false;
+            }
+            type = top().type;
+            pending_[static_cast<size_t>(type)] = false;
+            pop();
+            update_next_time();
+            return true;
+        }
+
+    private:
+        void update_next_time()
+        {
+            while (!empty() &&
+                   top().generation != generations_[static_cast<size_t>(top().type)])
+            {
+                pop();
+            }
+            next_time_ = empty() ? std::numeric_limits<uint64_t>::max() : top().time;
+        }
+
+        uint64_t now_ = 0;
+        uint64_t next_time_ = std::numeric_limits<uint64_t>::max();
+        uint64_t sequence_ = 0;
+        std::array<uint32_t, static_cast<size_t>(TaskType::Count)> generations_{};
+        std::array<bool, static_cast<size_t>(TaskType::Count)> pending_{};
+    };
+} // namespace hydra::N64
@@ -266,161 +266,6 @@ namespace hydra::N64
     };
 
     static_assert(sizeof(VUInstruction) == 4, "VUInstruction is not 4 bytes");
-    const static std::array<std::string, 64> OperationCodes = {
-        "nop",   "regimm", "j",     "jal",   "beq",   "bne",    "blez", "bgtz",  "addi",  "addiu",
-        "slti",  "stliu",  "andi",  "ori",   "xori",  "lui",    "cop0", "cop1",  "cop2",  "23err",
-        "beql",  "bnel",   "blezl", "bgtzl", "daddi", "daddiu", "ldl",  "ldr",   "34err", "35err",
-        "36err", "37err",  "lb",    "lh",    "lwl",   "lw",     "lbu",  "lhu",   "lwr",   "lwu",
-        "sb",    "sh",     "swl",   "sw",    "sdl",   "sdr",    "swr",  "cache", "ll",    "lwc1",
-        "lwc2",  "63err",  "lld",   "ldc1",  "ldc2",  "ld",     "sc",   "swc1",  "swc2",  "73err",
-        "scd",   "sdc1",   "sdc2",  "sd",
-    };
-    const static std::array<std::string, 64> SpecialCodes = {
-        "sll",    "s2err",  "srl",    "sra",    "sllv",    "s5err",  "srlv",   "srav",
-        "jr",     "jalr",   "s12err", "s13err", "syscall", "break",  "s16err", "sync",
-        "mfhi",   "mthi",   "mflo",   "mtlo",   "dsllv",   "s25err", "dsrlv",  "dsrav",
-        "mult",   "multu",  "div",    "divu",   "dmult",   "dmultu", "ddiv",   "ddivu",
-        "add",    "addu",   "sub",    "subu",   "and",     "or",     "xor",    "nor",
-        "s50err", "s51err", "slt",    "sltu",   "dadd",    "daddu",  "dsub",   "dsubu",
-        "tge",    "tgeu",   "tlt",    "tltu",   "teq",     "s65err", "tne",    "s67err",
-        "dsll",   "s71err", "dsrl",   "dsra",   "dsll32",  "s75err", "dsrl32", "dsra32",
-    };
-    enum class InstructionType
-    {
-        SPECIAL,
-        REGIMM,
-        J,
-        JAL,
-        BEQ,
-        BNE,
-        BLEZ,
-        BGTZ,
-        ADDI,
-        ADDIU,
-        SLTI,
-        STLIU,
-        ANDI,
-        ORI,
-        XORI,
-        LUI,
-        COP0,
-        COP1,
-        COP2,
-        _23ERR,
-        BEQL,
-        BNEL,
-        BLEZL,
-        BGTZL,
-        DADDI,
-        DADDIU,
-        LDL,
-        LDR,
-        _34ERR,
-        _35ERR,
-        _36ERR,
-        _37ERR,
-        LB,
-        LH,
-        LWL,
-        LW,
-        LBU,
-        LHU,
-        LWR,
-        LWU,
-        SB,
-        SH,
-        SWL,
-        SW,
-        SDL,
-        SDR,
-        SWR,
-        CACHE,
-        LL,
-        LWC1,
-        LWC2,
-        _63ERR,
-        LLD,
-        LDC1,
-        LDC2,
-        LD,
-        SC,
-        SWC1,
-        SWC2,
-        _73ERR,
-        SCD,
-        SDC1,
-        SDC2,
-        SD,
-
-        s_SLL,
-        _S2ERR,
-        s_SRL,
-        s_SRA,
-        s_SLLV,
-        _S5ERR,
-        s_SRLV,
-        s_SRAV,
-        s_JR,
-        s_JALR,
-        _S12ERR,
-        _S13ERR,
-        s_SYSCALL,
-        s_BREAK,
-        _S16ERR,
-        s_SYNC,
-        s_MFHI,
-        s_MTHI,
-        s_MFLO,
-        s_MTLO,
-        s_DSLLV,
-        _S25ERR,
-        s_DSRLV,
-        s_DSRAV,
-        s_MULT,
-        s_MULTU,
-        s_DIV,
-        s_DIVU,
-        s_DMULT,
-        s_DMULTU,
-        s_DDIV,
-        s_DDIVU,
-        s_ADD,
-        s_ADDU,
-        s_SUB,
-        s_SUBU,
-        s_AND,
-        s_OR,
-        s_XOR,
-        s_NOR,
-        _S50ERR,
-        _S51ERR,
-        s_SLT,
-        s_SLTU,
-        s_DADD,
-        s_DADDU,
-        s_DSUB,
-        s_DSUBU,
-        s_TGE,
-        s_TGEU,
-        s_TLT,
-        s_TLTU,
-        s_TEQ,
-        _S65ERR,
-        s_TNE,
-        _S67ERR,
-        s_DSLL,
-        _S71ERR,
-        s_DSRL,
-        s_DSRA,
-        s_DSLL32,
-        _S75ERR,
-        s_DSRL32,
-        s_DSRA32,
-
-        NOP,
-        ERROR_INSTRUCTION
-    };
-
     [[maybe_unused]] static std::string gpr_get_name(int n, bool register_names)
     {
         if (register_names)
@@ -1,6 +1,7 @@
 #include <compatibility.hxx>
 #include <core/n64_log.hxx>
 #include <core/n64_addresses.hxx>
+#include <core/n64_mmio.hxx>
 #include <core/n64_types.hxx>
 #include <core/n64_vi.hxx>
 
@@ -11,6 +12,13 @@ namespace hydra::N64
         vi_v_intr_ = 0x100;
     }
 
+    uint32_t Vi::GetFramebufferSize() const
+    {
+        uint32_t height = (vi_v_end_ - vi_v_start_) / 2;
+        height = (height * (vi_y_scale_ ? vi_y_scale_ : 512)) >> 10;
+        return height * vi_width_ * (pixel_mode_ == 0b11 ? 4 : 2);
+    }
+
     void Vi::Redraw(std::vector<uint8_t>& data)
     {
         auto new_width = vi_h_end_ - vi_h_start_;
@@ -207,6 +215,14 @@ namespace hydra::N64
         }
     }
 
+    void Vi::MapRegisters(MmioMap& mmio)
+    {
+        mmio.MapRead(VI_AREA_START, VI_AREA_END,
+                     [this](uint32_t addr) { return ReadWord(addr); });
+        mmio.MapWrite(VI_AREA_START, VI_AREA_END,
+                      [this](uint32_t addr, uint32_t data) { WriteWord(addr, data); });
+    }
+
     void Vi::InstallBuses(uint8_t* rdram_ptr)
     {
         rdram_ptr_ = rdram_ptr;
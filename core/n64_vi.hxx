@@ -10,13 +10,17 @@ namespace hydra::N64
     class RCP;
     class CPU;
     class CPUBus;
+    class MmioMap;
 
     struct Vi
     {
         void Reset();
         void Redraw(std::vector<uint8_t>& data);
+        // Bytes of RDRAM the next Redraw reads from the origin on
+        uint32_t GetFramebufferSize() const;
         uint32_t ReadWord(uint32_t addr);
         void WriteWord(uint32_t addr, uint32_t data);
+        void MapRegisters(MmioMap& mmio);
         void InstallBuses(uint8_t* rdram_ptr);
         void SetInterruptCallback(std::function<void(bool)> callback);
 